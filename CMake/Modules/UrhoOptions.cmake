@@ -135,13 +135,16 @@ _option(URHO3D_SSL                "Enable OpenSSL support"
 
 if (WIN32)
     set(URHO3D_GRAPHICS_API D3D11 CACHE STRING "Graphics API")
-    set_property(CACHE URHO3D_GRAPHICS_API PROPERTY STRINGS D3D9 D3D11 OpenGL)
+    set_property(CACHE URHO3D_GRAPHICS_API PROPERTY STRINGS D3D9 D3D11 OpenGL Null)
     _option(URHO3D_WIN32_CONSOLE "Show log messages in win32 console"                     OFF)
 elseif (IOS OR ANDROID)
     set(URHO3D_GRAPHICS_API GLES2 CACHE STRING "Graphics API")
     set_property(CACHE URHO3D_GRAPHICS_API PROPERTY STRINGS GLES2 GLES3)
-else ()
+elseif (WEB)
     set(URHO3D_GRAPHICS_API OpenGL)
+else ()
+    set(URHO3D_GRAPHICS_API OpenGL CACHE STRING "Graphics API")
+    set_property(CACHE URHO3D_GRAPHICS_API PROPERTY STRINGS OpenGL Null)
 endif ()
 string(TOUPPER "${URHO3D_GRAPHICS_API}" URHO3D_GRAPHICS_API)
 set (URHO3D_${URHO3D_GRAPHICS_API} ON)
@@ -166,6 +169,11 @@ elseif (URHO3D_TOOLS AND NOT MINI_URHO)
     set (URHO3D_HASH_DEBUG ON)
 endif ()
 
+if (URHO3D_NULL)
+    # Null backend renders nothing, SystemUI has no renderer implementation for it.
+    set (URHO3D_SYSTEMUI OFF)
+endif ()
+
 if (WEB AND URHO3D_CSHARP)
     message(WARNING "C# is not supported in this configuration.")
     set (URHO3D_CSHARP OFF)
@@ -0,0 +1,229 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/Graphics/LightClusters.h>
+#include <Urho3D/Math/Random.h>
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include <Urho3D/DebugNew.h>
+
+using namespace Urho3D;
+
+namespace
+{
+
+/// Default number of lights.
+const unsigned DEFAULT_NUM_LIGHTS = 500;
+/// Number of worker threads used for the threaded assignment.
+const unsigned NUM_WORKER_THREADS = 3;
+/// Number of random points checked against the cluster boxes.
+const unsigned NUM_POINTS = 10000;
+/// Small per-cluster light limit, so that many clusters are truncated.
+const unsigned SMALL_MAX_LIGHTS_PER_CLUSTER = 4;
+/// Near and far clip distances.
+const float NEAR_CLIP = 0.1f;
+const float FAR_CLIP = 100.0f;
+
+/// Return whether sphere overlaps box, computed per axis independently of LightClusters.
+bool SphereOverlapsBox(const Sphere& sphere, const BoundingBox& box)
+{
+    float distanceSquared = 0.0f;
+    for (unsigned axis = 0; axis < 3; ++axis)
+    {
+        const float center = sphere.center_.Data()[axis];
+        float delta = 0.0f;
+        if (center < box.min_.Data()[axis])
+            delta = box.min_.Data()[axis] - center;
+        else if (center > box.max_.Data()[axis])
+            delta = box.max_.Data()[axis] - center;
+        distanceSquared += delta * delta;
+    }
+    return distanceSquared < sphere.radius_ * sphere.radius_;
+}
+
+/// Return random light spheres within the view space frustum bounding box.
+ea::vector<Sphere> CreateLightSpheres(const Frustum& frustum, unsigned numLights)
+{
+    BoundingBox frustumBox;
+    frustumBox.Define(frustum);
+
+    ea::vector<Sphere> lightSpheres;
+    for (unsigned i = 0; i < numLights; ++i)
+    {
+        const Vector3 center(Random(frustumBox.min_.x_, frustumBox.max_.x_), Random(frustumBox.min_.y_, frustumBox.max_.y_),
+            Random(frustumBox.min_.z_, frustumBox.max_.z_));
+        lightSpheres.emplace_back(center, Random(0.5f, 8.0f));
+    }
+    return lightSpheres;
+}
+
+/// Check that random points of the frustum are inside the bounding box of the cluster they belong to. Return number of failures.
+unsigned CheckClusterBoxes(const LightClusters& clusters, const Frustum& frustum)
+{
+    const IntVector3& gridSize = clusters.GetGridSize();
+    unsigned failures = 0;
+    for (unsigned i = 0; i < NUM_POINTS; ++i)
+    {
+        const float x = Random();
+        const float y = Random();
+        const float depth = Random(NEAR_CLIP, FAR_CLIP);
+        const float depthFactor = (depth - NEAR_CLIP) / (FAR_CLIP - NEAR_CLIP);
+
+        // Frustum vertices 0..3 are the near plane, 4..7 the far plane, in the order top right, bottom right,
+        // bottom left, top left
+        const Vector3 bottomLeft = frustum.vertices_[2].Lerp(frustum.vertices_[6], depthFactor);
+        const Vector3 bottomRight = frustum.vertices_[1].Lerp(frustum.vertices_[5], depthFactor);
+        const Vector3 topLeft = frustum.vertices_[3].Lerp(frustum.vertices_[7], depthFactor);
+        const Vector3 topRight = frustum.vertices_[0].Lerp(frustum.vertices_[4], depthFactor);
+        const Vector3 point = bottomLeft.Lerp(bottomRight, x).Lerp(topLeft.Lerp(topRight, x), y);
+
+        const auto clusterX = static_cast<unsigned>(Min(FloorToInt(x * gridSize.x_), gridSize.x_ - 1));
+        const auto clusterY = static_cast<unsigned>(Min(FloorToInt(y * gridSize.y_), gridSize.y_ - 1));
+        const unsigned clusterZ = clusters.GetDepthSlice(point.z_);
+
+        // Points exactly on a boundary may round into the neighbour cluster
+        BoundingBox box = clusters.GetClusterBoundingBox(clusters.GetClusterIndex(clusterX, clusterY, clusterZ));
+        const Vector3 tolerance = Vector3::ONE * (1e-3f * Max(1.0f, point.z_));
+        box.min_ -= tolerance;
+        box.max_ += tolerance;
+        if (box.IsInside(point) == OUTSIDE)
+            ++failures;
+    }
+    return failures;
+}
+
+/// Compare light assignment of all clusters with brute-force assignment. Return number of failures.
+unsigned CheckAssignment(const LightClusters& clusters, const ea::vector<Sphere>& lightSpheres)
+{
+    const ea::vector<LightCluster>& clusterRanges = clusters.GetClusters();
+    const ea::vector<unsigned>& lightIndices = clusters.GetLightIndices();
+    const unsigned maxLights = clusters.GetMaxLightsPerCluster();
+
+    unsigned failures = 0;
+    unsigned expectedDropped = 0;
+    ea::vector<unsigned> expected;
+    for (unsigned clusterIndex = 0; clusterIndex < clusters.GetNumClusters(); ++clusterIndex)
+    {
+        // Lights with lower indices take precedence when the cluster is full
+        expected.clear();
+        const BoundingBox& clusterBox = clusters.GetClusterBoundingBox(clusterIndex);
+        for (unsigned lightIndex = 0; lightIndex < lightSpheres.size(); ++lightIndex)
+        {
+            if (SphereOverlapsBox(lightSpheres[lightIndex], clusterBox))
+            {
+                if (expected.size() < maxLights)
+                    expected.push_back(lightIndex);
+                else
+                    ++expectedDropped;
+            }
+        }
+
+        const LightCluster& cluster = clusterRanges[clusterIndex];
+        if (cluster.count_ != expected.size() || cluster.offset_ + cluster.count_ > lightIndices.size()
+            || !ea::equal(expected.begin(), expected.end(), lightIndices.begin() + cluster.offset_))
+            ++failures;
+    }
+
+    if (clusters.GetNumDroppedLights() != expectedDropped)
+        ++failures;
+    return failures;
+}
+
+/// Define clusters, assign lights and compare with brute force. Return number of failures.
+unsigned RunCheck(WorkQueue* workQueue, bool orthographic, unsigned maxLightsPerCluster, unsigned numLights)
+{
+    Frustum frustum;
+    if (orthographic)
+        frustum.DefineOrtho(40.0f, 16.0f / 9.0f, 1.0f, NEAR_CLIP, FAR_CLIP);
+    else
+        frustum.Define(60.0f, 16.0f / 9.0f, 1.0f, NEAR_CLIP, FAR_CLIP);
+
+    LightClusters clusters;
+    clusters.SetMaxLightsPerCluster(maxLightsPerCluster);
+    clusters.Define(frustum, orthographic);
+
+    const unsigned boxFailures = CheckClusterBoxes(clusters, frustum);
+    const ea::vector<Sphere> lightSpheres = CreateLightSpheres(frustum, numLights);
+    clusters.AssignLights(lightSpheres, workQueue);
+    const unsigned assignmentFailures = CheckAssignment(clusters, lightSpheres);
+
+    PrintLine(Format("{} {}, max {} lights per cluster: {} light indices, {} dropped, cluster box failures {}, "
+        "assignment failures {}", orthographic ? "orthographic" : "perspective", workQueue ? "threaded" : "single-threaded",
+        maxLightsPerCluster, clusters.GetLightIndices().size(), clusters.GetNumDroppedLights(), boxFailures,
+        assignmentFailures));
+    return boxFailures + assignmentFailures;
+}
+
+void Run(const ea::vector<ea::string>& arguments)
+{
+    if (arguments.size() > 0 && (arguments[0] == "-h" || arguments[0] == "--help"))
+    {
+        ErrorExit("Usage: LightClustersCheck [lights]\n\n"
+            "Assigns random lights to light clusters of perspective and orthographic frustums and compares\n"
+            "the result with brute-force sphere and cluster box overlap tests. Exits with an error on mismatch.");
+    }
+
+    const unsigned numLights = arguments.size() > 0 ? ToUInt(arguments[0]) : DEFAULT_NUM_LIGHTS;
+
+    SharedPtr<Context> context(new Context());
+    SharedPtr<WorkQueue> workQueue(new WorkQueue(context));
+    workQueue->CreateThreads(NUM_WORKER_THREADS);
+
+    SetRandomSeed(1);
+    unsigned failures = 0;
+    for (bool orthographic : { false, true })
+    {
+        for (unsigned maxLights : { DEFAULT_MAX_LIGHTS_PER_CLUSTER, SMALL_MAX_LIGHTS_PER_CLUSTER })
+        {
+            failures += RunCheck(nullptr, orthographic, maxLights, numLights);
+            failures += RunCheck(workQueue, orthographic, maxLights, numLights);
+        }
+    }
+
+    if (failures)
+        ErrorExit(Format("{} failures", failures));
+    PrintLine("All checks passed");
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    ea::vector<ea::string> arguments;
+
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+
+    Run(arguments);
+    return 0;
+}
@@ -0,0 +1,281 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Engine/Engine.h>
+#include <Urho3D/Engine/EngineDefs.h>
+#include <Urho3D/Graphics/AnimatedModel.h>
+#include <Urho3D/Graphics/AnimationController.h>
+#include <Urho3D/Graphics/Camera.h>
+#include <Urho3D/Graphics/Graphics.h>
+#include <Urho3D/Graphics/GraphicsImpl.h>
+#include <Urho3D/Graphics/Light.h>
+#include <Urho3D/Graphics/Material.h>
+#include <Urho3D/Graphics/Model.h>
+#include <Urho3D/Graphics/Octree.h>
+#include <Urho3D/Graphics/Renderer.h>
+#include <Urho3D/Graphics/StaticModel.h>
+#include <Urho3D/Graphics/Viewport.h>
+#include <Urho3D/IO/Log.h>
+#include <Urho3D/Resource/ResourceCache.h>
+#include <Urho3D/Scene/Scene.h>
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include <Urho3D/DebugNew.h>
+
+using namespace Urho3D;
+
+namespace
+{
+
+/// Number of frames rendered before measuring, so that shaders are loaded and caches are warm.
+const unsigned NUM_WARMUP_FRAMES = 10;
+/// Default number of measured frames.
+const unsigned DEFAULT_NUM_FRAMES = 200;
+
+/// Benchmark scene.
+struct BenchmarkScene
+{
+    /// Name used on the command line.
+    const char* name_;
+    /// Populate scene and return the camera.
+    Camera* (*create_)(Scene* scene);
+};
+
+/// Create octree, camera and a shadowed directional light.
+Camera* CreateSceneBase(Scene* scene, const Vector3& cameraPosition)
+{
+    scene->CreateComponent<Octree>();
+
+    Node* lightNode = scene->CreateChild("Light");
+    lightNode->SetDirection(Vector3(0.6f, -1.0f, 0.8f));
+    auto* light = lightNode->CreateComponent<Light>();
+    light->SetLightType(LIGHT_DIRECTIONAL);
+    light->SetCastShadows(true);
+    light->SetShadowCascade(CascadeParameters(10.0f, 50.0f, 200.0f, 0.0f, 0.8f));
+
+    Node* cameraNode = scene->CreateChild("Camera");
+    cameraNode->SetPosition(cameraPosition);
+    cameraNode->LookAt(Vector3::ZERO);
+    auto* camera = cameraNode->CreateComponent<Camera>();
+    camera->SetFarClip(300.0f);
+    return camera;
+}
+
+/// Many instanced static boxes.
+Camera* CreateBoxesScene(Scene* scene)
+{
+    auto* cache = scene->GetSubsystem<ResourceCache>();
+    Camera* camera = CreateSceneBase(scene, Vector3(0.0f, 40.0f, -60.0f));
+
+    for (int y = -50; y < 50; ++y)
+    {
+        for (int x = -50; x < 50; ++x)
+        {
+            Node* boxNode = scene->CreateChild("Box");
+            boxNode->SetPosition(Vector3(x * 1.5f, 0.0f, y * 1.5f));
+            auto* boxObject = boxNode->CreateComponent<StaticModel>();
+            boxObject->SetModel(cache->GetResource<Model>("Models/Box.mdl"));
+            boxObject->SetMaterial(cache->GetResource<Material>("Materials/Stone.xml"));
+            boxObject->SetCastShadows(true);
+        }
+    }
+    return camera;
+}
+
+/// Crowd of skinned, animated characters.
+Camera* CreateCrowdScene(Scene* scene)
+{
+    auto* cache = scene->GetSubsystem<ResourceCache>();
+    Camera* camera = CreateSceneBase(scene, Vector3(0.0f, 25.0f, -45.0f));
+
+    const char* animations[] = { "Models/Mutant/Mutant_Run.ani", "Models/Mutant/Mutant_Walk.ani", "Models/Mutant/Mutant_Idle0.ani" };
+    for (int y = -10; y < 10; ++y)
+    {
+        for (int x = -10; x < 10; ++x)
+        {
+            const unsigned index = (y + 10) * 20 + x + 10;
+            Node* modelNode = scene->CreateChild("Mutant");
+            modelNode->SetPosition(Vector3(x * 2.0f, 0.0f, y * 2.0f));
+            auto* modelObject = modelNode->CreateComponent<AnimatedModel>();
+            modelObject->SetModel(cache->GetResource<Model>("Models/Mutant/Mutant.mdl"));
+            modelObject->SetMaterial(cache->GetResource<Material>("Models/Mutant/Materials/mutant_M.xml"));
+            modelObject->SetCastShadows(true);
+
+            auto* animationController = modelNode->CreateComponent<AnimationController>();
+            animationController->Play(animations[index % 3], 0, true);
+            animationController->SetTime(animations[index % 3], (index % 17) * 0.1f);
+        }
+    }
+    return camera;
+}
+
+/// Static boxes lit by many point and spot lights.
+Camera* CreateLightsScene(Scene* scene)
+{
+    auto* cache = scene->GetSubsystem<ResourceCache>();
+    Camera* camera = CreateSceneBase(scene, Vector3(0.0f, 30.0f, -40.0f));
+
+    for (int y = -20; y < 20; ++y)
+    {
+        for (int x = -20; x < 20; ++x)
+        {
+            Node* boxNode = scene->CreateChild("Box");
+            boxNode->SetPosition(Vector3(x * 1.5f, 0.0f, y * 1.5f));
+            auto* boxObject = boxNode->CreateComponent<StaticModel>();
+            boxObject->SetModel(cache->GetResource<Model>("Models/Box.mdl"));
+            boxObject->SetMaterial(cache->GetResource<Material>("Materials/Stone.xml"));
+            boxObject->SetCastShadows(true);
+        }
+    }
+
+    for (int y = -4; y < 4; ++y)
+    {
+        for (int x = -4; x < 4; ++x)
+        {
+            const bool spot = (x + y) % 4 == 0;
+            Node* lightNode = scene->CreateChild("Light");
+            lightNode->SetPosition(Vector3(x * 7.5f + 3.75f, 4.0f, y * 7.5f + 3.75f));
+            lightNode->SetDirection(Vector3::DOWN);
+            auto* light = lightNode->CreateComponent<Light>();
+            light->SetLightType(spot ? LIGHT_SPOT : LIGHT_POINT);
+            light->SetRange(10.0f);
+            light->SetCastShadows(spot);
+        }
+    }
+    return camera;
+}
+
+/// All benchmark scenes.
+const BenchmarkScene benchmarkScenes[] = {
+    { "boxes", CreateBoxesScene },
+    { "crowd", CreateCrowdScene },
+    { "lights", CreateLightsScene },
+};
+
+/// Render a scene and print frame times and backend counters averaged over the measured frames.
+void RunBenchmark(Engine* engine, const BenchmarkScene& benchmarkScene, unsigned numFrames)
+{
+    Context* context = engine->GetContext();
+    auto* renderer = context->GetSubsystem<Renderer>();
+    auto* graphics = context->GetSubsystem<Graphics>();
+    GraphicsImpl* impl = graphics->GetImpl();
+
+    SharedPtr<Scene> scene(new Scene(context));
+    Camera* camera = benchmarkScene.create_(scene);
+    renderer->SetViewport(0, new Viewport(context, scene, camera));
+
+    for (unsigned i = 0; i < NUM_WARMUP_FRAMES; ++i)
+        engine->RunFrame();
+
+    impl->ResetTotalStats();
+    long long totalTime = 0;
+    long long minTime = M_MAX_INT;
+    HiresTimer timer;
+    for (unsigned i = 0; i < numFrames; ++i)
+    {
+        timer.Reset();
+        engine->RunFrame();
+        const long long frameTime = timer.GetUSec(false);
+        totalTime += frameTime;
+        minTime = Min(minTime, frameTime);
+    }
+
+    const NullGraphicsStats& stats = impl->GetTotalStats();
+    const unsigned frames = Max(impl->GetNumFrames(), 1u);
+    PrintLine(Format("{}: {:.3f} ms/frame (min {:.3f} ms) over {} frames", benchmarkScene.name_,
+        totalTime / 1000.0 / numFrames, minTime / 1000.0, numFrames));
+    PrintLine(Format("    draws {} (instanced {}), primitives {}, shader changes {}, parameter updates {}, texture changes {}",
+        stats.draws_ / frames, stats.instancedDraws_ / frames, stats.primitives_ / frames, stats.shaderChanges_ / frames,
+        stats.shaderParameterUpdates_ / frames, stats.textureChanges_ / frames));
+    PrintLine(Format("    render target changes {}, state changes {}, buffer uploads {} ({} bytes)",
+        stats.renderTargetChanges_ / frames,
+        (stats.blendStateChanges_ + stats.depthStateChanges_ + stats.rasterizerStateChanges_) / frames,
+        stats.bufferUploads_ / frames, stats.bufferUploadBytes_ / frames));
+
+    renderer->SetViewport(0, nullptr);
+}
+
+void Run(const ea::vector<ea::string>& arguments)
+{
+    if (arguments.size() < 1)
+    {
+        ErrorExit("Usage: RenderBenchmark <scene> [frames] [resource prefix path]\n\n"
+            "Renders a benchmark scene through the null graphics backend and prints frame times and\n"
+            "per-frame draw call and state change counts.\n\n"
+            "Scenes: boxes, crowd, lights, all");
+    }
+
+    const ea::string& sceneName = arguments[0];
+    const unsigned numFrames = arguments.size() > 1 ? Max(ToUInt(arguments[1]), 1u) : DEFAULT_NUM_FRAMES;
+
+    SharedPtr<Context> context(new Context());
+    SharedPtr<Engine> engine(new Engine(context));
+    VariantMap engineParameters;
+    if (arguments.size() > 2)
+        engineParameters[EP_RESOURCE_PREFIX_PATHS] = arguments[2];
+    engineParameters[EP_RESOURCE_PATHS] = "CoreData;Data";
+    engineParameters[EP_WINDOW_WIDTH] = 1280;
+    engineParameters[EP_WINDOW_HEIGHT] = 720;
+    engineParameters[EP_SOUND] = false;
+    engineParameters[EP_LOG_LEVEL] = LOG_WARNING;
+    if (!engine->Initialize(engineParameters))
+        ErrorExit("Failed to initialize the engine");
+
+    engine->SetMaxFps(0);
+
+    bool found = false;
+    for (const BenchmarkScene& benchmarkScene : benchmarkScenes)
+    {
+        if (sceneName == "all" || sceneName == benchmarkScene.name_)
+        {
+            RunBenchmark(engine, benchmarkScene, numFrames);
+            found = true;
+        }
+    }
+
+    if (!found)
+        ErrorExit("Unknown scene " + sceneName);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    ea::vector<ea::string> arguments;
+
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+
+    Run(arguments);
+    return 0;
+}
@@ -0,0 +1,276 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/WorkQueue.h>
+#include <Urho3D/Graphics/SkinMatrixArena.h>
+#include <Urho3D/Math/Random.h>
+
+#include <EASTL/sort.h>
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include <Urho3D/DebugNew.h>
+
+using namespace Urho3D;
+
+namespace
+{
+
+/// Default number of ranges allocated per frame.
+const unsigned DEFAULT_NUM_RANGES = 2000;
+/// Maximum number of matrices in a range, roughly the bone count of a large skeleton.
+const unsigned MAX_RANGE_SIZE = 128;
+/// Number of simulated frames.
+const unsigned NUM_FRAMES = 3;
+/// Number of worker threads used for concurrent allocation.
+const unsigned NUM_WORKER_THREADS = 3;
+
+const unsigned BLOCK_SIZE = SkinMatrixArena::SKIN_MATRIX_BLOCK_SIZE;
+const unsigned MAX_BLOCKS = SkinMatrixArena::MAX_SKIN_MATRIX_BLOCKS;
+
+/// Allocated range.
+struct Range
+{
+    /// Offset returned by the arena.
+    unsigned offset_{};
+    /// Number of matrices.
+    unsigned count_{};
+    /// Pointer returned by the arena right after allocation.
+    Matrix3x4* matrices_{};
+};
+
+/// Fill range with matrices identifying it.
+void WriteRange(const Range& range, unsigned rangeIndex)
+{
+    for (unsigned i = 0; i < range.count_; ++i)
+    {
+        range.matrices_[i] = Matrix3x4::IDENTITY;
+        range.matrices_[i].m03_ = static_cast<float>(rangeIndex);
+        range.matrices_[i].m13_ = static_cast<float>(i);
+    }
+}
+
+/// Return whether range still contains the matrices written by WriteRange.
+bool IsRangeIntact(const Range& range, unsigned rangeIndex)
+{
+    for (unsigned i = 0; i < range.count_; ++i)
+    {
+        if (range.matrices_[i].m03_ != static_cast<float>(rangeIndex) || range.matrices_[i].m13_ != static_cast<float>(i))
+            return false;
+    }
+    return true;
+}
+
+/// Check ranges allocated in one frame: each range lies in one block, ranges do not overlap, offsets still map to
+/// the pointers returned at allocation and the written contents survived all later allocations. Return number of failures.
+unsigned CheckRanges(const SkinMatrixArena& arena, const ea::vector<Range>& ranges)
+{
+    unsigned failures = 0;
+    for (unsigned i = 0; i < ranges.size(); ++i)
+    {
+        const Range& range = ranges[i];
+        if (range.offset_ == M_MAX_UNSIGNED)
+        {
+            ++failures;
+            continue;
+        }
+        if (range.offset_ % BLOCK_SIZE + range.count_ > BLOCK_SIZE || range.offset_ + range.count_ > arena.GetNumMatrices())
+            ++failures;
+        if (arena.GetMatrices(range.offset_) != range.matrices_ || !IsRangeIntact(range, i))
+            ++failures;
+    }
+
+    ea::vector<Range> sortedRanges = ranges;
+    ea::sort(sortedRanges.begin(), sortedRanges.end(), [](const Range& lhs, const Range& rhs) { return lhs.offset_ < rhs.offset_; });
+    for (unsigned i = 1; i < sortedRanges.size(); ++i)
+    {
+        if (sortedRanges[i - 1].offset_ + sortedRanges[i - 1].count_ > sortedRanges[i].offset_)
+            ++failures;
+    }
+    return failures;
+}
+
+/// Allocate ranges of random size in the calling thread. Return number of failures.
+unsigned CheckSequential(SkinMatrixArena& arena, unsigned numRanges)
+{
+    // Same range sizes every frame, so that the blocks of the first frame are enough for the next ones
+    ea::vector<unsigned> counts(numRanges);
+    for (unsigned& count : counts)
+        count = static_cast<unsigned>(Random(1, MAX_RANGE_SIZE + 1));
+
+    unsigned failures = 0;
+    unsigned capacity = 0;
+    for (unsigned frame = 0; frame < NUM_FRAMES; ++frame)
+    {
+        arena.BeginFrame();
+        if (arena.GetNumMatrices() != 0)
+            ++failures;
+
+        ea::vector<Range> ranges(numRanges);
+        for (unsigned i = 0; i < numRanges; ++i)
+        {
+            Range& range = ranges[i];
+            range.count_ = counts[i];
+            range.offset_ = arena.Allocate(range.count_);
+            if (range.offset_ == M_MAX_UNSIGNED)
+                return failures + 1;
+
+            // Without concurrent allocation the ranges are packed in order
+            if (i > 0 && range.offset_ < ranges[i - 1].offset_ + ranges[i - 1].count_)
+                ++failures;
+            range.matrices_ = arena.GetMatrices(range.offset_);
+            WriteRange(range, i);
+        }
+        failures += CheckRanges(arena, ranges);
+
+        if (frame == 0)
+            capacity = arena.GetCapacity();
+        else if (arena.GetCapacity() != capacity)
+            ++failures;
+
+        PrintLine(Format("sequential frame {}: {} ranges, {} matrices, capacity {}, failures {}",
+            frame, numRanges, arena.GetNumMatrices(), arena.GetCapacity(), failures));
+    }
+    return failures;
+}
+
+/// Allocate ranges of random size from worker threads. Return number of failures.
+unsigned CheckConcurrent(SkinMatrixArena& arena, WorkQueue* workQueue, unsigned numRanges)
+{
+    unsigned failures = 0;
+    for (unsigned frame = 0; frame < NUM_FRAMES; ++frame)
+    {
+        arena.BeginFrame();
+
+        ea::vector<Range> ranges(numRanges);
+        for (Range& range : ranges)
+            range.count_ = static_cast<unsigned>(Random(1, MAX_RANGE_SIZE + 1));
+
+        workQueue->ParallelFor(numRanges, 1, [&](unsigned beginIndex, unsigned endIndex, unsigned)
+        {
+            for (unsigned i = beginIndex; i < endIndex; ++i)
+            {
+                Range& range = ranges[i];
+                range.offset_ = arena.Allocate(range.count_);
+                if (range.offset_ != M_MAX_UNSIGNED)
+                {
+                    range.matrices_ = arena.GetMatrices(range.offset_);
+                    WriteRange(range, i);
+                }
+            }
+        });
+        failures += CheckRanges(arena, ranges);
+
+        PrintLine(Format("concurrent frame {}: {} ranges, {} matrices, capacity {}, failures {}",
+            frame, numRanges, arena.GetNumMatrices(), arena.GetCapacity(), failures));
+    }
+    return failures;
+}
+
+/// Check ranges that do not fit into a block or into the arena. Return number of failures.
+unsigned CheckLimits(SkinMatrixArena& arena)
+{
+    unsigned failures = 0;
+    arena.BeginFrame();
+
+    if (arena.Allocate(BLOCK_SIZE + 1) != M_MAX_UNSIGNED)
+        ++failures;
+
+    // Range that does not fit into the rest of a block starts at the next block
+    if (arena.Allocate(1) != 0)
+        ++failures;
+    if (arena.Allocate(BLOCK_SIZE) != BLOCK_SIZE)
+        ++failures;
+
+    // Fill the remaining blocks, the skipped end of the first block is not reused within the frame
+    for (unsigned i = 2; i < MAX_BLOCKS; ++i)
+    {
+        if (arena.Allocate(BLOCK_SIZE) != i * BLOCK_SIZE)
+            ++failures;
+    }
+    if (arena.Allocate(1) != M_MAX_UNSIGNED)
+        ++failures;
+    if (arena.GetCapacity() != BLOCK_SIZE * MAX_BLOCKS)
+        ++failures;
+
+    // Storage is kept for the next frame
+    arena.BeginFrame();
+    if (arena.Allocate(BLOCK_SIZE) != 0 || arena.GetCapacity() != BLOCK_SIZE * MAX_BLOCKS)
+        ++failures;
+
+    PrintLine(Format("limits: capacity {}, failures {}", arena.GetCapacity(), failures));
+    return failures;
+}
+
+void Run(const ea::vector<ea::string>& arguments)
+{
+    if (arguments.size() > 0 && (arguments[0] == "-h" || arguments[0] == "--help"))
+    {
+        ErrorExit("Usage: SkinMatrixArenaCheck [ranges]\n\n"
+            "Allocates ranges of skinning matrices from the skin matrix arena in the main thread and in worker\n"
+            "threads for several frames and checks offsets, block growth and limits. Exits with an error on failure.");
+    }
+
+    const unsigned numRanges = arguments.size() > 0 ? Max(ToUInt(arguments[0]), 1u) : DEFAULT_NUM_RANGES;
+
+    SharedPtr<Context> context(new Context());
+    SharedPtr<WorkQueue> workQueue(new WorkQueue(context));
+    workQueue->CreateThreads(NUM_WORKER_THREADS);
+
+    SetRandomSeed(1);
+    unsigned failures = 0;
+    {
+        SkinMatrixArena arena;
+        failures += CheckSequential(arena, numRanges);
+        failures += CheckConcurrent(arena, workQueue, numRanges);
+    }
+    {
+        SkinMatrixArena arena;
+        failures += CheckLimits(arena);
+    }
+
+    if (failures)
+        ErrorExit(Format("{} failures", failures));
+    PrintLine("All checks passed");
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    ea::vector<ea::string> arguments;
+
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+
+    Run(arguments);
+    return 0;
+}
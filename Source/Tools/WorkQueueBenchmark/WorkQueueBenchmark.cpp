@@ -0,0 +1,254 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include <Urho3D/Container/Ptr.h>
+#include <Urho3D/Core/Context.h>
+#include <Urho3D/Core/Mutex.h>
+#include <Urho3D/Core/ProcessUtils.h>
+#include <Urho3D/Core/StringUtils.h>
+#include <Urho3D/Core/Thread.h>
+#include <Urho3D/Core/Timer.h>
+#include <Urho3D/Core/WorkQueue.h>
+
+#include <EASTL/list.h>
+
+#include <atomic>
+
+#ifdef WIN32
+#include <windows.h>
+#endif
+
+#include <Urho3D/DebugNew.h>
+
+using namespace Urho3D;
+
+namespace
+{
+
+/// Default maximum number of threads, including the main thread.
+const unsigned DEFAULT_MAX_THREADS = 64;
+/// Default number of work items per round.
+const unsigned DEFAULT_NUM_ITEMS = 10000;
+/// Number of measured rounds per queue and thread count.
+const unsigned NUM_ROUNDS = 20;
+/// Number of loop iterations of a single work item. Small on purpose, so that queue overhead dominates.
+const unsigned WORK_ITERATIONS = 64;
+
+/// Simulate a small amount of work.
+void DoWork()
+{
+    volatile unsigned value = 0;
+    for (unsigned i = 0; i < WORK_ITERATIONS; ++i)
+        value = value * 31 + i;
+}
+
+/// Single mutex-guarded list with priority-ordered insertion, as used by the work queue before work stealing.
+class MutexListQueue
+{
+public:
+    /// Construct and start worker threads.
+    explicit MutexListQueue(unsigned numThreads)
+    {
+        for (unsigned i = 0; i < numThreads; ++i)
+        {
+            threads_.emplace_back(new WorkerThread(this));
+            threads_.back()->Run();
+        }
+    }
+
+    /// Stop worker threads.
+    ~MutexListQueue()
+    {
+        shutDown_ = true;
+        for (const auto& thread : threads_)
+            thread->Stop();
+    }
+
+    /// Add work item with the given priority.
+    void AddWorkItem(unsigned priority)
+    {
+        MutexLock lock(queueMutex_);
+        ++numPending_;
+
+        auto i = queue_.begin();
+        while (i != queue_.end() && *i > priority)
+            ++i;
+        queue_.insert(i, priority);
+    }
+
+    /// Execute work items also in the calling thread and wait until all are completed.
+    void Complete()
+    {
+        while (ProcessItem())
+        {
+        }
+        while (numPending_.load(std::memory_order_acquire) != 0)
+        {
+        }
+    }
+
+private:
+    /// Worker thread that executes items until shut down.
+    class WorkerThread : public Thread
+    {
+    public:
+        /// Construct.
+        explicit WorkerThread(MutexListQueue* owner) : owner_(owner) {}
+
+        /// Process work items until shut down.
+        void ThreadFunction() override
+        {
+            while (!owner_->shutDown_)
+            {
+                if (!owner_->ProcessItem())
+                    Time::Sleep(0);
+            }
+        }
+
+    private:
+        /// Owner queue.
+        MutexListQueue* owner_;
+    };
+
+    /// Execute the first queued item. Return false if the queue was empty.
+    bool ProcessItem()
+    {
+        queueMutex_.Acquire();
+        if (queue_.empty())
+        {
+            queueMutex_.Release();
+            return false;
+        }
+        queue_.pop_front();
+        queueMutex_.Release();
+
+        DoWork();
+        numPending_.fetch_sub(1, std::memory_order_release);
+        return true;
+    }
+
+    /// Item priorities in execution order.
+    ea::list<unsigned> queue_;
+    /// Mutex for the list.
+    Mutex queueMutex_;
+    /// Number of items not completed yet.
+    std::atomic<unsigned> numPending_{};
+    /// Shutting down flag.
+    std::atomic<bool> shutDown_{};
+    /// Worker threads.
+    ea::vector<ea::unique_ptr<WorkerThread> > threads_;
+};
+
+/// Return average nanoseconds per item of the rounds executed by the function.
+template <class T> double MeasureRounds(unsigned numItems, const T& round)
+{
+    // Warm up item pools and wake up the threads
+    round();
+
+    HiresTimer timer;
+    for (unsigned i = 0; i < NUM_ROUNDS; ++i)
+        round();
+    return timer.GetUSec(false) * 1000.0 / (NUM_ROUNDS * numItems);
+}
+
+/// Measure queues with the given number of threads, including the main thread, and print the results.
+void RunBenchmark(Context* context, unsigned numThreads, unsigned numItems)
+{
+    double mutexListTime = 0.0;
+    {
+        MutexListQueue queue(numThreads - 1);
+        mutexListTime = MeasureRounds(numItems, [&]()
+        {
+            for (unsigned i = 0; i < numItems; ++i)
+                queue.AddWorkItem(M_MAX_UNSIGNED);
+            queue.Complete();
+        });
+    }
+
+    double workStealingTime = 0.0;
+    double parallelForTime = 0.0;
+    {
+        SharedPtr<WorkQueue> queue(new WorkQueue(context));
+        if (numThreads > 1)
+            queue->CreateThreads(numThreads - 1);
+
+        workStealingTime = MeasureRounds(numItems, [&]()
+        {
+            for (unsigned i = 0; i < numItems; ++i)
+            {
+                SharedPtr<WorkItem> item = queue->GetFreeItem();
+                item->workFunction_ = [](const WorkItem*, unsigned) { DoWork(); };
+                item->priority_ = M_MAX_UNSIGNED;
+                queue->AddWorkItem(item);
+            }
+            queue->Complete(M_MAX_UNSIGNED);
+        });
+
+        parallelForTime = MeasureRounds(numItems, [&]()
+        {
+            queue->ParallelFor(numItems, 1, [](unsigned beginIndex, unsigned endIndex, unsigned)
+            {
+                for (unsigned i = beginIndex; i < endIndex; ++i)
+                    DoWork();
+            });
+        });
+    }
+
+    PrintLine(Format("{:>3} threads: mutex list {:.1f} ns/item, work stealing {:.1f} ns/item, parallel for {:.1f} ns/item",
+        numThreads, mutexListTime, workStealingTime, parallelForTime));
+}
+
+void Run(const ea::vector<ea::string>& arguments)
+{
+    if (arguments.size() > 0 && (arguments[0] == "-h" || arguments[0] == "--help"))
+    {
+        ErrorExit("Usage: WorkQueueBenchmark [max threads] [items]\n\n"
+            "Executes rounds of small work items with 1, 2, 4 ... max threads and prints the time per item for\n"
+            "a single mutex-guarded list, the work-stealing work queue and a parallel loop.");
+    }
+
+    const unsigned maxThreads = arguments.size() > 0 ? Max(ToUInt(arguments[0]), 1u) : DEFAULT_MAX_THREADS;
+    const unsigned numItems = arguments.size() > 1 ? Max(ToUInt(arguments[1]), 1u) : DEFAULT_NUM_ITEMS;
+
+    // Time subsystem initializes the high-resolution timer
+    SharedPtr<Context> context(new Context());
+    context->RegisterSubsystem(new Time(context));
+    for (unsigned numThreads = 1; numThreads <= maxThreads; numThreads *= 2)
+        RunBenchmark(context, numThreads, numItems);
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    ea::vector<ea::string> arguments;
+
+    #ifdef WIN32
+    arguments = ParseArguments(GetCommandLineW());
+    #else
+    arguments = ParseArguments(argc, argv);
+    #endif
+
+    Run(arguments);
+    return 0;
+}
@@ -492,6 +492,10 @@ public:
 %ignore Urho3D::PointOctreeQuery::TestDrawables;
 %ignore Urho3D::BoxOctreeQuery::TestDrawables;
 %ignore Urho3D::OctreeQuery::TestDrawables;
+%ignore Urho3D::OctreeQuery::TestPackedDrawables;
+%ignore Urho3D::FrustumOctreeQuery::TestPackedDrawables;
+%ignore Urho3D::Octree::GetAnimationPoseCache;
+%ignore Urho3D::Octree::GetSkinMatrixArena;
 %ignore Urho3D::UpdateDrawablesWork;
 %ignore Urho3D::ProcessLightWork;
 %ignore Urho3D::CheckVisibilityWork;
@@ -561,6 +565,7 @@ public:
 %include "Urho3D/Graphics/Model.h"
 %include "Urho3D/Graphics/StaticModel.h"
 %include "Urho3D/Graphics/StaticModelGroup.h"
+%ignore Urho3D::Animation::GetCompressedAnimation;
 %include "Urho3D/Graphics/Animation.h"
 %include "Urho3D/Graphics/AnimationState.h"
 %include "Urho3D/Graphics/AnimationController.h"
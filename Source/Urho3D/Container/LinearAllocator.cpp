@@ -0,0 +1,162 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Container/LinearAllocator.h"
+#include "../Math/MathDefs.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+namespace
+{
+
+/// Return offset aligned to given power of two relative to base address.
+size_t AlignOffset(const unsigned char* base, size_t offset, size_t alignment)
+{
+    const auto address = reinterpret_cast<size_t>(base) + offset;
+    return offset + ((alignment - (address & (alignment - 1))) & (alignment - 1));
+}
+
+}
+
+LinearAllocator::LinearAllocator(unsigned blockSize) :
+    blockSize_(Max(blockSize, 1u))
+{
+}
+
+LinearAllocator::~LinearAllocator()
+{
+    FreeBlocks();
+}
+
+void* LinearAllocator::Allocate(size_t size, size_t alignment)
+{
+    void* result = nullptr;
+    if (currentBlock_ < blocks_.size())
+    {
+        Block& block = blocks_[currentBlock_];
+        const size_t alignedOffset = AlignOffset(block.data_, offset_, alignment);
+        if (alignedOffset + size <= block.size_)
+        {
+            result = block.data_ + alignedOffset;
+            usedSize_ += alignedOffset + size - offset_;
+            offset_ = alignedOffset + size;
+        }
+    }
+
+    if (!result)
+        result = AllocateFromNextBlock(size, alignment);
+
+    peakUsedSize_ = Max(peakUsedSize_, usedSize_);
+    return result;
+}
+
+void* LinearAllocator::AllocateFromNextBlock(size_t size, size_t alignment)
+{
+    // Waste the rest of the current block
+    if (currentBlock_ < blocks_.size())
+    {
+        usedSize_ += blocks_[currentBlock_].size_ - offset_;
+        ++currentBlock_;
+    }
+
+    // Skip blocks which are too small, then create a new block if none fits
+    const size_t requiredSize = size + alignment;
+    while (currentBlock_ < blocks_.size() && blocks_[currentBlock_].size_ < requiredSize)
+    {
+        usedSize_ += blocks_[currentBlock_].size_;
+        ++currentBlock_;
+    }
+
+    if (currentBlock_ == blocks_.size())
+    {
+        Block block;
+        block.size_ = Max(blockSize_, requiredSize);
+        block.data_ = new unsigned char[block.size_];
+        blocks_.push_back(block);
+        capacity_ += block.size_;
+    }
+
+    Block& block = blocks_[currentBlock_];
+    const size_t alignedOffset = AlignOffset(block.data_, 0, alignment);
+    usedSize_ += alignedOffset + size;
+    offset_ = alignedOffset + size;
+    return block.data_ + alignedOffset;
+}
+
+void LinearAllocator::Reset()
+{
+    // Merge blocks so that the same amount of memory fits into one block next time
+    if (blocks_.size() > 1)
+    {
+        const size_t totalSize = capacity_;
+        FreeBlocks();
+
+        Block block;
+        block.size_ = totalSize;
+        block.data_ = new unsigned char[block.size_];
+        blocks_.push_back(block);
+        capacity_ = block.size_;
+    }
+
+    currentBlock_ = 0;
+    offset_ = 0;
+    usedSize_ = 0;
+}
+
+void LinearAllocator::FreeBlocks()
+{
+    for (const Block& block : blocks_)
+        delete[] block.data_;
+    blocks_.clear();
+    capacity_ = 0;
+}
+
+void* LinearAllocatorAdapter::allocate(size_t n, int flags)
+{
+    if (allocator_)
+        return allocator_->Allocate(n);
+    return EASTLAllocatorDefault()->allocate(n, flags);
+}
+
+void* LinearAllocatorAdapter::allocate(size_t n, size_t alignment, size_t offset, int flags)
+{
+    if (allocator_)
+    {
+        // Offset alignment is not supported, over-align instead
+        return allocator_->Allocate(n, Max(alignment, alignof(std::max_align_t)));
+    }
+    return EASTLAllocatorDefault()->allocate(n, alignment, offset, flags);
+}
+
+void LinearAllocatorAdapter::deallocate(void* p, size_t n)
+{
+    if (!allocator_)
+        EASTLAllocatorDefault()->deallocate(p, n);
+}
+
+}
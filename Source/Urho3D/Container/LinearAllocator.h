@@ -0,0 +1,135 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+/// \file
+
+#pragma once
+
+#include "../Core/NonCopyable.h"
+
+#include <Urho3D/Urho3D.h>
+
+#include <EASTL/allocator.h>
+#include <EASTL/vector.h>
+
+#include <cstddef>
+
+namespace Urho3D
+{
+
+/// Default size of linear allocator memory blocks.
+static const unsigned DEFAULT_LINEAR_ALLOCATOR_BLOCK_SIZE = 64 * 1024;
+
+/// Linear (arena) allocator for transient memory, e.g. data rebuilt every frame. Individual allocations are never freed,
+/// all of them are released at once by Reset(). Not thread-safe: use a separate allocator for each thread.
+class URHO3D_API LinearAllocator : private NonCopyable
+{
+public:
+    /// Construct with minimum size of memory blocks.
+    explicit LinearAllocator(unsigned blockSize = DEFAULT_LINEAR_ALLOCATOR_BLOCK_SIZE);
+    /// Destruct. Frees all memory blocks.
+    ~LinearAllocator();
+
+    /// Allocate memory. Alignment must be a power of two.
+    void* Allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+    /// Release all allocations. Memory blocks are kept; if more than one block was used, they are merged into a single block.
+    void Reset();
+    /// Reset peak used size.
+    void ResetPeakUsedSize() { peakUsedSize_ = usedSize_; }
+
+    /// Return number of bytes allocated since the last reset, including alignment padding.
+    size_t GetUsedSize() const { return usedSize_; }
+    /// Return highest number of bytes allocated between resets.
+    size_t GetPeakUsedSize() const { return peakUsedSize_; }
+    /// Return total size of memory blocks.
+    size_t GetCapacity() const { return capacity_; }
+    /// Return number of memory blocks.
+    unsigned GetNumBlocks() const { return blocks_.size(); }
+
+private:
+    /// Memory block.
+    struct Block
+    {
+        /// Memory.
+        unsigned char* data_{};
+        /// Size in bytes.
+        size_t size_{};
+    };
+
+    /// Allocate from the next block that fits, creating one if needed.
+    void* AllocateFromNextBlock(size_t size, size_t alignment);
+    /// Free all memory blocks.
+    void FreeBlocks();
+
+    /// Minimum block size.
+    size_t blockSize_{};
+    /// Memory blocks.
+    ea::vector<Block> blocks_;
+    /// Index of the current block.
+    unsigned currentBlock_{};
+    /// Offset in the current block.
+    size_t offset_{};
+    /// Bytes allocated since the last reset.
+    size_t usedSize_{};
+    /// Highest number of bytes allocated between resets.
+    size_t peakUsedSize_{};
+    /// Total size of memory blocks.
+    size_t capacity_{};
+};
+
+/// EASTL allocator that takes memory from a linear allocator, or from the default heap allocator if none is set.
+/// A container using it must release its memory, including hash table buckets, before the linear allocator is reset.
+class URHO3D_API LinearAllocatorAdapter
+{
+public:
+    /// Construct using the default heap allocator.
+    explicit LinearAllocatorAdapter(const char* name = nullptr) { }
+    /// Construct using linear allocator. Null means the default heap allocator.
+    explicit LinearAllocatorAdapter(LinearAllocator* allocator) : allocator_(allocator) { }
+
+    /// Allocate memory.
+    void* allocate(size_t n, int flags = 0);
+    /// Allocate aligned memory.
+    void* allocate(size_t n, size_t alignment, size_t offset, int flags = 0);
+    /// Free memory. Does nothing for memory of a linear allocator.
+    void deallocate(void* p, size_t n);
+
+    /// Return name. Names are not supported.
+    const char* get_name() const { return "LinearAllocatorAdapter"; }
+    /// Set name. Names are not supported.
+    void set_name(const char* name) { }
+
+    /// Return linear allocator, or null if the default heap allocator is used.
+    LinearAllocator* GetAllocator() const { return allocator_; }
+
+private:
+    /// Linear allocator.
+    LinearAllocator* allocator_{};
+};
+
+/// Compare adapters. Memory can be exchanged between containers only if they use the same linear allocator.
+inline bool operator ==(const LinearAllocatorAdapter& lhs, const LinearAllocatorAdapter& rhs) { return lhs.GetAllocator() == rhs.GetAllocator(); }
+/// Compare adapters.
+inline bool operator !=(const LinearAllocatorAdapter& lhs, const LinearAllocatorAdapter& rhs) { return !(lhs == rhs); }
+
+}
@@ -0,0 +1,102 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include <EASTL/sort.h>
+#include <EASTL/vector.h>
+
+#include <cstring>
+
+namespace Urho3D
+{
+
+/// Value sorted by 64-bit key.
+template <class T> struct RadixSortItem
+{
+    /// Sort key.
+    unsigned long long key_;
+    /// Value.
+    T value_;
+};
+
+/// Return 32-bit key that sorts floats in ascending order.
+inline unsigned GetFloatSortKey(float value)
+{
+    unsigned bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+/// Stable LSD radix sort of items by the lowest numKeyBits of the key, 8 bits per pass.
+/// Passes over bytes that are equal for all keys are skipped. Temporary buffer is resized as needed.
+template <class T> void RadixSort(ea::vector<RadixSortItem<T>>& items, ea::vector<RadixSortItem<T>>& temp, unsigned numKeyBits = 64)
+{
+    static const unsigned maxInsertionSortSize = 32;
+
+    const unsigned count = items.size();
+    if (count <= maxInsertionSortSize)
+    {
+        ea::insertion_sort(items.begin(), items.end(),
+            [](const RadixSortItem<T>& lhs, const RadixSortItem<T>& rhs) { return lhs.key_ < rhs.key_; });
+        return;
+    }
+
+    // Build histograms of all bytes at once
+    const unsigned numBytes = (numKeyBits + 7) / 8;
+    unsigned histograms[8][256] = {};
+    for (const RadixSortItem<T>& item : items)
+    {
+        for (unsigned i = 0; i < numBytes; ++i)
+            ++histograms[i][(item.key_ >> (i * 8)) & 0xffu];
+    }
+
+    temp.resize(count);
+    RadixSortItem<T>* src = items.data();
+    RadixSortItem<T>* dest = temp.data();
+    for (unsigned i = 0; i < numBytes; ++i)
+    {
+        const unsigned shift = i * 8;
+        unsigned* histogram = histograms[i];
+        if (histogram[(src[0].key_ >> shift) & 0xffu] == count)
+            continue;
+
+        unsigned offset = 0;
+        for (unsigned j = 0; j < 256; ++j)
+        {
+            const unsigned bucketSize = histogram[j];
+            histogram[j] = offset;
+            offset += bucketSize;
+        }
+
+        for (unsigned j = 0; j < count; ++j)
+            dest[histogram[(src[j].key_ >> shift) & 0xffu]++] = src[j];
+
+        ea::swap(src, dest);
+    }
+
+    if (src != items.data())
+        items.swap(temp);
+}
+
+}
@@ -0,0 +1,179 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#include "../Precompiled.h"
+
+#include "../Core/TaskGraph.h"
+#include "../IO/Log.h"
+
+namespace Urho3D
+{
+
+TaskGraph::TaskGraph(WorkQueue* workQueue)
+    : workQueue_(workQueue)
+{
+}
+
+TaskGraph::~TaskGraph()
+{
+    Wait();
+}
+
+TaskHandle TaskGraph::AddTask(TaskFunction function, unsigned priority)
+{
+    assert(IsCompleted());
+
+    if (numTasks_ == tasks_.size())
+    {
+        auto task = ea::make_unique<Task>();
+        task->item_.workFunction_ = ExecuteTaskWork;
+        task->item_.start_ = this;
+        task->item_.aux_ = task.get();
+        tasks_.push_back(ea::move(task));
+    }
+
+    Task& task = *tasks_[numTasks_];
+    task.function_ = ea::move(function);
+    task.item_.priority_ = priority;
+    task.successors_.clear();
+    task.numPredecessors_ = 0;
+    return numTasks_++;
+}
+
+bool TaskGraph::AddDependency(TaskHandle task, TaskHandle predecessor)
+{
+    assert(IsCompleted());
+    assert(task < numTasks_ && predecessor < numTasks_);
+
+    // Tasks in a cycle would never become ready
+    if (IsReachable(task, predecessor))
+    {
+        URHO3D_LOGERROR("Task graph dependency would form a cycle");
+        return false;
+    }
+
+    tasks_[predecessor]->successors_.push_back(task);
+    ++tasks_[task]->numPredecessors_;
+    return true;
+}
+
+TaskHandle TaskGraph::AddContinuation(TaskHandle predecessor, TaskFunction function, unsigned priority)
+{
+    const TaskHandle task = AddTask(ea::move(function), priority);
+    AddDependency(task, predecessor);
+    return task;
+}
+
+bool TaskGraph::IsReachable(TaskHandle task, TaskHandle target)
+{
+    searchVisited_.assign(numTasks_, false);
+    searchStack_.clear();
+    searchStack_.push_back(task);
+    searchVisited_[task] = true;
+
+    while (!searchStack_.empty())
+    {
+        const TaskHandle current = searchStack_.back();
+        searchStack_.pop_back();
+        if (current == target)
+            return true;
+
+        for (TaskHandle successor : tasks_[current]->successors_)
+        {
+            if (!searchVisited_[successor])
+            {
+                searchVisited_[successor] = true;
+                searchStack_.push_back(successor);
+            }
+        }
+    }
+    return false;
+}
+
+void TaskGraph::Clear()
+{
+    assert(IsCompleted());
+
+    // Release captured state but keep the storage
+    for (unsigned i = 0; i < numTasks_; ++i)
+        tasks_[i]->function_ = nullptr;
+    numTasks_ = 0;
+}
+
+void TaskGraph::Run()
+{
+    assert(IsCompleted());
+    if (numTasks_ == 0)
+        return;
+
+    // Reset all counters before any task is scheduled
+    minPriority_ = M_MAX_UNSIGNED;
+    for (unsigned i = 0; i < numTasks_; ++i)
+    {
+        Task& task = *tasks_[i];
+        task.joinCounter_.store(task.numPredecessors_, std::memory_order_relaxed);
+        minPriority_ = Min(minPriority_, task.item_.priority_);
+    }
+    numIncomplete_.store(numTasks_, std::memory_order_release);
+
+    for (unsigned i = 0; i < numTasks_; ++i)
+    {
+        Task& task = *tasks_[i];
+        if (task.numPredecessors_ == 0)
+            workQueue_->AddDetachedWorkItem(&task.item_, 0);
+    }
+}
+
+void TaskGraph::Wait()
+{
+    while (!IsCompleted())
+    {
+        // Help worker threads with the tasks of this graph only, unrelated work items may take long
+        workQueue_->ProcessItem(0, minPriority_, IsOwnTask, this);
+    }
+}
+
+void TaskGraph::ExecuteTaskWork(const WorkItem* item, unsigned threadIndex)
+{
+    auto* graph = reinterpret_cast<TaskGraph*>(item->start_);
+    auto* task = reinterpret_cast<Task*>(item->aux_);
+
+    task->function_(threadIndex);
+
+    // Successors are scheduled to the queue of the current thread, other threads may steal them
+    for (TaskHandle successorIndex : task->successors_)
+    {
+        Task* successor = graph->tasks_[successorIndex].get();
+        if (successor->joinCounter_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            graph->workQueue_->AddDetachedWorkItem(&successor->item_, threadIndex);
+    }
+
+    // Graph may be destroyed right after the last task is completed
+    graph->numIncomplete_.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+bool TaskGraph::IsOwnTask(const WorkItem* item, const void* graph)
+{
+    return item->workFunction_ == ExecuteTaskWork && item->start_ == graph;
+}
+
+}
@@ -0,0 +1,114 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Core/NonCopyable.h"
+#include "../Core/WorkQueue.h"
+
+#include <EASTL/unique_ptr.h>
+#include <EASTL/vector.h>
+
+#include <atomic>
+#include <functional>
+
+namespace Urho3D
+{
+
+/// Index of the task in the task graph.
+using TaskHandle = unsigned;
+
+/// Graph of tasks executed on work queue threads.
+/// Each task is scheduled as soon as all its predecessors are completed, so independent chains of tasks overlap.
+/// Graph is built and waited for by the main thread and may be executed many times.
+class URHO3D_API TaskGraph : private NonCopyable
+{
+public:
+    /// Task function. Called with the thread index (0 = main thread).
+    using TaskFunction = std::function<void(unsigned threadIndex)>;
+
+    /// Construct.
+    explicit TaskGraph(WorkQueue* workQueue);
+    /// Destruct. Wait for completion if executing.
+    ~TaskGraph();
+
+    /// Add task. Return task handle.
+    TaskHandle AddTask(TaskFunction function, unsigned priority = M_MAX_UNSIGNED);
+    /// Add dependency: task will not start until predecessor is completed. Dependencies that would form a cycle are rejected, return false in that case.
+    bool AddDependency(TaskHandle task, TaskHandle predecessor);
+    /// Add task that is executed after the predecessor is completed. Return task handle.
+    TaskHandle AddContinuation(TaskHandle predecessor, TaskFunction function, unsigned priority = M_MAX_UNSIGNED);
+    /// Remove all tasks. Graph must not be executing. Task storage is kept for reuse.
+    void Clear();
+
+    /// Start execution of all tasks. Graph must not be executing already.
+    void Run();
+    /// Wait for all tasks to complete. Main thread executes queued tasks of the graph in the meantime, other work items are not taken.
+    void Wait();
+    /// Run and wait for completion.
+    void Execute() { Run(); Wait(); }
+
+    /// Return number of tasks.
+    unsigned GetNumTasks() const { return numTasks_; }
+    /// Return whether all tasks are completed.
+    bool IsCompleted() const { return numIncomplete_.load(std::memory_order_acquire) == 0; }
+
+private:
+    /// Task internal data.
+    struct Task
+    {
+        /// Task function.
+        TaskFunction function_;
+        /// Tasks that depend on this task.
+        ea::vector<TaskHandle> successors_;
+        /// Number of predecessors.
+        unsigned numPredecessors_{};
+        /// Number of predecessors not yet completed.
+        std::atomic<unsigned> joinCounter_{};
+        /// Work item used for scheduling.
+        WorkItem item_;
+    };
+
+    /// Return whether target is reachable from the task through successors.
+    bool IsReachable(TaskHandle task, TaskHandle target);
+    /// Execute task and schedule successors that became ready.
+    static void ExecuteTaskWork(const WorkItem* item, unsigned threadIndex);
+    /// Return whether the work item is a task of the graph.
+    static bool IsOwnTask(const WorkItem* item, const void* graph);
+
+    /// Work queue.
+    WorkQueue* workQueue_{};
+    /// Tasks. Only first numTasks_ are used, the rest are kept to avoid allocations when graph is rebuilt.
+    ea::vector<ea::unique_ptr<Task>> tasks_;
+    /// Number of tasks in use.
+    unsigned numTasks_{};
+    /// Lowest priority of the tasks.
+    unsigned minPriority_{};
+    /// Number of tasks not yet completed.
+    std::atomic<unsigned> numIncomplete_{};
+    /// Tasks to visit when searching for cycles.
+    ea::vector<TaskHandle> searchStack_;
+    /// Tasks visited when searching for cycles.
+    ea::vector<bool> searchVisited_;
+};
+
+}
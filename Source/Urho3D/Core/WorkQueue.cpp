@@ -33,6 +33,64 @@
 namespace Urho3D
 {
 
+namespace
+{
+
+/// Work queue of the current thread.
+thread_local WorkQueue* currentThreadQueue = nullptr;
+/// Index of the current thread in the work queue.
+thread_local unsigned currentThreadIndex = M_MAX_UNSIGNED;
+
+/// Shared state of parallel loop.
+struct ParallelForState
+{
+    /// Callback invoker.
+    void (*invoke_)(const void* callback, unsigned beginIndex, unsigned endIndex, unsigned threadIndex){};
+    /// Callback.
+    const void* callback_{};
+    /// Number of elements.
+    unsigned count_{};
+    /// Minimum number of elements processed at once.
+    unsigned minChunkSize_{};
+    /// Number of threads processing the loop.
+    unsigned numParticipants_{};
+    /// Index of the first element not taken by any thread yet.
+    std::atomic<unsigned> nextIndex_{};
+    /// Number of helper work items not completed yet.
+    std::atomic<unsigned> numPendingHelpers_{};
+};
+
+/// Process chunks of parallel loop until there are none left.
+void ProcessParallelForChunks(ParallelForState& state, unsigned threadIndex)
+{
+    unsigned beginIndex = state.nextIndex_.load(std::memory_order_relaxed);
+    for (;;)
+    {
+        if (beginIndex >= state.count_)
+            return;
+
+        // Take big chunks first and smaller ones at the end to balance the load
+        const unsigned numRemaining = state.count_ - beginIndex;
+        const unsigned chunkSize = Max(state.minChunkSize_, numRemaining / (2 * state.numParticipants_));
+        const unsigned endIndex = beginIndex + Min(chunkSize, numRemaining);
+        if (state.nextIndex_.compare_exchange_weak(beginIndex, endIndex, std::memory_order_relaxed))
+        {
+            state.invoke_(state.callback_, beginIndex, endIndex, threadIndex);
+            beginIndex = endIndex;
+        }
+    }
+}
+
+/// Parallel loop work function for helper threads.
+void ParallelForWork(const WorkItem* item, unsigned threadIndex)
+{
+    auto state = reinterpret_cast<ParallelForState*>(item->aux_);
+    ProcessParallelForChunks(*state, threadIndex);
+    state->numPendingHelpers_.fetch_sub(1, std::memory_order_release);
+}
+
+}
+
 /// Worker thread managed by the work queue.
 class WorkerThread : public Thread, public RefCounted
 {
@@ -66,13 +124,17 @@ private:
 WorkQueue::WorkQueue(Context* context) :
     Object(context),
     shutDown_(false),
-    pausing_(false),
     paused_(false),
     completing_(false),
     tolerance_(10),
     lastSize_(0),
     maxNonThreadedWorkMs_(5)
 {
+    // Work queue is created in the main thread
+    currentThreadQueue = this;
+    currentThreadIndex = 0;
+
+    queues_.emplace_back(new ThreadQueues());
     SubscribeToEvent(E_BEGINFRAME, URHO3D_HANDLER(WorkQueue, HandleBeginFrame));
 }
 
@@ -84,6 +146,12 @@ WorkQueue::~WorkQueue()
 
     for (unsigned i = 0; i < threads_.size(); ++i)
         threads_[i]->Stop();
+
+    if (currentThreadQueue == this)
+    {
+        currentThreadQueue = nullptr;
+        currentThreadIndex = M_MAX_UNSIGNED;
+    }
 }
 
 void WorkQueue::CreateThreads(unsigned numThreads)
@@ -97,6 +165,10 @@ void WorkQueue::CreateThreads(unsigned numThreads)
     // Start threads in paused mode
     Pause();
 
+    // Allocate all queues before any thread is running
+    for (unsigned i = 0; i < numThreads; ++i)
+        queues_.emplace_back(new ThreadQueues());
+
     for (unsigned i = 0; i < numThreads; ++i)
     {
         SharedPtr<WorkerThread> thread(new WorkerThread(this, i + 1));
@@ -137,41 +209,33 @@ void WorkQueue::AddWorkItem(const SharedPtr<WorkItem>& item)
     // Check for duplicate items.
     assert(ea::find(workItems_.begin(), workItems_.end(), item) == workItems_.end());
 
-    // Push to the main thread list to keep item alive
-    // Clear completed flag in case item is reused
-    workItems_.push_back(item);
-    item->completed_ = false;
-
-    // Make sure worker threads' list is safe to modify
-    if (threads_.size() && !paused_)
-        queueMutex_.Acquire();
-
-    // Find position for new item
-    if (queue_.empty())
-        queue_.push_back(item.Get());
-    else
+    // Removed item stays referenced by the queues until it is discarded, adding it before would execute it twice
+    if (!removedItems_.empty())
     {
-        bool inserted = false;
-
-        for (auto i = queue_.begin(); i != queue_.end(); ++i)
+        auto i = ea::find(removedItems_.begin(), removedItems_.end(), item);
+        if (i != removedItems_.end())
         {
-            if ((*i)->priority_ <= item->priority_)
+            if (item->state_ != WorkItemState::Discarded)
             {
-                queue_.insert(i, item.Get());
-                inserted = true;
-                break;
+                URHO3D_LOGERROR("Removed work item can not be added again before the queue discards it");
+                return;
             }
+            removedItems_.erase(i);
         }
-
-        if (!inserted)
-            queue_.push_back(item.Get());
     }
 
+    // Push to the main thread list to keep item alive
+    // Clear completed flag in case item is reused
+    workItems_.push_back(item);
+    item->completed_ = false;
+    item->detached_ = false;
+    item->state_ = WorkItemState::Queued;
+
+    // Main thread owns the first deque, worker threads steal from it
+    queues_[0]->lanes_[GetLane(item->priority_)].Push(item.Get());
+
     if (threads_.size())
-    {
-        queueMutex_.Release();
-        paused_ = false;
-    }
+        Resume();
 }
 
 SharedPtr<WorkItem> WorkQueue::AddWorkItem(std::function<void()> workFunction, unsigned priority)
@@ -184,49 +248,143 @@ SharedPtr<WorkItem> WorkQueue::AddWorkItem(std::function<void()> workFunction, u
     return item;
 }
 
+void WorkQueue::AddDetachedWorkItem(WorkItem* item, unsigned threadIndex)
+{
+    item->completed_ = false;
+    item->detached_ = true;
+    item->state_ = WorkItemState::Queued;
+
+    queues_[threadIndex]->lanes_[GetLane(item->priority_)].Push(item);
+
+    // Only main thread owns the pause mutex
+    if (threadIndex == 0 && threads_.size())
+        Resume();
+}
+
+bool WorkQueue::ProcessItem(unsigned threadIndex, unsigned priority)
+{
+    ea::vector<WorkItem*>& skippedItems = queues_[threadIndex]->skippedItems_;
+    WorkItem* item = TakeItem(threadIndex, priority, skippedItems);
+    RequeueItems(threadIndex, skippedItems);
+
+    if (item)
+    {
+        ExecuteItem(item, threadIndex);
+        return true;
+    }
+    return false;
+}
+
+bool WorkQueue::ProcessItem(unsigned threadIndex, unsigned priority, bool (*filter)(const WorkItem* item, const void* filterContext),
+    const void* filterContext)
+{
+    ea::vector<WorkItem*>& skippedItems = queues_[threadIndex]->skippedItems_;
+    WorkItem* item = nullptr;
+    while ((item = TakeItem(threadIndex, priority, skippedItems)) && !filter(item, filterContext))
+        skippedItems.push_back(item);
+    RequeueItems(threadIndex, skippedItems);
+
+    if (item)
+    {
+        ExecuteItem(item, threadIndex);
+        return true;
+    }
+    return false;
+}
+
+void WorkQueue::ParallelForInternal(unsigned count, unsigned minChunkSize, ParallelForCallback invoke, const void* callback,
+    unsigned priority)
+{
+    if (count == 0)
+        return;
+
+    minChunkSize = Max(minChunkSize, 1u);
+    // Thread index of other threads would alias the per-thread state of the main thread
+    const unsigned callerIndex = currentThreadQueue == this ? currentThreadIndex : M_MAX_UNSIGNED;
+    assert(callerIndex != M_MAX_UNSIGNED);
+
+    // Execute small loops in place. Release builds also execute loops from other threads in place, as a last resort
+    const unsigned maxChunks = (count + minChunkSize - 1) / minChunkSize;
+    const unsigned numHelpers = callerIndex != M_MAX_UNSIGNED ? Min(GetNumThreads(), maxChunks - 1) : 0;
+    if (numHelpers == 0)
+    {
+        invoke(callback, 0, count, callerIndex != M_MAX_UNSIGNED ? callerIndex : 0);
+        return;
+    }
+
+    URHO3D_PROFILE("ParallelFor");
+
+    ParallelForState state;
+    state.invoke_ = invoke;
+    state.callback_ = callback;
+    state.count_ = count;
+    state.minChunkSize_ = minChunkSize;
+    state.numParticipants_ = numHelpers + 1;
+    state.numPendingHelpers_.store(numHelpers, std::memory_order_relaxed);
+
+    // Take helper items in stack order, nested loops on this thread use the items after these
+    ThreadQueues& callerQueues = *queues_[callerIndex];
+    const unsigned firstItem = callerQueues.numParallelForItemsUsed_;
+    callerQueues.numParallelForItemsUsed_ += numHelpers;
+    while (callerQueues.parallelForItems_.size() < callerQueues.numParallelForItemsUsed_)
+        callerQueues.parallelForItems_.emplace_back(new WorkItem());
+
+    for (unsigned i = 0; i < numHelpers; ++i)
+    {
+        WorkItem* item = callerQueues.parallelForItems_[firstItem + i].get();
+        item->workFunction_ = ParallelForWork;
+        item->aux_ = &state;
+        item->priority_ = priority;
+        AddDetachedWorkItem(item, callerIndex);
+    }
+
+    ProcessParallelForChunks(state, callerIndex);
+
+    // No chunks are left, so helpers that did not start yet are claimed here and never executed. Stale pointers to them
+    // may remain in the deques and are skipped by ExecuteItem. Unrelated items are not taken, as they may take long
+    for (unsigned i = 0; i < numHelpers; ++i)
+    {
+        WorkItem* item = callerQueues.parallelForItems_[firstItem + i].get();
+        WorkItemState expected = WorkItemState::Queued;
+        if (item->state_.compare_exchange_strong(expected, WorkItemState::Taken))
+            state.numPendingHelpers_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // Started helpers only finish their last chunk
+    while (state.numPendingHelpers_.load(std::memory_order_acquire) != 0)
+        Time::Sleep(0);
+
+    callerQueues.numParallelForItemsUsed_ = firstItem;
+}
+
 bool WorkQueue::RemoveWorkItem(SharedPtr<WorkItem> item)
 {
     if (!item)
         return false;
 
-    MutexLock lock(queueMutex_);
+    auto i = ea::find(workItems_.begin(), workItems_.end(), item);
+    if (i == workItems_.end())
+        return false;
 
     // Can only remove successfully if the item was not yet taken by threads for execution
-    auto i = ea::find(queue_.begin(), queue_.end(), item.Get());
-    if (i != queue_.end())
-    {
-        auto j = ea::find(workItems_.begin(), workItems_.end(), item);
-        if (j != workItems_.end())
-        {
-            queue_.erase(i);
-            ReturnToPool(item);
-            workItems_.erase(j);
-            return true;
-        }
-    }
+    WorkItemState expected = WorkItemState::Queued;
+    if (!item->state_.compare_exchange_strong(expected, WorkItemState::Removed))
+        return false;
 
-    return false;
+    // Item is still referenced by the queue, it will be returned to the pool once discarded
+    removedItems_.push_back(item);
+    workItems_.erase(i);
+    return true;
 }
 
 unsigned WorkQueue::RemoveWorkItems(const ea::vector<SharedPtr<WorkItem> >& items)
 {
-    MutexLock lock(queueMutex_);
     unsigned removed = 0;
 
-    for (auto i = items.begin(); i != items.end(); ++i)
+    for (const SharedPtr<WorkItem>& item : items)
     {
-        auto j = ea::find(queue_.begin(), queue_.end(), i->Get());
-        if (j != queue_.end())
-        {
-            auto k = ea::find(workItems_.begin(), workItems_.end(), *i);
-            if (k != workItems_.end())
-            {
-                queue_.erase(j);
-                ReturnToPool(*k);
-                workItems_.erase(k);
-                ++removed;
-            }
-        }
+        if (RemoveWorkItem(item))
+            ++removed;
     }
 
     return removed;
@@ -236,12 +394,8 @@ void WorkQueue::Pause()
 {
     if (!paused_)
     {
-        pausing_ = true;
-
-        queueMutex_.Acquire();
+        pauseMutex_.Acquire();
         paused_ = true;
-
-        pausing_ = false;
     }
 }
 
@@ -249,8 +403,8 @@ void WorkQueue::Resume()
 {
     if (paused_)
     {
-        queueMutex_.Release();
         paused_ = false;
+        pauseMutex_.Release();
     }
 }
 
@@ -259,48 +413,34 @@ void WorkQueue::Complete(unsigned priority)
 {
     completing_ = true;
 
+    // Lower priority items taken by the main thread are put aside and queued again when done
+    ea::vector<WorkItem*>& skippedItems = queues_[0]->skippedItems_;
     if (threads_.size())
     {
         Resume();
 
-        // Take work items also in the main thread until queue empty or no high-priority items anymore
-        while (!queue_.empty())
+        // Take work items also in the main thread until no high-priority items remain, then wait for threaded work
+        for (;;)
         {
-            queueMutex_.Acquire();
-            if (!queue_.empty() && queue_.front()->priority_ >= priority)
-            {
-                WorkItem* item = queue_.front();
-                queue_.pop_front();
-                queueMutex_.Release();
-                item->workFunction_(item, 0);
-                item->completed_ = true;
-            }
-            else
-            {
-                queueMutex_.Release();
+            if (WorkItem* item = TakeItem(0, priority, skippedItems))
+                ExecuteItem(item, 0);
+            else if (IsCompleted(priority))
                 break;
-            }
         }
 
-        // Wait for threaded work to complete
-        while (!IsCompleted(priority))
-        {
-        }
+        RequeueItems(0, skippedItems);
 
         // If no work at all remaining, pause worker threads by leaving the mutex locked
-        if (queue_.empty())
+        if (AreQueuesEmpty())
             Pause();
     }
     else
     {
         // No worker threads: ensure all high-priority items are completed in the main thread
-        while (!queue_.empty() && queue_.front()->priority_ >= priority)
-        {
-            WorkItem* item = queue_.front();
-            queue_.pop_front();
-            item->workFunction_(item, 0);
-            item->completed_ = true;
-        }
+        while (WorkItem* item = TakeItem(0, priority, skippedItems))
+            ExecuteItem(item, 0);
+
+        RequeueItems(0, skippedItems);
     }
 
     PurgeCompleted(priority);
@@ -330,38 +470,134 @@ bool WorkQueue::IsCompleted(unsigned priority) const
     return true;
 }
 
+unsigned WorkQueue::GetLane(unsigned priority)
+{
+    if (priority == M_MAX_UNSIGNED)
+        return LANE_HIGH;
+    else if (priority > 0)
+        return LANE_NORMAL;
+    else
+        return LANE_LOW;
+}
+
+unsigned WorkQueue::GetNumLanesToComplete(unsigned priority)
+{
+    return GetLane(priority) + 1;
+}
+
+WorkItem* WorkQueue::TakeItem(unsigned threadIndex, unsigned maxLane)
+{
+    const unsigned numQueues = queues_.size();
+    for (unsigned lane = 0; lane < maxLane; ++lane)
+    {
+        // Main thread takes its own items in submission order
+        WorkStealingDeque<WorkItem*>& ownDeque = queues_[threadIndex]->lanes_[lane];
+        if (WorkItem* item = threadIndex == 0 ? ownDeque.Steal() : ownDeque.Pop())
+            return item;
+
+        // Steal from other threads, starting from the next one to spread the contention
+        for (unsigned i = 1; i < numQueues; ++i)
+        {
+            const unsigned victimIndex = (threadIndex + i) % numQueues;
+            if (WorkItem* item = queues_[victimIndex]->lanes_[lane].Steal())
+                return item;
+        }
+    }
+    return nullptr;
+}
+
+WorkItem* WorkQueue::TakeItem(unsigned threadIndex, unsigned priority, ea::vector<WorkItem*>& skippedItems)
+{
+    // Normal lane holds a range of priorities, so it may return items below the requested priority
+    const unsigned maxLane = GetNumLanesToComplete(priority);
+    while (WorkItem* item = TakeItem(threadIndex, maxLane))
+    {
+        if (item->priority_ >= priority)
+            return item;
+        skippedItems.push_back(item);
+    }
+    return nullptr;
+}
+
+void WorkQueue::RequeueItems(unsigned threadIndex, ea::vector<WorkItem*>& items)
+{
+    if (items.empty())
+        return;
+
+    for (WorkItem* item : items)
+        queues_[threadIndex]->lanes_[GetLane(item->priority_)].Push(item);
+    items.clear();
+
+    if (threadIndex == 0 && threads_.size())
+        Resume();
+}
+
+void WorkQueue::ExecuteItem(WorkItem* item, unsigned threadIndex)
+{
+    WorkItemState expected = WorkItemState::Queued;
+    if (item->state_.compare_exchange_strong(expected, WorkItemState::Taken))
+    {
+        // Detached item may be destroyed by the owner as soon as work function returns
+        const bool detached = item->detached_;
+        item->workFunction_(item, threadIndex);
+        if (!detached)
+            item->completed_ = true;
+    }
+    else if (expected == WorkItemState::Removed)
+    {
+        // Item was removed, the queue does not reference it anymore
+        item->state_ = WorkItemState::Discarded;
+    }
+    else
+    {
+        // Detached item was claimed by its owner, this is a stale pointer
+        assert(item->detached_);
+    }
+}
+
+bool WorkQueue::AreQueuesEmpty() const
+{
+    for (const auto& threadQueues : queues_)
+    {
+        for (const WorkStealingDeque<WorkItem*>& deque : threadQueues->lanes_)
+        {
+            if (!deque.IsEmpty())
+                return false;
+        }
+    }
+    return true;
+}
+
+unsigned WorkQueue::GetThreadIndex()
+{
+    return currentThreadIndex;
+}
+
+WorkQueue* WorkQueue::GetThreadWorkQueue()
+{
+    return currentThreadQueue;
+}
+
 void WorkQueue::ProcessItems(unsigned threadIndex)
 {
-    bool wasActive = false;
+    currentThreadQueue = this;
+    currentThreadIndex = threadIndex;
 
     for (;;)
     {
         if (shutDown_)
             return;
 
-        if (pausing_ && !wasActive)
-            Time::Sleep(0);
-        else
+        if (WorkItem* item = TakeItem(threadIndex, MAX_LANES))
+            ExecuteItem(item, threadIndex);
+        else if (paused_)
         {
-            queueMutex_.Acquire();
-            if (!queue_.empty())
-            {
-                wasActive = true;
-
-                WorkItem* item = queue_.front();
-                queue_.pop_front();
-                queueMutex_.Release();
-                item->workFunction_(item, threadIndex);
-                item->completed_ = true;
-            }
-            else
-            {
-                wasActive = false;
-
-                queueMutex_.Release();
-                Time::Sleep(0);
-            }
+            // Block until resumed
+            pauseMutex_.Acquire();
+            pauseMutex_.Release();
         }
+        else
+            Time::Sleep(0);
     }
 }
 
@@ -389,6 +625,18 @@ void WorkQueue::PurgeCompleted(unsigned priority)
         else
             ++i;
     }
+
+    // Recycle removed items that were discarded by the queue
+    for (auto i = removedItems_.begin(); i != removedItems_.end();)
+    {
+        if ((*i)->state_ == WorkItemState::Discarded)
+        {
+            ReturnToPool(*i);
+            i = removedItems_.erase(i);
+        }
+        else
+            ++i;
+    }
 }
 
 void WorkQueue::PurgePool()
@@ -427,18 +675,18 @@ void WorkQueue::ReturnToPool(SharedPtr<WorkItem>& item)
 void WorkQueue::HandleBeginFrame(StringHash eventType, VariantMap& eventData)
 {
     // If no worker threads, complete low-priority work here
-    if (threads_.empty() && !queue_.empty())
+    if (threads_.empty() && !AreQueuesEmpty())
     {
         URHO3D_PROFILE("CompleteWorkNonthreaded");
 
         HiresTimer timer;
 
-        while (!queue_.empty() && timer.GetUSec(false) < maxNonThreadedWorkMs_ * 1000LL)
+        while (timer.GetUSec(false) < maxNonThreadedWorkMs_ * 1000LL)
         {
-            WorkItem* item = queue_.front();
-            queue_.pop_front();
-            item->workFunction_(item, 0);
-            item->completed_ = true;
+            WorkItem* item = TakeItem(0, MAX_LANES);
+            if (!item)
+                break;
+            ExecuteItem(item, 0);
         }
     }
 
@@ -23,12 +23,12 @@
 #pragma once
 
 #include <EASTL/list.h>
+#include <EASTL/unique_ptr.h>
 #include <atomic>
 
 #include "../Core/Mutex.h"
 #include "../Core/Object.h"
-
-#include <atomic>
+#include "../Core/WorkStealingDeque.h"
 
 namespace Urho3D
 {
@@ -41,6 +41,19 @@ URHO3D_EVENT(E_WORKITEMCOMPLETED, WorkItemCompleted)
 
 class WorkerThread;
 
+/// Execution state of the work item.
+enum class WorkItemState : unsigned char
+{
+    /// Item is waiting in the queue.
+    Queued,
+    /// Item was taken by a thread for execution.
+    Taken,
+    /// Item was removed from the queue before execution, but may still be referenced by the queue.
+    Removed,
+    /// Removed item is no longer referenced by the queue.
+    Discarded,
+};
+
 /// Work queue item.
 struct WorkItem : public RefCounted
 {
@@ -64,8 +77,12 @@ public:
 
 private:
     bool pooled_{};
+    /// Whether the item is not tracked by the queue.
+    bool detached_{};
     /// Work function. Called without any parameters.
     std::function<void()> workLambda_;
+    /// Execution state.
+    std::atomic<WorkItemState> state_{};
 };
 
 /// Work queue subsystem for multithreading.
@@ -85,11 +102,20 @@ public:
     void CreateThreads(unsigned numThreads);
     /// Get pointer to an usable WorkItem from the item pool. Allocate one if no more free items.
     SharedPtr<WorkItem> GetFreeItem();
-    /// Add a work item and resume worker threads.
+    /// Add a work item and resume worker threads. A removed item can be added again only after the queue has discarded it.
     void AddWorkItem(const SharedPtr<WorkItem>& item);
     /// Add a work item and resume worker threads.
     SharedPtr<WorkItem> AddWorkItem(std::function<void()> workFunction, unsigned priority = 0);
-    /// Remove a work item before it has started executing. Return true if successfully removed.
+    /// Add a work item that is not tracked by the queue to the queue of the calling thread (0 = main thread).
+    /// The item is not kept alive, not pooled and not marked completed, caller is responsible for tracking its execution.
+    void AddDetachedWorkItem(WorkItem* item, unsigned threadIndex);
+    /// Execute one queued work item which has at least the specified priority, if any. Return true if an item was executed.
+    bool ProcessItem(unsigned threadIndex, unsigned priority);
+    /// Execute one queued work item which has at least the specified priority and is accepted by filter(item, filterContext), if any.
+    /// Other items stay queued. Return true if an item was executed.
+    bool ProcessItem(unsigned threadIndex, unsigned priority, bool (*filter)(const WorkItem* item, const void* filterContext),
+        const void* filterContext);
+    /// Remove a work item before it has started executing. Return true if successfully removed. The queue discards the removed item when a thread reaches it.
     bool RemoveWorkItem(SharedPtr<WorkItem> item);
     /// Remove a number of work items before they have started executing. Return the number of items successfully removed.
     unsigned RemoveWorkItems(const ea::vector<SharedPtr<WorkItem> >& items);
@@ -100,6 +126,41 @@ public:
     /// Finish all queued work which has at least the specified priority. Main thread will also execute priority work. Pause worker threads if no more work remains.
     void Complete(unsigned priority);
 
+    /// Invoke callback(beginIndex, endIndex, threadIndex) for all indices in [0, count) on the calling thread and worker threads.
+    /// Chunks are taken dynamically with decreasing size but not smaller than minChunkSize, so uneven per-item cost is balanced.
+    /// Must be called from the main thread or a worker thread of this queue: callers index per-thread state with the thread
+    /// index, and other threads have none. Returns when all chunks are processed. Priority is used for the work items of helper threads.
+    /// While waiting for the helpers, the calling thread does not take unrelated work items, so long background work
+    /// can not delay the loop.
+    template <class T>
+    void ParallelFor(unsigned count, unsigned minChunkSize, const T& callback, unsigned priority = M_MAX_UNSIGNED)
+    {
+        const auto invoke = [](const void* storage, unsigned beginIndex, unsigned endIndex, unsigned threadIndex)
+        {
+            (*static_cast<const T*>(storage))(beginIndex, endIndex, threadIndex);
+        };
+        ParallelForInternal(count, minChunkSize, invoke, &callback, priority);
+    }
+
+    /// Compute value = map(beginIndex, endIndex, threadIndex) for chunks of [0, count) in parallel and combine values with reduce(lhs, rhs).
+    /// Reduce function must be associative and commutative.
+    template <class T, class MapFunction, class ReduceFunction>
+    T ParallelReduce(unsigned count, unsigned minChunkSize, const T& identity, const MapFunction& map, const ReduceFunction& reduce,
+        unsigned priority = M_MAX_UNSIGNED)
+    {
+        // Each thread accumulates its own value
+        ea::vector<T> threadValues(GetNumThreads() + 1, identity);
+        ParallelFor(count, minChunkSize, [&](unsigned beginIndex, unsigned endIndex, unsigned threadIndex)
+        {
+            threadValues[threadIndex] = reduce(threadValues[threadIndex], map(beginIndex, endIndex, threadIndex));
+        }, priority);
+
+        T result = identity;
+        for (const T& value : threadValues)
+            result = reduce(result, value);
+        return result;
+    }
+
     /// Set the pool telerance before it starts deleting pool items.
     void SetTolerance(int tolerance) { tolerance_ = tolerance; }
 
@@ -108,6 +169,10 @@ public:
 
     /// Return number of worker threads.
     unsigned GetNumThreads() const { return threads_.size(); }
+    /// Return index of the calling thread: 0 for main thread, 1 and above for worker threads, M_MAX_UNSIGNED for other threads.
+    static unsigned GetThreadIndex();
+    /// Return work queue that owns the calling thread, or null for threads that are neither main nor worker threads.
+    static WorkQueue* GetThreadWorkQueue();
 
     /// Return number of incomplete tasks with at least the specified priority.
     unsigned GetNumIncomplete(unsigned priority) const;
@@ -123,6 +188,49 @@ public:
     int GetNonThreadedWorkMs() const { return maxNonThreadedWorkMs_; }
 
 private:
+    /// Priority lanes. Items of higher lane are always taken first.
+    enum PriorityLane
+    {
+        /// Priority M_MAX_UNSIGNED, used for engine work that is completed within the frame.
+        LANE_HIGH = 0,
+        /// Priority between 0 and M_MAX_UNSIGNED exclusive.
+        LANE_NORMAL,
+        /// Priority 0, used for background work.
+        LANE_LOW,
+        MAX_LANES
+    };
+
+    /// Per-thread lock-free work item deques, one for each priority lane.
+    struct ThreadQueues
+    {
+        WorkStealingDeque<WorkItem*> lanes_[MAX_LANES];
+        /// Work items for parallel loops started by the thread. Reused in stack order by nested loops.
+        ea::vector<ea::unique_ptr<WorkItem> > parallelForItems_;
+        /// Number of parallel loop work items in use.
+        unsigned numParallelForItemsUsed_{};
+        /// Items put aside by the thread while looking for items to execute.
+        ea::vector<WorkItem*> skippedItems_;
+    };
+
+    /// Type-erased parallel loop callback.
+    using ParallelForCallback = void(*)(const void* callback, unsigned beginIndex, unsigned endIndex, unsigned threadIndex);
+    /// Execute parallel loop.
+    void ParallelForInternal(unsigned count, unsigned minChunkSize, ParallelForCallback invoke, const void* callback, unsigned priority);
+
+    /// Return lane for given priority.
+    static unsigned GetLane(unsigned priority);
+    /// Return number of lanes, starting from the highest, that may contain items of at least the specified priority.
+    static unsigned GetNumLanesToComplete(unsigned priority);
+    /// Take work item from own deque or steal it from other threads. Only lanes below maxLane are checked.
+    WorkItem* TakeItem(unsigned threadIndex, unsigned maxLane);
+    /// Take work item which has at least the specified priority. Lower priority items taken meanwhile are appended to skippedItems.
+    WorkItem* TakeItem(unsigned threadIndex, unsigned priority, ea::vector<WorkItem*>& skippedItems);
+    /// Push items back to the deques of the calling thread and clear the vector.
+    void RequeueItems(unsigned threadIndex, ea::vector<WorkItem*>& items);
+    /// Execute work item if it was not removed.
+    void ExecuteItem(WorkItem* item, unsigned threadIndex);
+    /// Return whether all queues are empty.
+    bool AreQueuesEmpty() const;
     /// Process work items until shut down. Called by the worker threads.
     void ProcessItems(unsigned threadIndex);
     /// Purge completed work items which have at least the specified priority, and send completion events as necessary.
@@ -140,16 +248,16 @@ private:
     ea::list<SharedPtr<WorkItem> > poolItems_;
     /// Work item collection. Accessed only by the main thread.
     ea::list<SharedPtr<WorkItem> > workItems_;
-    /// Work item prioritized queue for worker threads. Pointers are guaranteed to be valid (point to workItems).
-    ea::list<WorkItem*> queue_;
-    /// Worker queue mutex.
-    Mutex queueMutex_;
+    /// Removed work items that may still be referenced by the queues. Accessed only by the main thread.
+    ea::list<SharedPtr<WorkItem> > removedItems_;
+    /// Work item queues for main thread (index 0) and worker threads. Pointers are guaranteed to be valid (point to workItems or removedItems).
+    ea::vector<ea::unique_ptr<ThreadQueues> > queues_;
+    /// Mutex that is kept locked while paused to prevent worker threads using up CPU time.
+    Mutex pauseMutex_;
     /// Shutting down flag.
     std::atomic<bool> shutDown_;
-    /// Pausing flag. Indicates the worker threads should not contend for the queue mutex.
-    std::atomic<bool> pausing_;
-    /// Paused flag. Indicates the queue mutex being locked to prevent worker threads using up CPU time.
-    bool paused_;
+    /// Paused flag.
+    std::atomic<bool> paused_;
     /// Completing work in the main thread flag.
     bool completing_;
     /// Tolerance for the shared pool before it begins to deallocate.
@@ -0,0 +1,157 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+#pragma once
+
+#include "../Core/NonCopyable.h"
+
+#include <EASTL/unique_ptr.h>
+#include <EASTL/vector.h>
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+namespace Urho3D
+{
+
+/// Lock-free single-owner work-stealing deque of pointers (Chase-Lev, weak memory model variant).
+/// Owner thread pushes and pops at the bottom, any other thread may steal from the top.
+template <class T>
+class WorkStealingDeque : private NonCopyable
+{
+    static_assert(std::is_pointer<T>::value, "WorkStealingDeque can only store pointers");
+
+    /// Ring buffer of items. Old buffers are retired but kept alive because thieves may still read them.
+    struct Buffer
+    {
+        explicit Buffer(int64_t capacity)
+            : capacity_(capacity)
+            , mask_(capacity - 1)
+            , items_(new std::atomic<T>[capacity])
+        {
+        }
+
+        T Get(int64_t index) const { return items_[index & mask_].load(std::memory_order_relaxed); }
+        void Put(int64_t index, T item) { items_[index & mask_].store(item, std::memory_order_relaxed); }
+
+        /// Return buffer of twice the size with the same [top, bottom) range of items.
+        Buffer* Grow(int64_t top, int64_t bottom) const
+        {
+            auto newBuffer = new Buffer(capacity_ * 2);
+            for (int64_t i = top; i != bottom; ++i)
+                newBuffer->Put(i, Get(i));
+            return newBuffer;
+        }
+
+        const int64_t capacity_;
+        const int64_t mask_;
+        ea::unique_ptr<std::atomic<T>[]> items_;
+    };
+
+public:
+    /// Construct. Capacity must be a power of two.
+    explicit WorkStealingDeque(int64_t capacity = 256)
+    {
+        buffers_.emplace_back(new Buffer(capacity));
+        buffer_.store(buffers_.back().get(), std::memory_order_relaxed);
+    }
+
+    /// Push item to the bottom. Owner thread only.
+    void Push(T item)
+    {
+        const int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        const int64_t top = top_.load(std::memory_order_acquire);
+        Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+        if (bottom - top > buffer->capacity_ - 1)
+        {
+            buffers_.emplace_back(buffer->Grow(top, bottom));
+            buffer = buffers_.back().get();
+            buffer_.store(buffer, std::memory_order_release);
+        }
+        buffer->Put(bottom, item);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom_.store(bottom + 1, std::memory_order_relaxed);
+    }
+
+    /// Pop item from the bottom. Owner thread only. Return null if empty.
+    T Pop()
+    {
+        const int64_t bottom = bottom_.load(std::memory_order_relaxed) - 1;
+        Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+        bottom_.store(bottom, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t top = top_.load(std::memory_order_relaxed);
+
+        T item = nullptr;
+        if (top <= bottom)
+        {
+            item = buffer->Get(bottom);
+            if (top == bottom)
+            {
+                // Last item, race against thieves
+                if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                    item = nullptr;
+                bottom_.store(bottom + 1, std::memory_order_relaxed);
+            }
+        }
+        else
+            bottom_.store(bottom + 1, std::memory_order_relaxed);
+        return item;
+    }
+
+    /// Steal item from the top. Safe to call from any thread. Return null if empty or if lost the race.
+    T Steal()
+    {
+        int64_t top = top_.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const int64_t bottom = bottom_.load(std::memory_order_acquire);
+        if (top >= bottom)
+            return nullptr;
+
+        Buffer* buffer = buffer_.load(std::memory_order_acquire);
+        T item = buffer->Get(top);
+        if (!top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            return nullptr;
+        return item;
+    }
+
+    /// Return whether the deque is empty. The result is approximate if other threads are modifying the deque.
+    bool IsEmpty() const
+    {
+        const int64_t bottom = bottom_.load(std::memory_order_relaxed);
+        const int64_t top = top_.load(std::memory_order_relaxed);
+        return bottom <= top;
+    }
+
+private:
+    /// Index of the top item. Modified by thieves.
+    alignas(64) std::atomic<int64_t> top_{};
+    /// Index past the bottom item. Modified by owner only.
+    alignas(64) std::atomic<int64_t> bottom_{};
+    /// Current buffer.
+    alignas(64) std::atomic<Buffer*> buffer_{};
+    /// All allocated buffers. Accessed by owner only.
+    ea::vector<ea::unique_ptr<Buffer>> buffers_;
+};
+
+}
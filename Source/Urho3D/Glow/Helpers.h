@@ -23,6 +23,7 @@
 #pragma once
 
 #include "../Core/Context.h"
+#include "../Core/WorkQueue.h"
 #include "../Graphics/Material.h"
 #include "../Graphics/RenderPath.h"
 #include "../Graphics/StaticModel.h"
@@ -34,31 +35,25 @@
 
 #include <EASTL/string.h>
 
-#include <future>
-
 namespace Urho3D
 {
 
-/// Parallel loop.
+/// Parallel loop on the work queue of the calling thread. Number of tasks limits the smallest chunk size.
+/// Executed in place if called from the thread not owned by work queue.
 template <class T>
 void ParallelFor(unsigned count, unsigned numTasks, const T& callback)
 {
-    // Post async tasks
-    ea::vector<std::future<void>> tasks;
-    const unsigned chunkSize = (count + numTasks - 1) / numTasks;
-    for (unsigned i = 0; i < numTasks; ++i)
+    WorkQueue* workQueue = WorkQueue::GetThreadWorkQueue();
+    if (!workQueue)
     {
-        tasks.push_back(std::async([&, i]()
-        {
-            const unsigned fromIndex = i * chunkSize;
-            const unsigned toIndex = ea::min(fromIndex + chunkSize, count);
-            callback(fromIndex, toIndex);
-        }));
+        callback(0, count);
+        return;
     }
 
-    // Wait for async tasks
-    for (auto& task : tasks)
-        task.wait();
+    // Baking is background work and should not delay work of higher priority
+    const unsigned minChunkSize = Max(1u, count / Max(1u, numTasks));
+    workQueue->ParallelFor(count, minChunkSize,
+        [&](unsigned fromIndex, unsigned toIndex, unsigned) { callback(fromIndex, toIndex); }, 0);
 }
 
 /// Load render path.
@@ -30,7 +30,6 @@
 #include <embree3/rtcore.h>
 #include <embree3/rtcore_ray.h>
 
-#include <future>
 
 using namespace embree3;
 
@@ -46,7 +46,6 @@
 
 #include <EASTL/sort.h>
 
-#include <future>
 
 namespace Urho3D
 {
@@ -331,25 +330,19 @@ LightmapGeometryBakingScenesArray GenerateLightmapGeometryBakingScenes(
             usedModels.insert(staticModel->GetModel());
     }
 
-    // Schedule model seams collecting
-    ea::vector<std::future<ea::pair<Model*, LightmapSeamVector>>> collectSeamsTasks;
-    for (Model* model : usedModels)
+    // Collect model seams
+    const ea::vector<Model*> usedModelsArray(usedModels.begin(), usedModels.end());
+    ea::vector<LightmapSeamVector> usedModelsSeams(usedModelsArray.size());
+    ParallelFor(usedModelsArray.size(), usedModelsArray.size(), [&](unsigned fromIndex, unsigned toIndex)
     {
-        const unsigned uvChannel = settings.uvChannel_;
-        collectSeamsTasks.push_back(std::async([model, uvChannel]()
-        {
-            LightmapSeamVector modelSeams = CollectModelSeams(model, uvChannel);
-            return ea::make_pair(model, ea::move(modelSeams));
-        }));
-    }
+        for (unsigned i = fromIndex; i < toIndex; ++i)
+            usedModelsSeams[i] = CollectModelSeams(usedModelsArray[i], settings.uvChannel_);
+    });
 
     // Cache model seams
     ea::hash_map<Model*, LightmapSeamVector> modelSeamsCache;
-    for (auto& task : collectSeamsTasks)
-    {
-        auto result = task.get();
-        modelSeamsCache.emplace(result.first, ea::move(result.second));
-    }
+    for (unsigned i = 0; i < usedModelsArray.size(); ++i)
+        modelSeamsCache.emplace(usedModelsArray[i], ea::move(usedModelsSeams[i]));
 
     // Zero ID is reserved for invalid texels
     GeometryIDToObjectMappingVector mapping;
@@ -70,6 +70,8 @@ static bool CompareAnimationOrder(const SharedPtr<AnimationState>& lhs, const Sh
 }
 
 static const unsigned MAX_ANIMATION_STATES = 256;
+/// Number of distinct animation state weights between zero and one for pose sharing.
+static const float POSE_SHARING_WEIGHT_STEPS = 128.0f;
 
 AnimatedModel::AnimatedModel(Context* context) :
     StaticModel(context),
@@ -123,6 +125,9 @@ void AnimatedModel::RegisterObject(Context* context)
     URHO3D_ACCESSOR_ATTRIBUTE("Shadow Distance", GetShadowDistance, SetShadowDistance, float, 0.0f, AM_DEFAULT);
     URHO3D_ACCESSOR_ATTRIBUTE("LOD Bias", GetLodBias, SetLodBias, float, 1.0f, AM_DEFAULT);
     URHO3D_ACCESSOR_ATTRIBUTE("Animation LOD Bias", GetAnimationLodBias, SetAnimationLodBias, float, 1.0f, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Pose Sharing Tolerance", GetPoseSharingTolerance, SetPoseSharingTolerance, float, 0.0f, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Reduced Skeleton Distance", GetReducedSkeletonDistance, SetReducedSkeletonDistance, float, 0.0f, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Reduced Skeleton Depth", GetReducedSkeletonDepth, SetReducedSkeletonDepth, unsigned, 2, AM_DEFAULT);
     URHO3D_COPY_BASE_ATTRIBUTES(Drawable);
     URHO3D_MIXED_ACCESSOR_ATTRIBUTE("Bone Animation Enabled", GetBonesEnabledAttr, SetBonesEnabledAttr, VariantVector,
         Variant::emptyVariantVector, AM_FILE | AM_NOEDIT);
@@ -309,6 +314,9 @@ void AnimatedModel::UpdateBatches(const FrameInfo& frame)
         lodDistance_ = newLodDistance;
         CalculateLodLevels();
     }
+
+    if (skinMatrices_.size() && !softwareSkinning_)
+        AllocateArenaSkinMatrices(frame);
 }
 
 void AnimatedModel::UpdateGeometry(const FrameInfo& frame)
@@ -321,7 +329,11 @@ void AnimatedModel::UpdateGeometry(const FrameInfo& frame)
     }
 
     if (skinningDirty_)
+    {
         UpdateSkinning();
+        if (arenaSkinMatrices_ && arenaSkinMatrixFrameNumber_.load(std::memory_order_relaxed) == frame.frameNumber_)
+            CopyArenaSkinMatrices();
+    }
 
     if (morphsDirty_)
         UpdateMorphs();
@@ -411,9 +423,14 @@ void AnimatedModel::SetModel(Model* model, bool createBones)
         skinMatrices_.resize(skeleton_.GetNumBones());
         SetGeometryBoneMappings();
 
-        // Enable skinning in batches
+        // Enable skinning in batches. Skinning matrices are moved to the skin matrix arena once the model is rendered,
+        // if the arena is enabled
+        arenaSkinMatrices_ = nullptr;
+        arenaSkinMatrixOffset_ = M_MAX_UNSIGNED;
+        arenaSkinMatrixFrameNumber_.store(M_MAX_UNSIGNED, std::memory_order_relaxed);
         for (unsigned i = 0; i < batches_.size(); ++i)
         {
+            batches_[i].skinMatrixOffset_ = M_MAX_UNSIGNED;
             if (skinMatrices_.size() && !softwareSkinning_)
             {
                 batches_[i].geometryType_ = GEOM_SKINNED;
@@ -570,6 +587,26 @@ void AnimatedModel::SetUpdateInvisible(bool enable)
     MarkNetworkUpdate();
 }
 
+void AnimatedModel::SetPoseSharingTolerance(float tolerance)
+{
+    poseSharingTolerance_ = Max(tolerance, 0.0f);
+    MarkNetworkUpdate();
+}
+
+void AnimatedModel::SetReducedSkeletonDistance(float distance)
+{
+    reducedSkeletonDistance_ = Max(distance, 0.0f);
+    MarkAnimationDirty();
+    MarkNetworkUpdate();
+}
+
+void AnimatedModel::SetReducedSkeletonDepth(unsigned depth)
+{
+    reducedSkeletonDepth_ = depth;
+    MarkAnimationDirty();
+    MarkNetworkUpdate();
+}
+
 
 void AnimatedModel::SetMorphWeight(unsigned index, float weight)
 {
@@ -765,6 +802,7 @@ void AnimatedModel::SetSkeleton(const Skeleton& skeleton, bool createBones)
             RemoveRootBone();
 
         skeleton_.Define(skeleton);
+        skeletonPose_.Clear();
 
         // Merge bounding boxes from non-master models
         FinalizeBoneBoundingBoxes();
@@ -802,6 +840,7 @@ void AnimatedModel::SetSkeleton(const Skeleton& skeleton, bool createBones)
     {
         // For non-master models: use the bone nodes of the master model
         skeleton_.Define(skeleton);
+        skeletonPose_.Clear();
 
         // Instruct the master model to refresh (merge) its bone bounding boxes
         auto* master = node_->GetComponent<AnimatedModel>();
@@ -1213,21 +1252,67 @@ void AnimatedModel::ApplyAnimation()
     // (first AnimatedModel in a node)
     if (isMaster_)
     {
-        skeleton_.ResetSilent();
-        for (auto i = animationStates_.begin(); i !=
-            animationStates_.end(); ++i)
-            (*i)->Apply();
+        // Far away only the bones close to the root are animated, the rest keep their initial transforms
+        const bool reducedSkeleton = reducedSkeletonDistance_ > 0.0f && animationLodDistance_ >= reducedSkeletonDistance_;
+        const unsigned maxBoneDepth = reducedSkeleton ? reducedSkeletonDepth_ : M_MAX_UNSIGNED;
+
+        // Reuse the pose of another model playing the same animations at nearly the same time if possible
+        Octree* octree = octant_ ? octant_->GetRoot() : nullptr;
+        AnimationPoseCache* poseCache = octree && poseSharingTolerance_ > 0.0f && UpdatePoseKey(maxBoneDepth)
+            ? &octree->GetAnimationPoseCache() : nullptr;
+
+        // Blend all animations into the pose arrays first, then write the bone nodes in one pass
+        skeletonPose_.Reset(skeleton_);
+        if (!poseCache || !poseCache->GetPose(poseKey_, skeletonPose_))
+        {
+            for (auto i = animationStates_.begin(); i != animationStates_.end(); ++i)
+                (*i)->ApplyToPose(skeletonPose_, maxBoneDepth);
+            if (poseCache)
+                poseCache->StorePose(poseKey_, skeletonPose_);
+        }
+        skeletonPose_.ApplySilent(skeleton_);
 
-        // Skeleton reset and animations apply the node transforms "silently" to avoid repeated marking dirty. Mark dirty now
+        // Pose applies the node transforms "silently" to avoid repeated marking dirty. Mark dirty now
         node_->MarkDirty();
 
-        // Calculate new bone bounding box
+        // Calculate new bone bounding box. The world transforms of the bone nodes evaluated here are reused for skinning
         UpdateBoneBoundingBox();
     }
 
     animationDirty_ = false;
 }
 
+bool AnimatedModel::UpdatePoseKey(unsigned maxBoneDepth)
+{
+    // Poses with manually controlled bones, partial skeletons or per-bone weights are unique
+    for (const Bone& bone : skeleton_.GetBones())
+    {
+        if (!bone.animated_)
+            return false;
+    }
+
+    const Bone* rootBone = skeleton_.GetRootBone();
+    poseKey_.Reset(model_, poseSharingTolerance_, maxBoneDepth);
+    for (const SharedPtr<AnimationState>& state : animationStates_)
+    {
+        if (!state->GetAnimation() || !state->IsEnabled())
+            continue;
+        if (state->GetStartBone() != rootBone || state->HasBoneWeights())
+            return false;
+
+        AnimationPoseKeyState keyState;
+        keyState.animation_ = state->GetAnimation();
+        keyState.time_ = FloorToInt(state->GetTime() / poseSharingTolerance_);
+        keyState.weight_ = static_cast<unsigned>(RoundToInt(state->GetWeight() * POSE_SHARING_WEIGHT_STEPS));
+        keyState.layer_ = state->GetLayer();
+        keyState.blendMode_ = static_cast<unsigned char>(state->GetBlendMode());
+        keyState.looped_ = state->IsLooped();
+        poseKey_.AddState(keyState);
+    }
+
+    return true;
+}
+
 void AnimatedModel::UpdateSkinning()
 {
     // Note: the model's world transform will be baked in the skin matrices
@@ -1271,6 +1356,80 @@ void AnimatedModel::UpdateSkinning()
         morphsDirty_ = true;
 }
 
+void AnimatedModel::AllocateArenaSkinMatrices(const FrameInfo& frame)
+{
+    // Arena is disabled by default, then the batches keep pointing to the model's own matrices
+    Octree* octree = octant_ ? octant_->GetRoot() : nullptr;
+    SkinMatrixArena* arena = octree && octree->GetSkinMatrixArena().IsEnabled() ? &octree->GetSkinMatrixArena() : nullptr;
+    if (!arena && !arenaSkinMatrices_)
+        return;
+
+    // Shadow casters outside the view may have their batches updated from several threads at once. Only the first one
+    // allocates
+    unsigned lastFrameNumber = arenaSkinMatrixFrameNumber_.load(std::memory_order_relaxed);
+    if (lastFrameNumber == frame.frameNumber_
+        || !arenaSkinMatrixFrameNumber_.compare_exchange_strong(lastFrameNumber, frame.frameNumber_))
+        return;
+
+    // Per-geometry matrices are packed first, followed by the global matrices if any geometry uses them
+    unsigned numMatrices = 0;
+    bool useGlobalMatrices = false;
+    for (unsigned i = 0; i < batches_.size(); ++i)
+    {
+        if (geometrySkinMatrices_.size() && geometrySkinMatrices_[i].size())
+            numMatrices += geometrySkinMatrices_[i].size();
+        else
+            useGlobalMatrices = true;
+    }
+    const unsigned globalMatricesOffset = numMatrices;
+    if (useGlobalMatrices)
+        numMatrices += skinMatrices_.size();
+
+    arenaSkinMatrixOffset_ = arena ? arena->Allocate(numMatrices) : M_MAX_UNSIGNED;
+    arenaSkinMatrices_ = arenaSkinMatrixOffset_ != M_MAX_UNSIGNED ? arena->GetMatrices(arenaSkinMatrixOffset_) : nullptr;
+
+    // If the arena was disabled or is exhausted, render from the model's own matrices
+    unsigned geometryMatricesOffset = 0;
+    for (unsigned i = 0; i < batches_.size(); ++i)
+    {
+        SourceBatch& batch = batches_[i];
+        const bool useGeometryMatrices = geometrySkinMatrices_.size() && geometrySkinMatrices_[i].size();
+        const unsigned offset = useGeometryMatrices ? geometryMatricesOffset : globalMatricesOffset;
+        if (arenaSkinMatrices_)
+        {
+            batch.worldTransform_ = arenaSkinMatrices_ + offset;
+            batch.skinMatrixOffset_ = arenaSkinMatrixOffset_ + offset;
+        }
+        else
+        {
+            batch.worldTransform_ = useGeometryMatrices ? &geometrySkinMatrices_[i][0] : &skinMatrices_[0];
+            batch.skinMatrixOffset_ = M_MAX_UNSIGNED;
+        }
+
+        if (useGeometryMatrices)
+            geometryMatricesOffset += geometrySkinMatrices_[i].size();
+    }
+
+    // Otherwise the matrices are copied after skinning is updated
+    if (arenaSkinMatrices_ && !skinningDirty_)
+        CopyArenaSkinMatrices();
+}
+
+void AnimatedModel::CopyArenaSkinMatrices()
+{
+    bool globalMatricesCopied = false;
+    for (unsigned i = 0; i < batches_.size(); ++i)
+    {
+        const bool useGeometryMatrices = geometrySkinMatrices_.size() && geometrySkinMatrices_[i].size();
+        if (!useGeometryMatrices && globalMatricesCopied)
+            continue;
+
+        const ea::vector<Matrix3x4>& matrices = useGeometryMatrices ? geometrySkinMatrices_[i] : skinMatrices_;
+        ea::copy(matrices.begin(), matrices.end(), arenaSkinMatrices_ + batches_[i].skinMatrixOffset_ - arenaSkinMatrixOffset_);
+        globalMatricesCopied |= !useGeometryMatrices;
+    }
+}
+
 void AnimatedModel::UpdateMorphs()
 {
     auto* graphics = GetSubsystem<Graphics>();
@@ -22,10 +22,13 @@
 
 #pragma once
 
+#include "../Graphics/AnimationPoseCache.h"
 #include "../Graphics/Model.h"
 #include "../Graphics/Skeleton.h"
 #include "../Graphics/StaticModel.h"
 
+#include <atomic>
+
 namespace Urho3D
 {
 
@@ -92,6 +95,12 @@ public:
     void SetAnimationLodBias(float bias);
     /// Set whether to update animation and the bounding box when not visible. Recommended to enable for physically controlled models like ragdolls.
     void SetUpdateInvisible(bool enable);
+    /// Set time tolerance for reusing skeleton poses of other models that play the same animations. Zero (default) disables pose sharing.
+    void SetPoseSharingTolerance(float tolerance);
+    /// Set animation LOD distance from which only the bones up to reduced skeleton depth are animated. Zero (default) disables.
+    void SetReducedSkeletonDistance(float distance);
+    /// Set maximum depth in the bone hierarchy of the bones animated beyond reduced skeleton distance.
+    void SetReducedSkeletonDepth(unsigned depth);
     /// Set vertex morph weight by index.
     void SetMorphWeight(unsigned index, float weight);
     /// Set vertex morph weight by name.
@@ -106,6 +115,9 @@ public:
     /// Return skeleton.
     Skeleton& GetSkeleton() { return skeleton_; }
 
+    /// Return skeleton pose from the last animation update. Model space transforms are valid only if the bone nodes follow the skeleton hierarchy.
+    const SkeletonPose& GetSkeletonPose() const { return skeletonPose_; }
+
     /// Return all animation states.
     const ea::vector<SharedPtr<AnimationState> >& GetAnimationStates() const { return animationStates_; }
 
@@ -127,6 +139,15 @@ public:
     /// Return whether to update animation when not visible.
     bool GetUpdateInvisible() const { return updateInvisible_; }
 
+    /// Return time tolerance for pose sharing.
+    float GetPoseSharingTolerance() const { return poseSharingTolerance_; }
+
+    /// Return animation LOD distance from which the reduced skeleton is animated.
+    float GetReducedSkeletonDistance() const { return reducedSkeletonDistance_; }
+
+    /// Return maximum depth in the bone hierarchy of the bones animated beyond reduced skeleton distance.
+    unsigned GetReducedSkeletonDepth() const { return reducedSkeletonDepth_; }
+
     /// Return all vertex morphs.
     const ea::vector<ModelMorph>& GetMorphs() const { return morphs_; }
 
@@ -201,8 +222,14 @@ private:
     void CloneGeometries();
     /// Recalculate animations. Called from Update().
     void UpdateAnimation(const FrameInfo& frame);
+    /// Update the key for pose sharing. Return false if the pose can not be shared.
+    bool UpdatePoseKey(unsigned maxBoneDepth);
     /// Recalculate skinning.
     void UpdateSkinning();
+    /// Allocate skinning matrices from the octree's skin matrix arena once per frame if it is enabled, and point the batches to them.
+    void AllocateArenaSkinMatrices(const FrameInfo& frame);
+    /// Copy skinning matrices to the range allocated from the skin matrix arena.
+    void CopyArenaSkinMatrices();
     /// Reapply all vertex morphs.
     void UpdateMorphs();
     /// Handle model reload finished.
@@ -210,6 +237,8 @@ private:
 
     /// Skeleton.
     Skeleton skeleton_;
+    /// Skeleton pose used for evaluating animations.
+    SkeletonPose skeletonPose_;
     /// Software model animator.
     SharedPtr<SoftwareModelAnimator> modelAnimator_;
     /// Vertex morphs.
@@ -224,6 +253,12 @@ private:
     ea::vector<ea::vector<Matrix3x4> > geometrySkinMatrices_;
     /// Subgeometry skinning matrix pointers, if more bones than skinning shader can manage.
     ea::vector<ea::vector<Matrix3x4*> > geometrySkinMatrixPtrs_;
+    /// Skinning matrices allocated from the skin matrix arena in the current frame. Null if the allocation failed.
+    Matrix3x4* arenaSkinMatrices_{};
+    /// Offset of the skinning matrices in the skin matrix arena.
+    unsigned arenaSkinMatrixOffset_{M_MAX_UNSIGNED};
+    /// The frame number skinning matrices were last allocated from the skin matrix arena on.
+    std::atomic<unsigned> arenaSkinMatrixFrameNumber_{M_MAX_UNSIGNED};
     /// Bounding box calculated from bones.
     BoundingBox boneBoundingBox_;
     /// Attribute buffer.
@@ -236,6 +271,14 @@ private:
     float animationLodTimer_;
     /// Animation LOD distance, the minimum of all LOD view distances last frame.
     float animationLodDistance_;
+    /// Time tolerance for pose sharing.
+    float poseSharingTolerance_{};
+    /// Animation LOD distance from which the reduced skeleton is animated.
+    float reducedSkeletonDistance_{};
+    /// Maximum depth of animated bones in the reduced skeleton.
+    unsigned reducedSkeletonDepth_{ 2 };
+    /// Key for pose sharing.
+    AnimationPoseKey poseKey_;
     /// Update animation when invisible flag.
     bool updateInvisible_;
     /// Animation dirty flag.
@@ -27,6 +27,7 @@
 #include "../Core/Context.h"
 #include "../Core/Profiler.h"
 #include "../Graphics/Animation.h"
+#include "../Graphics/CompressedAnimation.h"
 #include "../IO/Deserializer.h"
 #include "../IO/FileSystem.h"
 #include "../IO/Log.h"
@@ -141,6 +142,8 @@ bool Animation::BeginLoad(Deserializer& source)
     animationNameHash_ = animationName_;
     length_ = source.ReadFloat();
     tracks_.clear();
+    compressedAnimation_ = nullptr;
+    keyFramesDiscarded_ = false;
 
     unsigned tracks = source.ReadUInt();
     memoryUse += tracks * sizeof(AnimationTrack);
@@ -187,6 +190,22 @@ bool Animation::BeginLoad(Deserializer& source)
 
         LoadMetadataFromXML(rootElem);
 
+        // Optionally compress the tracks
+        XMLElement compressionElem = rootElem.GetChild("compression");
+        if (compressionElem)
+        {
+            AnimationCompressionSettings settings;
+            if (compressionElem.HasAttribute("positiontolerance"))
+                settings.positionTolerance_ = compressionElem.GetFloat("positiontolerance");
+            if (compressionElem.HasAttribute("rotationtolerance"))
+                settings.rotationTolerance_ = compressionElem.GetFloat("rotationtolerance");
+            if (compressionElem.HasAttribute("scaletolerance"))
+                settings.scaleTolerance_ = compressionElem.GetFloat("scaletolerance");
+            SetMemoryUse(memoryUse);
+            Compress(settings, compressionElem.GetBool("discardkeyframes"));
+            memoryUse = GetMemoryUse();
+        }
+
         memoryUse += triggers_.size() * sizeof(AnimationTriggerPoint);
         SetMemoryUse(memoryUse);
         return true;
@@ -218,6 +237,19 @@ bool Animation::BeginLoad(Deserializer& source)
         const JSONArray& metadataArray = rootVal.Get("metadata").GetArray();
         LoadMetadataFromJSON(metadataArray);
 
+        // Optionally compress the tracks
+        const JSONValue& compressionVal = rootVal.Get("compression");
+        if (compressionVal.IsObject())
+        {
+            AnimationCompressionSettings settings;
+            settings.positionTolerance_ = compressionVal.Get("positionTolerance").GetFloat(settings.positionTolerance_);
+            settings.rotationTolerance_ = compressionVal.Get("rotationTolerance").GetFloat(settings.rotationTolerance_);
+            settings.scaleTolerance_ = compressionVal.Get("scaleTolerance").GetFloat(settings.scaleTolerance_);
+            SetMemoryUse(memoryUse);
+            Compress(settings, compressionVal.Get("discardKeyFrames").GetBool());
+            memoryUse = GetMemoryUse();
+        }
+
         memoryUse += triggers_.size() * sizeof(AnimationTriggerPoint);
         SetMemoryUse(memoryUse);
         return true;
@@ -229,6 +261,12 @@ bool Animation::BeginLoad(Deserializer& source)
 
 bool Animation::Save(Serializer& dest) const
 {
+    if (keyFramesDiscarded_)
+    {
+        URHO3D_LOGERROR("Can not save animation " + GetName() + ", keyframes were discarded after compression");
+        return false;
+    }
+
     // Write ID, name and length
     dest.WriteFileID("UANI");
     dest.WriteString(animationName_);
@@ -381,12 +419,52 @@ SharedPtr<Animation> Animation::Clone(const ea::string& cloneName) const
     ret->length_ = length_;
     ret->tracks_ = tracks_;
     ret->triggers_ = triggers_;
+    ret->compressedAnimation_ = compressedAnimation_;
+    ret->keyFramesDiscarded_ = keyFramesDiscarded_;
     ret->CopyMetadata(*this);
     ret->SetMemoryUse(GetMemoryUse());
 
     return ret;
 }
 
+void Animation::Compress(const AnimationCompressionSettings& settings, bool discardKeyFrames)
+{
+    if (keyFramesDiscarded_)
+    {
+        URHO3D_LOGERROR("Can not compress animation " + GetName() + " again, keyframes were discarded");
+        return;
+    }
+
+    URHO3D_PROFILE("CompressAnimation");
+
+    RemoveCompressedAnimation();
+    compressedAnimation_ = MakeShared<CompressedAnimation>(*this, settings);
+
+    unsigned memoryUse = GetMemoryUse() + compressedAnimation_->GetMemoryUse();
+    if (discardKeyFrames)
+    {
+        for (auto& item : tracks_)
+        {
+            AnimationTrack& track = item.second;
+            memoryUse -= Min<unsigned>(memoryUse, track.keyFrames_.size() * sizeof(AnimationKeyFrame));
+            track.keyFrames_.clear();
+            track.keyFrames_.shrink_to_fit();
+        }
+        keyFramesDiscarded_ = true;
+    }
+    SetMemoryUse(memoryUse);
+}
+
+void Animation::RemoveCompressedAnimation()
+{
+    if (!compressedAnimation_)
+        return;
+
+    const unsigned compressedMemoryUse = compressedAnimation_->GetMemoryUse();
+    SetMemoryUse(GetMemoryUse() - Min(GetMemoryUse(), compressedMemoryUse));
+    compressedAnimation_ = nullptr;
+}
+
 AnimationTrack* Animation::GetTrack(unsigned index)
 {
     if (index >= GetNumTracks())
@@ -149,6 +149,19 @@ struct AnimationTriggerPoint
     }
 };
 
+/// Settings of skeletal animation compression.
+struct AnimationCompressionSettings
+{
+    /// Maximum position error caused by keyframe removal.
+    float positionTolerance_{ 0.001f };
+    /// Maximum rotation error in degrees caused by keyframe removal.
+    float rotationTolerance_{ 0.1f };
+    /// Maximum scale error caused by keyframe removal.
+    float scaleTolerance_{ 0.001f };
+};
+
+class CompressedAnimation;
+
 /// Skeletal animation resource.
 class URHO3D_API Animation : public ResourceWithMetadata
 {
@@ -191,6 +204,10 @@ public:
     void SetNumTriggers(unsigned num);
     /// Clone the animation.
     SharedPtr<Animation> Clone(const ea::string& cloneName = EMPTY_STRING) const;
+    /// Create compressed copy of the tracks, which is used for playback instead of keyframes. Optionally discard the keyframes to save memory, after which the animation can not be saved or compressed again. Compressed data is not updated when tracks or keyframes are modified.
+    void Compress(const AnimationCompressionSettings& settings, bool discardKeyFrames = false);
+    /// Remove compressed copy of the tracks.
+    void RemoveCompressedAnimation();
 
     /// Return animation name.
     const ea::string& GetAnimationName() const { return animationName_; }
@@ -224,6 +241,12 @@ public:
     /// Return a trigger point by index.
     AnimationTriggerPoint* GetTrigger(unsigned index);
 
+    /// Return compressed copy of the tracks, or null if not compressed.
+    CompressedAnimation* GetCompressedAnimation() const { return compressedAnimation_; }
+
+    /// Return whether keyframes were discarded after compression.
+    bool AreKeyFramesDiscarded() const { return keyFramesDiscarded_; }
+
     /// Set all animation tracks.
     void SetTracks(const ea::vector<AnimationTrack>& tracks);
 private:
@@ -237,6 +260,10 @@ private:
     ea::unordered_map<StringHash, AnimationTrack> tracks_;
     /// Animation trigger points.
     ea::vector<AnimationTriggerPoint> triggers_;
+    /// Compressed copy of the tracks.
+    SharedPtr<CompressedAnimation> compressedAnimation_;
+    /// Whether keyframes were discarded after compression.
+    bool keyFramesDiscarded_{};
 };
 
 }
@@ -0,0 +1,153 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Container/Hash.h"
+#include "../Graphics/AnimationPoseCache.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+namespace
+{
+
+/// Minimum number of reserved entries.
+const unsigned MIN_POSE_CACHE_ENTRIES = 32;
+
+}
+
+void AnimationPoseKey::Reset(const Model* model, float timeTolerance, unsigned maxBoneDepth)
+{
+    model_ = model;
+    timeTolerance_ = timeTolerance;
+    maxBoneDepth_ = maxBoneDepth;
+    states_.clear();
+
+    hash_ = MakeHash(model);
+    CombineHash(hash_, MakeHash(timeTolerance));
+    CombineHash(hash_, maxBoneDepth);
+}
+
+void AnimationPoseKey::AddState(const AnimationPoseKeyState& state)
+{
+    states_.push_back(state);
+
+    CombineHash(hash_, MakeHash(state.animation_));
+    CombineHash(hash_, static_cast<unsigned>(state.time_));
+    CombineHash(hash_, state.weight_);
+    CombineHash(hash_, state.layer_ | (state.blendMode_ << 8u) | (static_cast<unsigned>(state.looped_) << 16u));
+}
+
+void AnimationPoseCache::BeginFrame()
+{
+    lastNumInstances_ = numInstances_.load(std::memory_order_relaxed);
+    lastNumUniquePoses_ = numEntries_;
+    numInstances_.store(0, std::memory_order_relaxed);
+    numEntries_ = 0;
+
+    // Reserve entries for the worst case of all poses being unique, so no allocations happen during the frame.
+    // Keep the hash table at most half full
+    const unsigned numReservedEntries = Max(lastNumInstances_, MIN_POSE_CACHE_ENTRIES);
+    while (entries_.size() < numReservedEntries)
+        entries_.push_back(ea::make_unique<Entry>());
+
+    buckets_.clear();
+    buckets_.resize(NextPowerOfTwo(entries_.size() * 2), 0);
+}
+
+bool AnimationPoseCache::GetPose(const AnimationPoseKey& key, SkeletonPose& pose)
+{
+    numInstances_.fetch_add(1, std::memory_order_relaxed);
+
+    unsigned index;
+    {
+        MutexLock<SpinLockMutex> lock(mutex_);
+        index = FindEntry(key);
+    }
+
+    // Pose that is still being written is evaluated again rather than waited for
+    if (index == M_MAX_UNSIGNED || !entries_[index]->ready_.load(std::memory_order_acquire))
+        return false;
+
+    const SkeletonPose& cachedPose = entries_[index]->pose_;
+    if (cachedPose.positions_.size() != pose.positions_.size())
+        return false;
+
+    pose.positions_ = cachedPose.positions_;
+    pose.rotations_ = cachedPose.rotations_;
+    pose.scales_ = cachedPose.scales_;
+    return true;
+}
+
+void AnimationPoseCache::StorePose(const AnimationPoseKey& key, const SkeletonPose& pose)
+{
+    Entry* entry;
+    {
+        MutexLock<SpinLockMutex> lock(mutex_);
+
+        // Another thread may have evaluated the same pose in the meanwhile
+        if (numEntries_ == entries_.size() || FindEntry(key) != M_MAX_UNSIGNED)
+            return;
+
+        const unsigned index = numEntries_++;
+        entry = entries_[index].get();
+        entry->key_ = key;
+        entry->ready_.store(false, std::memory_order_relaxed);
+        InsertEntry(index);
+    }
+
+    // Entry is not reused until the next frame, so the pose can be written without the lock
+    entry->pose_.positions_ = pose.positions_;
+    entry->pose_.rotations_ = pose.rotations_;
+    entry->pose_.scales_ = pose.scales_;
+    entry->ready_.store(true, std::memory_order_release);
+}
+
+unsigned AnimationPoseCache::FindEntry(const AnimationPoseKey& key) const
+{
+    if (buckets_.empty())
+        return M_MAX_UNSIGNED;
+
+    const unsigned mask = buckets_.size() - 1;
+    for (unsigned slot = key.hash_ & mask; buckets_[slot] != 0; slot = (slot + 1) & mask)
+    {
+        const unsigned index = buckets_[slot] - 1;
+        if (entries_[index]->key_ == key)
+            return index;
+    }
+    return M_MAX_UNSIGNED;
+}
+
+void AnimationPoseCache::InsertEntry(unsigned index)
+{
+    const unsigned mask = buckets_.size() - 1;
+    unsigned slot = entries_[index]->key_.hash_ & mask;
+    while (buckets_[slot] != 0)
+        slot = (slot + 1) & mask;
+    buckets_[slot] = index + 1;
+}
+
+}
@@ -0,0 +1,148 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+/// \file
+
+#pragma once
+
+#include "../Core/Mutex.h"
+#include "../Graphics/Skeleton.h"
+
+#include <EASTL/unique_ptr.h>
+#include <EASTL/vector.h>
+
+#include <atomic>
+
+namespace Urho3D
+{
+
+class Animation;
+class Model;
+
+/// Animation state parameters that contribute to a shared pose.
+struct AnimationPoseKeyState
+{
+    /// Test for equality with another key state.
+    bool operator ==(const AnimationPoseKeyState& rhs) const
+    {
+        return animation_ == rhs.animation_ && time_ == rhs.time_ && weight_ == rhs.weight_ && layer_ == rhs.layer_
+            && blendMode_ == rhs.blendMode_ && looped_ == rhs.looped_;
+    }
+
+    /// Animation.
+    const Animation* animation_{};
+    /// Time position divided by time tolerance.
+    int time_{};
+    /// Quantized blending weight.
+    unsigned weight_{};
+    /// Blending layer.
+    unsigned char layer_{};
+    /// Blending mode.
+    unsigned char blendMode_{};
+    /// Looped flag.
+    bool looped_{};
+};
+
+/// Key of a shared skeleton pose.
+struct AnimationPoseKey
+{
+    /// Reset to the key without animation states.
+    void Reset(const Model* model, float timeTolerance, unsigned maxBoneDepth);
+    /// Add animation state parameters.
+    void AddState(const AnimationPoseKeyState& state);
+
+    /// Test for equality with another key.
+    bool operator ==(const AnimationPoseKey& rhs) const
+    {
+        return hash_ == rhs.hash_ && model_ == rhs.model_ && timeTolerance_ == rhs.timeTolerance_
+            && maxBoneDepth_ == rhs.maxBoneDepth_ && states_ == rhs.states_;
+    }
+
+    /// Return hash value.
+    unsigned ToHash() const { return hash_; }
+
+    /// Model the skeleton is defined by.
+    const Model* model_{};
+    /// Time tolerance used to quantize time positions.
+    float timeTolerance_{};
+    /// Maximum depth of animated bones.
+    unsigned maxBoneDepth_{};
+    /// Animation states in application order.
+    ea::vector<AnimationPoseKeyState> states_;
+    /// Hash value.
+    unsigned hash_{};
+};
+
+/// Per-frame cache of evaluated skeleton poses. Lets animated models that play the same animations at nearly the same
+/// time reuse one pose instead of sampling their own. Safe to use from worker threads. Only the lookup is locked, poses
+/// are copied outside the lock to and from entries that are reserved in BeginFrame.
+class URHO3D_API AnimationPoseCache
+{
+public:
+    /// Remove all poses, store the counters of the finished frame and reserve entries for as many poses as there were
+    /// lookups. Call from the main thread.
+    void BeginFrame();
+    /// Copy the local bone transforms of a cached pose. Return false if there is no finished pose with matching key.
+    bool GetPose(const AnimationPoseKey& key, SkeletonPose& pose);
+    /// Store evaluated pose. Does nothing if a pose with matching key already exists or all reserved entries are in use.
+    void StorePose(const AnimationPoseKey& key, const SkeletonPose& pose);
+
+    /// Return number of pose lookups in the last frame, which is the number of animated models that use pose sharing.
+    unsigned GetNumInstances() const { return lastNumInstances_; }
+    /// Return number of unique poses stored in the last frame.
+    unsigned GetNumUniquePoses() const { return lastNumUniquePoses_; }
+
+private:
+    /// Cached pose.
+    struct Entry
+    {
+        /// Key.
+        AnimationPoseKey key_;
+        /// Pose.
+        SkeletonPose pose_;
+        /// Whether the pose is written and may be read.
+        std::atomic<bool> ready_{};
+    };
+
+    /// Return entry index with matching key, or M_MAX_UNSIGNED if not found. Must be called with the mutex acquired.
+    unsigned FindEntry(const AnimationPoseKey& key) const;
+    /// Insert entry index to the hash table. Must be called with the mutex acquired.
+    void InsertEntry(unsigned index);
+
+    /// Entries. Only the first numEntries_ are in use, the rest keep their memory for the next frames.
+    ea::vector<ea::unique_ptr<Entry> > entries_;
+    /// Number of entries in use.
+    unsigned numEntries_{};
+    /// Open addressing hash table of entry indices plus one. Zero marks an empty slot.
+    ea::vector<unsigned> buckets_;
+    /// Mutex for the entries and the hash table.
+    SpinLockMutex mutex_;
+    /// Number of pose lookups in the current frame.
+    std::atomic<unsigned> numInstances_{};
+    /// Number of pose lookups in the last frame.
+    unsigned lastNumInstances_{};
+    /// Number of unique poses in the last frame.
+    unsigned lastNumUniquePoses_{};
+};
+
+}
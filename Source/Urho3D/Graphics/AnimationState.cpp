@@ -37,7 +37,9 @@ AnimationStateTrack::AnimationStateTrack() :
     track_(nullptr),
     bone_(nullptr),
     weight_(1.0f),
-    keyFrame_(0)
+    keyFrame_(0),
+    compressedTrack_(M_MAX_UNSIGNED),
+    boneIndex_(M_MAX_UNSIGNED)
 {
 }
 
@@ -125,6 +127,7 @@ void AnimationState::SetStartBone(Bone* startBone)
 
     const ea::unordered_map<StringHash, AnimationTrack>& tracks = animation_->GetTracks();
     stateTracks_.clear();
+    compressedAnimation_ = nullptr;
 
     if (!startBone->node_)
         return;
@@ -150,6 +153,7 @@ void AnimationState::SetStartBone(Bone* startBone)
         if (trackBone && trackBone->node_)
         {
             stateTrack.bone_ = trackBone;
+            stateTrack.boneIndex_ = skeleton.GetBoneIndex(trackBone);
             stateTrack.node_ = trackBone->node_;
             stateTracks_.push_back(stateTrack);
         }
@@ -437,6 +441,17 @@ unsigned AnimationState::GetTrackIndex(StringHash nameHash) const
     return M_MAX_UNSIGNED;
 }
 
+bool AnimationState::HasBoneWeights() const
+{
+    for (const AnimationStateTrack& stateTrack : stateTracks_)
+    {
+        if (stateTrack.weight_ != 1.0f)
+            return true;
+    }
+
+    return false;
+}
+
 float AnimationState::GetLength() const
 {
     return animation_ ? animation_->GetLength() : 0.0f;
@@ -447,12 +462,53 @@ void AnimationState::Apply()
     if (!animation_ || !IsEnabled())
         return;
 
+    SampleCompressed();
+
     if (model_)
         ApplyToModel();
     else
         ApplyToNodes();
 }
 
+void AnimationState::ApplyToPose(SkeletonPose& pose, unsigned maxBoneDepth)
+{
+    if (!animation_ || !model_ || !IsEnabled())
+        return;
+
+    SampleCompressed();
+
+    const unsigned numBones = pose.positions_.size();
+    for (AnimationStateTrack& stateTrack : stateTracks_)
+    {
+        const float finalWeight = weight_ * stateTrack.weight_;
+        const unsigned index = stateTrack.boneIndex_;
+
+        // Do not apply if zero effective weight, the bone has animation disabled or is cut off by animation LOD
+        if (Equals(finalWeight, 0.0f) || !stateTrack.bone_->animated_ || index >= numBones
+            || pose.boneDepths_[index] > maxBoneDepth)
+            continue;
+
+        Vector3 newPosition;
+        Quaternion newRotation;
+        Vector3 newScale;
+        if (!SampleTrack(stateTrack, newPosition, newRotation, newScale))
+            continue;
+
+        Vector3& position = pose.positions_[index];
+        Quaternion& rotation = pose.rotations_[index];
+        Vector3& scale = pose.scales_[index];
+        BlendTrack(stateTrack, finalWeight, position, rotation, scale, newPosition, newRotation, newScale);
+
+        const AnimationChannelFlags channelMask = stateTrack.track_->channelMask_;
+        if (channelMask & CHANNEL_POSITION)
+            position = newPosition;
+        if (channelMask & CHANNEL_ROTATION)
+            rotation = newRotation;
+        if (channelMask & CHANNEL_SCALE)
+            scale = newScale;
+    }
+}
+
 void AnimationState::ApplyToModel()
 {
     for (auto i = stateTracks_.begin(); i != stateTracks_.end(); ++i)
@@ -477,12 +533,69 @@ void AnimationState::ApplyToNodes()
 
 void AnimationState::ApplyTrack(AnimationStateTrack& stateTrack, float weight, bool silent)
 {
-    const AnimationTrack* track = stateTrack.track_;
     Node* node = stateTrack.node_;
 
-    if (track->keyFrames_.empty() || !node)
+    if (!node)
+        return;
+
+    Vector3 newPosition;
+    Quaternion newRotation;
+    Vector3 newScale;
+
+    if (!SampleTrack(stateTrack, newPosition, newRotation, newScale))
         return;
 
+    BlendTrack(stateTrack, weight, node->GetPosition(), node->GetRotation(), node->GetScale(),
+        newPosition, newRotation, newScale);
+
+    const AnimationChannelFlags channelMask = stateTrack.track_->channelMask_;
+
+    if (silent)
+    {
+        if (channelMask & CHANNEL_POSITION)
+            node->SetPositionSilent(newPosition);
+        if (channelMask & CHANNEL_ROTATION)
+            node->SetRotationSilent(newRotation);
+        if (channelMask & CHANNEL_SCALE)
+            node->SetScaleSilent(newScale);
+    }
+    else
+    {
+        if (channelMask & CHANNEL_POSITION)
+            node->SetPosition(newPosition);
+        if (channelMask & CHANNEL_ROTATION)
+            node->SetRotation(newRotation);
+        if (channelMask & CHANNEL_SCALE)
+            node->SetScale(newScale);
+    }
+}
+
+void AnimationState::SampleCompressed()
+{
+    // Sample all tracks at once if the animation is compressed
+    if (animation_->GetCompressedAnimation() != compressedAnimation_)
+        UpdateCompressedTracks();
+    if (compressedAnimation_)
+        compressedAnimation_->Sample(time_, looped_, compressedPose_);
+}
+
+bool AnimationState::SampleTrack(AnimationStateTrack& stateTrack, Vector3& position, Quaternion& rotation, Vector3& scale)
+{
+    const AnimationTrack* track = stateTrack.track_;
+    const AnimationChannelFlags channelMask = track->channelMask_;
+
+    if (stateTrack.compressedTrack_ != M_MAX_UNSIGNED)
+    {
+        const unsigned index = stateTrack.compressedTrack_;
+        position = compressedPose_.positions_[index];
+        rotation = compressedPose_.rotations_[index];
+        scale = compressedPose_.scales_[index];
+        return true;
+    }
+
+    if (track->keyFrames_.empty())
+        return false;
+
     unsigned& frame = stateTrack.keyFrame_;
     track->GetKeyFrameIndex(time_, frame);
 
@@ -501,11 +614,6 @@ void AnimationState::ApplyTrack(AnimationStateTrack& stateTrack, float weight, b
     }
 
     const AnimationKeyFrame* keyFrame = &track->keyFrames_[frame];
-    const AnimationChannelFlags channelMask = track->channelMask_;
-
-    Vector3 newPosition;
-    Quaternion newRotation;
-    Vector3 newScale;
 
     if (interpolate)
     {
@@ -516,40 +624,48 @@ void AnimationState::ApplyTrack(AnimationStateTrack& stateTrack, float weight, b
         float t = timeInterval > 0.0f ? (time_ - keyFrame->time_) / timeInterval : 1.0f;
 
         if (channelMask & CHANNEL_POSITION)
-            newPosition = keyFrame->position_.Lerp(nextKeyFrame->position_, t);
+            position = keyFrame->position_.Lerp(nextKeyFrame->position_, t);
         if (channelMask & CHANNEL_ROTATION)
-            newRotation = keyFrame->rotation_.Slerp(nextKeyFrame->rotation_, t);
+            rotation = keyFrame->rotation_.Slerp(nextKeyFrame->rotation_, t);
         if (channelMask & CHANNEL_SCALE)
-            newScale = keyFrame->scale_.Lerp(nextKeyFrame->scale_, t);
+            scale = keyFrame->scale_.Lerp(nextKeyFrame->scale_, t);
     }
     else
     {
         if (channelMask & CHANNEL_POSITION)
-            newPosition = keyFrame->position_;
+            position = keyFrame->position_;
         if (channelMask & CHANNEL_ROTATION)
-            newRotation = keyFrame->rotation_;
+            rotation = keyFrame->rotation_;
         if (channelMask & CHANNEL_SCALE)
-            newScale = keyFrame->scale_;
+            scale = keyFrame->scale_;
     }
 
+    return true;
+}
+
+void AnimationState::BlendTrack(const AnimationStateTrack& stateTrack, float weight, const Vector3& currentPosition,
+    const Quaternion& currentRotation, const Vector3& currentScale, Vector3& position, Quaternion& rotation, Vector3& scale) const
+{
+    const AnimationChannelFlags channelMask = stateTrack.track_->channelMask_;
+
     if (blendingMode_ == ABM_ADDITIVE) // not ABM_LERP
     {
         if (channelMask & CHANNEL_POSITION)
         {
-            Vector3 delta = newPosition - stateTrack.bone_->initialPosition_;
-            newPosition = node->GetPosition() + delta * weight;
+            Vector3 delta = position - stateTrack.bone_->initialPosition_;
+            position = currentPosition + delta * weight;
         }
         if (channelMask & CHANNEL_ROTATION)
         {
-            Quaternion delta = newRotation * stateTrack.bone_->initialRotation_.Inverse();
-            newRotation = (delta * node->GetRotation()).Normalized();
+            Quaternion delta = rotation * stateTrack.bone_->initialRotation_.Inverse();
+            rotation = (delta * currentRotation).Normalized();
             if (!Equals(weight, 1.0f))
-                newRotation = node->GetRotation().Slerp(newRotation, weight);
+                rotation = currentRotation.Slerp(rotation, weight);
         }
         if (channelMask & CHANNEL_SCALE)
         {
-            Vector3 delta = newScale - stateTrack.bone_->initialScale_;
-            newScale = node->GetScale() + delta * weight;
+            Vector3 delta = scale - stateTrack.bone_->initialScale_;
+            scale = currentScale + delta * weight;
         }
     }
     else
@@ -557,31 +673,26 @@ void AnimationState::ApplyTrack(AnimationStateTrack& stateTrack, float weight, b
         if (!Equals(weight, 1.0f)) // not full weight
         {
             if (channelMask & CHANNEL_POSITION)
-                newPosition = node->GetPosition().Lerp(newPosition, weight);
+                position = currentPosition.Lerp(position, weight);
             if (channelMask & CHANNEL_ROTATION)
-                newRotation = node->GetRotation().Slerp(newRotation, weight);
+                rotation = currentRotation.Slerp(rotation, weight);
             if (channelMask & CHANNEL_SCALE)
-                newScale = node->GetScale().Lerp(newScale, weight);
+                scale = currentScale.Lerp(scale, weight);
         }
     }
+}
 
-    if (silent)
-    {
-        if (channelMask & CHANNEL_POSITION)
-            node->SetPositionSilent(newPosition);
-        if (channelMask & CHANNEL_ROTATION)
-            node->SetRotationSilent(newRotation);
-        if (channelMask & CHANNEL_SCALE)
-            node->SetScaleSilent(newScale);
-    }
-    else
+void AnimationState::UpdateCompressedTracks()
+{
+    compressedAnimation_ = animation_->GetCompressedAnimation();
+    for (AnimationStateTrack& stateTrack : stateTracks_)
     {
-        if (channelMask & CHANNEL_POSITION)
-            node->SetPosition(newPosition);
-        if (channelMask & CHANNEL_ROTATION)
-            node->SetRotation(newRotation);
-        if (channelMask & CHANNEL_SCALE)
-            node->SetScale(newScale);
+        stateTrack.compressedTrack_ = compressedAnimation_
+            ? compressedAnimation_->GetTrackIndex(stateTrack.track_->nameHash_) : M_MAX_UNSIGNED;
+
+        // Tracks without keys are not sampled, same as uncompressed tracks without keyframes
+        if (stateTrack.compressedTrack_ != M_MAX_UNSIGNED && !compressedAnimation_->GetNumKeys(stateTrack.compressedTrack_))
+            stateTrack.compressedTrack_ = M_MAX_UNSIGNED;
     }
 }
 
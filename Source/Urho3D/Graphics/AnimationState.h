@@ -27,6 +27,7 @@
 #include <EASTL/unordered_map.h>
 
 #include "../Container/Ptr.h"
+#include "../Graphics/CompressedAnimation.h"
 #include "../Math/StringHash.h"
 
 namespace Urho3D
@@ -40,6 +41,7 @@ class Serializer;
 class Skeleton;
 struct AnimationTrack;
 struct Bone;
+struct SkeletonPose;
 
 /// %Animation blending mode.
 enum AnimationBlendMode
@@ -80,6 +82,10 @@ struct URHO3D_API AnimationStateTrack
     float weight_;
     /// Last key frame.
     unsigned keyFrame_;
+    /// Track index in compressed animation, or M_MAX_UNSIGNED if not compressed.
+    unsigned compressedTrack_;
+    /// Bone index in the skeleton (model mode).
+    unsigned boneIndex_;
 };
 
 /// %Animation instance.
@@ -137,6 +143,8 @@ public:
     unsigned GetTrackIndex(const ea::string& name) const;
     /// Return track index by bone name hash, or M_MAX_UNSIGNED if not found.
     unsigned GetTrackIndex(StringHash nameHash) const;
+    /// Return whether any per-bone blending weight differs from the default.
+    bool HasBoneWeights() const;
 
     /// Return whether weight is nonzero.
     bool IsEnabled() const { return weight_ > 0.0f; }
@@ -161,6 +169,9 @@ public:
 
     /// Apply the animation at the current time position.
     void Apply();
+    /// Apply the animation at the current time position to a skeleton pose of the model instead of the bone nodes. Model mode only.
+    /// Bones deeper than maxBoneDepth in the hierarchy are not animated.
+    void ApplyToPose(SkeletonPose& pose, unsigned maxBoneDepth = M_MAX_UNSIGNED);
 
 private:
     /// Apply animation to a skeleton. Transform changes are applied silently, so the model needs to dirty its root model afterward.
@@ -169,6 +180,15 @@ private:
     void ApplyToNodes();
     /// Apply track.
     void ApplyTrack(AnimationStateTrack& stateTrack, float weight, bool silent);
+    /// Sample compressed animation if it is available.
+    void SampleCompressed();
+    /// Sample track at the current time position. Return false if the track has no keyframes.
+    bool SampleTrack(AnimationStateTrack& stateTrack, Vector3& position, Quaternion& rotation, Vector3& scale);
+    /// Blend sampled track values with the current bone transform. The results are written to the sampled values.
+    void BlendTrack(const AnimationStateTrack& stateTrack, float weight, const Vector3& currentPosition,
+        const Quaternion& currentRotation, const Vector3& currentScale, Vector3& position, Quaternion& rotation, Vector3& scale) const;
+    /// Find tracks in compressed animation after it has been changed.
+    void UpdateCompressedTracks();
 
     /// Animated model (model mode).
     WeakPtr<AnimatedModel> model_;
@@ -190,6 +210,10 @@ private:
     unsigned char layer_;
     /// Blending mode.
     AnimationBlendMode blendingMode_;
+    /// Compressed animation the tracks were matched with.
+    SharedPtr<CompressedAnimation> compressedAnimation_;
+    /// Compressed animation sampled at current time position.
+    CompressedAnimationPose compressedPose_;
 };
 
 }
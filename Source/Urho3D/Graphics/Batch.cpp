@@ -43,44 +43,58 @@
 namespace Urho3D
 {
 
-inline bool CompareBatchesState(const Batch* lhs, const Batch* rhs)
+inline bool CompareInstancesFrontToBack(const InstanceData& lhs, const InstanceData& rhs)
 {
-    if (lhs->renderOrder_ != rhs->renderOrder_)
-        return lhs->renderOrder_ < rhs->renderOrder_;
-    else if (lhs->sortKey_ != rhs->sortKey_)
-        return lhs->sortKey_ < rhs->sortKey_;
-    else
-        return lhs->distance_ < rhs->distance_;
+    return lhs.distance_ < rhs.distance_;
 }
 
-inline bool CompareBatchesFrontToBack(const Batch* lhs, const Batch* rhs)
+inline unsigned long long GetRenderOrderSortKey(const Batch* batch)
 {
-    if (lhs->renderOrder_ != rhs->renderOrder_)
-        return lhs->renderOrder_ < rhs->renderOrder_;
-    else if (lhs->distance_ != rhs->distance_)
-        return lhs->distance_ < rhs->distance_;
-    else
-        return lhs->sortKey_ < rhs->sortKey_;
+    return batch->renderOrder_;
 }
 
-inline bool CompareBatchesBackToFront(const Batch* lhs, const Batch* rhs)
+inline unsigned long long GetStateSortKey(const Batch* batch)
 {
-    if (lhs->renderOrder_ != rhs->renderOrder_)
-        return lhs->renderOrder_ < rhs->renderOrder_;
-    else if (lhs->distance_ != rhs->distance_)
-        return lhs->distance_ > rhs->distance_;
-    else
-        return lhs->sortKey_ < rhs->sortKey_;
+    return batch->sortKey_;
 }
 
-inline bool CompareInstancesFrontToBack(const InstanceData& lhs, const InstanceData& rhs)
+inline unsigned long long GetDistanceSortKey(const Batch* batch)
 {
-    return lhs.distance_ < rhs.distance_;
+    return GetFloatSortKey(batch->distance_);
+}
+
+inline unsigned long long GetFrontToBackSortKey(const Batch* batch)
+{
+    return (static_cast<unsigned long long>(batch->renderOrder_) << 32u) | GetFloatSortKey(batch->distance_);
+}
+
+inline unsigned long long GetBackToFrontSortKey(const Batch* batch)
+{
+    return (static_cast<unsigned long long>(batch->renderOrder_) << 32u) | ~GetFloatSortKey(batch->distance_);
 }
 
-inline bool CompareBatchGroupOrder(const BatchGroup* lhs, const BatchGroup* rhs)
+/// Load batches into radix sort items.
+template <class T> void LoadBatchSortItems(const ea::vector<T>& batches, ea::vector<RadixSortItem<Batch*>>& items)
 {
-    return lhs->renderOrder_ < rhs->renderOrder_;
+    items.resize(batches.size());
+    for (unsigned i = 0; i < batches.size(); ++i)
+        items[i].value_ = batches[i];
+}
+
+/// Stable sort of loaded batches by key.
+template <class KeyFunction> void SortBatchesByKey(ea::vector<RadixSortItem<Batch*>>& items,
+    ea::vector<RadixSortItem<Batch*>>& temp, KeyFunction getKey, unsigned numKeyBits)
+{
+    for (RadixSortItem<Batch*>& item : items)
+        item.key_ = getKey(item.value_);
+    RadixSort(items, temp, numKeyBits);
+}
+
+/// Store sorted batches from radix sort items.
+template <class T> void StoreBatchSortItems(const ea::vector<RadixSortItem<Batch*>>& items, ea::vector<T>& batches)
+{
+    for (unsigned i = 0; i < batches.size(); ++i)
+        batches[i] = static_cast<T>(items[i].value_);
 }
 
 void CalculateShadowMatrix(Matrix4& dest, LightBatchQueue* queue, unsigned split, Renderer* renderer)
@@ -770,6 +784,14 @@ void BatchQueue::Clear(int maxSortedInstances)
     maxSortedInstances_ = (unsigned)maxSortedInstances;
 }
 
+void BatchQueue::SetAllocator(LinearAllocator* allocator)
+{
+    // Release nodes and buckets before switching, they may belong to the previous allocator
+    batchGroups_.clear(true);
+    sortedBatchGroups_.clear();
+    batchGroups_.set_allocator(LinearAllocatorAdapter(allocator));
+}
+
 void BatchQueue::SortBackToFront()
 {
     sortedBatches_.resize(batches_.size());
@@ -777,7 +799,10 @@ void BatchQueue::SortBackToFront()
     for (unsigned i = 0; i < batches_.size(); ++i)
         sortedBatches_[i] = &batches_[i];
 
-    ea::quick_sort(sortedBatches_.begin(), sortedBatches_.end(), CompareBatchesBackToFront);
+    LoadBatchSortItems(sortedBatches_, sortItems_);
+    SortBatchesByKey(sortItems_, sortTemp_, GetStateSortKey, 64);
+    SortBatchesByKey(sortItems_, sortTemp_, GetBackToFrontSortKey, 40);
+    StoreBatchSortItems(sortItems_, sortedBatches_);
 
     sortedBatchGroups_.resize(batchGroups_.size());
 
@@ -785,7 +810,9 @@ void BatchQueue::SortBackToFront()
     for (auto i = batchGroups_.begin(); i != batchGroups_.end(); ++i)
         sortedBatchGroups_[index++] = &i->second;
 
-    ea::quick_sort(sortedBatchGroups_.begin(), sortedBatchGroups_.end(), CompareBatchGroupOrder);
+    LoadBatchSortItems(sortedBatchGroups_, sortItems_);
+    SortBatchesByKey(sortItems_, sortTemp_, GetRenderOrderSortKey, 8);
+    StoreBatchSortItems(sortItems_, sortedBatchGroups_);
 }
 
 void BatchQueue::SortFrontToBack()
@@ -831,10 +858,17 @@ template <class T> void BatchQueue::SortFrontToBack2Pass(ea::vector<T>& batches)
     // Mobile devices likely use a tiled deferred approach, with which front-to-back sorting is irrelevant. The 2-pass
     // method is also time consuming, so just sort with state having priority
 #ifdef GL_ES_VERSION_2_0
-    ea::quick_sort(batches.begin(), batches.end(), CompareBatchesState);
+    LoadBatchSortItems(batches, sortItems_);
+    SortBatchesByKey(sortItems_, sortTemp_, GetDistanceSortKey, 32);
+    SortBatchesByKey(sortItems_, sortTemp_, GetStateSortKey, 64);
+    SortBatchesByKey(sortItems_, sortTemp_, GetRenderOrderSortKey, 8);
+    StoreBatchSortItems(sortItems_, batches);
 #else
     // For desktop, first sort by distance and remap shader/material/geometry IDs in the sort key
-    ea::quick_sort(batches.begin(), batches.end(), CompareBatchesFrontToBack);
+    LoadBatchSortItems(batches, sortItems_);
+    SortBatchesByKey(sortItems_, sortTemp_, GetStateSortKey, 64);
+    SortBatchesByKey(sortItems_, sortTemp_, GetFrontToBackSortKey, 40);
+    StoreBatchSortItems(sortItems_, batches);
 
     unsigned freeShaderID = 0;
     unsigned short freeMaterialID = 0;
@@ -882,7 +916,11 @@ template <class T> void BatchQueue::SortFrontToBack2Pass(ea::vector<T>& batches)
     geometryRemapping_.clear();
 
     // Finally sort again with the rewritten ID's
-    ea::quick_sort(batches.begin(), batches.end(), CompareBatchesState);
+    LoadBatchSortItems(batches, sortItems_);
+    SortBatchesByKey(sortItems_, sortTemp_, GetDistanceSortKey, 32);
+    SortBatchesByKey(sortItems_, sortTemp_, GetStateSortKey, 64);
+    SortBatchesByKey(sortItems_, sortTemp_, GetRenderOrderSortKey, 8);
+    StoreBatchSortItems(sortItems_, batches);
 #endif
 }
 
@@ -22,7 +22,9 @@
 
 #pragma once
 
+#include "../Container/LinearAllocator.h"
 #include "../Container/Ptr.h"
+#include "../Container/RadixSort.h"
 #include "../Graphics/Drawable.h"
 #include "../Graphics/Material.h"
 #include "../Math/MathDefs.h"
@@ -77,6 +79,7 @@ struct Batch
         material_(rhs.material_.Get()),
         worldTransform_(rhs.worldTransform_),
         numWorldTransforms_(rhs.numWorldTransforms_),
+        skinMatrixOffset_(rhs.skinMatrixOffset_),
         instancingData_(rhs.instancingData_),
         lightQueue_(nullptr),
         geometryType_(rhs.geometryType_),
@@ -110,6 +113,8 @@ struct Batch
     const Matrix3x4* worldTransform_{};
     /// Number of world transforms.
     unsigned numWorldTransforms_{};
+    /// Offset of the bone transforms in the octree's skin matrix arena, or M_MAX_UNSIGNED if they are not stored there.
+    unsigned skinMatrixOffset_{M_MAX_UNSIGNED};
     /// Per-instance data. If not null, must contain enough data to fill instancing buffer.
     void* instancingData_{};
     /// Zone.
@@ -167,9 +172,10 @@ struct BatchGroup : public Batch
     {
     }
 
-    /// Construct from a batch.
-    explicit BatchGroup(const Batch& batch) :
+    /// Construct from a batch. Instance data is allocated with given allocator.
+    explicit BatchGroup(const Batch& batch, const LinearAllocatorAdapter& allocator = LinearAllocatorAdapter{}) :
         Batch(batch),
+        instances_(allocator),
         startIndex_(M_MAX_UNSIGNED)
     {
     }
@@ -198,7 +204,7 @@ struct BatchGroup : public Batch
     void Draw(View* view, Camera* camera, bool allowDepthWrite) const;
 
     /// Instance data.
-    ea::vector<InstanceData> instances_;
+    ea::vector<InstanceData, LinearAllocatorAdapter> instances_;
     /// Instance stream start index, or M_MAX_UNSIGNED if transforms not pre-set.
     unsigned startIndex_;
 };
@@ -270,11 +276,14 @@ public:
     /// Return the combined amount of instances.
     unsigned GetNumInstances() const;
 
+    /// Set allocator for instanced draw calls. Null means the default heap allocator. Clears instanced draw calls.
+    void SetAllocator(LinearAllocator* allocator);
+
     /// Return whether the batch group is empty.
     bool IsEmpty() const { return batches_.empty() && batchGroups_.empty(); }
 
     /// Instanced draw calls.
-    ea::unordered_map<BatchGroupKey, BatchGroup> batchGroups_;
+    ea::unordered_map<BatchGroupKey, BatchGroup, ea::hash<BatchGroupKey>, ea::equal_to<BatchGroupKey>, LinearAllocatorAdapter> batchGroups_;
     /// Shader remapping table for 2-pass state and distance sort.
     ea::unordered_map<unsigned, unsigned> shaderRemapping_;
     /// Material remapping table for 2-pass state and distance sort.
@@ -288,6 +297,10 @@ public:
     ea::vector<Batch*> sortedBatches_;
     /// Sorted instanced draw calls.
     ea::vector<BatchGroup*> sortedBatchGroups_;
+    /// Radix sort items.
+    ea::vector<RadixSortItem<Batch*>> sortItems_;
+    /// Radix sort temporary buffer.
+    ea::vector<RadixSortItem<Batch*>> sortTemp_;
     /// Maximum sorted instances.
     unsigned maxSortedInstances_;
     /// Whether the pass command contains extra shader defines.
@@ -326,6 +339,10 @@ struct LightBatchQueue
     bool negative_;
     /// Shadow map depth texture.
     Texture2D* shadowMap_;
+    /// Split hashes of a cached shadow map. Empty if the shadow map is not cached.
+    ea::vector<unsigned long long> shadowSplitHashes_;
+    /// Cached shadow map up to date flag. If set, shadow batches are not collected and the shadow map is not rendered.
+    bool shadowMapUpToDate_;
     /// Lit geometry draw calls, base (replace blend mode).
     BatchQueue litBaseBatches_;
     /// Lit geometry draw calls, non-base (additive).
@@ -0,0 +1,554 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Graphics/CompressedAnimation.h"
+
+#include <EASTL/algorithm.h>
+
+#ifdef URHO3D_SSE
+#include <emmintrin.h>
+#endif
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+namespace
+{
+
+/// Maximum value of quantized key time.
+const float MAX_QUANTIZED_TIME = 65535.0f;
+/// Maximum value of quantized vector component.
+const float MAX_QUANTIZED_VECTOR = 65535.0f;
+/// Maximum value of quantized quaternion component.
+const float MAX_QUANTIZED_QUATERNION = 32767.0f;
+/// Range of the three smallest quaternion components.
+const float QUATERNION_COMPONENT_RANGE = 0.70710678f;
+/// Quantized identity quaternion.
+const unsigned short IDENTITY_QUATERNION[3] = { 16384, 16384, 16384 };
+
+/// Return indices of keys that have to be kept so that the removed keys are linearly interpolated within tolerance.
+/// Channel with all keys equal within tolerance is reduced to the first key.
+template <class T, class Interpolate, class Error>
+ea::vector<unsigned> ReduceKeys(const ea::vector<float>& times, const ea::vector<T>& values, float tolerance,
+    const Interpolate& interpolate, const Error& error)
+{
+    const unsigned numKeys = values.size();
+    ea::vector<unsigned> keptKeys;
+    if (!numKeys)
+        return keptKeys;
+
+    keptKeys.push_back(0);
+
+    bool isConstant = true;
+    for (unsigned i = 1; i < numKeys; ++i)
+    {
+        if (error(values[i], values[0]) > tolerance)
+        {
+            isConstant = false;
+            break;
+        }
+    }
+    if (isConstant)
+        return keptKeys;
+
+    const auto canRemoveKeysBetween = [&](unsigned first, unsigned last)
+    {
+        const float interval = times[last] - times[first];
+        for (unsigned i = first + 1; i < last; ++i)
+        {
+            const float t = interval > 0.0f ? (times[i] - times[first]) / interval : 0.0f;
+            if (error(interpolate(values[first], values[last], t), values[i]) > tolerance)
+                return false;
+        }
+        return true;
+    };
+
+    unsigned anchor = 0;
+    for (unsigned last = 2; last < numKeys; ++last)
+    {
+        if (!canRemoveKeysBetween(anchor, last))
+        {
+            anchor = last - 1;
+            keptKeys.push_back(anchor);
+        }
+    }
+
+    keptKeys.push_back(numKeys - 1);
+    return keptKeys;
+}
+
+/// Quantize key time. Rounded down, so that sampling at exact key time does not return the previous key.
+unsigned short QuantizeTime(float time, float timeScale)
+{
+    return static_cast<unsigned short>(Clamp(FloorToInt(time * timeScale), 0, static_cast<int>(MAX_QUANTIZED_TIME)));
+}
+
+unsigned short QuantizeUnitFloat(float value, float maxValue)
+{
+    return static_cast<unsigned short>(Clamp(RoundToInt(value * maxValue), 0, static_cast<int>(maxValue)));
+}
+
+/// Quantize quaternion as three smallest components. Index of the omitted component is stored in the highest bits.
+void QuantizeQuaternion(const Quaternion& rotation, unsigned short dest[3])
+{
+    const Quaternion normalized = rotation.Normalized();
+    const float* data = normalized.Data();
+
+    unsigned largest = 0;
+    for (unsigned i = 1; i < 4; ++i)
+    {
+        if (Abs(data[i]) > Abs(data[largest]))
+            largest = i;
+    }
+
+    // Quaternion and its negation represent the same rotation, keep the omitted component positive
+    const float sign = data[largest] < 0.0f ? -1.0f : 1.0f;
+    unsigned j = 0;
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        if (i == largest)
+            continue;
+        const float value = (sign * data[i] / QUATERNION_COMPONENT_RANGE) * 0.5f + 0.5f;
+        dest[j++] = QuantizeUnitFloat(value, MAX_QUANTIZED_QUATERNION);
+    }
+
+    dest[0] |= (largest & 1u) << 15u;
+    dest[1] |= (largest >> 1u) << 15u;
+}
+
+/// Unpack quantized quaternion into three smallest components and index of the omitted component, stored with the stride.
+void UnpackQuaternion(const unsigned short source[3], int* dest, unsigned stride)
+{
+    dest[0] = source[0] & 0x7fff;
+    dest[stride] = source[1] & 0x7fff;
+    dest[stride * 2] = source[2] & 0x7fff;
+    dest[stride * 3] = (source[0] >> 15u) | ((source[1] >> 15u) << 1u);
+}
+
+#ifndef URHO3D_SSE
+/// Decode unpacked quaternion.
+Quaternion DecodeQuaternion(const int* source, unsigned stride)
+{
+    const float scale = 2.0f * QUATERNION_COMPONENT_RANGE / MAX_QUANTIZED_QUATERNION;
+    const float a = source[0] * scale - QUATERNION_COMPONENT_RANGE;
+    const float b = source[stride] * scale - QUATERNION_COMPONENT_RANGE;
+    const float c = source[stride * 2] * scale - QUATERNION_COMPONENT_RANGE;
+    const float largest = sqrtf(Max(0.0f, 1.0f - a * a - b * b - c * c));
+
+    switch (source[stride * 3])
+    {
+    case 0: return Quaternion(largest, a, b, c);
+    case 1: return Quaternion(a, largest, b, c);
+    case 2: return Quaternion(a, b, largest, c);
+    default: return Quaternion(a, b, c, largest);
+    }
+}
+#endif
+
+/// Interpolate rotations along the shortest path. Interpolation factor is adjusted so that the result closely matches
+/// spherical interpolation, which is used for uncompressed animations, without trigonometric functions.
+Quaternion InterpolateRotation(const Quaternion& lhs, const Quaternion& rhs, float t)
+{
+    const float cosAngle = lhs.DotProduct(rhs);
+    const float d = Abs(cosAngle);
+    const float a = 1.0904f + d * (-3.2452f + d * (3.55645f - d * 1.43519f));
+    const float b = 0.848013f + d * (-1.06021f + d * 0.215638f);
+    const float k = a * (t - 0.5f) * (t - 0.5f) + b;
+    const float adjustedT = t + t * (t - 0.5f) * (t - 1.0f) * k;
+
+    Quaternion result = lhs * (1.0f - adjustedT) + rhs * (cosAngle < 0.0f ? -adjustedT : adjustedT);
+    result.Normalize();
+    return result;
+}
+
+#ifdef URHO3D_SSE
+/// Decode four unpacked quaternions as separate component vectors.
+void DecodeQuaternions(const int* source, __m128& w, __m128& x, __m128& y, __m128& z)
+{
+    const __m128 scale = _mm_set1_ps(2.0f * QUATERNION_COMPONENT_RANGE / MAX_QUANTIZED_QUATERNION);
+    const __m128 offset = _mm_set1_ps(QUATERNION_COMPONENT_RANGE);
+    const __m128 a = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source))), scale), offset);
+    const __m128 b = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 4))), scale), offset);
+    const __m128 c = _mm_sub_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 8))), scale), offset);
+    const __m128i largestIndex = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + 12));
+
+    const __m128 sumSquares = _mm_add_ps(_mm_mul_ps(a, a), _mm_add_ps(_mm_mul_ps(b, b), _mm_mul_ps(c, c)));
+    const __m128 largest = _mm_sqrt_ps(_mm_max_ps(_mm_setzero_ps(), _mm_sub_ps(_mm_set1_ps(1.0f), sumSquares)));
+
+    // Put the omitted component in place without branches
+    const __m128 isW = _mm_castsi128_ps(_mm_cmpeq_epi32(largestIndex, _mm_set1_epi32(0)));
+    const __m128 isX = _mm_castsi128_ps(_mm_cmpeq_epi32(largestIndex, _mm_set1_epi32(1)));
+    const __m128 isY = _mm_castsi128_ps(_mm_cmpeq_epi32(largestIndex, _mm_set1_epi32(2)));
+    const __m128 isZ = _mm_castsi128_ps(_mm_cmpeq_epi32(largestIndex, _mm_set1_epi32(3)));
+    const auto select = [](__m128 mask, __m128 ifTrue, __m128 ifFalse)
+    {
+        return _mm_or_ps(_mm_and_ps(mask, ifTrue), _mm_andnot_ps(mask, ifFalse));
+    };
+    w = select(isW, largest, a);
+    x = select(isW, a, select(isX, largest, b));
+    y = select(isZ, c, select(isY, largest, b));
+    z = select(isZ, largest, c);
+}
+#endif
+
+/// Decode and interpolate unpacked rotations grouped by four. Each group has components of four keys followed by components of four keys to interpolate to.
+void DecodeRotations(const int* keys, const float* factors, Quaternion* dest, unsigned count)
+{
+    unsigned i = 0;
+#ifdef URHO3D_SSE
+    // Same as InterpolateRotation, four rotations at a time
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 threeHalves = _mm_set1_ps(1.5f);
+    for (; i < count; i += 4)
+    {
+        __m128 w0, x0, y0, z0;
+        __m128 w1, x1, y1, z1;
+        DecodeQuaternions(&keys[i * 8], w0, x0, y0, z0);
+        DecodeQuaternions(&keys[i * 8 + 16], w1, x1, y1, z1);
+
+        const __m128 t = _mm_loadu_ps(&factors[i]);
+        const __m128 cosAngle = _mm_add_ps(_mm_add_ps(_mm_mul_ps(w0, w1), _mm_mul_ps(x0, x1)),
+            _mm_add_ps(_mm_mul_ps(y0, y1), _mm_mul_ps(z0, z1)));
+        const __m128 d = _mm_andnot_ps(signMask, cosAngle);
+
+        __m128 a = _mm_sub_ps(_mm_set1_ps(3.55645f), _mm_mul_ps(d, _mm_set1_ps(1.43519f)));
+        a = _mm_add_ps(_mm_set1_ps(-3.2452f), _mm_mul_ps(d, a));
+        a = _mm_add_ps(_mm_set1_ps(1.0904f), _mm_mul_ps(d, a));
+        __m128 b = _mm_add_ps(_mm_set1_ps(-1.06021f), _mm_mul_ps(d, _mm_set1_ps(0.215638f)));
+        b = _mm_add_ps(_mm_set1_ps(0.848013f), _mm_mul_ps(d, b));
+
+        const __m128 tHalf = _mm_sub_ps(t, half);
+        const __m128 k = _mm_add_ps(_mm_mul_ps(a, _mm_mul_ps(tHalf, tHalf)), b);
+        const __m128 adjustedT = _mm_add_ps(t, _mm_mul_ps(_mm_mul_ps(t, tHalf), _mm_mul_ps(_mm_sub_ps(t, one), k)));
+
+        const __m128 t0 = _mm_sub_ps(one, adjustedT);
+        const __m128 t1 = _mm_xor_ps(adjustedT, _mm_and_ps(cosAngle, signMask));
+        __m128 w = _mm_add_ps(_mm_mul_ps(w0, t0), _mm_mul_ps(w1, t1));
+        __m128 x = _mm_add_ps(_mm_mul_ps(x0, t0), _mm_mul_ps(x1, t1));
+        __m128 y = _mm_add_ps(_mm_mul_ps(y0, t0), _mm_mul_ps(y1, t1));
+        __m128 z = _mm_add_ps(_mm_mul_ps(z0, t0), _mm_mul_ps(z1, t1));
+
+        // Normalize with reciprocal square root estimate refined by one Newton-Raphson step
+        const __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(w, w), _mm_mul_ps(x, x)),
+            _mm_add_ps(_mm_mul_ps(y, y), _mm_mul_ps(z, z)));
+        const __m128 estimate = _mm_rsqrt_ps(lengthSquared);
+        const __m128 invLength = _mm_mul_ps(estimate,
+            _mm_sub_ps(threeHalves, _mm_mul_ps(_mm_mul_ps(half, lengthSquared), _mm_mul_ps(estimate, estimate))));
+        w = _mm_mul_ps(w, invLength);
+        x = _mm_mul_ps(x, invLength);
+        y = _mm_mul_ps(y, invLength);
+        z = _mm_mul_ps(z, invLength);
+
+        _MM_TRANSPOSE4_PS(w, x, y, z);
+        if (i + 4 <= count)
+        {
+            _mm_storeu_ps(&dest[i].w_, w);
+            _mm_storeu_ps(&dest[i + 1].w_, x);
+            _mm_storeu_ps(&dest[i + 2].w_, y);
+            _mm_storeu_ps(&dest[i + 3].w_, z);
+        }
+        else
+        {
+            Quaternion group[4];
+            _mm_storeu_ps(&group[0].w_, w);
+            _mm_storeu_ps(&group[1].w_, x);
+            _mm_storeu_ps(&group[2].w_, y);
+            _mm_storeu_ps(&group[3].w_, z);
+            ea::copy(group, group + count - i, &dest[i]);
+        }
+    }
+#else
+    for (; i < count; ++i)
+    {
+        const int* groupKeys = &keys[(i / 4) * 32 + i % 4];
+        dest[i] = InterpolateRotation(DecodeQuaternion(groupKeys, 4), DecodeQuaternion(groupKeys + 16, 4), factors[i]);
+    }
+#endif
+}
+
+Vector3 DequantizeVector(const unsigned short source[3], const Vector3& rangeMin, const Vector3& rangeStep)
+{
+    return rangeMin + Vector3(source[0], source[1], source[2]) * rangeStep;
+}
+
+}
+
+unsigned CompressedAnimation::Channel::GetMemoryUse() const
+{
+    return keyOffsets_.capacity() * sizeof(unsigned)
+        + times_.capacity() * sizeof(unsigned short)
+        + values_.capacity() * sizeof(unsigned short)
+        + rangeMin_.capacity() * sizeof(Vector3)
+        + rangeStep_.capacity() * sizeof(Vector3);
+}
+
+CompressedAnimation::CompressedAnimation(const Animation& animation, const AnimationCompressionSettings& settings)
+    : length_(animation.GetLength())
+{
+    const auto& tracks = animation.GetTracks();
+    const float timeScale = length_ > 0.0f ? MAX_QUANTIZED_TIME / length_ : 0.0f;
+    const float rotationTolerance = settings.rotationTolerance_;
+
+    const auto lerpVector = [](const Vector3& lhs, const Vector3& rhs, float t) { return lhs.Lerp(rhs, t); };
+    const auto vectorError = [](const Vector3& lhs, const Vector3& rhs) { return (lhs - rhs).Length(); };
+    const auto lerpQuaternion = [](const Quaternion& lhs, const Quaternion& rhs, float t) { return InterpolateRotation(lhs, rhs, t); };
+    const auto quaternionError = [](const Quaternion& lhs, const Quaternion& rhs)
+    {
+        // Angle between rotations in degrees
+        return 2.0f * Acos(Abs(lhs.DotProduct(rhs)));
+    };
+
+    trackNameHashes_.reserve(tracks.size());
+    for (Channel* channel : { &positions_, &rotations_, &scales_ })
+        channel->keyOffsets_.push_back(0);
+
+    ea::vector<float> times;
+    ea::vector<Vector3> vectors;
+    ea::vector<Quaternion> quaternions;
+
+    for (const auto& item : tracks)
+    {
+        const AnimationTrack& track = item.second;
+        const unsigned trackIndex = trackNameHashes_.size();
+        trackNameHashes_.push_back(track.nameHash_);
+        trackIndices_[track.nameHash_] = trackIndex;
+
+        times.clear();
+        for (const AnimationKeyFrame& keyFrame : track.keyFrames_)
+            times.push_back(keyFrame.time_);
+
+        const auto addVectorChannel = [&](Channel& channel, AnimationChannel channelFlag, Vector3 AnimationKeyFrame::*member,
+            float tolerance)
+        {
+            Vector3 rangeMin;
+            Vector3 rangeStep;
+            if (track.channelMask_ & channelFlag)
+            {
+                vectors.clear();
+                for (const AnimationKeyFrame& keyFrame : track.keyFrames_)
+                    vectors.push_back(keyFrame.*member);
+                numSourceKeys_ += vectors.size();
+
+                const ea::vector<unsigned> keptKeys = ReduceKeys(times, vectors, tolerance, lerpVector, vectorError);
+                if (!keptKeys.empty())
+                {
+                    rangeMin = vectors[keptKeys[0]];
+                    Vector3 rangeMax = rangeMin;
+                    for (unsigned key : keptKeys)
+                    {
+                        rangeMin = VectorMin(rangeMin, vectors[key]);
+                        rangeMax = VectorMax(rangeMax, vectors[key]);
+                    }
+                    rangeStep = (rangeMax - rangeMin) / MAX_QUANTIZED_VECTOR;
+                    const Vector3 rangeSize = rangeMax - rangeMin;
+
+                    for (unsigned key : keptKeys)
+                    {
+                        const Vector3 offset = vectors[key] - rangeMin;
+                        channel.times_.push_back(QuantizeTime(times[key], timeScale));
+                        for (unsigned i = 0; i < 3; ++i)
+                        {
+                            const float size = rangeSize.Data()[i];
+                            const float value = size > 0.0f ? offset.Data()[i] / size : 0.0f;
+                            channel.values_.push_back(QuantizeUnitFloat(value, MAX_QUANTIZED_VECTOR));
+                        }
+                    }
+                }
+            }
+            channel.rangeMin_.push_back(rangeMin);
+            channel.rangeStep_.push_back(rangeStep);
+            channel.keyOffsets_.push_back(channel.times_.size());
+        };
+
+        addVectorChannel(positions_, CHANNEL_POSITION, &AnimationKeyFrame::position_, settings.positionTolerance_);
+        addVectorChannel(scales_, CHANNEL_SCALE, &AnimationKeyFrame::scale_, settings.scaleTolerance_);
+
+        if (track.channelMask_ & CHANNEL_ROTATION)
+        {
+            quaternions.clear();
+            for (const AnimationKeyFrame& keyFrame : track.keyFrames_)
+                quaternions.push_back(keyFrame.rotation_.Normalized());
+            numSourceKeys_ += quaternions.size();
+
+            const ea::vector<unsigned> keptKeys = ReduceKeys(times, quaternions, rotationTolerance,
+                lerpQuaternion, quaternionError);
+            for (unsigned key : keptKeys)
+            {
+                unsigned short quantized[3];
+                QuantizeQuaternion(quaternions[key], quantized);
+                rotations_.times_.push_back(QuantizeTime(times[key], timeScale));
+                rotations_.values_.insert(rotations_.values_.end(), ea::begin(quantized), ea::end(quantized));
+            }
+        }
+        rotations_.keyOffsets_.push_back(rotations_.times_.size());
+    }
+
+    for (Channel* channel : { &positions_, &rotations_, &scales_ })
+    {
+        channel->times_.shrink_to_fit();
+        channel->values_.shrink_to_fit();
+    }
+}
+
+bool CompressedAnimation::FindKeys(const Channel& channel, unsigned track, float normalizedTime, bool looped,
+    unsigned& key, unsigned& nextKey, float& t) const
+{
+    const unsigned begin = channel.keyOffsets_[track];
+    const unsigned end = channel.keyOffsets_[track + 1];
+    if (begin == end)
+        return false;
+
+    // Find the last key not after the time position, or the first key if time is before it.
+    // Usually the time advances a little since the last sample, so check the previous key and the one after it first.
+    const unsigned short* times = channel.times_.data();
+    const auto isKeyValid = [&](unsigned index)
+    {
+        return (index == begin || times[index] <= normalizedTime) && (index + 1 == end || normalizedTime < times[index + 1]);
+    };
+
+    if (key < begin || key >= end || !isKeyValid(key))
+    {
+        if (key >= begin && key + 1 < end && isKeyValid(key + 1))
+            ++key;
+        else
+        {
+            const unsigned short* upper = ea::upper_bound(times + begin, times + end, normalizedTime,
+                [](float lhs, unsigned short rhs) { return lhs < rhs; });
+            key = upper != times + begin ? static_cast<unsigned>(upper - times) - 1 : begin;
+        }
+    }
+
+    float interval = 0.0f;
+    if (key + 1 < end)
+    {
+        nextKey = key + 1;
+        interval = static_cast<float>(times[nextKey]) - times[key];
+    }
+    else if (looped && end - begin > 1)
+    {
+        nextKey = begin;
+        interval = MAX_QUANTIZED_TIME - times[key] + times[begin];
+    }
+    else
+        nextKey = key;
+
+    t = interval > 0.0f ? Clamp((normalizedTime - times[key]) / interval, 0.0f, 1.0f) : 1.0f;
+    return true;
+}
+
+void CompressedAnimation::Sample(float time, bool looped, CompressedAnimationPose& pose) const
+{
+    const unsigned numTracks = GetNumTracks();
+    pose.positions_.resize(numTracks);
+    pose.rotations_.resize(numTracks);
+    pose.scales_.resize(numTracks);
+    pose.keys_.resize(numTracks * 3);
+    const unsigned numTrackGroups = (numTracks + 3) / 4;
+    pose.rotationKeys_.resize(numTrackGroups * 32);
+    pose.rotationFactors_.resize(numTrackGroups * 4);
+
+    const float normalizedTime = length_ > 0.0f ? Clamp(time / length_, 0.0f, 1.0f) * MAX_QUANTIZED_TIME : 0.0f;
+
+    unsigned nextKey;
+    float t;
+    for (unsigned track = 0; track < numTracks; ++track)
+    {
+        unsigned* keys = &pose.keys_[track * 3];
+
+        unsigned key = keys[0];
+        if (FindKeys(positions_, track, normalizedTime, looped, key, nextKey, t))
+        {
+            const Vector3& rangeMin = positions_.rangeMin_[track];
+            const Vector3& rangeStep = positions_.rangeStep_[track];
+            const unsigned short* values = positions_.values_.data();
+            pose.positions_[track] = DequantizeVector(&values[key * 3], rangeMin, rangeStep);
+            if (key != nextKey)
+                pose.positions_[track] = pose.positions_[track].Lerp(DequantizeVector(&values[nextKey * 3], rangeMin, rangeStep), t);
+            keys[0] = key;
+        }
+
+        // Rotations are unpacked here and decoded for all tracks at once afterwards
+        int* rotationKeys = &pose.rotationKeys_[(track / 4) * 32 + track % 4];
+        key = keys[1];
+        if (FindKeys(rotations_, track, normalizedTime, looped, key, nextKey, t))
+        {
+            const unsigned short* values = rotations_.values_.data();
+            UnpackQuaternion(&values[key * 3], rotationKeys, 4);
+            UnpackQuaternion(&values[nextKey * 3], rotationKeys + 16, 4);
+            pose.rotationFactors_[track] = t;
+            keys[1] = key;
+        }
+        else
+        {
+            UnpackQuaternion(IDENTITY_QUATERNION, rotationKeys, 4);
+            UnpackQuaternion(IDENTITY_QUATERNION, rotationKeys + 16, 4);
+            pose.rotationFactors_[track] = 0.0f;
+        }
+
+        key = keys[2];
+        if (FindKeys(scales_, track, normalizedTime, looped, key, nextKey, t))
+        {
+            const Vector3& rangeMin = scales_.rangeMin_[track];
+            const Vector3& rangeStep = scales_.rangeStep_[track];
+            const unsigned short* values = scales_.values_.data();
+            pose.scales_[track] = DequantizeVector(&values[key * 3], rangeMin, rangeStep);
+            if (key != nextKey)
+                pose.scales_[track] = pose.scales_[track].Lerp(DequantizeVector(&values[nextKey * 3], rangeMin, rangeStep), t);
+            keys[2] = key;
+        }
+    }
+
+    DecodeRotations(pose.rotationKeys_.data(), pose.rotationFactors_.data(), pose.rotations_.data(), numTracks);
+}
+
+unsigned CompressedAnimation::GetTrackIndex(StringHash nameHash) const
+{
+    auto iter = trackIndices_.find(nameHash);
+    return iter != trackIndices_.end() ? iter->second : M_MAX_UNSIGNED;
+}
+
+unsigned CompressedAnimation::GetNumKeys() const
+{
+    return positions_.times_.size() + rotations_.times_.size() + scales_.times_.size();
+}
+
+unsigned CompressedAnimation::GetNumKeys(unsigned track) const
+{
+    return positions_.GetNumKeys(track) + rotations_.GetNumKeys(track) + scales_.GetNumKeys(track);
+}
+
+unsigned CompressedAnimation::GetMemoryUse() const
+{
+    return sizeof(CompressedAnimation)
+        + trackNameHashes_.capacity() * sizeof(StringHash)
+        + trackIndices_.size() * (sizeof(StringHash) + sizeof(unsigned) + sizeof(void*))
+        + positions_.GetMemoryUse() + rotations_.GetMemoryUse() + scales_.GetMemoryUse();
+}
+
+}
@@ -0,0 +1,124 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+/// \file
+
+#pragma once
+
+#include "../Container/RefCounted.h"
+#include "../Graphics/Animation.h"
+
+#include <EASTL/unordered_map.h>
+#include <EASTL/vector.h>
+
+namespace Urho3D
+{
+
+/// Transforms of all tracks of compressed animation sampled at the same time. Indexed by track index.
+struct CompressedAnimationPose
+{
+    /// Track positions.
+    ea::vector<Vector3> positions_;
+    /// Track rotations.
+    ea::vector<Quaternion> rotations_;
+    /// Track scales.
+    ea::vector<Vector3> scales_;
+    /// Last sampled position, rotation and scale keys of each track. Used to speed up the search when sampling again.
+    ea::vector<unsigned> keys_;
+    /// Unpacked rotation keys of groups of four tracks, used during sampling.
+    ea::vector<int> rotationKeys_;
+    /// Rotation interpolation factors, used during sampling.
+    ea::vector<float> rotationFactors_;
+};
+
+/// Immutable compressed copy of skeletal animation tracks, stored as structure of arrays.
+/// Constant channels are stored as single key, keys that can be linearly interpolated within tolerance are removed.
+/// Key times and positions are quantized to 16 bits, rotations are quantized to 48 bits (smallest three components).
+class URHO3D_API CompressedAnimation : public RefCounted
+{
+public:
+    /// Construct from animation tracks.
+    CompressedAnimation(const Animation& animation, const AnimationCompressionSettings& settings);
+
+    /// Sample all tracks at time position. Looped animation interpolates between last and first keys.
+    void Sample(float time, bool looped, CompressedAnimationPose& pose) const;
+
+    /// Return animation length.
+    float GetLength() const { return length_; }
+    /// Return number of tracks.
+    unsigned GetNumTracks() const { return trackNameHashes_.size(); }
+    /// Return track index by name hash, or M_MAX_UNSIGNED if not found.
+    unsigned GetTrackIndex(StringHash nameHash) const;
+    /// Return track name hash by index.
+    StringHash GetTrackNameHash(unsigned index) const { return trackNameHashes_[index]; }
+    /// Return number of stored keys of all tracks and channels.
+    unsigned GetNumKeys() const;
+    /// Return number of stored keys of all channels of track.
+    unsigned GetNumKeys(unsigned track) const;
+    /// Return number of keys of all tracks and channels before compression.
+    unsigned GetNumSourceKeys() const { return numSourceKeys_; }
+    /// Return memory use in bytes.
+    unsigned GetMemoryUse() const;
+
+private:
+    /// Keys of one channel of all tracks.
+    struct Channel
+    {
+        /// Return number of keys of track.
+        unsigned GetNumKeys(unsigned track) const { return keyOffsets_[track + 1] - keyOffsets_[track]; }
+        /// Return memory use in bytes.
+        unsigned GetMemoryUse() const;
+
+        /// Index of first key of each track. Has extra element for the end of the last track.
+        ea::vector<unsigned> keyOffsets_;
+        /// Key times normalized to animation length.
+        ea::vector<unsigned short> times_;
+        /// Quantized key values, three per key.
+        ea::vector<unsigned short> values_;
+        /// Minimum value of each track. Not used for rotations.
+        ea::vector<Vector3> rangeMin_;
+        /// Quantization step of each track. Not used for rotations.
+        ea::vector<Vector3> rangeStep_;
+    };
+
+    /// Find keys to interpolate between and interpolation factor, starting from the previously found key. Return false if track has no keys.
+    bool FindKeys(const Channel& channel, unsigned track, float normalizedTime, bool looped,
+        unsigned& key, unsigned& nextKey, float& t) const;
+
+    /// Animation length.
+    float length_{};
+    /// Track name hashes.
+    ea::vector<StringHash> trackNameHashes_;
+    /// Track indices by name hash.
+    ea::unordered_map<StringHash, unsigned> trackIndices_;
+    /// Position keys.
+    Channel positions_;
+    /// Rotation keys.
+    Channel rotations_;
+    /// Scale keys.
+    Channel scales_;
+    /// Number of source keys.
+    unsigned numSourceKeys_{};
+};
+
+}
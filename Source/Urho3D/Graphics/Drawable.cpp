@@ -373,6 +373,7 @@ void Drawable::OnSceneSet(Scene* scene)
 void Drawable::OnMarkedDirty(Node* node)
 {
     worldBoundingBoxDirty_ = true;
+    ++revision_;
     if (!updateQueued_ && octant_)
         octant_->GetRoot()->QueueUpdate(this);
 
@@ -28,9 +28,21 @@
 #include "../Math/BoundingBox.h"
 #include "../Scene/Component.h"
 
+#if URHO3D_SPHERICAL_HARMONICS
+#include "../Math/SphericalHarmonics.h"
+#endif
+
 namespace Urho3D
 {
 
+#if URHO3D_SPHERICAL_HARMONICS
+/// Ambient lighting sampled from light probes.
+using LightProbeAmbient = SphericalHarmonicsDot9;
+#else
+/// Ambient lighting sampled from light probes.
+using LightProbeAmbient = Vector4;
+#endif
+
 enum DrawableFlag : unsigned char
 {
     DRAWABLE_UNDEFINED = 0x0,
@@ -59,7 +71,6 @@ class Octant;
 class RayOctreeQuery;
 class Zone;
 struct RayQueryResult;
-struct WorkItem;
 
 /// Geometry update type.
 enum UpdateGeometryType
@@ -105,6 +116,8 @@ struct URHO3D_API SourceBatch
     const Matrix3x4* worldTransform_{&Matrix3x4::IDENTITY};
     /// Number of world transforms.
     unsigned numWorldTransforms_{1};
+    /// Offset of the bone transforms in the octree's skin matrix arena, or M_MAX_UNSIGNED if they are not stored there.
+    unsigned skinMatrixOffset_{M_MAX_UNSIGNED};
     /// Per-instance data. If not null, must contain enough data to fill instancing buffer.
     void* instancingData_{};
     /// %Geometry type.
@@ -138,7 +151,7 @@ class URHO3D_API Drawable : public Component
 
     friend class Octant;
     friend class Octree;
-    friend void UpdateDrawablesWork(const WorkItem* item, unsigned threadIndex);
+    friend void UpdateDrawablesWork(Drawable** start, Drawable** end, const FrameInfo& frame);
 
 public:
     /// Construct.
@@ -281,6 +294,9 @@ public:
     /// Return whether current zone is inconclusive or dirty due to the drawable moving.
     bool IsZoneDirty() const { return zoneDirty_; }
 
+    /// Return revision number, which is incremented whenever the drawable or any node it listens to is marked dirty.
+    unsigned GetRevision() const { return revision_; }
+
     /// Return distance from camera.
     float GetDistance() const { return distance_; }
 
@@ -313,6 +329,16 @@ public:
 
     /// Return mutable light probe tetrahedron hint.
     unsigned& GetMutableLightProbeTetrahedronHint() { return lightProbeTetrahedronHint_; }
+    /// Set ambient lighting sampled from light probes on given frame. Called by View.
+    void SetLightProbeAmbient(const LightProbeAmbient& ambient, unsigned frameNumber)
+    {
+        lightProbeAmbient_ = ambient;
+        lightProbeAmbientFrame_ = frameNumber;
+    }
+    /// Return ambient lighting sampled from light probes.
+    const LightProbeAmbient& GetLightProbeAmbient() const { return lightProbeAmbient_; }
+    /// Return frame number when light probe ambient was last sampled.
+    unsigned GetLightProbeAmbientFrame() const { return lightProbeAmbientFrame_; }
 
     /// Add a per-pixel light affecting the object this frame.
     void AddLight(Light* light)
@@ -375,6 +401,8 @@ protected:
     bool zoneDirty_;
     /// Octree octant.
     Octant* octant_;
+    /// Index in the octant drawable arrays.
+    unsigned octantIndex_{};
     /// Current zone.
     Zone* zone_;
     /// View mask.
@@ -387,6 +415,8 @@ protected:
     unsigned zoneMask_;
     /// Last visible frame number.
     unsigned viewFrameNumber_;
+    /// Revision number.
+    unsigned revision_{};
     /// Current distance to camera.
     float distance_;
     /// LOD scaled distance.
@@ -405,6 +435,10 @@ protected:
     float lodBias_;
     /// Light probe tetrahedron hint.
     unsigned lightProbeTetrahedronHint_{ M_MAX_UNSIGNED };
+    /// Frame number when light probe ambient was last sampled.
+    unsigned lightProbeAmbientFrame_{ M_MAX_UNSIGNED };
+    /// Ambient lighting sampled from light probes.
+    LightProbeAmbient lightProbeAmbient_{};
     /// Base pass flags, bit per batch.
     unsigned basePassFlags_;
     /// Maximum per-pixel lights.
@@ -135,6 +135,18 @@ Vector3 GlobalIllumination::SampleAverageAmbient(const Vector3& position, unsign
     return lightProbesMesh_.Sample(lightProbesBakedData_.ambient_, position, hint);
 }
 
+void GlobalIllumination::SampleAmbientSH(ea::span<const Vector3> positions, ea::span<unsigned> hints,
+    ea::span<SphericalHarmonicsDot9> results) const
+{
+    lightProbesMesh_.Sample(lightProbesBakedData_.sphericalHarmonics_, positions, hints, results);
+}
+
+void GlobalIllumination::SampleAverageAmbient(ea::span<const Vector3> positions, ea::span<unsigned> hints,
+    ea::span<Vector3> results) const
+{
+    lightProbesMesh_.Sample(lightProbesBakedData_.ambient_, positions, hints, results);
+}
+
 void GlobalIllumination::SetFileRef(const ResourceRef& fileRef)
 {
     if (fileRef_ != fileRef)
@@ -59,6 +59,11 @@ public:
     SphericalHarmonicsDot9 SampleAmbientSH(const Vector3& position, unsigned& hint) const;
     /// Sample average ambient lighting.
     Vector3 SampleAverageAmbient(const Vector3& position, unsigned& hint) const;
+    /// Sample ambient spherical harmonics at multiple positions. Results match the single position overload.
+    void SampleAmbientSH(ea::span<const Vector3> positions, ea::span<unsigned> hints,
+        ea::span<SphericalHarmonicsDot9> results) const;
+    /// Sample average ambient lighting at multiple positions. Results match the single position overload.
+    void SampleAverageAmbient(ea::span<const Vector3> positions, ea::span<unsigned> hints, ea::span<Vector3> results) const;
 
     /// Set emission brightness.
     void SetEmissionBrightness(float emissionBrightness) { emissionBrightness_ = emissionBrightness; }
@@ -138,6 +138,7 @@ void Light::RegisterObject(Context* context)
     URHO3D_ACCESSOR_ATTRIBUTE("Shadow Fade Distance", GetShadowFadeDistance, SetShadowFadeDistance, float, 0.0f, AM_DEFAULT);
     URHO3D_ACCESSOR_ATTRIBUTE("Shadow Intensity", GetShadowIntensity, SetShadowIntensity, float, 0.0f, AM_DEFAULT);
     URHO3D_ACCESSOR_ATTRIBUTE("Shadow Resolution", GetShadowResolution, SetShadowResolution, float, 1.0f, AM_DEFAULT);
+    URHO3D_ACCESSOR_ATTRIBUTE("Cache Shadow Map", GetCacheShadowMap, SetCacheShadowMap, bool, false, AM_DEFAULT);
     URHO3D_ATTRIBUTE_EX("Focus To Scene", bool, shadowFocus_.focus_, ValidateShadowFocus, true, AM_DEFAULT);
     URHO3D_ATTRIBUTE_EX("Non-uniform View", bool, shadowFocus_.nonUniform_, ValidateShadowFocus, true, AM_DEFAULT);
     URHO3D_ATTRIBUTE_EX("Auto-Reduce Size", bool, shadowFocus_.autoSize_, ValidateShadowFocus, true, AM_DEFAULT);
@@ -404,6 +405,12 @@ void Light::SetShadowResolution(float resolution)
     MarkNetworkUpdate();
 }
 
+void Light::SetCacheShadowMap(bool enable)
+{
+    cacheShadowMap_ = enable;
+    MarkNetworkUpdate();
+}
+
 void Light::SetRampTexture(Texture* texture)
 {
     rampTexture_ = texture;
@@ -235,6 +235,8 @@ public:
     void SetShadowIntensity(float intensity);
     /// Set shadow resolution between 0.25 - 1.0. Determines the shadow map to use.
     void SetShadowResolution(float resolution);
+    /// Set whether to keep the shadow map of a spot or point light between frames and re-render it only when the shadow casters or the light change. Does not affect directional lights.
+    void SetCacheShadowMap(bool enable);
     /// Set shadow camera near/far clip distance ratio for spot and point lights. Does not affect directional lights, since they are orthographic and have near clip 0.
     void SetShadowNearFarRatio(float nearFarRatio);
     /// Set maximum shadow extrusion for directional lights. The actual extrusion will be the smaller of this and camera far clip. Default 1000.
@@ -319,6 +321,12 @@ public:
     /// Return shadow resolution.
     float GetShadowResolution() const { return shadowResolution_; }
 
+    /// Return whether shadow map caching is enabled.
+    bool GetCacheShadowMap() const { return cacheShadowMap_; }
+
+    /// Return whether the shadow map is actually cached: caching is enabled and the light is not directional.
+    bool IsShadowMapCached() const { return cacheShadowMap_ && lightType_ != LIGHT_DIRECTIONAL; }
+
     /// Return shadow camera near/far clip distance ratio.
     float GetShadowNearFarRatio() const { return shadowNearFarRatio_; }
 
@@ -435,6 +443,8 @@ private:
     float shadowMaxExtrusion_;
     /// Per-vertex lighting flag.
     bool perVertex_;
+    /// Shadow map caching flag.
+    bool cacheShadowMap_{};
     /// Use physical light values flag.
     bool usePhysicalValues_;
 };
@@ -28,6 +28,7 @@
 #include "../Core/CoreEvents.h"
 #include "../Core/StopToken.h"
 #include "../Core/Timer.h"
+#include "../Core/WorkQueue.h"
 #include "../Graphics/GlobalIllumination.h"
 #include "../Graphics/Octree.h"
 #include "../Graphics/Renderer.h"
@@ -92,7 +93,12 @@ LightBaker::~LightBaker()
     if (state_ != InternalState::NotStarted)
     {
         taskData_->stopToken_.Stop();
-        task_.wait();
+        if (task_)
+        {
+            auto workQueue = GetSubsystem<WorkQueue>();
+            while (!task_->completed_)
+                workQueue->ProcessItem(0, 0);
+        }
     }
 }
 
@@ -231,8 +237,9 @@ void LightBaker::Update()
         // Do all the work with Scene here
         taskData->baker_.ProcessScene();
 
-        // Bake now or schedule task
-        if (state_ == InternalState::ScheduledSync)
+        // Bake now or schedule task. Asynchronous baking requires worker threads
+        auto workQueue = GetSubsystem<WorkQueue>();
+        if (state_ == InternalState::ScheduledSync || workQueue->GetNumThreads() == 0)
         {
             taskData->baker_.Bake(taskData->stopToken_);
 
@@ -250,7 +257,8 @@ void LightBaker::Update()
                 taskData->weakSelf_->state_ = InternalState::CommitPending;
             };
 
-            task_ = std::async(taskFunction);
+            // Low priority so the main thread never picks the task up while completing frame work
+            task_ = workQueue->AddWorkItem(taskFunction, 0);
 
             // Don't expect any results now, so return
             state_ = InternalState::InProgress;
@@ -268,9 +276,8 @@ void LightBaker::Update()
     // Commit changes
     if (state_ == InternalState::CommitPending)
     {
-        // If was async task, close future
-        if (task_.valid())
-            task_.get();
+        // If was async task, release work item
+        task_ = nullptr;
 
 #if URHO3D_GLOW
         taskData_->baker_.CommitScene();
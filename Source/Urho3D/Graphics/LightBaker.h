@@ -30,11 +30,12 @@
 #include <EASTL/shared_ptr.h>
 
 #include <atomic>
-#include <future>
 
 namespace Urho3D
 {
 
+struct WorkItem;
+
 /// Light baking quality settings.
 enum class LightBakingQuality
 {
@@ -102,7 +103,7 @@ private:
     /// Current state.
     std::atomic<InternalState> state_{};
     /// Async baking task.
-    std::future<void> task_;
+    SharedPtr<WorkItem> task_;
     /// Task data.
     ea::shared_ptr<TaskData> taskData_;
 };
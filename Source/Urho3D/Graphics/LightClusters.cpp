@@ -0,0 +1,256 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Core/WorkQueue.h"
+#include "../Graphics/LightClusters.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+namespace
+{
+
+/// Return point of view frustum at given depth and normalized position within the view.
+Vector3 GetFrustumPoint(const Frustum& frustum, float depthFactor, float x, float y)
+{
+    const Vector3 bottomLeft = frustum.vertices_[2].Lerp(frustum.vertices_[6], depthFactor);
+    const Vector3 bottomRight = frustum.vertices_[1].Lerp(frustum.vertices_[5], depthFactor);
+    const Vector3 topLeft = frustum.vertices_[3].Lerp(frustum.vertices_[7], depthFactor);
+    const Vector3 topRight = frustum.vertices_[0].Lerp(frustum.vertices_[4], depthFactor);
+    return bottomLeft.Lerp(bottomRight, x).Lerp(topLeft.Lerp(topRight, x), y);
+}
+
+}
+
+void LightClusters::SetGridSize(const IntVector3& gridSize)
+{
+    gridSize_ = VectorMax(gridSize, IntVector3::ONE);
+}
+
+void LightClusters::Define(const Frustum& viewSpaceFrustum, bool orthographic)
+{
+    orthographic_ = orthographic;
+    nearClip_ = viewSpaceFrustum.vertices_[0].z_;
+    farClip_ = viewSpaceFrustum.vertices_[4].z_;
+    if (!orthographic_)
+        nearClip_ = Max(nearClip_, M_EPSILON);
+    farClip_ = Max(farClip_, nearClip_ + M_EPSILON);
+
+    const auto numX = static_cast<unsigned>(gridSize_.x_);
+    const auto numY = static_cast<unsigned>(gridSize_.y_);
+    const auto numZ = static_cast<unsigned>(gridSize_.z_);
+
+    depthSliceScale_ = orthographic_ ? numZ / (farClip_ - nearClip_) : numZ / Ln(farClip_ / nearClip_);
+
+    // Calculate depth slice ranges
+    sliceDepths_.resize(numZ);
+    for (unsigned z = 0; z < numZ; ++z)
+    {
+        const float nearFactor = static_cast<float>(z) / numZ;
+        const float farFactor = static_cast<float>(z + 1) / numZ;
+        if (orthographic_)
+        {
+            sliceDepths_[z].x_ = Lerp(nearClip_, farClip_, nearFactor);
+            sliceDepths_[z].y_ = Lerp(nearClip_, farClip_, farFactor);
+        }
+        else
+        {
+            sliceDepths_[z].x_ = nearClip_ * Pow(farClip_ / nearClip_, nearFactor);
+            sliceDepths_[z].y_ = nearClip_ * Pow(farClip_ / nearClip_, farFactor);
+        }
+    }
+    sliceDepths_[0].x_ = nearClip_;
+    sliceDepths_[numZ - 1].y_ = farClip_;
+
+    // Calculate cluster and row bounding boxes
+    clusterBoxes_.resize(numX * numY * numZ);
+    rowBoxes_.resize(numY * numZ);
+    const float depthRange = farClip_ - nearClip_;
+    for (unsigned z = 0; z < numZ; ++z)
+    {
+        const float nearFactor = (sliceDepths_[z].x_ - nearClip_) / depthRange;
+        const float farFactor = (sliceDepths_[z].y_ - nearClip_) / depthRange;
+        for (unsigned y = 0; y < numY; ++y)
+        {
+            BoundingBox& rowBox = rowBoxes_[z * numY + y];
+            rowBox.Clear();
+
+            const float minY = static_cast<float>(y) / numY;
+            const float maxY = static_cast<float>(y + 1) / numY;
+            for (unsigned x = 0; x < numX; ++x)
+            {
+                const float minX = static_cast<float>(x) / numX;
+                const float maxX = static_cast<float>(x + 1) / numX;
+
+                BoundingBox& clusterBox = clusterBoxes_[GetClusterIndex(x, y, z)];
+                clusterBox.Clear();
+                for (float depthFactor : { nearFactor, farFactor })
+                {
+                    clusterBox.Merge(GetFrustumPoint(viewSpaceFrustum, depthFactor, minX, minY));
+                    clusterBox.Merge(GetFrustumPoint(viewSpaceFrustum, depthFactor, maxX, minY));
+                    clusterBox.Merge(GetFrustumPoint(viewSpaceFrustum, depthFactor, minX, maxY));
+                    clusterBox.Merge(GetFrustumPoint(viewSpaceFrustum, depthFactor, maxX, maxY));
+                }
+                rowBox.Merge(clusterBox);
+            }
+        }
+
+        // Use actual depth range of cluster boxes to reject lights before testing the boxes
+        sliceDepths_[z] = Vector2(M_INFINITY, -M_INFINITY);
+        for (unsigned y = 0; y < numY; ++y)
+        {
+            const BoundingBox& rowBox = rowBoxes_[z * numY + y];
+            sliceDepths_[z].x_ = Min(sliceDepths_[z].x_, rowBox.min_.z_);
+            sliceDepths_[z].y_ = Max(sliceDepths_[z].y_, rowBox.max_.z_);
+        }
+    }
+
+    clusters_.clear();
+    clusters_.resize(clusterBoxes_.size());
+    lightIndices_.clear();
+}
+
+unsigned LightClusters::GetDepthSlice(float depth) const
+{
+    const float slice = orthographic_
+        ? (depth - nearClip_) * depthSliceScale_
+        : Ln(Max(depth, nearClip_) / nearClip_) * depthSliceScale_;
+    return static_cast<unsigned>(Clamp(FloorToInt(slice), 0, gridSize_.z_ - 1));
+}
+
+bool LightClusters::IsLightInCluster(const Sphere& lightSphere, const BoundingBox& clusterBox)
+{
+    const Vector3 closestPoint = VectorMax(clusterBox.min_, VectorMin(lightSphere.center_, clusterBox.max_));
+    return (closestPoint - lightSphere.center_).LengthSquared() < lightSphere.radius_ * lightSphere.radius_;
+}
+
+void LightClusters::AssignLights(const ea::vector<Sphere>& lightSpheres, WorkQueue* workQueue)
+{
+    const auto numZ = static_cast<unsigned>(gridSize_.z_);
+    sliceLightIndices_.resize(numZ);
+    sliceDroppedLights_.resize(numZ);
+    sliceCandidates_.resize(numZ);
+
+    // Depth slices are independent, so each of them is processed as a separate chunk
+    if (workQueue)
+    {
+        workQueue->ParallelFor(numZ, 1, [&](unsigned beginIndex, unsigned endIndex, unsigned)
+        {
+            for (unsigned z = beginIndex; z < endIndex; ++z)
+                AssignLightsToSlice(lightSpheres, z);
+        });
+    }
+    else
+    {
+        for (unsigned z = 0; z < numZ; ++z)
+            AssignLightsToSlice(lightSpheres, z);
+    }
+
+    // Merge light indices of all slices in order
+    unsigned numLightIndices = 0;
+    numDroppedLights_ = 0;
+    for (unsigned z = 0; z < numZ; ++z)
+    {
+        numLightIndices += sliceLightIndices_[z].size();
+        numDroppedLights_ += sliceDroppedLights_[z];
+    }
+    lightIndices_.resize(numLightIndices);
+
+    const unsigned numClustersInSlice = static_cast<unsigned>(gridSize_.x_ * gridSize_.y_);
+    unsigned sliceOffset = 0;
+    for (unsigned z = 0; z < numZ; ++z)
+    {
+        const ea::vector<unsigned>& sliceIndices = sliceLightIndices_[z];
+        ea::copy(sliceIndices.begin(), sliceIndices.end(), lightIndices_.begin() + sliceOffset);
+
+        const unsigned firstCluster = z * numClustersInSlice;
+        for (unsigned i = firstCluster; i < firstCluster + numClustersInSlice; ++i)
+            clusters_[i].offset_ += sliceOffset;
+        sliceOffset += sliceIndices.size();
+    }
+}
+
+void LightClusters::AssignLightsToSlice(const ea::vector<Sphere>& lightSpheres, unsigned slice)
+{
+    const auto numX = static_cast<unsigned>(gridSize_.x_);
+    const auto numY = static_cast<unsigned>(gridSize_.y_);
+    const Vector2& sliceDepth = sliceDepths_[slice];
+
+    ea::vector<unsigned>& sliceIndices = sliceLightIndices_[slice];
+    sliceIndices.clear();
+    unsigned& numDropped = sliceDroppedLights_[slice];
+    numDropped = 0;
+
+    // Find lights overlapping slice depth range
+    ea::vector<unsigned>& candidates = sliceCandidates_[slice];
+    candidates.clear();
+    for (unsigned i = 0; i < lightSpheres.size(); ++i)
+    {
+        const Sphere& sphere = lightSpheres[i];
+        if (sphere.center_.z_ + sphere.radius_ >= sliceDepth.x_ && sphere.center_.z_ - sphere.radius_ <= sliceDepth.y_)
+            candidates.push_back(i);
+    }
+    const unsigned numSliceCandidates = candidates.size();
+
+    for (unsigned y = 0; y < numY; ++y)
+    {
+        // Find lights overlapping the row, store them after the slice candidates
+        candidates.resize(numSliceCandidates);
+        const BoundingBox& rowBox = rowBoxes_[slice * numY + y];
+        for (unsigned i = 0; i < numSliceCandidates; ++i)
+        {
+            if (IsLightInCluster(lightSpheres[candidates[i]], rowBox))
+                candidates.push_back(candidates[i]);
+        }
+
+        for (unsigned x = 0; x < numX; ++x)
+        {
+            const unsigned clusterIndex = GetClusterIndex(x, y, slice);
+            const BoundingBox& clusterBox = clusterBoxes_[clusterIndex];
+            LightCluster& cluster = clusters_[clusterIndex];
+            cluster.offset_ = sliceIndices.size();
+            cluster.count_ = 0;
+
+            for (unsigned i = numSliceCandidates; i < candidates.size(); ++i)
+            {
+                const unsigned lightIndex = candidates[i];
+                if (!IsLightInCluster(lightSpheres[lightIndex], clusterBox))
+                    continue;
+
+                if (cluster.count_ < maxLightsPerCluster_)
+                {
+                    sliceIndices.push_back(lightIndex);
+                    ++cluster.count_;
+                }
+                else
+                    ++numDropped;
+            }
+        }
+    }
+}
+
+}
@@ -0,0 +1,127 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+/// \file
+
+#pragma once
+
+#include "../Math/BoundingBox.h"
+#include "../Math/Frustum.h"
+#include "../Math/Sphere.h"
+#include "../Math/Vector3.h"
+
+#include <EASTL/vector.h>
+
+namespace Urho3D
+{
+
+class WorkQueue;
+
+/// Default number of light clusters along X, Y and Z axes.
+static const IntVector3 DEFAULT_LIGHT_CLUSTER_GRID{ 16, 9, 24 };
+/// Default maximum number of lights per cluster.
+static const unsigned DEFAULT_MAX_LIGHTS_PER_CLUSTER = 32;
+
+/// Range of light indices affecting a cluster. Layout matches a pair of unsigned integers in shader buffers.
+struct LightCluster
+{
+    /// Offset of the first light index.
+    unsigned offset_{};
+    /// Number of lights.
+    unsigned count_{};
+};
+
+/// View frustum divided into clusters (froxels) with lights assigned to each cluster, for clustered forward lighting.
+/// Clusters are indexed by (z * gridHeight + y) * gridWidth + x. X and Y go from the left bottom corner of the view.
+/// Depth slices are distributed exponentially for perspective projection and uniformly for orthographic projection.
+/// Lights are given as bounding spheres in view space and are referenced by their index in the input array.
+class URHO3D_API LightClusters
+{
+public:
+    /// Set number of clusters along X, Y and Z axes.
+    void SetGridSize(const IntVector3& gridSize);
+    /// Set maximum number of lights per cluster. Lights with lower indices take precedence, the rest are counted as dropped.
+    void SetMaxLightsPerCluster(unsigned maxLights) { maxLightsPerCluster_ = maxLights; }
+    /// Define clusters from view space frustum.
+    void Define(const Frustum& viewSpaceFrustum, bool orthographic);
+    /// Assign lights to clusters. Work is split between worker threads if work queue is provided.
+    void AssignLights(const ea::vector<Sphere>& lightSpheres, WorkQueue* workQueue = nullptr);
+
+    /// Return number of clusters along X, Y and Z axes.
+    const IntVector3& GetGridSize() const { return gridSize_; }
+    /// Return maximum number of lights per cluster.
+    unsigned GetMaxLightsPerCluster() const { return maxLightsPerCluster_; }
+    /// Return total number of clusters.
+    unsigned GetNumClusters() const { return clusters_.size(); }
+    /// Return cluster index.
+    unsigned GetClusterIndex(unsigned x, unsigned y, unsigned z) const { return (z * gridSize_.y_ + y) * gridSize_.x_ + x; }
+    /// Return depth slice containing view space depth.
+    unsigned GetDepthSlice(float depth) const;
+    /// Return cluster bounding box in view space.
+    const BoundingBox& GetClusterBoundingBox(unsigned index) const { return clusterBoxes_[index]; }
+    /// Return light index range of each cluster.
+    const ea::vector<LightCluster>& GetClusters() const { return clusters_; }
+    /// Return light indices referenced by clusters.
+    const ea::vector<unsigned>& GetLightIndices() const { return lightIndices_; }
+    /// Return number of light and cluster pairs that were not assigned because of the per-cluster light limit.
+    unsigned GetNumDroppedLights() const { return numDroppedLights_; }
+    /// Return whether light sphere affects cluster bounding box. Used for light assignment.
+    static bool IsLightInCluster(const Sphere& lightSphere, const BoundingBox& clusterBox);
+
+private:
+    /// Assign lights to clusters of depth slice.
+    void AssignLightsToSlice(const ea::vector<Sphere>& lightSpheres, unsigned slice);
+
+    /// Number of clusters along X, Y and Z axes.
+    IntVector3 gridSize_{ DEFAULT_LIGHT_CLUSTER_GRID };
+    /// Maximum number of lights per cluster.
+    unsigned maxLightsPerCluster_{ DEFAULT_MAX_LIGHTS_PER_CLUSTER };
+    /// Whether depth slices are distributed uniformly.
+    bool orthographic_{};
+    /// Near clip distance.
+    float nearClip_{};
+    /// Far clip distance.
+    float farClip_{};
+    /// Scale from logarithmic or linear depth to depth slice.
+    float depthSliceScale_{};
+    /// Cluster bounding boxes in view space.
+    ea::vector<BoundingBox> clusterBoxes_;
+    /// Bounding boxes of cluster rows in view space.
+    ea::vector<BoundingBox> rowBoxes_;
+    /// Depth range of each depth slice.
+    ea::vector<Vector2> sliceDepths_;
+    /// Light index range of each cluster.
+    ea::vector<LightCluster> clusters_;
+    /// Light indices referenced by clusters.
+    ea::vector<unsigned> lightIndices_;
+    /// Light indices of each depth slice before merging.
+    ea::vector<ea::vector<unsigned>> sliceLightIndices_;
+    /// Number of dropped lights of each depth slice.
+    ea::vector<unsigned> sliceDroppedLights_;
+    /// Number of dropped lights.
+    unsigned numDroppedLights_{};
+    /// Candidate lights of each depth slice.
+    ea::vector<ea::vector<unsigned>> sliceCandidates_;
+};
+
+}
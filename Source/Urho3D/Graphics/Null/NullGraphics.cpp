@@ -0,0 +1,1448 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../../Precompiled.h"
+
+#include "../../Core/Context.h"
+#include "../../Core/Profiler.h"
+#include "../../Graphics/ConstantBuffer.h"
+#include "../../Graphics/Graphics.h"
+#include "../../Graphics/GraphicsEvents.h"
+#include "../../Graphics/GraphicsImpl.h"
+#include "../../Graphics/IndexBuffer.h"
+#include "../../Graphics/Shader.h"
+#include "../../Graphics/ShaderPrecache.h"
+#include "../../Graphics/ShaderProgram.h"
+#include "../../Graphics/Texture2D.h"
+#include "../../Graphics/TextureCube.h"
+#include "../../Graphics/VertexBuffer.h"
+#include "../../IO/Log.h"
+#include "../../Resource/ResourceCache.h"
+
+#include "../../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Default backbuffer size when the screen mode does not specify one.
+static const IntVector2 DEFAULT_BACKBUFFER_SIZE{ 1024, 768 };
+
+static unsigned GetPrimitiveCount(unsigned elementCount, PrimitiveType type)
+{
+    switch (type)
+    {
+    case TRIANGLE_LIST:
+        return elementCount / 3;
+
+    case LINE_LIST:
+        return elementCount / 2;
+
+    case POINT_LIST:
+        return elementCount;
+
+    case TRIANGLE_STRIP:
+    case TRIANGLE_FAN:
+        return elementCount > 2 ? elementCount - 2 : 0;
+
+    case LINE_STRIP:
+        return elementCount > 1 ? elementCount - 1 : 0;
+
+    default:
+        return 0;
+    }
+}
+
+const Vector2 Graphics::pixelUVOffset(0.0f, 0.0f);
+bool Graphics::gl3Support = false;
+
+Graphics::Graphics(Context* context) :
+    Object(context),
+    impl_(new GraphicsImpl()),
+    position_(IntVector2::ZERO),
+    shaderPath_("Shaders/HLSL/"),
+    shaderExtension_(".hlsl"),
+    orientations_("LandscapeLeft LandscapeRight"),
+    apiName_("Null")
+{
+    SetTextureUnitMappings();
+    ResetCachedState();
+
+    // Register Graphics library object factories
+    RegisterGraphicsLibrary(context_);
+}
+
+Graphics::~Graphics()
+{
+    {
+        MutexLock lock(gpuObjectMutex_);
+
+        // Release all GPU objects that still exist
+        for (auto i = gpuObjects_.begin(); i != gpuObjects_.end(); ++i)
+            (*i)->Release();
+        gpuObjects_.clear();
+    }
+
+    impl_->shaderPrograms_.clear();
+    impl_->allConstantBuffers_.clear();
+
+    delete impl_;
+    impl_ = nullptr;
+}
+
+bool Graphics::SetScreenMode(int width, int height, const ScreenModeParams& params, bool maximize)
+{
+    URHO3D_PROFILE("SetScreenMode");
+
+    // There is no window: use the requested size as is, or the default size if not specified
+    if (width <= 0 || height <= 0)
+    {
+        width = DEFAULT_BACKBUFFER_SIZE.x_;
+        height = DEFAULT_BACKBUFFER_SIZE.y_;
+    }
+
+    ScreenModeParams newParams = params;
+    newParams.highDPI_ = false;
+    newParams.multiSample_ = Clamp(newParams.multiSample_, 1, 16);
+
+    // If nothing changes, do not reset the state
+    if (impl_->initialized_ && width == width_ && height == height_ && newParams == screenParams_)
+        return true;
+
+    screenParams_ = newParams;
+    width_ = width;
+    height_ = height;
+
+    if (!impl_->initialized_)
+    {
+        CheckFeatureSupport();
+        impl_->initialized_ = true;
+    }
+
+    ResetRenderTargets();
+
+    OnScreenModeChanged();
+    return true;
+}
+
+void Graphics::SetSRGB(bool enable)
+{
+    sRGB_ = enable && sRGBWriteSupport_;
+}
+
+void Graphics::SetDither(bool enable)
+{
+    // No effect on null backend
+}
+
+void Graphics::SetFlushGPU(bool enable)
+{
+    flushGPU_ = enable;
+}
+
+void Graphics::SetForceGL2(bool enable)
+{
+    // No effect on null backend
+}
+
+void Graphics::Close()
+{
+    impl_->initialized_ = false;
+}
+
+bool Graphics::TakeScreenShot(Image& destImage)
+{
+    URHO3D_PROFILE("TakeScreenShot");
+
+    if (!IsInitialized())
+        return false;
+
+    // Nothing is rasterized, the backbuffer is always black
+    destImage.SetSize(width_, height_, 3);
+    memset(destImage.GetData(), 0, (size_t)width_ * height_ * 3);
+    return true;
+}
+
+bool Graphics::BeginFrame()
+{
+    if (!IsInitialized())
+        return false;
+
+    // Set default rendertarget and depth buffer
+    ResetRenderTargets();
+
+    // Cleanup textures from previous frame
+    for (unsigned i = 0; i < MAX_TEXTURE_UNITS; ++i)
+        SetTexture(i, nullptr);
+
+    numPrimitives_ = 0;
+    numBatches_ = 0;
+
+    SendEvent(E_BEGINRENDERING);
+    return true;
+}
+
+void Graphics::EndFrame()
+{
+    if (!IsInitialized())
+        return;
+
+    SendEvent(E_ENDRENDERING);
+    impl_->EndFrameStats();
+
+    // Clean up too large scratch buffers
+    CleanupScratchBuffers();
+}
+
+void Graphics::Clear(ClearTargetFlags flags, const Color& color, float depth, unsigned stencil)
+{
+    // Apply pending rendertarget changes, a device would need them bound for the clear
+    PrepareDraw();
+    ++impl_->currentStats_.clears_;
+}
+
+bool Graphics::ResolveToTexture(Texture2D* destination, const IntRect& viewport)
+{
+    if (!destination || !destination->GetRenderSurface())
+        return false;
+
+    ++impl_->currentStats_.resolves_;
+    return true;
+}
+
+bool Graphics::ResolveToTexture(Texture2D* texture)
+{
+    if (!texture)
+        return false;
+    RenderSurface* surface = texture->GetRenderSurface();
+    if (!surface)
+        return false;
+
+    texture->SetResolveDirty(false);
+    surface->SetResolveDirty(false);
+    if (!texture->GetGPUObject() || !texture->GetResolveTexture())
+        return false;
+
+    ++impl_->currentStats_.resolves_;
+    return true;
+}
+
+bool Graphics::ResolveToTexture(TextureCube* texture)
+{
+    if (!texture)
+        return false;
+
+    texture->SetResolveDirty(false);
+    if (!texture->GetGPUObject() || !texture->GetResolveTexture())
+        return false;
+
+    for (unsigned i = 0; i < MAX_CUBEMAP_FACES; ++i)
+    {
+        // Resolve only the surface(s) that were actually rendered to
+        RenderSurface* surface = texture->GetRenderSurface((CubeMapFace)i);
+        if (!surface->IsResolveDirty())
+            continue;
+
+        surface->SetResolveDirty(false);
+        ++impl_->currentStats_.resolves_;
+    }
+
+    return true;
+}
+
+void Graphics::Draw(PrimitiveType type, unsigned vertexStart, unsigned vertexCount)
+{
+    if (!vertexCount || !impl_->shaderProgram_)
+        return;
+
+    PrepareDraw();
+
+    if (fillMode_ == FILL_POINT)
+        type = POINT_LIST;
+
+    const unsigned primitiveCount = GetPrimitiveCount(vertexCount, type);
+    ++impl_->currentStats_.draws_;
+    impl_->currentStats_.primitives_ += primitiveCount;
+
+    numPrimitives_ += primitiveCount;
+    ++numBatches_;
+}
+
+void Graphics::Draw(PrimitiveType type, unsigned indexStart, unsigned indexCount, unsigned minVertex, unsigned vertexCount)
+{
+    Draw(type, indexStart, indexCount, 0, minVertex, vertexCount);
+}
+
+void Graphics::Draw(PrimitiveType type, unsigned indexStart, unsigned indexCount, unsigned baseVertexIndex, unsigned minVertex, unsigned vertexCount)
+{
+    if (!vertexCount || !impl_->shaderProgram_)
+        return;
+
+    PrepareDraw();
+
+    if (fillMode_ == FILL_POINT)
+        type = POINT_LIST;
+
+    const unsigned primitiveCount = GetPrimitiveCount(indexCount, type);
+    ++impl_->currentStats_.draws_;
+    impl_->currentStats_.primitives_ += primitiveCount;
+
+    numPrimitives_ += primitiveCount;
+    ++numBatches_;
+}
+
+void Graphics::DrawInstanced(PrimitiveType type, unsigned indexStart, unsigned indexCount, unsigned minVertex, unsigned vertexCount,
+    unsigned instanceCount)
+{
+    DrawInstanced(type, indexStart, indexCount, 0, minVertex, vertexCount, instanceCount);
+}
+
+void Graphics::DrawInstanced(PrimitiveType type, unsigned indexStart, unsigned indexCount, unsigned baseVertexIndex, unsigned minVertex, unsigned vertexCount,
+    unsigned instanceCount)
+{
+    if (!indexCount || !instanceCount || !impl_->shaderProgram_)
+        return;
+
+    PrepareDraw();
+
+    if (fillMode_ == FILL_POINT)
+        type = POINT_LIST;
+
+    const unsigned primitiveCount = GetPrimitiveCount(indexCount, type);
+    ++impl_->currentStats_.draws_;
+    ++impl_->currentStats_.instancedDraws_;
+    impl_->currentStats_.primitives_ += instanceCount * primitiveCount;
+
+    numPrimitives_ += instanceCount * primitiveCount;
+    ++numBatches_;
+}
+
+void Graphics::SetVertexBuffer(VertexBuffer* buffer)
+{
+    // Note: this is not multi-instance safe
+    static ea::vector<VertexBuffer*> vertexBuffers(1);
+    vertexBuffers[0] = buffer;
+    SetVertexBuffers(vertexBuffers);
+}
+
+bool Graphics::SetVertexBuffers(const ea::vector<VertexBuffer*>& buffers, unsigned instanceOffset)
+{
+    if (buffers.size() > MAX_VERTEX_STREAMS)
+    {
+        URHO3D_LOGERROR("Too many vertex buffers");
+        return false;
+    }
+
+    for (unsigned i = 0; i < MAX_VERTEX_STREAMS; ++i)
+    {
+        VertexBuffer* buffer = i < buffers.size() ? buffers[i] : nullptr;
+        if (buffer)
+        {
+            const ea::vector<VertexElement>& elements = buffer->GetElements();
+            // Check if buffer has per-instance data
+            bool hasInstanceData = elements.size() && elements[0].perInstance_;
+            unsigned offset = hasInstanceData ? instanceOffset * buffer->GetVertexSize() : 0;
+
+            if (buffer != vertexBuffers_[i] || offset != impl_->vertexOffsets_[i])
+            {
+                vertexBuffers_[i] = buffer;
+                impl_->vertexOffsets_[i] = offset;
+                ++impl_->currentStats_.vertexBufferChanges_;
+            }
+        }
+        else if (vertexBuffers_[i])
+        {
+            vertexBuffers_[i] = nullptr;
+            impl_->vertexOffsets_[i] = 0;
+            ++impl_->currentStats_.vertexBufferChanges_;
+        }
+    }
+
+    return true;
+}
+
+bool Graphics::SetVertexBuffers(const ea::vector<SharedPtr<VertexBuffer> >& buffers, unsigned instanceOffset)
+{
+    ea::vector<VertexBuffer*> bufferPointers;
+    bufferPointers.reserve(buffers.size());
+    for (auto& buffer : buffers)
+        bufferPointers.push_back(buffer.Get());
+    return SetVertexBuffers(bufferPointers, instanceOffset);
+}
+
+void Graphics::SetIndexBuffer(IndexBuffer* buffer)
+{
+    if (buffer != indexBuffer_)
+    {
+        indexBuffer_ = buffer;
+        ++impl_->currentStats_.indexBufferChanges_;
+    }
+}
+
+void Graphics::SetShaders(ShaderVariation* vs, ShaderVariation* ps)
+{
+    // Switch to the clip plane variations if necessary
+    if (useClipPlane_)
+    {
+        if (vs)
+            vs = vs->GetOwner()->GetVariation(VS, vs->GetDefinesClipPlane());
+        if (ps)
+            ps = ps->GetOwner()->GetVariation(PS, ps->GetDefinesClipPlane());
+    }
+
+    if (vs == vertexShader_ && ps == pixelShader_)
+        return;
+
+    if (vs != vertexShader_)
+    {
+        // Create the shader now if not yet created. If already attempted, do not retry
+        if (vs && !vs->GetGPUObject())
+        {
+            if (vs->GetCompilerOutput().empty())
+            {
+                if (!vs->Create())
+                {
+                    URHO3D_LOGERROR("Failed to create vertex shader " + vs->GetFullName() + ":\n" + vs->GetCompilerOutput());
+                    vs = nullptr;
+                }
+            }
+            else
+                vs = nullptr;
+        }
+
+        vertexShader_ = vs;
+    }
+
+    if (ps != pixelShader_)
+    {
+        if (ps && !ps->GetGPUObject())
+        {
+            if (ps->GetCompilerOutput().empty())
+            {
+                if (!ps->Create())
+                {
+                    URHO3D_LOGERROR("Failed to create pixel shader " + ps->GetFullName() + ":\n" + ps->GetCompilerOutput());
+                    ps = nullptr;
+                }
+            }
+            else
+                ps = nullptr;
+        }
+
+        pixelShader_ = ps;
+    }
+
+    ++impl_->currentStats_.shaderChanges_;
+
+    if (vertexShader_ && pixelShader_)
+    {
+        ea::pair<ShaderVariation*, ShaderVariation*> key = ea::make_pair(vertexShader_, pixelShader_);
+        auto i = impl_->shaderPrograms_.find(key);
+        if (i != impl_->shaderPrograms_.end())
+            impl_->shaderProgram_ = i->second.Get();
+        else
+        {
+            ShaderProgram* newProgram = impl_->shaderPrograms_[key] = new ShaderProgram(this, vertexShader_, pixelShader_);
+            impl_->shaderProgram_ = newProgram;
+        }
+
+        // A new program has its own parameter storage, all parameter groups need to be set again
+        ClearParameterSources();
+    }
+    else
+        impl_->shaderProgram_ = nullptr;
+
+    // Store shader combination if shader dumping in progress
+    if (shaderPrecache_)
+        shaderPrecache_->StoreShaders(vertexShader_, pixelShader_);
+
+    // Update clip plane parameter if necessary
+    if (useClipPlane_)
+        SetShaderParameter(VSP_CLIPPLANE, clipPlane_);
+}
+
+void Graphics::SetShaderParameter(StringHash param, const float data[], unsigned count)
+{
+    if (impl_->shaderProgram_)
+        ++impl_->currentStats_.shaderParameterUpdates_;
+}
+
+void Graphics::SetShaderParameter(StringHash param, float value)
+{
+    if (impl_->shaderProgram_)
+        ++impl_->currentStats_.shaderParameterUpdates_;
+}
+
+void Graphics::SetShaderParameter(StringHash param, int value)
+{
+    if (impl_->shaderProgram_)
+        ++impl_->currentStats_.shaderParameterUpdates_;
+}
+
+void Graphics::SetShaderParameter(StringHash param, bool value)
+{
+    if (impl_->shaderProgram_)
+        ++impl_->currentStats_.shaderParameterUpdates_;
+}
+
+void Graphics::SetShaderParameter(StringHash param, const Color& color)
+{
+    if (impl_->shaderProgram_)
+        ++impl_->currentStats_.shaderParameterUpdates_;
+}
+
+void Graphics::SetShaderParameter(StringHash param, const Vector2& vector)
+{
+    if (impl_->shaderProgram_)
+        ++impl_->currentStats_.shaderParameterUpdates_;
+}
+
+void Graphics::SetShaderParameter(StringHash param, const Matrix3& matrix)
+{
+    if (impl_->shaderProgram_)
+        ++impl_->currentStats_.shaderParameterUpdates_;
+}
+
+void Graphics::SetShaderParameter(StringHash param, const Vector3& vector)
+{
+    if (impl_->shaderProgram_)
+        ++impl_->currentStats_.shaderParameterUpdates_;
+}
+
+void Graphics::SetShaderParameter(StringHash param, const Matrix4& matrix)
+{
+    if (impl_->shaderProgram_)
+        ++impl_->currentStats_.shaderParameterUpdates_;
+}
+
+void Graphics::SetShaderParameter(StringHash param, const Vector4& vector)
+{
+    if (impl_->shaderProgram_)
+        ++impl_->currentStats_.shaderParameterUpdates_;
+}
+
+void Graphics::SetShaderParameter(StringHash param, const Matrix3x4& matrix)
+{
+    if (impl_->shaderProgram_)
+        ++impl_->currentStats_.shaderParameterUpdates_;
+}
+
+bool Graphics::NeedParameterUpdate(ShaderParameterGroup group, const void* source)
+{
+    if ((unsigned)(size_t)shaderParameterSources_[group] == M_MAX_UNSIGNED || shaderParameterSources_[group] != source)
+    {
+        shaderParameterSources_[group] = source;
+        return true;
+    }
+    else
+        return false;
+}
+
+bool Graphics::HasShaderParameter(StringHash param)
+{
+    // Shaders are not reflected, assume that the bound program uses every parameter
+    return impl_->shaderProgram_ != nullptr;
+}
+
+bool Graphics::HasTextureUnit(TextureUnit unit)
+{
+    return (vertexShader_ && vertexShader_->HasTextureUnit(unit)) || (pixelShader_ && pixelShader_->HasTextureUnit(unit));
+}
+
+void Graphics::ClearParameterSource(ShaderParameterGroup group)
+{
+    shaderParameterSources_[group] = (const void*)M_MAX_UNSIGNED;
+}
+
+void Graphics::ClearParameterSources()
+{
+    for (unsigned i = 0; i < MAX_SHADER_PARAMETER_GROUPS; ++i)
+        shaderParameterSources_[i] = (const void*)M_MAX_UNSIGNED;
+}
+
+void Graphics::ClearTransformSources()
+{
+    shaderParameterSources_[SP_CAMERA] = (const void*)M_MAX_UNSIGNED;
+    shaderParameterSources_[SP_OBJECT] = (const void*)M_MAX_UNSIGNED;
+}
+
+void Graphics::SetTexture(unsigned index, Texture* texture)
+{
+    if (index >= MAX_TEXTURE_UNITS)
+        return;
+
+    // Check if texture is currently bound as a rendertarget. In that case, use its backup texture, or blank if not defined
+    if (texture)
+    {
+        if (renderTargets_[0] && renderTargets_[0]->GetParentTexture() == texture)
+            texture = texture->GetBackupTexture();
+        else
+        {
+            // Resolve multisampled texture now as necessary
+            if (texture->GetMultiSample() > 1 && texture->GetAutoResolve() && texture->IsResolveDirty())
+            {
+                if (texture->GetType() == Texture2D::GetTypeStatic())
+                    ResolveToTexture(static_cast<Texture2D*>(texture));
+                if (texture->GetType() == TextureCube::GetTypeStatic())
+                    ResolveToTexture(static_cast<TextureCube*>(texture));
+            }
+        }
+
+        if (texture && texture->GetLevelsDirty())
+            texture->RegenerateLevels();
+    }
+
+    if (texture && texture->GetParametersDirty())
+    {
+        texture->UpdateParameters();
+        textures_[index] = nullptr; // Force reassign
+    }
+
+    if (texture != textures_[index])
+    {
+        textures_[index] = texture;
+        ++impl_->currentStats_.textureChanges_;
+    }
+}
+
+void Graphics::SetDefaultTextureFilterMode(TextureFilterMode mode)
+{
+    if (mode != defaultTextureFilterMode_)
+    {
+        defaultTextureFilterMode_ = mode;
+        SetTextureParametersDirty();
+    }
+}
+
+void Graphics::SetDefaultTextureAnisotropy(unsigned level)
+{
+    level = Max(level, 1U);
+
+    if (level != defaultTextureAnisotropy_)
+    {
+        defaultTextureAnisotropy_ = level;
+        SetTextureParametersDirty();
+    }
+}
+
+void Graphics::Restore()
+{
+    // No-op on null backend
+}
+
+void Graphics::SetTextureParametersDirty()
+{
+    MutexLock lock(gpuObjectMutex_);
+
+    for (auto i = gpuObjects_.begin(); i != gpuObjects_.end(); ++i)
+    {
+        Texture* texture = dynamic_cast<Texture*>(*i);
+        if (texture)
+            texture->SetParametersDirty();
+    }
+}
+
+void Graphics::ResetRenderTargets()
+{
+    for (unsigned i = 0; i < MAX_RENDERTARGETS; ++i)
+        SetRenderTarget(i, (RenderSurface*)nullptr);
+    SetDepthStencil((RenderSurface*)nullptr);
+    SetViewport(IntRect(0, 0, width_, height_));
+}
+
+void Graphics::ResetRenderTarget(unsigned index)
+{
+    SetRenderTarget(index, (RenderSurface*)nullptr);
+}
+
+void Graphics::ResetDepthStencil()
+{
+    SetDepthStencil((RenderSurface*)nullptr);
+}
+
+void Graphics::SetRenderTarget(unsigned index, RenderSurface* renderTarget)
+{
+    if (index >= MAX_RENDERTARGETS)
+        return;
+
+    if (renderTarget != renderTargets_[index])
+    {
+        renderTargets_[index] = renderTarget;
+        impl_->renderTargetsDirty_ = true;
+
+        // If the rendertarget is also bound as a texture, replace with backup texture or null
+        if (renderTarget)
+        {
+            Texture* parentTexture = renderTarget->GetParentTexture();
+
+            for (unsigned i = 0; i < MAX_TEXTURE_UNITS; ++i)
+            {
+                if (textures_[i] == parentTexture)
+                    SetTexture(i, textures_[i]->GetBackupTexture());
+            }
+
+            // If multisampled, mark the texture & surface needing resolve
+            if (parentTexture->GetMultiSample() > 1 && parentTexture->GetAutoResolve())
+            {
+                parentTexture->SetResolveDirty(true);
+                renderTarget->SetResolveDirty(true);
+            }
+
+            // If mipmapped, mark the levels needing regeneration
+            if (parentTexture->GetLevels() > 1)
+                parentTexture->SetLevelsDirty();
+        }
+    }
+}
+
+void Graphics::SetRenderTarget(unsigned index, Texture2D* texture)
+{
+    RenderSurface* renderTarget = nullptr;
+    if (texture)
+        renderTarget = texture->GetRenderSurface();
+
+    SetRenderTarget(index, renderTarget);
+}
+
+void Graphics::SetDepthStencil(RenderSurface* depthStencil)
+{
+    if (depthStencil != depthStencil_)
+    {
+        depthStencil_ = depthStencil;
+        impl_->renderTargetsDirty_ = true;
+    }
+}
+
+void Graphics::SetDepthStencil(Texture2D* texture)
+{
+    RenderSurface* depthStencil = nullptr;
+    if (texture)
+        depthStencil = texture->GetRenderSurface();
+
+    SetDepthStencil(depthStencil);
+    // Constant depth bias depends on the bitdepth
+    impl_->rasterizerStateDirty_ = true;
+}
+
+void Graphics::SetViewport(const IntRect& rect)
+{
+    IntVector2 size = GetRenderTargetDimensions();
+
+    IntRect rectCopy = rect;
+
+    if (rectCopy.right_ <= rectCopy.left_)
+        rectCopy.right_ = rectCopy.left_ + 1;
+    if (rectCopy.bottom_ <= rectCopy.top_)
+        rectCopy.bottom_ = rectCopy.top_ + 1;
+    rectCopy.left_ = Clamp(rectCopy.left_, 0, size.x_);
+    rectCopy.top_ = Clamp(rectCopy.top_, 0, size.y_);
+    rectCopy.right_ = Clamp(rectCopy.right_, 0, size.x_);
+    rectCopy.bottom_ = Clamp(rectCopy.bottom_, 0, size.y_);
+
+    if (rectCopy != viewport_)
+    {
+        viewport_ = rectCopy;
+        ++impl_->currentStats_.viewportChanges_;
+    }
+
+    // Disable scissor test, needs to be re-enabled by the user
+    SetScissorTest(false);
+}
+
+void Graphics::SetBlendMode(BlendMode mode, bool alphaToCoverage)
+{
+    if (mode != blendMode_ || alphaToCoverage != alphaToCoverage_)
+    {
+        blendMode_ = mode;
+        alphaToCoverage_ = alphaToCoverage;
+        impl_->blendStateDirty_ = true;
+    }
+}
+
+void Graphics::SetColorWrite(bool enable)
+{
+    if (enable != colorWrite_)
+    {
+        colorWrite_ = enable;
+        impl_->blendStateDirty_ = true;
+    }
+}
+
+void Graphics::SetCullMode(CullMode mode)
+{
+    if (mode != cullMode_)
+    {
+        cullMode_ = mode;
+        impl_->rasterizerStateDirty_ = true;
+    }
+}
+
+void Graphics::SetDepthBias(float constantBias, float slopeScaledBias)
+{
+    if (constantBias != constantDepthBias_ || slopeScaledBias != slopeScaledDepthBias_)
+    {
+        constantDepthBias_ = constantBias;
+        slopeScaledDepthBias_ = slopeScaledBias;
+        impl_->rasterizerStateDirty_ = true;
+    }
+}
+
+void Graphics::SetDepthTest(CompareMode mode)
+{
+    if (mode != depthTestMode_)
+    {
+        depthTestMode_ = mode;
+        impl_->depthStateDirty_ = true;
+    }
+}
+
+void Graphics::SetDepthWrite(bool enable)
+{
+    if (enable != depthWrite_)
+    {
+        depthWrite_ = enable;
+        impl_->depthStateDirty_ = true;
+        // Also affects whether a read-only version of depth-stencil should be bound, to allow sampling
+        impl_->renderTargetsDirty_ = true;
+    }
+}
+
+void Graphics::SetFillMode(FillMode mode)
+{
+    if (mode != fillMode_)
+    {
+        fillMode_ = mode;
+        impl_->rasterizerStateDirty_ = true;
+    }
+}
+
+void Graphics::SetLineAntiAlias(bool enable)
+{
+    if (enable != lineAntiAlias_)
+    {
+        lineAntiAlias_ = enable;
+        impl_->rasterizerStateDirty_ = true;
+    }
+}
+
+void Graphics::SetScissorTest(bool enable, const Rect& rect, bool borderInclusive)
+{
+    // During some light rendering loops, a full rect is toggled on/off repeatedly.
+    // Disable scissor in that case to reduce state changes
+    if (rect.min_.x_ <= 0.0f && rect.min_.y_ <= 0.0f && rect.max_.x_ >= 1.0f && rect.max_.y_ >= 1.0f)
+        enable = false;
+
+    if (enable)
+    {
+        IntVector2 rtSize(GetRenderTargetDimensions());
+        IntVector2 viewSize(viewport_.Size());
+        IntVector2 viewPos(viewport_.left_, viewport_.top_);
+        IntRect intRect;
+        int expand = borderInclusive ? 1 : 0;
+
+        intRect.left_ = Clamp((int)((rect.min_.x_ + 1.0f) * 0.5f * viewSize.x_) + viewPos.x_, 0, rtSize.x_ - 1);
+        intRect.top_ = Clamp((int)((-rect.max_.y_ + 1.0f) * 0.5f * viewSize.y_) + viewPos.y_, 0, rtSize.y_ - 1);
+        intRect.right_ = Clamp((int)((rect.max_.x_ + 1.0f) * 0.5f * viewSize.x_) + viewPos.x_ + expand, 0, rtSize.x_);
+        intRect.bottom_ = Clamp((int)((-rect.min_.y_ + 1.0f) * 0.5f * viewSize.y_) + viewPos.y_ + expand, 0, rtSize.y_);
+
+        if (intRect.right_ == intRect.left_)
+            intRect.right_++;
+        if (intRect.bottom_ == intRect.top_)
+            intRect.bottom_++;
+
+        if (intRect.right_ < intRect.left_ || intRect.bottom_ < intRect.top_)
+            enable = false;
+
+        if (enable && intRect != scissorRect_)
+            scissorRect_ = intRect;
+    }
+
+    if (enable != scissorTest_)
+    {
+        scissorTest_ = enable;
+        impl_->rasterizerStateDirty_ = true;
+    }
+}
+
+void Graphics::SetScissorTest(bool enable, const IntRect& rect)
+{
+    IntVector2 rtSize(GetRenderTargetDimensions());
+    IntVector2 viewPos(viewport_.left_, viewport_.top_);
+
+    if (enable)
+    {
+        IntRect intRect;
+        intRect.left_ = Clamp(rect.left_ + viewPos.x_, 0, rtSize.x_ - 1);
+        intRect.top_ = Clamp(rect.top_ + viewPos.y_, 0, rtSize.y_ - 1);
+        intRect.right_ = Clamp(rect.right_ + viewPos.x_, 0, rtSize.x_);
+        intRect.bottom_ = Clamp(rect.bottom_ + viewPos.y_, 0, rtSize.y_);
+
+        if (intRect.right_ == intRect.left_)
+            intRect.right_++;
+        if (intRect.bottom_ == intRect.top_)
+            intRect.bottom_++;
+
+        if (intRect.right_ < intRect.left_ || intRect.bottom_ < intRect.top_)
+            enable = false;
+
+        if (enable && intRect != scissorRect_)
+            scissorRect_ = intRect;
+    }
+
+    if (enable != scissorTest_)
+    {
+        scissorTest_ = enable;
+        impl_->rasterizerStateDirty_ = true;
+    }
+}
+
+void Graphics::SetStencilTest(bool enable, CompareMode mode, StencilOp pass, StencilOp fail, StencilOp zFail, unsigned stencilRef,
+    unsigned compareMask, unsigned writeMask)
+{
+    if (enable != stencilTest_)
+    {
+        stencilTest_ = enable;
+        impl_->depthStateDirty_ = true;
+    }
+
+    if (enable)
+    {
+        if (mode != stencilTestMode_)
+        {
+            stencilTestMode_ = mode;
+            impl_->depthStateDirty_ = true;
+        }
+        if (pass != stencilPass_)
+        {
+            stencilPass_ = pass;
+            impl_->depthStateDirty_ = true;
+        }
+        if (fail != stencilFail_)
+        {
+            stencilFail_ = fail;
+            impl_->depthStateDirty_ = true;
+        }
+        if (zFail != stencilZFail_)
+        {
+            stencilZFail_ = zFail;
+            impl_->depthStateDirty_ = true;
+        }
+        if (compareMask != stencilCompareMask_)
+        {
+            stencilCompareMask_ = compareMask;
+            impl_->depthStateDirty_ = true;
+        }
+        if (writeMask != stencilWriteMask_)
+        {
+            stencilWriteMask_ = writeMask;
+            impl_->depthStateDirty_ = true;
+        }
+        if (stencilRef != stencilRef_)
+        {
+            stencilRef_ = stencilRef;
+            impl_->depthStateDirty_ = true;
+        }
+    }
+}
+
+void Graphics::SetClipPlane(bool enable, const Plane& clipPlane, const Matrix3x4& view, const Matrix4& projection)
+{
+    useClipPlane_ = enable;
+
+    if (enable)
+    {
+        Matrix4 viewProj = projection * view;
+        clipPlane_ = clipPlane.Transformed(viewProj).ToVector4();
+        SetShaderParameter(VSP_CLIPPLANE, clipPlane_);
+    }
+}
+
+bool Graphics::IsInitialized() const
+{
+    return impl_->initialized_;
+}
+
+ea::vector<int> Graphics::GetMultiSampleLevels() const
+{
+    ea::vector<int> ret;
+    for (int i = 1; i <= 16; i *= 2)
+        ret.emplace_back(i);
+    return ret;
+}
+
+unsigned Graphics::GetFormat(CompressedFormat format) const
+{
+    switch (format)
+    {
+    case CF_RGBA:
+        return NULL_FORMAT_RGBA8;
+
+    case CF_DXT1:
+        return NULL_FORMAT_DXT1;
+
+    case CF_DXT3:
+        return NULL_FORMAT_DXT3;
+
+    case CF_DXT5:
+        return NULL_FORMAT_DXT5;
+
+    default:
+        return 0;
+    }
+}
+
+ShaderVariation* Graphics::GetShader(ShaderType type, const ea::string& name, const ea::string& defines) const
+{
+    return GetShader(type, name.c_str(), defines.c_str());
+}
+
+ShaderVariation* Graphics::GetShader(ShaderType type, const char* name, const char* defines) const
+{
+    if (lastShaderName_ != name || !lastShader_)
+    {
+        ResourceCache* cache = GetSubsystem<ResourceCache>();
+
+        ea::string fullShaderName = shaderPath_ + name + shaderExtension_;
+        // Try to reduce repeated error log prints because of missing shaders
+        if (lastShaderName_ == name && !cache->Exists(fullShaderName))
+            return nullptr;
+
+        lastShader_ = cache->GetResource<Shader>(fullShaderName);
+        lastShaderName_ = name;
+    }
+
+    return lastShader_ ? lastShader_->GetVariation(type, defines) : nullptr;
+}
+
+VertexBuffer* Graphics::GetVertexBuffer(unsigned index) const
+{
+    return index < MAX_VERTEX_STREAMS ? vertexBuffers_[index] : nullptr;
+}
+
+ShaderProgram* Graphics::GetShaderProgram() const
+{
+    return impl_->shaderProgram_;
+}
+
+TextureUnit Graphics::GetTextureUnit(const ea::string& name)
+{
+    auto i = textureUnits_.find(name);
+    if (i != textureUnits_.end())
+        return i->second;
+    else
+        return MAX_TEXTURE_UNITS;
+}
+
+const ea::string& Graphics::GetTextureUnitName(TextureUnit unit)
+{
+    for (auto i = textureUnits_.begin(); i != textureUnits_.end(); ++i)
+    {
+        if (i->second == unit)
+            return i->first;
+    }
+    return EMPTY_STRING;
+}
+
+Texture* Graphics::GetTexture(unsigned index) const
+{
+    return index < MAX_TEXTURE_UNITS ? textures_[index] : nullptr;
+}
+
+RenderSurface* Graphics::GetRenderTarget(unsigned index) const
+{
+    return index < MAX_RENDERTARGETS ? renderTargets_[index] : nullptr;
+}
+
+IntVector2 Graphics::GetRenderTargetDimensions() const
+{
+    int width, height;
+
+    if (renderTargets_[0])
+    {
+        width = renderTargets_[0]->GetWidth();
+        height = renderTargets_[0]->GetHeight();
+    }
+    else if (depthStencil_) // Depth-only rendering
+    {
+        width = depthStencil_->GetWidth();
+        height = depthStencil_->GetHeight();
+    }
+    else
+    {
+        width = width_;
+        height = height_;
+    }
+
+    return IntVector2(width, height);
+}
+
+bool Graphics::GetDither() const
+{
+    return false;
+}
+
+bool Graphics::IsDeviceLost() const
+{
+    // There is no device to lose
+    return false;
+}
+
+void Graphics::OnWindowResized()
+{
+    // No window on null backend
+}
+
+void Graphics::OnWindowMoved()
+{
+    // No window on null backend
+}
+
+void Graphics::CleanupShaderPrograms(ShaderVariation* variation)
+{
+    for (auto i = impl_->shaderPrograms_.begin(); i != impl_->shaderPrograms_.end();)
+    {
+        if (i->first.first == variation || i->first.second == variation)
+            i = impl_->shaderPrograms_.erase(i);
+        else
+            ++i;
+    }
+
+    if (vertexShader_ == variation || pixelShader_ == variation)
+        impl_->shaderProgram_ = nullptr;
+}
+
+void Graphics::CleanupRenderSurface(RenderSurface* surface)
+{
+    // No-op on null backend
+}
+
+ConstantBuffer* Graphics::GetOrCreateConstantBuffer(ShaderType type, unsigned index, unsigned size)
+{
+    // Ensure that different shader types and index slots get unique buffers, even if the size is same
+    unsigned key = type | (index << 1) | (size << 4);
+    auto i = impl_->allConstantBuffers_.find(key);
+    if (i != impl_->allConstantBuffers_.end())
+        return i->second.Get();
+    else
+    {
+        SharedPtr<ConstantBuffer> newConstantBuffer(context_->CreateObject<ConstantBuffer>());
+        newConstantBuffer->SetSize(size);
+        impl_->allConstantBuffers_[key] = newConstantBuffer;
+        return newConstantBuffer.Get();
+    }
+}
+
+unsigned Graphics::GetAlphaFormat()
+{
+    return NULL_FORMAT_A8;
+}
+
+unsigned Graphics::GetLuminanceFormat()
+{
+    return NULL_FORMAT_R8;
+}
+
+unsigned Graphics::GetLuminanceAlphaFormat()
+{
+    return NULL_FORMAT_RG8;
+}
+
+unsigned Graphics::GetRGBFormat()
+{
+    return NULL_FORMAT_RGBA8;
+}
+
+unsigned Graphics::GetRGBAFormat()
+{
+    return NULL_FORMAT_RGBA8;
+}
+
+unsigned Graphics::GetRGBA16Format()
+{
+    return NULL_FORMAT_RGBA16;
+}
+
+unsigned Graphics::GetRGBAFloat16Format()
+{
+    return NULL_FORMAT_RGBA16F;
+}
+
+unsigned Graphics::GetRGBAFloat32Format()
+{
+    return NULL_FORMAT_RGBA32F;
+}
+
+unsigned Graphics::GetRG16Format()
+{
+    return NULL_FORMAT_RG16;
+}
+
+unsigned Graphics::GetRGFloat16Format()
+{
+    return NULL_FORMAT_RG16F;
+}
+
+unsigned Graphics::GetRGFloat32Format()
+{
+    return NULL_FORMAT_RG32F;
+}
+
+unsigned Graphics::GetFloat16Format()
+{
+    return NULL_FORMAT_R16F;
+}
+
+unsigned Graphics::GetFloat32Format()
+{
+    return NULL_FORMAT_R32F;
+}
+
+unsigned Graphics::GetLinearDepthFormat()
+{
+    return NULL_FORMAT_R32F;
+}
+
+unsigned Graphics::GetDepthStencilFormat()
+{
+    return NULL_FORMAT_D24S8;
+}
+
+unsigned Graphics::GetReadableDepthFormat()
+{
+    return NULL_FORMAT_D24S8;
+}
+
+unsigned Graphics::GetFormat(const ea::string& formatName)
+{
+    ea::string nameLower = formatName.to_lower();
+    nameLower.trim();
+
+    if (nameLower == "a")
+        return GetAlphaFormat();
+    if (nameLower == "l")
+        return GetLuminanceFormat();
+    if (nameLower == "la")
+        return GetLuminanceAlphaFormat();
+    if (nameLower == "rgb")
+        return GetRGBFormat();
+    if (nameLower == "rgba")
+        return GetRGBAFormat();
+    if (nameLower == "rgba16")
+        return GetRGBA16Format();
+    if (nameLower == "rgba16f")
+        return GetRGBAFloat16Format();
+    if (nameLower == "rgba32f")
+        return GetRGBAFloat32Format();
+    if (nameLower == "rg16")
+        return GetRG16Format();
+    if (nameLower == "rg16f")
+        return GetRGFloat16Format();
+    if (nameLower == "rg32f")
+        return GetRGFloat32Format();
+    if (nameLower == "r16f")
+        return GetFloat16Format();
+    if (nameLower == "r32f" || nameLower == "float")
+        return GetFloat32Format();
+    if (nameLower == "lineardepth" || nameLower == "depth")
+        return GetLinearDepthFormat();
+    if (nameLower == "d24s8")
+        return GetDepthStencilFormat();
+    if (nameLower == "readabledepth" || nameLower == "hwdepth")
+        return GetReadableDepthFormat();
+
+    return GetRGBFormat();
+}
+
+unsigned Graphics::GetMaxBones()
+{
+    return 128;
+}
+
+bool Graphics::GetGL3Support()
+{
+    return gl3Support;
+}
+
+void Graphics::CheckFeatureSupport()
+{
+    anisotropySupport_ = true;
+    dxtTextureSupport_ = true;
+    lightPrepassSupport_ = true;
+    deferredSupport_ = true;
+    hardwareShadowSupport_ = true;
+    instancingSupport_ = true;
+    shadowMapFormat_ = NULL_FORMAT_D16;
+    hiresShadowMapFormat_ = NULL_FORMAT_D32;
+    dummyColorFormat_ = NULL_FORMAT_NONE;
+    sRGBSupport_ = true;
+    sRGBWriteSupport_ = true;
+
+    maxVertexShaderUniforms_ = 4096;
+    maxPixelShaderUniforms_ = 4096;
+}
+
+void Graphics::ResetCachedState()
+{
+    for (unsigned i = 0; i < MAX_VERTEX_STREAMS; ++i)
+    {
+        vertexBuffers_[i] = nullptr;
+        impl_->vertexOffsets_[i] = 0;
+    }
+
+    for (unsigned i = 0; i < MAX_TEXTURE_UNITS; ++i)
+        textures_[i] = nullptr;
+
+    for (unsigned i = 0; i < MAX_RENDERTARGETS; ++i)
+        renderTargets_[i] = nullptr;
+
+    depthStencil_ = nullptr;
+    viewport_ = IntRect(0, 0, width_, height_);
+
+    indexBuffer_ = nullptr;
+    vertexDeclarationHash_ = 0;
+    primitiveType_ = 0;
+    vertexShader_ = nullptr;
+    pixelShader_ = nullptr;
+    blendMode_ = BLEND_REPLACE;
+    alphaToCoverage_ = false;
+    colorWrite_ = true;
+    cullMode_ = CULL_CCW;
+    constantDepthBias_ = 0.0f;
+    slopeScaledDepthBias_ = 0.0f;
+    depthTestMode_ = CMP_LESSEQUAL;
+    depthWrite_ = true;
+    fillMode_ = FILL_SOLID;
+    lineAntiAlias_ = false;
+    scissorTest_ = false;
+    scissorRect_ = IntRect::ZERO;
+    stencilTest_ = false;
+    stencilTestMode_ = CMP_ALWAYS;
+    stencilPass_ = OP_KEEP;
+    stencilFail_ = OP_KEEP;
+    stencilZFail_ = OP_KEEP;
+    stencilRef_ = 0;
+    stencilCompareMask_ = M_MAX_UNSIGNED;
+    stencilWriteMask_ = M_MAX_UNSIGNED;
+    useClipPlane_ = false;
+    impl_->shaderProgram_ = nullptr;
+    impl_->renderTargetsDirty_ = true;
+    impl_->blendStateDirty_ = true;
+    impl_->depthStateDirty_ = true;
+    impl_->rasterizerStateDirty_ = true;
+    impl_->blendStateHash_ = M_MAX_UNSIGNED;
+    impl_->depthStateHash_ = M_MAX_UNSIGNED;
+    impl_->rasterizerStateHash_ = M_MAX_UNSIGNED;
+}
+
+void Graphics::PrepareDraw()
+{
+    // Hash the states the same way as the Direct3D11 backend does, so that only changes a device would see are recorded
+    if (impl_->renderTargetsDirty_)
+    {
+        ++impl_->currentStats_.renderTargetChanges_;
+        impl_->renderTargetsDirty_ = false;
+    }
+
+    if (impl_->blendStateDirty_)
+    {
+        unsigned newBlendStateHash = (unsigned)((colorWrite_ ? 1 : 0) | (alphaToCoverage_ ? 2 : 0) | (blendMode_ << 2));
+        if (newBlendStateHash != impl_->blendStateHash_)
+        {
+            impl_->blendStateHash_ = newBlendStateHash;
+            ++impl_->currentStats_.blendStateChanges_;
+        }
+
+        impl_->blendStateDirty_ = false;
+    }
+
+    if (impl_->depthStateDirty_)
+    {
+        unsigned newDepthStateHash =
+            (depthWrite_ ? 1 : 0) | (stencilTest_ ? 2 : 0) | (depthTestMode_ << 2) | ((stencilCompareMask_ & 0xff) << 5) |
+            ((stencilWriteMask_ & 0xff) << 13) | (stencilTestMode_ << 21) |
+            ((stencilFail_ + stencilZFail_ * 5 + stencilPass_ * 25) << 24);
+        if (newDepthStateHash != impl_->depthStateHash_)
+        {
+            impl_->depthStateHash_ = newDepthStateHash;
+            ++impl_->currentStats_.depthStateChanges_;
+        }
+
+        impl_->depthStateDirty_ = false;
+    }
+
+    if (impl_->rasterizerStateDirty_)
+    {
+        unsigned depthBits = 24;
+        if (depthStencil_ && depthStencil_->GetParentTexture()->GetFormat() == NULL_FORMAT_D16)
+            depthBits = 16;
+        int scaledDepthBias = (int)(constantDepthBias_ * (1 << depthBits));
+
+        unsigned newRasterizerStateHash =
+            (scissorTest_ ? 1 : 0) | (lineAntiAlias_ ? 2 : 0) | (fillMode_ << 2) | (cullMode_ << 4) |
+            ((scaledDepthBias & 0x1fff) << 6) | (((int)(slopeScaledDepthBias_ * 100.0f) & 0x1fff) << 19);
+        if (newRasterizerStateHash != impl_->rasterizerStateHash_)
+        {
+            impl_->rasterizerStateHash_ = newRasterizerStateHash;
+            ++impl_->currentStats_.rasterizerStateChanges_;
+        }
+
+        impl_->rasterizerStateDirty_ = false;
+    }
+}
+
+void Graphics::SetTextureUnitMappings()
+{
+    textureUnits_["DiffMap"] = TU_DIFFUSE;
+    textureUnits_["DiffCubeMap"] = TU_DIFFUSE;
+    textureUnits_["NormalMap"] = TU_NORMAL;
+    textureUnits_["SpecMap"] = TU_SPECULAR;
+    textureUnits_["EmissiveMap"] = TU_EMISSIVE;
+    textureUnits_["EnvMap"] = TU_ENVIRONMENT;
+    textureUnits_["EnvCubeMap"] = TU_ENVIRONMENT;
+    textureUnits_["LightRampMap"] = TU_LIGHTRAMP;
+    textureUnits_["LightSpotMap"] = TU_LIGHTSHAPE;
+    textureUnits_["LightCubeMap"] = TU_LIGHTSHAPE;
+    textureUnits_["ShadowMap"] = TU_SHADOWMAP;
+    textureUnits_["FaceSelectCubeMap"] = TU_FACESELECT;
+    textureUnits_["IndirectionCubeMap"] = TU_INDIRECTION;
+    textureUnits_["VolumeMap"] = TU_VOLUMEMAP;
+    textureUnits_["ZoneCubeMap"] = TU_ZONE;
+    textureUnits_["ZoneVolumeMap"] = TU_ZONE;
+}
+
+void Graphics::SetTextureForUpdate(Texture* texture)
+{
+}
+
+void Graphics::MarkFBODirty()
+{
+}
+
+void Graphics::SetVBO(unsigned object)
+{
+}
+
+void Graphics::SetUBO(unsigned object)
+{
+}
+
+}
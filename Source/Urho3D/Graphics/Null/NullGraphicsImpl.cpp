@@ -0,0 +1,72 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../../Precompiled.h"
+
+#include "../../Graphics/Graphics.h"
+#include "../../Graphics/GraphicsImpl.h"
+
+#include "../../DebugNew.h"
+
+namespace Urho3D
+{
+
+NullGraphicsStats& NullGraphicsStats::operator +=(const NullGraphicsStats& rhs)
+{
+    draws_ += rhs.draws_;
+    instancedDraws_ += rhs.instancedDraws_;
+    primitives_ += rhs.primitives_;
+    clears_ += rhs.clears_;
+    shaderChanges_ += rhs.shaderChanges_;
+    shaderParameterUpdates_ += rhs.shaderParameterUpdates_;
+    textureChanges_ += rhs.textureChanges_;
+    renderTargetChanges_ += rhs.renderTargetChanges_;
+    vertexBufferChanges_ += rhs.vertexBufferChanges_;
+    indexBufferChanges_ += rhs.indexBufferChanges_;
+    blendStateChanges_ += rhs.blendStateChanges_;
+    depthStateChanges_ += rhs.depthStateChanges_;
+    rasterizerStateChanges_ += rhs.rasterizerStateChanges_;
+    viewportChanges_ += rhs.viewportChanges_;
+    bufferUploads_ += rhs.bufferUploads_;
+    bufferUploadBytes_ += rhs.bufferUploadBytes_;
+    textureUploads_ += rhs.textureUploads_;
+    textureUploadBytes_ += rhs.textureUploadBytes_;
+    resolves_ += rhs.resolves_;
+    return *this;
+}
+
+void GraphicsImpl::ResetTotalStats()
+{
+    totalStats_.Reset();
+    numFrames_ = 0;
+}
+
+void GraphicsImpl::EndFrameStats()
+{
+    lastFrameStats_ = currentStats_;
+    totalStats_ += currentStats_;
+    currentStats_.Reset();
+    ++numFrames_;
+}
+
+}
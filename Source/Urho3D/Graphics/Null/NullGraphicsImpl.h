@@ -0,0 +1,178 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#pragma once
+
+#include "../../Graphics/ConstantBuffer.h"
+#include "../../Graphics/GraphicsDefs.h"
+#include "../../Graphics/ShaderProgram.h"
+#include "../../Graphics/Texture2D.h"
+
+#include <EASTL/unordered_map.h>
+
+namespace Urho3D
+{
+
+using ShaderProgramMap = ea::unordered_map<ea::pair<ShaderVariation*, ShaderVariation*>, SharedPtr<ShaderProgram> >;
+
+/// Texture formats of the null backend. Values are only used to identify the format and its data size on the CPU side.
+enum NullTextureFormat : unsigned
+{
+    NULL_FORMAT_NONE = 0,
+    NULL_FORMAT_A8,
+    NULL_FORMAT_R8,
+    NULL_FORMAT_RG8,
+    NULL_FORMAT_RGBA8,
+    NULL_FORMAT_RGBA8_SRGB,
+    NULL_FORMAT_RGBA16,
+    NULL_FORMAT_RGBA16F,
+    NULL_FORMAT_RGBA32F,
+    NULL_FORMAT_RG16,
+    NULL_FORMAT_RG16F,
+    NULL_FORMAT_RG32F,
+    NULL_FORMAT_R16F,
+    NULL_FORMAT_R32F,
+    NULL_FORMAT_D16,
+    NULL_FORMAT_D24S8,
+    NULL_FORMAT_D32,
+    NULL_FORMAT_DXT1,
+    NULL_FORMAT_DXT1_SRGB,
+    NULL_FORMAT_DXT3,
+    NULL_FORMAT_DXT3_SRGB,
+    NULL_FORMAT_DXT5,
+    NULL_FORMAT_DXT5_SRGB,
+};
+
+/// Commands and state changes recorded by the null backend during one frame.
+struct URHO3D_API NullGraphicsStats
+{
+    /// Reset all counters.
+    void Reset() { *this = NullGraphicsStats{}; }
+    /// Add counters of another frame.
+    NullGraphicsStats& operator +=(const NullGraphicsStats& rhs);
+
+    /// Number of draw calls.
+    unsigned draws_{};
+    /// Number of instanced draw calls.
+    unsigned instancedDraws_{};
+    /// Number of rendered primitives.
+    unsigned primitives_{};
+    /// Number of clears.
+    unsigned clears_{};
+    /// Number of shader program changes.
+    unsigned shaderChanges_{};
+    /// Number of shader parameter updates while a shader program is bound.
+    unsigned shaderParameterUpdates_{};
+    /// Number of texture unit changes.
+    unsigned textureChanges_{};
+    /// Number of rendertarget and depth-stencil binding changes applied before draws.
+    unsigned renderTargetChanges_{};
+    /// Number of vertex buffer binding changes.
+    unsigned vertexBufferChanges_{};
+    /// Number of index buffer binding changes.
+    unsigned indexBufferChanges_{};
+    /// Number of blend state changes.
+    unsigned blendStateChanges_{};
+    /// Number of depth-stencil state changes.
+    unsigned depthStateChanges_{};
+    /// Number of rasterizer state changes.
+    unsigned rasterizerStateChanges_{};
+    /// Number of viewport changes.
+    unsigned viewportChanges_{};
+    /// Number of vertex and index buffer uploads.
+    unsigned bufferUploads_{};
+    /// Bytes of vertex and index buffer data uploaded.
+    unsigned bufferUploadBytes_{};
+    /// Number of texture data uploads.
+    unsigned textureUploads_{};
+    /// Bytes of texture data uploaded.
+    unsigned textureUploadBytes_{};
+    /// Number of multisample resolves.
+    unsigned resolves_{};
+};
+
+/// %Graphics implementation of the null backend. Holds no device; records draw calls and state changes instead.
+class URHO3D_API GraphicsImpl
+{
+    friend class Graphics;
+    friend class IndexBuffer;
+    friend class Texture2D;
+    friend class Texture2DArray;
+    friend class Texture3D;
+    friend class TextureCube;
+    friend class VertexBuffer;
+
+public:
+    /// Construct.
+    GraphicsImpl() = default;
+
+    /// Return statistics of the last frame, i.e. everything recorded between the last two EndFrame() calls.
+    const NullGraphicsStats& GetFrameStats() const { return lastFrameStats_; }
+    /// Return statistics recorded since the last EndFrame() call.
+    const NullGraphicsStats& GetCurrentStats() const { return currentStats_; }
+    /// Return statistics accumulated since the last ResetTotalStats() call.
+    const NullGraphicsStats& GetTotalStats() const { return totalStats_; }
+    /// Return number of frames accumulated into the total statistics.
+    unsigned GetNumFrames() const { return numFrames_; }
+    /// Reset accumulated statistics.
+    void ResetTotalStats();
+
+private:
+    /// Finish recording of the current frame.
+    void EndFrameStats();
+
+    /// Whether the screen mode has been set.
+    bool initialized_{};
+    /// Statistics being recorded.
+    NullGraphicsStats currentStats_;
+    /// Statistics of the last frame.
+    NullGraphicsStats lastFrameStats_;
+    /// Accumulated statistics.
+    NullGraphicsStats totalStats_;
+    /// Number of accumulated frames.
+    unsigned numFrames_{};
+    /// Rendertargets dirty flag.
+    bool renderTargetsDirty_{true};
+    /// Blend state dirty flag.
+    bool blendStateDirty_{true};
+    /// Depth state dirty flag.
+    bool depthStateDirty_{true};
+    /// Rasterizer state dirty flag.
+    bool rasterizerStateDirty_{true};
+    /// Hash of current blend state.
+    unsigned blendStateHash_{M_MAX_UNSIGNED};
+    /// Hash of current depth state.
+    unsigned depthStateHash_{M_MAX_UNSIGNED};
+    /// Hash of current rasterizer state.
+    unsigned rasterizerStateHash_{M_MAX_UNSIGNED};
+    /// Shader programs.
+    ShaderProgramMap shaderPrograms_;
+    /// Shader program in use.
+    ShaderProgram* shaderProgram_{};
+    /// Vertex offsets per buffer.
+    unsigned vertexOffsets_[MAX_VERTEX_STREAMS]{};
+    /// Constant buffers.
+    ea::unordered_map<unsigned, SharedPtr<ConstantBuffer> > allConstantBuffers_;
+};
+
+}
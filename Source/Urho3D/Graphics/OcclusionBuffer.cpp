@@ -29,6 +29,10 @@
 #include "../Graphics/OcclusionBuffer.h"
 #include "../IO/Log.h"
 
+#ifdef URHO3D_SSE
+#include <emmintrin.h>
+#endif
+
 #include "../DebugNew.h"
 
 namespace Urho3D
@@ -45,13 +49,8 @@ enum ClipMask : unsigned
 };
 URHO3D_FLAGSET(ClipMask, ClipMaskFlags);
 
-void DrawOcclusionBatchWork(const WorkItem* item, unsigned threadIndex)
-{
-    URHO3D_PROFILE("DrawOcclusionBatchWork");
-    auto* buffer = reinterpret_cast<OcclusionBuffer*>(item->aux_);
-    OcclusionBatch& batch = *reinterpret_cast<OcclusionBatch*>(item->start_);
-    buffer->DrawBatch(batch, threadIndex);
-}
+/// Minimum number of rows processed at once when building the depth hierarchy.
+static const unsigned DEPTH_HIERARCHY_CHUNK_SIZE = 8;
 
 OcclusionBuffer::OcclusionBuffer(Context* context) :
     Object(context)
@@ -71,7 +70,7 @@ bool OcclusionBuffer::SetSize(int width, int height, bool threaded)
     if (height & 1u)
         ++height;
 
-    if (width == width_ && height == height_)
+    if (width == width_ && height == height_ && threaded == threaded_)
         return true;
 
     if (width <= 0 || height <= 0)
@@ -85,18 +84,20 @@ bool OcclusionBuffer::SetSize(int width, int height, bool threaded)
 
     width_ = width;
     height_ = height;
+    // Triangles spanning several bands are set up once per band, so use only a few bands per thread
+    const unsigned numThreads = GetSubsystem<WorkQueue>()->GetNumThreads();
+    const int maxBands = (numThreads + 1) * OCCLUSION_BANDS_PER_THREAD;
+    threaded_ = threaded && numThreads > 0;
+    bandHeight_ = Max((height_ + maxBands - 1) / maxBands, OCCLUSION_MIN_BAND_HEIGHT);
+    numBands_ = (height_ + bandHeight_ - 1) / bandHeight_;
 
-    // Build work buffers for threading
-    unsigned numThreadBuffers = threaded ? GetSubsystem<WorkQueue>()->GetNumThreads() + 1 : 1;
-    buffers_.resize(numThreadBuffers);
-    for (unsigned i = 0; i < numThreadBuffers; ++i)
-    {
-        // Reserve extra memory in case 3D clipping is not exact
-        OcclusionBufferData& buffer = buffers_[i];
-        buffer.dataWithSafety_ = new int[width * (height + 2) + 2];
-        buffer.data_ = buffer.dataWithSafety_.get() + width + 1;
-        buffer.used_ = false;
-    }
+    // Reserve extra memory in case 3D clipping is not exact
+    buffer_.dataWithSafety_ = new int[width * (height + 2) + 2];
+    buffer_.data_ = buffer_.dataWithSafety_.get() + width + 1;
+
+    threadBins_.resize(threaded_ ? numThreads + 1 : 1);
+    for (ThreadBins& bins : threadBins_)
+        bins.bandTriangles_.resize(numBands_);
 
     mipBuffers_.clear();
 
@@ -113,7 +114,7 @@ bool OcclusionBuffer::SetSize(int width, int height, bool threaded)
     }
 
     URHO3D_LOGDEBUG("Set occlusion buffer size " + ea::to_string(width_) + "x" + ea::to_string(height_) + " with " +
-             ea::to_string(mipBuffers_.size()) + " mip levels and " + ea::to_string(numThreadBuffers) + " thread buffers");
+             ea::to_string(mipBuffers_.size()) + " mip levels and " + ea::to_string(threaded_ ? numBands_ : 0) + " threaded bands");
 
     CalculateViewport();
     return true;
@@ -159,11 +160,7 @@ void OcclusionBuffer::Reset()
 void OcclusionBuffer::Clear()
 {
     Reset();
-
-    // Only clear the main thread buffer. Rest are cleared on-demand when drawing the first batch
-    ClearBuffer(0);
-    for (unsigned i = 1; i < buffers_.size(); ++i)
-        buffers_[i].used_ = false;
+    ClearBuffer();
 
     depthHierarchyDirty_ = true;
 }
@@ -206,41 +203,60 @@ bool OcclusionBuffer::AddTriangles(const Matrix3x4& model, const void* vertexDat
 
 void OcclusionBuffer::DrawTriangles()
 {
-    if (buffers_.size() == 1)
+    if (!buffer_.data_)
+    {
+        batches_.clear();
+        return;
+    }
+
+    if (!threaded_)
     {
-        // Not threaded
         for (auto i = batches_.begin(); i != batches_.end(); ++i)
             DrawBatch(*i, 0);
-
-        depthHierarchyDirty_ = true;
     }
-    else if (buffers_.size() > 1)
+    else
     {
-        // Threaded
         auto* queue = GetSubsystem<WorkQueue>();
+        threadBins_.resize(queue->GetNumThreads() + 1);
+        for (ThreadBins& bins : threadBins_)
+            bins.bandTriangles_.resize(numBands_);
 
-        for (auto i = batches_.begin(); i != batches_.end(); ++i)
+        // Transform, clip and bin triangles, then rasterize each band independently
+        queue->ParallelFor(batches_.size(), 1, [this](unsigned begin, unsigned end, unsigned threadIndex)
         {
-            SharedPtr<WorkItem> item = queue->GetFreeItem();
-            item->priority_ = M_MAX_UNSIGNED;
-            item->workFunction_ = DrawOcclusionBatchWork;
-            item->aux_ = this;
-            item->start_ = &(*i);
-            queue->AddWorkItem(item);
-        }
+            URHO3D_PROFILE("BinOcclusionBatches");
+            for (unsigned i = begin; i < end; ++i)
+                DrawBatch(batches_[i], threadIndex);
+        });
 
-        queue->Complete(M_MAX_UNSIGNED);
+        queue->ParallelFor(numBands_, 1, [this](unsigned begin, unsigned end, unsigned threadIndex)
+        {
+            URHO3D_PROFILE("DrawOcclusionBands");
+            for (unsigned band = begin; band < end; ++band)
+                DrawBand(band);
+        });
+
+        for (ThreadBins& bins : threadBins_)
+        {
+            bins.triangles_.clear();
+            for (ea::vector<unsigned>& bandTriangles : bins.bandTriangles_)
+                bandTriangles.clear();
+        }
+    }
 
-        MergeBuffers();
-        depthHierarchyDirty_ = true;
+    for (ThreadBins& bins : threadBins_)
+    {
+        numTriangles_ += bins.numTriangles_;
+        bins.numTriangles_ = 0;
     }
 
+    depthHierarchyDirty_ = true;
     batches_.clear();
 }
 
 void OcclusionBuffer::BuildDepthHierarchy()
 {
-    if (buffers_.empty() || !depthHierarchyDirty_)
+    if (!buffer_.data_ || !depthHierarchyDirty_)
         return;
 
     URHO3D_PROFILE("BuildDepthHierarchy");
@@ -248,18 +264,18 @@ void OcclusionBuffer::BuildDepthHierarchy()
     // Build the first mip level from the pixel-level data
     int width = (width_ + 1) / 2;
     int height = (height_ + 1) / 2;
-    if (mipBuffers_.size())
+    const auto buildFirstLevelRows = [this, width](unsigned begin, unsigned end, unsigned /*threadIndex*/)
     {
-        for (int y = 0; y < height; ++y)
+        for (int y = begin; y < static_cast<int>(end); ++y)
         {
-            int* src = buffers_[0].data_ + (y * 2) * width_;
+            int* src = buffer_.data_ + (y * 2) * width_;
             DepthValue* dest = mipBuffers_[0].get() + y * width;
-            DepthValue* end = dest + width;
+            DepthValue* rowEnd = dest + width;
 
             if (y * 2 + 1 < height_)
             {
                 int* src2 = src + width_;
-                while (dest < end)
+                while (dest < rowEnd)
                 {
                     int minUpper = Min(src[0], src[1]);
                     int minLower = Min(src2[0], src2[1]);
@@ -275,7 +291,7 @@ void OcclusionBuffer::BuildDepthHierarchy()
             }
             else
             {
-                while (dest < end)
+                while (dest < rowEnd)
                 {
                     dest->min_ = Min(src[0], src[1]);
                     dest->max_ = Max(src[0], src[1]);
@@ -285,6 +301,14 @@ void OcclusionBuffer::BuildDepthHierarchy()
                 }
             }
         }
+    };
+
+    if (mipBuffers_.size())
+    {
+        if (threaded_)
+            GetSubsystem<WorkQueue>()->ParallelFor(height, DEPTH_HIERARCHY_CHUNK_SIZE, buildFirstLevelRows);
+        else
+            buildFirstLevelRows(0, height, 0);
     }
 
     // Build the rest of the mip levels
@@ -342,7 +366,7 @@ void OcclusionBuffer::ResetUseTimer()
 
 bool OcclusionBuffer::IsVisible(const BoundingBox& worldSpaceBox) const
 {
-    if (buffers_.empty())
+    if (!buffer_.data_)
         return true;
 
     // Transform corners to projection space
@@ -407,6 +431,9 @@ bool OcclusionBuffer::IsVisible(const BoundingBox& worldSpaceBox) const
 
     // Convert depth to integer and apply final bias
     int z = RoundToInt(minZ) - OCCLUSION_FIXED_BIAS;
+#ifdef URHO3D_SSE
+    const __m128i zVec = _mm_set1_epi32(z);
+#endif
 
     if (!depthHierarchyDirty_)
     {
@@ -427,6 +454,19 @@ bool OcclusionBuffer::IsVisible(const BoundingBox& worldSpaceBox) const
             {
                 DepthValue* src = row + left;
                 DepthValue* end = row + right;
+#ifdef URHO3D_SSE
+                // Test two min/max pairs at once
+                while (src < end)
+                {
+                    const __m128i depth = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+                    const unsigned notBehind = ~_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(zVec, depth))) & 0xfu;
+                    if (notBehind & 0x5u)
+                        return true;
+                    if (notBehind & 0xau)
+                        allOccluded = false;
+                    src += 2;
+                }
+#endif
                 while (src <= end)
                 {
                     if (z <= src->min_)
@@ -444,12 +484,21 @@ bool OcclusionBuffer::IsVisible(const BoundingBox& worldSpaceBox) const
     }
 
     // If no conclusive result, finally check the pixel-level data
-    int* row = buffers_[0].data_ + rect.top_ * width_;
-    int* endRow = buffers_[0].data_ + rect.bottom_ * width_;
+    int* row = buffer_.data_ + rect.top_ * width_;
+    int* endRow = buffer_.data_ + rect.bottom_ * width_;
     while (row <= endRow)
     {
         int* src = row + rect.left_;
         int* end = row + rect.right_;
+#ifdef URHO3D_SSE
+        while (src + 3 <= end)
+        {
+            const __m128i depth = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+            if (_mm_movemask_epi8(_mm_cmpgt_epi32(zVec, depth)) != 0xffff)
+                return true;
+            src += 4;
+        }
+#endif
         while (src <= end)
         {
             if (z <= *src)
@@ -470,13 +519,6 @@ unsigned OcclusionBuffer::GetUseTimer()
 
 void OcclusionBuffer::DrawBatch(const OcclusionBatch& batch, unsigned threadIndex)
 {
-    // If buffer not yet used, clear it
-    if (threadIndex > 0 && !buffers_[threadIndex].used_)
-    {
-        ClearBuffer(threadIndex);
-        buffers_[threadIndex].used_ = true;
-    }
-
     Matrix4 modelViewProj = viewProj_ * batch.model_;
 
     // Theoretical max. amount of vertices if each of the 6 clipping planes doubles the triangle count
@@ -640,7 +682,7 @@ void OcclusionBuffer::DrawTriangle(Vector4* vertices, unsigned threadIndex)
         bool clockwise = SignedArea(projected[0], projected[1], projected[2]) < 0.0f;
         if (cullMode_ == CULL_NONE || (cullMode_ == CULL_CCW && clockwise) || (cullMode_ == CULL_CW && !clockwise))
         {
-            DrawTriangle2D(projected, clockwise, threadIndex);
+            SubmitTriangle2D(projected, clockwise, threadIndex);
             drawOk = true;
         }
     }
@@ -678,7 +720,7 @@ void OcclusionBuffer::DrawTriangle(Vector4* vertices, unsigned threadIndex)
                 bool clockwise = SignedArea(projected[0], projected[1], projected[2]) < 0.0f;
                 if (cullMode_ == CULL_NONE || (cullMode_ == CULL_CCW && clockwise) || (cullMode_ == CULL_CW && !clockwise))
                 {
-                    DrawTriangle2D(projected, clockwise, threadIndex);
+                    SubmitTriangle2D(projected, clockwise, threadIndex);
                     drawOk = true;
                 }
             }
@@ -686,7 +728,7 @@ void OcclusionBuffer::DrawTriangle(Vector4* vertices, unsigned threadIndex)
     }
 
     if (drawOk)
-        ++numTriangles_;
+        ++threadBins_[threadIndex].numTriangles_;
 }
 
 void OcclusionBuffer::ClipVertices(const Vector4& plane, Vector4* vertices, bool* triangles, unsigned& numTriangles)
@@ -795,6 +837,8 @@ struct Gradients
 /// %Edge of a software rasterized triangle.
 struct Edge
 {
+    /// Construct undefined.
+    Edge() = default;
     /// Construct from gradients and top & bottom vertices.
     Edge(const Gradients& gradients, const Vector3& top, const Vector3& bottom, int topY)
     {
@@ -819,7 +863,84 @@ struct Edge
     int invZStep_;
 };
 
-void OcclusionBuffer::DrawTriangle2D(const Vector3* vertices, bool clockwise, unsigned threadIndex)
+/// Rasterization setup of a screen-space triangle.
+struct OcclusionTriangle
+{
+    /// Long edge from the top to the bottom vertex.
+    Edge topToBottom_;
+    /// Edge from the top to the middle vertex.
+    Edge topToMiddle_;
+    /// Edge from the middle to the bottom vertex.
+    Edge middleToBottom_;
+    /// Integer horizontal depth gradient.
+    int dInvZdX_;
+    /// First row.
+    int topY_;
+    /// Row of the middle vertex.
+    int middleY_;
+    /// Row after the last row.
+    int bottomY_;
+    /// Whether the middle vertex is to the right of the long edge.
+    bool middleIsRight_;
+};
+
+/// Draw horizontal spans between two edges for rows startY to endY (exclusive), clamped to rows minY to maxY. Both edges are advanced to endY.
+static void DrawSpans(int* bufferData, int width, Edge& left, Edge& right, int dInvZdX, int startY, int endY, int minY, int maxY)
+{
+    const int firstY = Max(startY, minY);
+    const int lastY = Min(endY, maxY);
+    if (firstY < lastY)
+    {
+        // Skipped rows only advance the edges, so the result does not depend on the clamp range
+        const int skip = firstY - startY;
+        int leftX = left.x_ + skip * left.xStep_;
+        int leftInvZ = left.invZ_ + skip * left.invZStep_;
+        int rightX = right.x_ + skip * right.xStep_;
+
+        int* row = bufferData + firstY * width;
+        for (int y = firstY; y < lastY; ++y)
+        {
+            int invZ = leftInvZ;
+            int* dest = row + Max(leftX >> 16, 0);
+            int* end = row + Min(rightX >> 16, width);
+#ifdef URHO3D_SSE
+            // Test and write 4 pixels at once
+            const __m128i invZStep = _mm_set1_epi32(dInvZdX * 4);
+            __m128i invZVec = _mm_set_epi32(invZ + 3 * dInvZdX, invZ + 2 * dInvZdX, invZ + dInvZdX, invZ);
+            while (dest + 4 <= end)
+            {
+                const __m128i depth = _mm_loadu_si128(reinterpret_cast<const __m128i*>(dest));
+                const __m128i closer = _mm_cmplt_epi32(invZVec, depth);
+                const __m128i result = _mm_or_si128(_mm_and_si128(closer, invZVec), _mm_andnot_si128(closer, depth));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dest), result);
+                invZVec = _mm_add_epi32(invZVec, invZStep);
+                dest += 4;
+            }
+            invZ = _mm_cvtsi128_si32(invZVec);
+#endif
+            while (dest < end)
+            {
+                if (invZ < *dest)
+                    *dest = invZ;
+                invZ += dInvZdX;
+                ++dest;
+            }
+
+            leftX += left.xStep_;
+            leftInvZ += left.invZStep_;
+            rightX += right.xStep_;
+            row += width;
+        }
+    }
+
+    const int numRows = endY - startY;
+    left.x_ += numRows * left.xStep_;
+    left.invZ_ += numRows * left.invZStep_;
+    right.x_ += numRows * right.xStep_;
+}
+
+/// Set up a clipped triangle for rasterization. Return false if the triangle covers no rows.
+static bool SetupTriangle(const Vector3* vertices, bool clockwise, OcclusionTriangle& triangle)
 {
     int top, middle, bottom;
     bool middleIsRight;
@@ -884,160 +1005,107 @@ void OcclusionBuffer::DrawTriangle2D(const Vector3* vertices, bool clockwise, un
 
     // Check for degenerate triangle
     if (topY == bottomY)
-        return;
+        return false;
 
     // Reverse middleIsRight test if triangle is counterclockwise
     if (!clockwise)
         middleIsRight = !middleIsRight;
 
-    const bool topDegenerate = topY == middleY;
-    const bool bottomDegenerate = middleY == bottomY;
-
     Gradients gradients(vertices);
-    Edge topToBottom(gradients, vertices[top], vertices[bottom], topY);
-
-    int* bufferData = buffers_[threadIndex].data_;
+    triangle.topToBottom_ = Edge(gradients, vertices[top], vertices[bottom], topY);
+    if (topY != middleY)
+        triangle.topToMiddle_ = Edge(gradients, vertices[top], vertices[middle], topY);
+    if (middleY != bottomY)
+        triangle.middleToBottom_ = Edge(gradients, vertices[middle], vertices[bottom], middleY);
+    triangle.dInvZdX_ = gradients.dInvZdXInt_;
+    triangle.topY_ = topY;
+    triangle.middleY_ = middleY;
+    triangle.bottomY_ = bottomY;
+    triangle.middleIsRight_ = middleIsRight;
+    return true;
+}
 
-    if (middleIsRight)
+void OcclusionBuffer::DrawTriangle2D(const OcclusionTriangle& triangle, int minY, int maxY)
+{
+    int* bufferData = buffer_.data_;
+    const int topY = triangle.topY_;
+    const int middleY = triangle.middleY_;
+    const int bottomY = triangle.bottomY_;
+
+    // Left edge provides depth, top to bottom edge is continued from the top half to the bottom half
+    Edge topToBottom = triangle.topToBottom_;
+    if (topY != middleY && minY < middleY)
     {
-        // Top half
-        if (!topDegenerate)
-        {
-            Edge topToMiddle(gradients, vertices[top], vertices[middle], topY);
-            int* row = bufferData + topY * width_;
-            int* endRow = bufferData + middleY * width_;
-            while (row < endRow)
-            {
-                int invZ = topToBottom.invZ_;
-                int* dest = row + (topToBottom.x_ >> 16u);
-                int* end = row + (topToMiddle.x_ >> 16u);
-                while (dest < end)
-                {
-                    if (invZ < *dest)
-                        *dest = invZ;
-                    invZ += gradients.dInvZdXInt_;
-                    ++dest;
-                }
-
-                topToBottom.x_ += topToBottom.xStep_;
-                topToBottom.invZ_ += topToBottom.invZStep_;
-                topToMiddle.x_ += topToMiddle.xStep_;
-                row += width_;
-            }
-        }
-
-        // Bottom half
-        if (!bottomDegenerate)
-        {
-            Edge middleToBottom(gradients, vertices[middle], vertices[bottom], middleY);
-            int* row = bufferData + middleY * width_;
-            int* endRow = bufferData + bottomY * width_;
-            while (row < endRow)
-            {
-                int invZ = topToBottom.invZ_;
-                int* dest = row + (topToBottom.x_ >> 16u);
-                int* end = row + (middleToBottom.x_ >> 16u);
-                while (dest < end)
-                {
-                    if (invZ < *dest)
-                        *dest = invZ;
-                    invZ += gradients.dInvZdXInt_;
-                    ++dest;
-                }
-
-                topToBottom.x_ += topToBottom.xStep_;
-                topToBottom.invZ_ += topToBottom.invZStep_;
-                middleToBottom.x_ += middleToBottom.xStep_;
-                row += width_;
-            }
-        }
+        Edge topToMiddle = triangle.topToMiddle_;
+        if (triangle.middleIsRight_)
+            DrawSpans(bufferData, width_, topToBottom, topToMiddle, triangle.dInvZdX_, topY, middleY, minY, maxY);
+        else
+            DrawSpans(bufferData, width_, topToMiddle, topToBottom, triangle.dInvZdX_, topY, middleY, minY, maxY);
     }
     else
     {
-        // Top half
-        if (!topDegenerate)
-        {
-            Edge topToMiddle(gradients, vertices[top], vertices[middle], topY);
-            int* row = bufferData + topY * width_;
-            int* endRow = bufferData + middleY * width_;
-            while (row < endRow)
-            {
-                int invZ = topToMiddle.invZ_;
-                int* dest = row + (topToMiddle.x_ >> 16u);
-                int* end = row + (topToBottom.x_ >> 16u);
-                while (dest < end)
-                {
-                    if (invZ < *dest)
-                        *dest = invZ;
-                    invZ += gradients.dInvZdXInt_;
-                    ++dest;
-                }
-
-                topToMiddle.x_ += topToMiddle.xStep_;
-                topToMiddle.invZ_ += topToMiddle.invZStep_;
-                topToBottom.x_ += topToBottom.xStep_;
-                row += width_;
-            }
-        }
-
-        // Bottom half
-        if (!bottomDegenerate)
-        {
-            Edge middleToBottom(gradients, vertices[middle], vertices[bottom], middleY);
-            int* row = bufferData + middleY * width_;
-            int* endRow = bufferData + bottomY * width_;
-            while (row < endRow)
-            {
-                int invZ = middleToBottom.invZ_;
-                int* dest = row + (middleToBottom.x_ >> 16u);
-                int* end = row + (topToBottom.x_ >> 16u);
-                while (dest < end)
-                {
-                    if (invZ < *dest)
-                        *dest = invZ;
-                    invZ += gradients.dInvZdXInt_;
-                    ++dest;
-                }
+        // Only advance the long edge
+        const int numRows = middleY - topY;
+        topToBottom.x_ += numRows * topToBottom.xStep_;
+        topToBottom.invZ_ += numRows * topToBottom.invZStep_;
+    }
 
-                middleToBottom.x_ += middleToBottom.xStep_;
-                middleToBottom.invZ_ += middleToBottom.invZStep_;
-                topToBottom.x_ += topToBottom.xStep_;
-                row += width_;
-            }
-        }
+    if (middleY != bottomY && maxY > middleY)
+    {
+        Edge middleToBottom = triangle.middleToBottom_;
+        if (triangle.middleIsRight_)
+            DrawSpans(bufferData, width_, topToBottom, middleToBottom, triangle.dInvZdX_, middleY, bottomY, minY, maxY);
+        else
+            DrawSpans(bufferData, width_, middleToBottom, topToBottom, triangle.dInvZdX_, middleY, bottomY, minY, maxY);
     }
 }
 
-void OcclusionBuffer::MergeBuffers()
+void OcclusionBuffer::SubmitTriangle2D(const Vector3* vertices, bool clockwise, unsigned threadIndex)
 {
-    URHO3D_PROFILE("MergeBuffers");
+    OcclusionTriangle triangle;
+    if (!SetupTriangle(vertices, clockwise, triangle))
+        return;
 
-    for (unsigned i = 1; i < buffers_.size(); ++i)
+    if (!threaded_)
     {
-        if (!buffers_[i].used_)
-            continue;
+        DrawTriangle2D(triangle, 0, height_);
+        return;
+    }
 
-        int* src = buffers_[i].data_;
-        int* dest = buffers_[0].data_;
-        int count = width_ * height_;
+    // Bin the triangle to all bands overlapped by its rows
+    const int topY = Max(triangle.topY_, 0);
+    const int bottomY = Min(triangle.bottomY_, height_);
+    if (topY >= bottomY)
+        return;
 
-        while (count--)
-        {
-            // If thread buffer's depth value is closer, overwrite the original
-            if (*src < *dest)
-                *dest = *src;
-            ++src;
-            ++dest;
-        }
+    ThreadBins& bins = threadBins_[threadIndex];
+    const unsigned index = bins.triangles_.size();
+    bins.triangles_.push_back(triangle);
+
+    const int firstBand = topY / bandHeight_;
+    const int lastBand = (bottomY - 1) / bandHeight_;
+    for (int band = firstBand; band <= lastBand; ++band)
+        bins.bandTriangles_[band].push_back(index);
+}
+
+void OcclusionBuffer::DrawBand(int band)
+{
+    const int minY = band * bandHeight_;
+    const int maxY = Min(minY + bandHeight_, height_);
+
+    for (const ThreadBins& bins : threadBins_)
+    {
+        for (unsigned index : bins.bandTriangles_[band])
+            DrawTriangle2D(bins.triangles_[index], minY, maxY);
     }
 }
 
-void OcclusionBuffer::ClearBuffer(unsigned threadIndex)
+void OcclusionBuffer::ClearBuffer()
 {
-    if (threadIndex >= buffers_.size())
+    if (!buffer_.data_)
         return;
 
-    int* dest = buffers_[threadIndex].data_;
+    int* dest = buffer_.data_;
     int count = width_ * height_;
     auto fillValue = (int)OCCLUSION_Z_SCALE;
 
@@ -41,6 +41,7 @@ class IntRect;
 class VertexBuffer;
 struct Edge;
 struct Gradients;
+struct OcclusionTriangle;
 
 /// Occlusion hierarchy depth value.
 struct DepthValue
@@ -51,15 +52,13 @@ struct DepthValue
     int max_;
 };
 
-/// Per-thread occlusion buffer data.
+/// Occlusion buffer data.
 struct OcclusionBufferData
 {
     /// Full buffer data with safety padding.
     ea::shared_array<int> dataWithSafety_;
     /// Buffer data.
-    int* data_;
-    /// Use flag.
-    bool used_;
+    int* data_{};
 };
 
 /// Stored occlusion render job.
@@ -87,6 +86,8 @@ static const float OCCLUSION_RELATIVE_BIAS = 0.00001f;
 static const int OCCLUSION_FIXED_BIAS = 16;
 static const float OCCLUSION_X_SCALE = 65536.0f;
 static const float OCCLUSION_Z_SCALE = 16777216.0f;
+static const int OCCLUSION_MIN_BAND_HEIGHT = 8;
+static const int OCCLUSION_BANDS_PER_THREAD = 2;
 
 /// Software renderer for occlusion.
 class URHO3D_API OcclusionBuffer : public Object
@@ -102,7 +103,7 @@ public:
     /// Register object with the engine.
     static void RegisterObject(Context* context);
 
-    /// Set occlusion buffer size and whether to reserve multiple buffers for threading optimization.
+    /// Set occlusion buffer size and whether to rasterize in horizontal bands on worker threads.
     bool SetSize(int width, int height, bool threaded);
     /// Set camera view to render from.
     void SetView(Camera* camera);
@@ -127,7 +128,7 @@ public:
     void ResetUseTimer();
 
     /// Return highest level depth values.
-    int* GetBuffer() const { return buffers_.size() ? buffers_[0].data_ : nullptr; }
+    int* GetBuffer() const { return buffer_.data_; }
 
     /// Return view transform matrix.
     const Matrix3x4& GetView() const { return view_; }
@@ -151,7 +152,7 @@ public:
     CullMode GetCullMode() const { return cullMode_; }
 
     /// Return whether is using threads to speed up rendering.
-    bool IsThreaded() const { return buffers_.size() > 1; }
+    bool IsThreaded() const { return threaded_; }
 
     /// Test a bounding box for visibility. For best performance, build depth hierarchy first.
     bool IsVisible(const BoundingBox& worldSpaceBox) const;
@@ -162,6 +163,17 @@ public:
     void DrawBatch(const OcclusionBatch& batch, unsigned threadIndex);
 
 private:
+    /// Triangles binned by one thread.
+    struct ThreadBins
+    {
+        /// Triangles set up for rasterization.
+        ea::vector<OcclusionTriangle> triangles_;
+        /// Indices of triangles overlapping each band.
+        ea::vector<ea::vector<unsigned>> bandTriangles_;
+        /// Number of drawn triangles.
+        unsigned numTriangles_{};
+    };
+
     /// Apply modelview transform to vertex.
     inline Vector4 ModelTransform(const Matrix4& transform, const Vector3& vertex) const;
     /// Apply projection and viewport transform to vertex.
@@ -176,15 +188,19 @@ private:
     void DrawTriangle(Vector4* vertices, unsigned threadIndex);
     /// Clip vertices against a plane.
     void ClipVertices(const Vector4& plane, Vector4* vertices, bool* triangles, unsigned& numTriangles);
-    /// Draw a clipped triangle.
-    void DrawTriangle2D(const Vector3* vertices, bool clockwise, unsigned threadIndex);
-    /// Clear a thread work buffer.
-    void ClearBuffer(unsigned threadIndex);
-    /// Merge thread work buffers into the first buffer.
-    void MergeBuffers();
-
-    /// Highest-level buffer data per thread.
-    ea::vector<OcclusionBufferData> buffers_;
+    /// Draw a clipped triangle or bin it for threaded rasterization.
+    void SubmitTriangle2D(const Vector3* vertices, bool clockwise, unsigned threadIndex);
+    /// Draw rows minY to maxY (exclusive) of a triangle.
+    void DrawTriangle2D(const OcclusionTriangle& triangle, int minY, int maxY);
+    /// Draw triangles binned to a band.
+    void DrawBand(int band);
+    /// Clear the buffer data.
+    void ClearBuffer();
+
+    /// Highest-level buffer data.
+    OcclusionBufferData buffer_;
+    /// Triangle bins per thread.
+    ea::vector<ThreadBins> threadBins_;
     /// Reduced size depth buffers.
     ea::vector<ea::shared_array<DepthValue> > mipBuffers_;
     /// Submitted render jobs.
@@ -193,12 +209,18 @@ private:
     int width_{};
     /// Buffer height.
     int height_{};
+    /// Height of horizontal bands for threaded rasterization.
+    int bandHeight_{};
+    /// Number of horizontal bands.
+    int numBands_{};
     /// Number of rendered triangles.
     unsigned numTriangles_{};
     /// Maximum number of triangles.
     unsigned maxTriangles_{OCCLUSION_DEFAULT_MAX_TRIANGLES};
     /// Culling mode.
     CullMode cullMode_{CULL_CCW};
+    /// Threaded rasterization flag.
+    bool threaded_{};
     /// Depth hierarchy needs update flag.
     bool depthHierarchyDirty_{true};
     /// Culling reverse flag.
@@ -150,12 +150,12 @@ static const int DEFAULT_OCTREE_LEVELS = 8;
 
 extern const char* SUBSYSTEM_CATEGORY;
 
-void UpdateDrawablesWork(const WorkItem* item, unsigned threadIndex)
+/// Minimum number of drawables updated at once.
+static const unsigned UPDATE_DRAWABLES_CHUNK_SIZE = 16;
+
+void UpdateDrawablesWork(Drawable** start, Drawable** end, const FrameInfo& frame)
 {
     URHO3D_PROFILE("UpdateDrawablesWork");
-    const FrameInfo& frame = *(reinterpret_cast<FrameInfo*>(item->aux_));
-    auto** start = reinterpret_cast<Drawable**>(item->start_);
-    auto** end = reinterpret_cast<Drawable**>(item->end_);
 
     while (start != end)
     {
@@ -188,10 +188,13 @@ Octant::~Octant()
         for (auto i = drawables_.begin(); i != drawables_.end(); ++i)
         {
             (*i)->SetOctant(root_);
+            (*i)->octantIndex_ = root_->drawables_.size();
             root_->drawables_.push_back(*i);
+            root_->drawableBoxes_.push_back(drawableBoxes_[i - drawables_.begin()]);
             root_->QueueUpdate(*i);
         }
         drawables_.clear();
+        drawableBoxes_.clear();
         numDrawables_ = 0;
     }
 
@@ -252,10 +255,13 @@ void Octant::InsertDrawable(Drawable* drawable)
         if (oldOctant != this)
         {
             // Add first, then remove, because drawable count going to zero deletes the octree branch in question
+            const unsigned oldIndex = drawable->octantIndex_;
             AddDrawable(drawable);
             if (oldOctant)
-                oldOctant->RemoveDrawable(drawable, false);
+                oldOctant->RemoveDrawableAt(oldIndex);
         }
+        else
+            RefitDrawable(drawable);
     }
     else
     {
@@ -347,7 +353,7 @@ void Octant::GetDrawablesInternal(OctreeQuery& query, bool inside) const
     {
         auto** start = const_cast<Drawable**>(&drawables_[0]);
         Drawable** end = start + drawables_.size();
-        query.TestDrawables(start, end, inside);
+        query.TestPackedDrawables(start, end, &drawableBoxes_[0], inside);
     }
 
     for (auto child : children_)
@@ -365,13 +371,12 @@ void Octant::GetDrawablesInternal(RayOctreeQuery& query) const
 
     if (drawables_.size())
     {
-        auto** start = const_cast<Drawable**>(&drawables_[0]);
-        Drawable** end = start + drawables_.size();
-
-        while (start != end)
+        for (unsigned i = 0; i < drawables_.size(); ++i)
         {
-            Drawable* drawable = *start++;
+            if (!IsDrawableHitByRay(query, i))
+                continue;
 
+            Drawable* drawable = drawables_[i];
             if ((drawable->GetDrawableFlags() & query.drawableFlags_) && (drawable->GetViewMask() & query.viewMask_))
                 drawable->ProcessRayQuery(query, query.result_);
         }
@@ -392,13 +397,12 @@ void Octant::GetDrawablesOnlyInternal(RayOctreeQuery& query, ea::vector<Drawable
 
     if (drawables_.size())
     {
-        auto** start = const_cast<Drawable**>(&drawables_[0]);
-        Drawable** end = start + drawables_.size();
-
-        while (start != end)
+        for (unsigned i = 0; i < drawables_.size(); ++i)
         {
-            Drawable* drawable = *start++;
+            if (!IsDrawableHitByRay(query, i))
+                continue;
 
+            Drawable* drawable = drawables_[i];
             if ((drawable->GetDrawableFlags() & query.drawableFlags_) && (drawable->GetViewMask() & query.viewMask_))
                 drawables.push_back(drawable);
         }
@@ -472,6 +476,16 @@ void Octree::Update(const FrameInfo& frame)
         return;
     }
 
+    animationPoseCache_.BeginFrame();
+    skinMatrixArena_.BeginFrame();
+
+    // Drawables queued during threaded scene update (for example, by thread-safe logic components) are updated in parallel as well
+    if (!threadedDrawableUpdates_.empty())
+    {
+        drawableUpdates_.insert(drawableUpdates_.end(), threadedDrawableUpdates_.begin(), threadedDrawableUpdates_.end());
+        threadedDrawableUpdates_.clear();
+    }
+
     // Let drawables update themselves before reinsertion. This can be used for animation
     if (!drawableUpdates_.empty())
     {
@@ -483,30 +497,12 @@ void Octree::Update(const FrameInfo& frame)
         auto* queue = GetSubsystem<WorkQueue>();
         scene->BeginThreadedUpdate();
 
-        int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-        int drawablesPerItem = Max((int)(drawableUpdates_.size() / numWorkItems), 1);
-
-        auto start = drawableUpdates_.begin();
-        // Create a work item for each thread
-        for (int i = 0; i < numWorkItems; ++i)
+        queue->ParallelFor(drawableUpdates_.size(), UPDATE_DRAWABLES_CHUNK_SIZE,
+            [&](unsigned beginIndex, unsigned endIndex, unsigned)
         {
-            SharedPtr<WorkItem> item = queue->GetFreeItem();
-            item->priority_ = M_MAX_UNSIGNED;
-            item->workFunction_ = UpdateDrawablesWork;
-            item->aux_ = const_cast<FrameInfo*>(&frame);
+            UpdateDrawablesWork(drawableUpdates_.data() + beginIndex, drawableUpdates_.data() + endIndex, frame);
+        });
 
-            auto end = drawableUpdates_.end();
-            if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                end = start + drawablesPerItem;
-
-            item->start_ = &(*start);
-            item->end_ = &(*end);
-            queue->AddWorkItem(item);
-
-            start = end;
-        }
-
-        queue->Complete(M_MAX_UNSIGNED);
         scene->EndThreadedUpdate();
     }
 
@@ -557,11 +553,19 @@ void Octree::Update(const FrameInfo& frame)
             // Skip if no octant or does not belong to this octree anymore
             if (!octant || octant->GetRoot() != this)
                 continue;
-            // Skip if still fits the current octant
+            // Only refit if still fits the current octant
             if (drawable->IsOccludee() && octant->GetCullingBox().IsInside(box) == INSIDE && octant->CheckDrawableFit(box))
+            {
+                octant->RefitDrawable(drawable);
                 continue;
+            }
 
-            InsertDrawable(drawable);
+            // Moving objects usually stay nearby: reinsert from the closest octant that contains the drawable.
+            // Non-occludees always live in the root octant
+            Octant* insertionOctant = drawable->IsOccludee() ? octant : this;
+            while (insertionOctant != this && insertionOctant->GetCullingBox().IsInside(box) != INSIDE)
+                insertionOctant = insertionOctant->GetParent();
+            insertionOctant->InsertDrawable(drawable);
 
 #ifdef _DEBUG
             // Verify that the drawable will be culled correctly
@@ -677,6 +681,9 @@ void Octree::QueueUpdate(Drawable* drawable)
     else
         drawableUpdates_.push_back(drawable);
 
+    // Bounding box is not known until the drawable is updated
+    if (drawable->octant_)
+        drawable->octant_->InvalidateDrawable(drawable);
     drawable->updateQueued_ = true;
 }
 
@@ -684,7 +691,9 @@ void Octree::CancelUpdate(Drawable* drawable)
 {
     // This doesn't have to take into account scene being in threaded update, because it is called only
     // when removing a drawable from octree, which should only ever happen from the main thread.
+    // Drawable may still be queued by the threaded scene update that happened earlier in the frame.
     drawableUpdates_.erase_first(drawable);
+    threadedDrawableUpdates_.erase_first(drawable);
     drawable->updateQueued_ = false;
 }
 
@@ -23,8 +23,10 @@
 #pragma once
 
 #include "../Core/Mutex.h"
+#include "../Graphics/AnimationPoseCache.h"
 #include "../Graphics/Drawable.h"
 #include "../Graphics/OctreeQuery.h"
+#include "../Graphics/SkinMatrixArena.h"
 
 namespace Urho3D
 {
@@ -58,23 +60,38 @@ public:
     void AddDrawable(Drawable* drawable)
     {
         drawable->SetOctant(this);
+        drawable->octantIndex_ = drawables_.size();
         drawables_.push_back(drawable);
+        drawableBoxes_.push_back(drawable->GetWorldBoundingBox());
         IncDrawableCount();
     }
 
     /// Remove a drawable object from this octant.
     void RemoveDrawable(Drawable* drawable, bool resetOctant = true)
     {
-        auto it = drawables_.find(drawable);
-        if (it != drawables_.end())
+        const unsigned index = drawable->octantIndex_;
+        if (index < drawables_.size() && drawables_[index] == drawable)
         {
-            drawables_.erase(it);
             if (resetOctant)
                 drawable->SetOctant(nullptr);
-            DecDrawableCount();
+            RemoveDrawableAt(index);
         }
     }
 
+    /// Make packed bounding box of a drawable object in this octant pass any test until the drawable is refit.
+    void InvalidateDrawable(Drawable* drawable)
+    {
+        assert(drawable->octant_ == this);
+        drawableBoxes_[drawable->octantIndex_] = BoundingBox(-M_LARGE_VALUE, M_LARGE_VALUE);
+    }
+
+    /// Update packed bounding box of a drawable object in this octant.
+    void RefitDrawable(Drawable* drawable)
+    {
+        assert(drawable->octant_ == this);
+        drawableBoxes_[drawable->octantIndex_] = drawable->GetWorldBoundingBox();
+    }
+
     /// Return world-space bounding box.
     const BoundingBox& GetWorldBoundingBox() const { return worldBoundingBox_; }
 
@@ -111,6 +128,27 @@ protected:
     /// Return drawable objects only for a threaded ray query, called internally.
     void GetDrawablesOnlyInternal(RayOctreeQuery& query, ea::vector<Drawable*>& drawables) const;
 
+    /// Remove a drawable object by index. Last drawable object is moved to its place.
+    void RemoveDrawableAt(unsigned index)
+    {
+        const unsigned lastIndex = drawables_.size() - 1;
+        if (index != lastIndex)
+        {
+            drawables_[index] = drawables_[lastIndex];
+            drawableBoxes_[index] = drawableBoxes_[lastIndex];
+            drawables_[index]->octantIndex_ = index;
+        }
+        drawables_.pop_back();
+        drawableBoxes_.pop_back();
+        DecDrawableCount();
+    }
+
+    /// Return whether the packed bounding box of the drawable object may be hit by the ray.
+    bool IsDrawableHitByRay(const RayOctreeQuery& query, unsigned index) const
+    {
+        return query.ray_.HitDistance(drawableBoxes_[index]) < query.maxDistance_;
+    }
+
     /// Increase drawable object count recursively.
     void IncDrawableCount()
     {
@@ -141,6 +179,8 @@ protected:
     BoundingBox cullingBox_;
     /// Drawable objects.
     ea::vector<Drawable*> drawables_;
+    /// World bounding boxes of drawable objects, packed contiguously for culling.
+    ea::vector<BoundingBox> drawableBoxes_;
     /// Child octants.
     Octant* children_[NUM_OCTANTS]{};
     /// World bounding box center.
@@ -198,6 +238,14 @@ public:
 
     /// Return subdivision levels.
     unsigned GetNumLevels() const { return numLevels_; }
+    /// Return cache of skeleton poses shared between animated models in the current frame.
+    AnimationPoseCache& GetAnimationPoseCache() { return animationPoseCache_; }
+    /// Return cache of skeleton poses shared between animated models. Its counters describe the last frame.
+    const AnimationPoseCache& GetAnimationPoseCache() const { return animationPoseCache_; }
+    /// Return skinning matrices of the skinned drawables rendered in the current frame.
+    SkinMatrixArena& GetSkinMatrixArena() { return skinMatrixArena_; }
+    /// Return skinning matrices of the skinned drawables rendered in the current frame.
+    const SkinMatrixArena& GetSkinMatrixArena() const { return skinMatrixArena_; }
 
     /// Mark drawable object as requiring an update and a reinsertion.
     void QueueUpdate(Drawable* drawable);
@@ -218,6 +266,10 @@ private:
     ea::vector<Drawable*> threadedDrawableUpdates_;
     /// Mutex for octree reinsertions.
     Mutex octreeMutex_;
+    /// Skeleton poses shared between animated models.
+    AnimationPoseCache animationPoseCache_;
+    /// Skinning matrices of the current frame.
+    SkinMatrixArena skinMatrixArena_;
     /// Ray query temporary list of drawables.
     mutable ea::vector<Drawable*> rayQueryDrawables_;
     /// Subdivision level.
@@ -29,6 +29,9 @@
 namespace Urho3D
 {
 
+/// Number of packed drawables tested against the frustum at once.
+static const unsigned PACKED_DRAWABLES_CHUNK_SIZE = 256;
+
 Intersection PointOctreeQuery::TestOctant(const BoundingBox& box, bool inside)
 {
     if (inside)
@@ -117,6 +120,46 @@ void FrustumOctreeQuery::TestDrawables(Drawable** start, Drawable** end, bool in
     }
 }
 
+void FrustumOctreeQuery::TestPackedDrawables(Drawable** start, Drawable** end, const BoundingBox* boxes, bool inside)
+{
+    if (inside)
+    {
+        TestDrawables(start, end, true);
+        return;
+    }
+
+    unsigned visibilityMask[PACKED_DRAWABLES_CHUNK_SIZE / 32];
+    const auto count = static_cast<unsigned>(end - start);
+    for (unsigned chunkBegin = 0; chunkBegin < count; chunkBegin += PACKED_DRAWABLES_CHUNK_SIZE)
+    {
+        const unsigned chunkSize = Min(PACKED_DRAWABLES_CHUNK_SIZE, count - chunkBegin);
+        frustum_.GetVisibilityMask(boxes + chunkBegin, chunkSize, visibilityMask);
+
+        // Packed boxes may be conservative, so consecutive ranges of visible drawables are tested again
+        unsigned index = 0;
+        while (index < chunkSize)
+        {
+            const unsigned bits = visibilityMask[index / 32] >> (index % 32);
+            if (!bits)
+            {
+                index = (index / 32 + 1) * 32;
+                continue;
+            }
+            if (!(bits & 1u))
+            {
+                ++index;
+                continue;
+            }
+
+            unsigned rangeEnd = index + 1;
+            while (rangeEnd < chunkSize && (visibilityMask[rangeEnd / 32] & (1u << (rangeEnd % 32))))
+                ++rangeEnd;
+
+            TestDrawables(start + chunkBegin + index, start + chunkBegin + rangeEnd, false);
+            index = rangeEnd;
+        }
+    }
+}
 
 Intersection AllContentOctreeQuery::TestOctant(const BoundingBox& box, bool inside)
 {
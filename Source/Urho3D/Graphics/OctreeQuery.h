@@ -56,6 +56,11 @@ public:
     virtual Intersection TestOctant(const BoundingBox& box, bool inside) = 0;
     /// Intersection test for drawables.
     virtual void TestDrawables(Drawable** start, Drawable** end, bool inside) = 0;
+    /// Intersection test for drawables with packed world bounding boxes. Boxes may be conservative.
+    virtual void TestPackedDrawables(Drawable** start, Drawable** end, const BoundingBox* boxes, bool inside)
+    {
+        TestDrawables(start, end, inside);
+    }
 
     /// Result vector reference.
     ea::vector<Drawable*>& result_;
@@ -144,6 +149,8 @@ public:
     Intersection TestOctant(const BoundingBox& box, bool inside) override;
     /// Intersection test for drawables.
     void TestDrawables(Drawable** start, Drawable** end, bool inside) override;
+    /// Intersection test for drawables with packed world bounding boxes. Only drawables that pass are tested individually.
+    void TestPackedDrawables(Drawable** start, Drawable** end, const BoundingBox* boxes, bool inside) override;
 
     /// Frustum.
     Frustum frustum_;
@@ -25,6 +25,7 @@
 #include "../Core/CoreEvents.h"
 #include "../Core/Context.h"
 #include "../Core/Profiler.h"
+#include "../Core/Thread.h"
 #include "../Graphics/Camera.h"
 #include "../Graphics/DebugRenderer.h"
 #include "../Graphics/Geometry.h"
@@ -255,6 +256,8 @@ static const char* heightFogVariations[] =
 
 static const unsigned MAX_BUFFER_AGE = 1000;
 
+static const unsigned MAX_CACHED_SHADOW_MAP_AGE = 60;
+
 static const int MAX_EXTRA_INSTANCING_BUFFER_ELEMENTS = 4;
 
 inline ea::vector<VertexElement> CreateInstancingBufferElements(unsigned numExtraElements)
@@ -705,6 +708,74 @@ unsigned Renderer::GetNumOccluders(bool allViews) const
     return numOccluders;
 }
 
+unsigned Renderer::GetNumBatchCacheHits(bool allViews) const
+{
+    unsigned numHits = 0;
+    unsigned lastView = allViews ? views_.size() : 1;
+
+    for (unsigned i = 0; i < lastView; ++i)
+    {
+        View* view = GetActualView(views_[i]);
+        if (!view)
+            continue;
+
+        numHits += view->GetNumBatchCacheHits();
+    }
+
+    return numHits;
+}
+
+unsigned Renderer::GetNumBatchCacheMisses(bool allViews) const
+{
+    unsigned numMisses = 0;
+    unsigned lastView = allViews ? views_.size() : 1;
+
+    for (unsigned i = 0; i < lastView; ++i)
+    {
+        View* view = GetActualView(views_[i]);
+        if (!view)
+            continue;
+
+        numMisses += view->GetNumBatchCacheMisses();
+    }
+
+    return numMisses;
+}
+
+size_t Renderer::GetFrameAllocatorUsedSize(bool allViews) const
+{
+    size_t size = 0;
+    unsigned lastView = allViews ? views_.size() : 1;
+
+    for (unsigned i = 0; i < lastView; ++i)
+    {
+        View* view = GetActualView(views_[i]);
+        if (!view)
+            continue;
+
+        size += view->GetFrameAllocatorUsedSize();
+    }
+
+    return size;
+}
+
+size_t Renderer::GetFrameAllocatorPeakSize(bool allViews) const
+{
+    size_t size = 0;
+    unsigned lastView = allViews ? views_.size() : 1;
+
+    for (unsigned i = 0; i < lastView; ++i)
+    {
+        View* view = GetActualView(views_[i]);
+        if (!view)
+            continue;
+
+        size += view->GetFrameAllocatorPeakSize();
+    }
+
+    return size;
+}
+
 void Renderer::Update(float timeStep)
 {
     URHO3D_PROFILE("UpdateViews");
@@ -724,6 +795,7 @@ void Renderer::Update(float timeStep)
     numShadowCameras_ = 0;
     numOcclusionBuffers_ = 0;
     updatedOctrees_.clear();
+    RemoveUnusedCachedShadowMaps();
 
     // Reload shaders now if needed
     if (shadersDirty_)
@@ -902,8 +974,9 @@ Texture2D* Renderer::GetShadowMap(Light* light, Camera* camera, unsigned viewWid
     LightType type = light->GetLightType();
     const FocusParameters& parameters = light->GetShadowFocus();
     float size = (float)shadowMapSize_ * light->GetShadowResolution();
-    // Automatically reduce shadow map size when far away
-    if (parameters.autoSize_ && type != LIGHT_DIRECTIONAL)
+    // Automatically reduce shadow map size when far away. Cached shadow maps must not depend on the camera, so keep their size
+    const bool cached = light->IsShadowMapCached();
+    if (parameters.autoSize_ && type != LIGHT_DIRECTIONAL && !cached)
     {
         const Matrix3x4& view = camera->GetView();
         const Matrix4& projection = camera->GetProjection();
@@ -953,6 +1026,9 @@ Texture2D* Renderer::GetShadowMap(Light* light, Camera* camera, unsigned viewWid
         height *= 3;
     }
 
+    if (cached)
+        return GetCachedShadowMap(light, width, height);
+
     int searchKey = width << 16u | height;
     if (shadowMaps_.contains(searchKey))
     {
@@ -973,6 +1049,19 @@ Texture2D* Renderer::GetShadowMap(Light* light, Camera* camera, unsigned viewWid
         }
     }
 
+    SharedPtr<Texture2D> newShadowMap = CreateShadowMap(width, height);
+    // If failed to create, store a null pointer so that we will not retry
+    shadowMaps_[searchKey].push_back(newShadowMap);
+    if (!reuseShadowMaps_)
+        shadowMapAllocations_[searchKey].push_back(light);
+
+    return newShadowMap;
+}
+
+SharedPtr<Texture2D> Renderer::CreateShadowMap(int width, int height)
+{
+    int searchKey = width << 16u | height;
+
     // Find format and usage of the shadow map
     unsigned shadowMapFormat = 0;
     TextureUsage shadowMapUsage = TEXTURE_DEPTHSTENCIL;
@@ -1046,17 +1135,61 @@ Texture2D* Renderer::GetShadowMap(Light* light, Camera* camera, unsigned viewWid
         }
     }
 
-    // If failed to set size, store a null pointer so that we will not retry
     if (!retries)
         newShadowMap.Reset();
 
-    shadowMaps_[searchKey].push_back(newShadowMap);
-    if (!reuseShadowMaps_)
-        shadowMapAllocations_[searchKey].push_back(light);
-
     return newShadowMap;
 }
 
+Texture2D* Renderer::GetCachedShadowMap(Light* light, int width, int height)
+{
+    CachedShadowMap& cachedShadowMap = cachedShadowMaps_[light];
+    // The light may have been destroyed and another one created at the same address
+    if (cachedShadowMap.light_ != light)
+    {
+        cachedShadowMap = CachedShadowMap();
+        cachedShadowMap.light_ = light;
+    }
+
+    const IntVector2 size(width, height);
+    if (cachedShadowMap.size_ != size)
+    {
+        cachedShadowMap.texture_ = CreateShadowMap(width, height);
+        cachedShadowMap.size_ = size;
+        cachedShadowMap.splitHashes_.clear();
+    }
+
+    cachedShadowMap.lastUsedFrame_ = frame_.frameNumber_;
+    return cachedShadowMap.texture_;
+}
+
+bool Renderer::IsShadowMapUpToDate(Light* light, const ea::vector<unsigned long long>& splitHashes) const
+{
+    auto i = cachedShadowMaps_.find(light);
+    return i != cachedShadowMaps_.end() && i->second.light_ == light && i->second.IsUpToDate(splitHashes);
+}
+
+void Renderer::SetShadowMapRendered(Light* light, const ea::vector<unsigned long long>& splitHashes)
+{
+    auto i = cachedShadowMaps_.find(light);
+    if (i == cachedShadowMaps_.end() || i->second.light_ != light || !i->second.texture_)
+        return;
+
+    i->second.splitHashes_ = splitHashes;
+    i->second.texture_->ClearDataLost();
+}
+
+void Renderer::RemoveUnusedCachedShadowMaps()
+{
+    for (auto i = cachedShadowMaps_.begin(); i != cachedShadowMaps_.end();)
+    {
+        if (!i->second.light_ || frame_.frameNumber_ - i->second.lastUsedFrame_ > MAX_CACHED_SHADOW_MAP_AGE)
+            i = cachedShadowMaps_.erase(i);
+        else
+            ++i;
+    }
+}
+
 Texture* Renderer::GetScreenBuffer(int width, int height, unsigned format, int multiSample, bool autoResolve, bool cubemap, bool filtered, bool srgb,
     unsigned persistentKey)
 {
@@ -1226,20 +1359,53 @@ View* Renderer::GetActualView(View* view)
 void Renderer::SetBatchShaders(Batch& batch, Technique* tech, bool allowShadows, const BatchQueue& queue)
 {
     Pass* pass = batch.pass_;
+    ea::vector<SharedPtr<ShaderVariation> >* vertexShaderList;
+    ea::vector<SharedPtr<ShaderVariation> >* pixelShaderList;
+    bool shadersLoaded;
+
+    // Light batches are built on worker threads. Shaders are released and looked up under the lock, and loaded shader
+    // lists are not modified again until shaders are changed, so they are used without locking
+    if (!queue.hasExtraDefines_ && pass->AreBaseShadersReady(shadersChangedFrameNumber_))
+    {
+        vertexShaderList = &pass->GetVertexShaders();
+        pixelShaderList = &pass->GetPixelShaders();
+        shadersLoaded = true;
+    }
+    else
+    {
+        MutexLock lock(batchShadersMutex_);
 
-    // Check if need to release/reload all shaders
-    if (pass->GetShadersLoadedFrameNumber() != shadersChangedFrameNumber_)
-        pass->ReleaseShaders();
+        // Check if need to release/reload all shaders
+        if (pass->GetShadersLoadedFrameNumber() != shadersChangedFrameNumber_)
+            pass->ReleaseShaders();
 
-    ea::vector<SharedPtr<ShaderVariation> >& vertexShaders = queue.hasExtraDefines_ ? pass->GetVertexShaders(queue.vsExtraDefinesHash_) : pass->GetVertexShaders();
-    ea::vector<SharedPtr<ShaderVariation> >& pixelShaders = queue.hasExtraDefines_ ? pass->GetPixelShaders(queue.psExtraDefinesHash_) : pass->GetPixelShaders();
+        vertexShaderList = queue.hasExtraDefines_ ? &pass->GetVertexShaders(queue.vsExtraDefinesHash_) : &pass->GetVertexShaders();
+        pixelShaderList = queue.hasExtraDefines_ ? &pass->GetPixelShaders(queue.psExtraDefinesHash_) : &pass->GetPixelShaders();
 
-    // Load shaders now if necessary
-    if (!vertexShaders.size() || !pixelShaders.size())
-        LoadPassShaders(pass, vertexShaders, pixelShaders, queue);
+        // Load shaders now if necessary. The resource cache is only accessible from the main thread, so worker
+        // threads leave the batch without shaders and the caller builds it again once on the main thread
+        if (!vertexShaderList->size() || !pixelShaderList->size())
+        {
+            if (!Thread::IsMainThread())
+            {
+                batchShadersDeferred_ = true;
+                batch.vertexShader_ = nullptr;
+                batch.pixelShader_ = nullptr;
+                return;
+            }
+            LoadPassShaders(pass, *vertexShaderList, *pixelShaderList, queue);
+        }
+
+        shadersLoaded = vertexShaderList->size() && pixelShaderList->size();
+        if (shadersLoaded && !queue.hasExtraDefines_)
+            pass->MarkBaseShadersReady(shadersChangedFrameNumber_);
+    }
+
+    ea::vector<SharedPtr<ShaderVariation> >& vertexShaders = *vertexShaderList;
+    ea::vector<SharedPtr<ShaderVariation> >& pixelShaders = *pixelShaderList;
 
     // Make sure shaders are loaded now
-    if (vertexShaders.size() && pixelShaders.size())
+    if (shadersLoaded)
     {
         bool heightFog = batch.zone_ && batch.zone_->GetHeightFog();
 
@@ -1330,6 +1496,7 @@ void Renderer::SetBatchShaders(Batch& batch, Technique* tech, bool allowShadows,
     // Log error if shaders could not be assigned, but only once per technique
     if (!batch.vertexShader_ || !batch.pixelShader_)
     {
+        MutexLock lock(batchShadersMutex_);
         if (!shaderErrorDisplayed_.contains(tech))
         {
             shaderErrorDisplayed_.insert(tech);
@@ -1338,6 +1505,13 @@ void Renderer::SetBatchShaders(Batch& batch, Technique* tech, bool allowShadows,
     }
 }
 
+bool Renderer::ResetBatchShadersDeferred()
+{
+    const bool deferred = batchShadersDeferred_;
+    batchShadersDeferred_ = false;
+    return deferred;
+}
+
 void Renderer::SetLightVolumeBatchShaders(Batch& batch, Camera* camera, const ea::string& vsName, const ea::string& psName, const ea::string& vsDefines,
     const ea::string& psDefines)
 {
@@ -1420,6 +1594,8 @@ bool Renderer::ResizeInstancingBuffer(unsigned numInstances)
     while (newSize < numInstances)
         newSize <<= 1;
 
+    instancingBufferView_.Reset();
+
     const ea::vector<VertexElement> instancingBufferElements = CreateInstancingBufferElements(numExtraInstancingBufferElements_);
     if (!instancingBuffer_->SetSize(newSize, instancingBufferElements, true))
     {
@@ -1945,8 +2121,22 @@ void Renderer::SetIndirectionTextureData()
     indirectionCubeMap_->ClearDataLost();
 }
 
+void Renderer::SetInstancingBufferSource(View* view, unsigned batchesVersion)
+{
+    instancingBufferView_ = view;
+    instancingBufferBatchesVersion_ = batchesVersion;
+}
+
+bool Renderer::IsInstancingBufferSource(View* view, unsigned batchesVersion) const
+{
+    return instancingBuffer_ && !instancingBuffer_->IsDataLost() && instancingBufferView_ == view
+        && instancingBufferBatchesVersion_ == batchesVersion;
+}
+
 void Renderer::CreateInstancingBuffer()
 {
+    instancingBufferView_.Reset();
+
     // Do not create buffer if instancing not supported
     if (!graphics_->GetInstancingSupport())
     {
@@ -1969,6 +2159,7 @@ void Renderer::ResetShadowMaps()
     shadowMaps_.clear();
     shadowMapAllocations_.clear();
     colorShadowMaps_.clear();
+    cachedShadowMaps_.clear();
 }
 
 void Renderer::ResetBuffers()
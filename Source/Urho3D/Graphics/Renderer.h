@@ -27,6 +27,7 @@
 #include "../Core/Mutex.h"
 #include "../Graphics/Batch.h"
 #include "../Graphics/Drawable.h"
+#include "../Graphics/ShadowMapCache.h"
 #include "../Graphics/Viewport.h"
 #include "../Math/Color.h"
 
@@ -327,6 +328,9 @@ public:
     /// Return whether dynamic instancing is in use.
     bool GetDynamicInstancing() const { return dynamicInstancing_; }
 
+    /// Return frame number when shaders were last changed. Passes with shaders loaded on a different frame need reloading.
+    unsigned GetShadersChangedFrameNumber() const { return shadersChangedFrameNumber_; }
+
     /// Return number of extra instancing buffer elements.
     int GetNumExtraInstancingBufferElements() const { return numExtraInstancingBufferElements_; };
 
@@ -383,6 +387,16 @@ public:
     unsigned GetNumShadowMaps(bool allViews = false) const;
     /// Return number of occluders rendered.
     unsigned GetNumOccluders(bool allViews = false) const;
+    /// Return number of drawables whose base batches were reused from the previous frames.
+    unsigned GetNumBatchCacheHits(bool allViews = false) const;
+    /// Return number of drawables whose base batches were prepared from scratch.
+    unsigned GetNumBatchCacheMisses(bool allViews = false) const;
+    /// Return bytes of transient batch data allocated from frame allocators during the last update.
+    size_t GetFrameAllocatorUsedSize(bool allViews = false) const;
+    /// Return highest bytes of transient batch data allocated from frame allocators during one update.
+    size_t GetFrameAllocatorPeakSize(bool allViews = false) const;
+    /// Return number of dedicated shadow maps kept for lights with shadow map caching.
+    unsigned GetNumCachedShadowMaps() const { return cachedShadowMaps_.size(); }
 
     /// Return the default zone.
     Zone* GetDefaultZone() const { return defaultZone_; }
@@ -425,6 +439,10 @@ public:
     Geometry* GetQuadGeometry();
     /// Allocate a shadow map. If shadow map reuse is disabled, a different map is returned each time.
     Texture2D* GetShadowMap(Light* light, Camera* camera, unsigned viewWidth, unsigned viewHeight);
+    /// Return whether the cached shadow map of a light was last rendered with the given split hashes.
+    bool IsShadowMapUpToDate(Light* light, const ea::vector<unsigned long long>& splitHashes) const;
+    /// Store split hashes of a cached shadow map after rendering it.
+    void SetShadowMapRendered(Light* light, const ea::vector<unsigned long long>& splitHashes);
     /// Allocate a rendertarget or depth-stencil texture for deferred rendering or postprocessing. Should only be called during actual rendering, not before.
     Texture* GetScreenBuffer
         (int width, int height, unsigned format, int multiSample, bool autoResolve, bool cubemap, bool filtered, bool srgb, unsigned persistentKey = 0);
@@ -438,8 +456,10 @@ public:
     void StorePreparedView(View* view, Camera* camera);
     /// Return a prepared view if exists for the specified camera. Used to avoid duplicate view preparation CPU work.
     View* GetPreparedView(Camera* camera);
-    /// Choose shaders for a forward rendering batch. The related batch queue is provided in case it has extra shader compilation defines.
+    /// Choose shaders for a forward rendering batch. The related batch queue is provided in case it has extra shader compilation defines. Is thread-safe, but shaders can only be loaded on the main thread: batches whose pass shaders are not loaded yet are left without shaders when called from a worker thread.
     void SetBatchShaders(Batch& batch, Technique* tech, bool allowShadows, const BatchQueue& queue);
+    /// Return whether batches were left without shaders on a worker thread since the last call, and reset the flag. Call from the main thread.
+    bool ResetBatchShadersDeferred();
     /// Choose shaders for a deferred light volume batch.
     void SetLightVolumeBatchShaders
         (Batch& batch, Camera* camera, const ea::string& vsName, const ea::string& psName, const ea::string& vsDefines, const ea::string& psDefines);
@@ -447,6 +467,10 @@ public:
     void SetCullMode(CullMode mode, Camera* camera);
     /// Ensure sufficient size of the instancing vertex buffer. Return true if successful.
     bool ResizeInstancingBuffer(unsigned numInstances);
+    /// Remember which version of the view batches is stored in the instancing buffer.
+    void SetInstancingBufferSource(View* view, unsigned batchesVersion);
+    /// Return whether the instancing buffer contains given version of the view batches.
+    bool IsInstancingBufferSource(View* view, unsigned batchesVersion) const;
     /// Optimize a light by scissor rectangle.
     void OptimizeLightByScissor(Light* light, Camera* camera);
     /// Optimize a light by marking it to the stencil buffer and setting a stencil test.
@@ -484,6 +508,12 @@ private:
     void ResetShadowMapAllocations();
     /// Reset screem buffer allocation counts.
     void ResetScreenBufferAllocations();
+    /// Create a shadow map texture using current shadow quality. Return null on failure.
+    SharedPtr<Texture2D> CreateShadowMap(int width, int height);
+    /// Return dedicated shadow map for a light with shadow map caching.
+    Texture2D* GetCachedShadowMap(Light* light, int width, int height);
+    /// Remove cached shadow maps of destroyed lights and lights that have not been rendered for a while.
+    void RemoveUnusedCachedShadowMaps();
     /// Remove all shadow maps. Called when global shadow map resolution or format is changed.
     void ResetShadowMaps();
     /// Remove all occlusion and screen buffers.
@@ -513,6 +543,10 @@ private:
     SharedPtr<Geometry> pointLightGeometry_;
     /// Instance stream vertex buffer.
     SharedPtr<VertexBuffer> instancingBuffer_;
+    /// View whose batches are stored in the instancing buffer.
+    WeakPtr<View> instancingBufferView_;
+    /// Version of the view batches stored in the instancing buffer.
+    unsigned instancingBufferBatchesVersion_{};
     /// Default material.
     SharedPtr<Material> defaultMaterial_;
     /// Default range attenuation texture.
@@ -533,6 +567,8 @@ private:
     ea::unordered_map<int, SharedPtr<Texture2D> > colorShadowMaps_;
     /// Shadow map allocations by resolution.
     ea::unordered_map<int, ea::vector<Light*> > shadowMapAllocations_;
+    /// Dedicated shadow maps of lights with shadow map caching.
+    ea::unordered_map<Light*, CachedShadowMap> cachedShadowMaps_;
     /// Instance of shadow map filter.
     Object* shadowMapFilterInstance_{};
     /// Function pointer of shadow map filter.
@@ -557,6 +593,10 @@ private:
     ea::hash_set<Technique*> shaderErrorDisplayed_;
     /// Mutex for shadow camera allocation.
     Mutex rendererMutex_;
+    /// Mutex for loading and releasing batch shaders from several threads.
+    Mutex batchShadersMutex_;
+    /// Whether a worker thread needed pass shaders that were not loaded yet.
+    bool batchShadersDeferred_{};
     /// Current variation names for deferred light volume shaders.
     ea::vector<ea::string> deferredLightPSVariations_;
     /// Global shader defines, sorted to reduce amount of variations.
@@ -0,0 +1,113 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Graphics/Camera.h"
+#include "../Graphics/Drawable.h"
+#include "../Graphics/ShadowMapCache.h"
+#include "../Graphics/Texture2D.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+namespace
+{
+
+/// Mix bits of 64-bit value so that sums of mixed values are unlikely to collide.
+unsigned long long MixHash(unsigned long long value)
+{
+    value ^= value >> 30u;
+    value *= 0xbf58476d1ce4e5b9ull;
+    value ^= value >> 27u;
+    value *= 0x94d049bb133111ebull;
+    value ^= value >> 31u;
+    return value;
+}
+
+/// Append value to ordered hash.
+void AppendHash(unsigned long long& hash, unsigned long long value)
+{
+    hash = MixHash(hash ^ (value + 0x9e3779b97f4a7c15ull + (hash << 6u) + (hash >> 2u)));
+}
+
+/// Append floats to ordered hash.
+void AppendHash(unsigned long long& hash, const float* data, unsigned count)
+{
+    for (unsigned i = 0; i < count; ++i)
+        AppendHash(hash, FloatToRawIntBits(data[i]));
+}
+
+}
+
+void ShadowSplitHash::AddCamera(const Camera* camera, const IntRect& viewport)
+{
+    AppendHash(stateHash_, camera->GetView().Data(), 12);
+    AppendHash(stateHash_, camera->GetProjection().Data(), 16);
+    AppendHash(stateHash_, (unsigned long long)(unsigned)viewport.left_ << 32u | (unsigned)viewport.top_);
+    AppendHash(stateHash_, (unsigned long long)(unsigned)viewport.right_ << 32u | (unsigned)viewport.bottom_);
+}
+
+void ShadowSplitHash::AddCaster(Drawable* drawable, unsigned frameNumber)
+{
+    unsigned long long hash = 0;
+    AppendHash(hash, (unsigned long long)(size_t)drawable);
+    AppendHash(hash, drawable->GetRevision());
+    if (drawable->GetUpdateGeometryType() != UPDATE_NONE)
+        AppendHash(hash, frameNumber);
+
+    for (const SourceBatch& batch : drawable->GetBatches())
+    {
+        AppendHash(hash, (unsigned long long)(size_t)batch.geometry_);
+        AppendHash(hash, (unsigned long long)(size_t)batch.material_.Get());
+        // Skinning matrices move in the skin matrix arena every frame. Skinning changes are caught by the update type
+        if (batch.skinMatrixOffset_ == M_MAX_UNSIGNED)
+            AppendHash(hash, (unsigned long long)(size_t)batch.worldTransform_);
+        AppendHash(hash, batch.numWorldTransforms_);
+    }
+
+    castersHash_ += MixHash(hash);
+    ++numCasters_;
+}
+
+void ShadowSplitHash::AddValue(unsigned long long value)
+{
+    AppendHash(stateHash_, value);
+}
+
+unsigned long long ShadowSplitHash::GetHash() const
+{
+    unsigned long long hash = stateHash_;
+    AppendHash(hash, castersHash_);
+    AppendHash(hash, numCasters_);
+    return hash;
+}
+
+bool CachedShadowMap::IsUpToDate(const ea::vector<unsigned long long>& splitHashes) const
+{
+    return texture_ && !texture_->IsDataLost() && !splitHashes_.empty() && splitHashes_ == splitHashes;
+}
+
+}
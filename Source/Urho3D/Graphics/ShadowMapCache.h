@@ -0,0 +1,84 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+/// \file
+
+#pragma once
+
+#include "../Container/Ptr.h"
+#include "../Math/Rect.h"
+
+#include <EASTL/vector.h>
+
+namespace Urho3D
+{
+
+class Camera;
+class Drawable;
+class Light;
+class Texture2D;
+
+/// Order-independent hash of everything that affects the contents of one shadow map split. Does not depend on GPU resources.
+class URHO3D_API ShadowSplitHash
+{
+public:
+    /// Add shadow camera view and projection and the shadow map viewport.
+    void AddCamera(const Camera* camera, const IntRect& viewport);
+    /// Add shadow caster. The order of casters does not matter. A caster which updates its geometry on this frame changes the hash on every frame.
+    void AddCaster(Drawable* drawable, unsigned frameNumber);
+    /// Add arbitrary value, such as the shadow map identity or depth bias.
+    void AddValue(unsigned long long value);
+
+    /// Return final hash.
+    unsigned long long GetHash() const;
+    /// Return number of added casters.
+    unsigned GetNumCasters() const { return numCasters_; }
+
+private:
+    /// Hash of camera and other ordered values.
+    unsigned long long stateHash_{};
+    /// Sum of individually mixed caster hashes.
+    unsigned long long castersHash_{};
+    /// Number of added casters.
+    unsigned numCasters_{};
+};
+
+/// Dedicated shadow map of a light with shadow map caching enabled.
+struct CachedShadowMap
+{
+    /// Return whether the contents match the given split hashes.
+    bool IsUpToDate(const ea::vector<unsigned long long>& splitHashes) const;
+
+    /// Light.
+    WeakPtr<Light> light_;
+    /// Shadow map texture.
+    SharedPtr<Texture2D> texture_;
+    /// Requested texture size. The actual size may be smaller if texture creation failed.
+    IntVector2 size_;
+    /// Split hashes of the rendered contents. Empty if the contents are not valid.
+    ea::vector<unsigned long long> splitHashes_;
+    /// Frame number when last used.
+    unsigned lastUsedFrame_{};
+};
+
+}
@@ -204,4 +204,83 @@ Bone* Skeleton::GetBone(const StringHash& boneNameHash)
     return index < bones_.size() ? &bones_[index] : nullptr;
 }
 
+void SkeletonPose::Reset(const Skeleton& skeleton)
+{
+    const ea::vector<Bone>& bones = skeleton.GetBones();
+    const unsigned numBones = bones.size();
+
+    if (hierarchyOrder_.size() != numBones)
+    {
+        positions_.resize(numBones);
+        rotations_.resize(numBones);
+        scales_.resize(numBones);
+
+        // Walk up from each bone until an already visited one, then append the chain in reverse
+        hierarchyOrder_.clear();
+        ea::vector<bool> visited(numBones, false);
+        ea::vector<unsigned> chain;
+        for (unsigned i = 0; i < numBones; ++i)
+        {
+            unsigned index = i;
+            while (index < numBones && !visited[index])
+            {
+                visited[index] = true;
+                chain.push_back(index);
+                index = bones[index].parentIndex_;
+            }
+            while (!chain.empty())
+            {
+                hierarchyOrder_.push_back(chain.back());
+                chain.pop_back();
+            }
+        }
+
+        boneDepths_.resize(numBones);
+        for (unsigned index : hierarchyOrder_)
+        {
+            const unsigned parentIndex = bones[index].parentIndex_;
+            const bool isRoot = parentIndex == index || parentIndex >= numBones;
+            boneDepths_[index] = isRoot ? 0 : boneDepths_[parentIndex] + 1;
+        }
+    }
+
+    for (unsigned i = 0; i < numBones; ++i)
+    {
+        const Bone& bone = bones[i];
+        if (bone.animated_ || !bone.node_)
+        {
+            positions_[i] = bone.initialPosition_;
+            rotations_[i] = bone.initialRotation_;
+            scales_[i] = bone.initialScale_;
+        }
+        else
+        {
+            positions_[i] = bone.node_->GetPosition();
+            rotations_[i] = bone.node_->GetRotation();
+            scales_[i] = bone.node_->GetScale();
+        }
+    }
+}
+
+void SkeletonPose::ApplySilent(const Skeleton& skeleton) const
+{
+    const ea::vector<Bone>& bones = skeleton.GetBones();
+    const unsigned numBones = Min(bones.size(), positions_.size());
+    for (unsigned i = 0; i < numBones; ++i)
+    {
+        const Bone& bone = bones[i];
+        if (bone.animated_ && bone.node_)
+            bone.node_->SetTransformSilent(positions_[i], rotations_[i], scales_[i]);
+    }
+}
+
+void SkeletonPose::Clear()
+{
+    positions_.clear();
+    rotations_.clear();
+    scales_.clear();
+    hierarchyOrder_.clear();
+    boneDepths_.clear();
+}
+
 }
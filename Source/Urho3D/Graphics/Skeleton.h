@@ -154,4 +154,27 @@ private:
     unsigned rootBoneIndex_;
 };
 
+/// Bone transforms of a skeleton stored in contiguous arrays. Used to evaluate and blend animations without touching
+/// the bone scene nodes, which are then updated in one pass.
+struct URHO3D_API SkeletonPose
+{
+    /// Set animated bones to their initial transforms and copy current transforms of the other bones from their nodes.
+    void Reset(const Skeleton& skeleton);
+    /// Write local transforms of animated bones to their scene nodes without marking them dirty.
+    void ApplySilent(const Skeleton& skeleton) const;
+    /// Clear all bone data.
+    void Clear();
+
+    /// Local bone positions.
+    ea::vector<Vector3> positions_;
+    /// Local bone rotations.
+    ea::vector<Quaternion> rotations_;
+    /// Local bone scales.
+    ea::vector<Vector3> scales_;
+    /// Bone indices ordered so that each parent precedes its children.
+    ea::vector<unsigned> hierarchyOrder_;
+    /// Bone depths in the hierarchy. Root bones have zero depth.
+    ea::vector<unsigned> boneDepths_;
+};
+
 }
@@ -0,0 +1,89 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Graphics/SkinMatrixArena.h"
+#include "../Math/MathDefs.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+SkinMatrixArena::~SkinMatrixArena()
+{
+    for (std::atomic<Matrix3x4*>& block : blocks_)
+        delete[] block.load(std::memory_order_relaxed);
+}
+
+void SkinMatrixArena::BeginFrame()
+{
+    numAllocated_.store(0, std::memory_order_relaxed);
+}
+
+unsigned SkinMatrixArena::Allocate(unsigned count)
+{
+    if (count > SKIN_MATRIX_BLOCK_SIZE)
+        return M_MAX_UNSIGNED;
+
+    // Ranges do not cross block boundaries, the rest of a block is skipped if the range does not fit
+    unsigned offset = numAllocated_.load(std::memory_order_relaxed);
+    unsigned beginOffset;
+    do
+    {
+        beginOffset = offset;
+        if (beginOffset % SKIN_MATRIX_BLOCK_SIZE + count > SKIN_MATRIX_BLOCK_SIZE)
+            beginOffset = (beginOffset / SKIN_MATRIX_BLOCK_SIZE + 1) * SKIN_MATRIX_BLOCK_SIZE;
+        if (beginOffset + count > SKIN_MATRIX_BLOCK_SIZE * MAX_SKIN_MATRIX_BLOCKS)
+            return M_MAX_UNSIGNED;
+    } while (!numAllocated_.compare_exchange_weak(offset, beginOffset + count, std::memory_order_relaxed));
+
+    GetOrCreateBlock(beginOffset / SKIN_MATRIX_BLOCK_SIZE);
+    return beginOffset;
+}
+
+unsigned SkinMatrixArena::GetNumMatrices() const
+{
+    return numAllocated_.load(std::memory_order_relaxed);
+}
+
+Matrix3x4* SkinMatrixArena::GetOrCreateBlock(unsigned index)
+{
+    Matrix3x4* block = blocks_[index].load(std::memory_order_acquire);
+    if (!block)
+    {
+        // Storage grows only until it fits the busiest frame
+        MutexLock lock(blockMutex_);
+        block = blocks_[index].load(std::memory_order_relaxed);
+        if (!block)
+        {
+            block = new Matrix3x4[SKIN_MATRIX_BLOCK_SIZE];
+            blocks_[index].store(block, std::memory_order_release);
+            numBlocks_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    return block;
+}
+
+}
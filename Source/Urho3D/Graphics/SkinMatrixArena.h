@@ -0,0 +1,89 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+/// \file
+
+#pragma once
+
+#include "../Core/Mutex.h"
+#include "../Math/Matrix3x4.h"
+
+#include <atomic>
+
+namespace Urho3D
+{
+
+/// Per-frame storage of skinning matrices. Skinned drawables allocate contiguous ranges from worker threads and their
+/// batches refer to the matrices by offset, so the bone palettes of the whole frame are packed in a few large blocks.
+/// Disabled by default: the built-in renderer uploads skinning matrices per batch, so packing them only adds copying.
+class URHO3D_API SkinMatrixArena
+{
+public:
+    /// Construct.
+    SkinMatrixArena() = default;
+    /// Destruct.
+    ~SkinMatrixArena();
+
+    /// Set whether skinned drawables allocate their matrices from the arena.
+    void SetEnabled(bool enable) { enabled_ = enable; }
+    /// Release all ranges. Call from the main thread.
+    void BeginFrame();
+    /// Allocate contiguous range of matrices within one block. Blocks are allocated on demand and kept for the next
+    /// frames. Return offset, or M_MAX_UNSIGNED if the range is larger than a block or all blocks are in use. Safe to
+    /// call from worker threads.
+    unsigned Allocate(unsigned count);
+
+    /// Return matrices at offset.
+    Matrix3x4* GetMatrices(unsigned offset) const
+    {
+        return blocks_[offset / SKIN_MATRIX_BLOCK_SIZE].load(std::memory_order_acquire) + offset % SKIN_MATRIX_BLOCK_SIZE;
+    }
+    /// Return whether skinned drawables allocate their matrices from the arena.
+    bool IsEnabled() const { return enabled_; }
+    /// Return end offset of the ranges allocated in the current frame, including the unused ends of the blocks.
+    unsigned GetNumMatrices() const;
+    /// Return number of matrices in the allocated blocks.
+    unsigned GetCapacity() const { return numBlocks_.load(std::memory_order_relaxed) * SKIN_MATRIX_BLOCK_SIZE; }
+
+    /// Number of matrices in one block.
+    static const unsigned SKIN_MATRIX_BLOCK_SIZE = 4096;
+    /// Maximum number of blocks.
+    static const unsigned MAX_SKIN_MATRIX_BLOCKS = 256;
+
+private:
+    /// Return block, allocate it if necessary.
+    Matrix3x4* GetOrCreateBlock(unsigned index);
+
+    /// Blocks. Kept until destruction, so that allocated ranges stay valid until the next BeginFrame().
+    std::atomic<Matrix3x4*> blocks_[MAX_SKIN_MATRIX_BLOCKS]{};
+    /// Number of allocated blocks.
+    std::atomic<unsigned> numBlocks_{};
+    /// Mutex for block allocation.
+    Mutex blockMutex_;
+    /// End offset of the ranges allocated in the current frame.
+    std::atomic<unsigned> numAllocated_{};
+    /// Enabled flag.
+    bool enabled_{};
+};
+
+}
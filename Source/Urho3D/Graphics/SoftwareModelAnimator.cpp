@@ -23,6 +23,7 @@
 #include "../Precompiled.h"
 
 #include "../Core/Context.h"
+#include "../Core/WorkQueue.h"
 #include "../IO/Log.h"
 #include "../Graphics/Geometry.h"
 #include "../Graphics/IndexBuffer.h"
@@ -31,6 +32,10 @@
 
 #include <EASTL/sort.h>
 
+#ifdef URHO3D_SSE
+#include <emmintrin.h>
+#endif
+
 #include "../DebugNew.h"
 
 namespace Urho3D
@@ -39,6 +44,97 @@ namespace Urho3D
 namespace
 {
 
+/// Minimum number of vertices skinned by one thread.
+const unsigned SKINNING_CHUNK_SIZE = 2048;
+
+#ifdef URHO3D_SSE
+/// Load three floats without reading past them.
+inline __m128 LoadVector3(const float* src)
+{
+    const __m128 xy = _mm_loadl_pi(_mm_setzero_ps(), reinterpret_cast<const __m64*>(src));
+    return _mm_movelh_ps(xy, _mm_load_ss(src + 2));
+}
+
+/// Store three floats without writing past them.
+inline void StoreVector3(float* dest, __m128 value)
+{
+    _mm_storel_pi(reinterpret_cast<__m64*>(dest), value);
+    _mm_store_ss(dest + 2, _mm_movehl_ps(value, value));
+}
+
+/// Transform direction by matrix columns.
+inline __m128 TransformDirection(const __m128 columns[3], const float* v)
+{
+    const __m128 x = _mm_mul_ps(columns[0], _mm_load1_ps(v));
+    const __m128 y = _mm_mul_ps(columns[1], _mm_load1_ps(v + 1));
+    const __m128 z = _mm_mul_ps(columns[2], _mm_load1_ps(v + 2));
+    return _mm_add_ps(_mm_add_ps(x, y), z);
+}
+
+/// Blend skinning matrix columns of one vertex.
+template <unsigned NumBones>
+inline void BlendColumns(__m128 columns[4], const unsigned char* indices, const float* weights, unsigned numBones,
+    const Vector4* matrixColumns)
+{
+    const unsigned count = NumBones ? NumBones : numBones;
+
+    const float* boneColumns = matrixColumns[indices[0] * 4].Data();
+    __m128 weight = _mm_load1_ps(weights);
+    for (unsigned i = 0; i < 4; ++i)
+        columns[i] = _mm_mul_ps(_mm_loadu_ps(boneColumns + i * 4), weight);
+
+    for (unsigned boneIndex = 1; boneIndex < count; ++boneIndex)
+    {
+        boneColumns = matrixColumns[indices[boneIndex] * 4].Data();
+        weight = _mm_load1_ps(weights + boneIndex);
+        for (unsigned i = 0; i < 4; ++i)
+            columns[i] = _mm_add_ps(columns[i], _mm_mul_ps(_mm_loadu_ps(boneColumns + i * 4), weight));
+    }
+}
+
+/// Skin range of vertices. Skinning matrices are blended column by column, so that the vertex elements
+/// can be transformed without transposing the blended matrix.
+template <bool SkinNormals, bool SkinTangents>
+void SkinVertices(unsigned char* vertexData, unsigned vertexSize, unsigned normalOffset, unsigned tangentOffset,
+    const unsigned char* indices, const float* weights, unsigned numBones, const Vector4* matrixColumns, unsigned count)
+{
+    for (unsigned vertexIndex = 0; vertexIndex < count; ++vertexIndex)
+    {
+        // Unroll the blending for the common case of four bones per vertex
+        __m128 columns[4];
+        if (numBones == SoftwareModelAnimator::MaxBones)
+            BlendColumns<SoftwareModelAnimator::MaxBones>(columns, indices, weights, numBones, matrixColumns);
+        else
+            BlendColumns<0>(columns, indices, weights, numBones, matrixColumns);
+
+        auto position = reinterpret_cast<float*>(vertexData);
+        StoreVector3(position, _mm_add_ps(TransformDirection(columns, position), columns[3]));
+
+        if (SkinNormals)
+        {
+            auto normal = reinterpret_cast<float*>(vertexData + normalOffset);
+            StoreVector3(normal, TransformDirection(columns, normal));
+        }
+
+        if (SkinTangents)
+        {
+            auto tangent = reinterpret_cast<float*>(vertexData + tangentOffset);
+            StoreVector3(tangent, TransformDirection(columns, tangent));
+        }
+
+        // Advance
+        indices += numBones;
+        weights += numBones;
+        vertexData += vertexSize;
+    }
+}
+
+/// Add weighted morph delta to three floats.
+inline void ApplyMorphDelta(float* dest, const float* src, __m128 weight)
+{
+    StoreVector3(dest, _mm_add_ps(LoadVector3(dest), _mm_mul_ps(LoadVector3(src), weight)));
+}
+#else
 Vector3 TransformNormal(const Matrix3x4& m, const Vector3& v)
 {
     return {
@@ -48,6 +144,49 @@ Vector3 TransformNormal(const Matrix3x4& m, const Vector3& v)
     };
 }
 
+/// Skin range of vertices.
+template <bool SkinNormals, bool SkinTangents>
+void SkinVertices(unsigned char* vertexData, unsigned vertexSize, unsigned normalOffset, unsigned tangentOffset,
+    const unsigned char* indices, const float* weights, unsigned numBones, const Matrix3x4* worldTransforms, unsigned count)
+{
+    Matrix3x4 matrix;
+    for (unsigned vertexIndex = 0; vertexIndex < count; ++vertexIndex)
+    {
+        matrix = worldTransforms[indices[0]] * weights[0];
+        for (unsigned boneIndex = 1; boneIndex < numBones; ++boneIndex)
+            matrix = matrix + worldTransforms[indices[boneIndex]] * weights[boneIndex];
+
+        Vector3& position = *reinterpret_cast<Vector3*>(vertexData);
+        position = matrix * position;
+
+        if (SkinNormals)
+        {
+            Vector3& normal = *reinterpret_cast<Vector3*>(vertexData + normalOffset);
+            normal = TransformNormal(matrix, normal);
+        }
+
+        if (SkinTangents)
+        {
+            Vector3& tangent = *reinterpret_cast<Vector3*>(vertexData + tangentOffset);
+            tangent = TransformNormal(matrix, tangent);
+        }
+
+        // Advance
+        indices += numBones;
+        weights += numBones;
+        vertexData += vertexSize;
+    }
+}
+
+/// Add weighted morph delta to three floats.
+inline void ApplyMorphDelta(float* dest, const float* src, float weight)
+{
+    dest[0] += src[0] * weight;
+    dest[1] += src[1] * weight;
+    dest[2] += src[2] * weight;
+}
+#endif
+
 }
 
 SoftwareModelAnimator::SoftwareModelAnimator(Context* context) : Object(context) {}
@@ -110,6 +249,21 @@ void SoftwareModelAnimator::ApplySkinning(ea::span<const Matrix3x4> worldTransfo
     if (!skinned_)
         return;
 
+#ifdef URHO3D_SSE
+    // Store skinning matrices by columns
+    skinMatrixColumns_.resize(worldTransforms.size() * 4);
+    for (unsigned i = 0; i < worldTransforms.size(); ++i)
+    {
+        const Matrix3x4& m = worldTransforms[i];
+        Vector4* columns = &skinMatrixColumns_[i * 4];
+        columns[0] = Vector4(m.m00_, m.m10_, m.m20_, 0.0f);
+        columns[1] = Vector4(m.m01_, m.m11_, m.m21_, 0.0f);
+        columns[2] = Vector4(m.m02_, m.m12_, m.m22_, 0.0f);
+        columns[3] = Vector4(m.m03_, m.m13_, m.m23_, 0.0f);
+    }
+#endif
+
+    auto* workQueue = GetSubsystem<WorkQueue>();
     for (unsigned bufferIndex = 0; bufferIndex < vertexBuffers_.size(); ++bufferIndex)
     {
         VertexBuffer* clonedBuffer = vertexBuffers_[bufferIndex];
@@ -117,68 +271,59 @@ void SoftwareModelAnimator::ApplySkinning(ea::span<const Matrix3x4> worldTransfo
         if (!clonedBuffer || !animationData.hasSkeletalAnimation_)
             continue;
 
-        if (!animationData.skinNormals_ && !animationData.skinTangents_)
-            ApplyVertexBufferSkinning<false, false>(clonedBuffer, animationData, worldTransforms);
-        else if (animationData.skinNormals_ && !animationData.skinTangents_)
-            ApplyVertexBufferSkinning<true, false>(clonedBuffer, animationData, worldTransforms);
-        else if (animationData.skinNormals_ && animationData.skinTangents_)
-            ApplyVertexBufferSkinning<true, true>(clonedBuffer, animationData, worldTransforms);
+        // Split large meshes between threads
+        const unsigned numVertices = clonedBuffer->GetVertexCount();
+        const auto applySkinning = [&](unsigned beginIndex, unsigned endIndex, unsigned)
+        {
+            ApplyVertexBufferSkinning(clonedBuffer, animationData, worldTransforms, beginIndex, endIndex);
+        };
+
+        if (workQueue)
+            workQueue->ParallelFor(numVertices, SKINNING_CHUNK_SIZE, applySkinning);
         else
-            ApplyVertexBufferSkinning<false, true>(clonedBuffer, animationData, worldTransforms); // this is really weird case
+            applySkinning(0, numVertices, 0);
     }
 }
 
-template <bool SkinNormals, bool SkinTangents>
 void SoftwareModelAnimator::ApplyVertexBufferSkinning(VertexBuffer* clonedBuffer, const VertexBufferAnimationData& animationData,
-    ea::span<const Matrix3x4> worldTransforms) const
+    ea::span<const Matrix3x4> worldTransforms, unsigned beginVertex, unsigned endVertex) const
 {
     const unsigned clonedVertexSize = clonedBuffer->GetVertexSize();
     const unsigned normalOffset = clonedBuffer->GetElementOffset(TYPE_VECTOR3, SEM_NORMAL);
     const unsigned tangentOffset = clonedBuffer->GetElementOffset(TYPE_VECTOR4, SEM_TANGENT);
 
-    unsigned char* clonedBufferData = clonedBuffer->GetShadowData();
-
-    unsigned char* positionsData = clonedBufferData;
-    unsigned char* normalsData = SkinNormals ? clonedBufferData + normalOffset : nullptr;
-    unsigned char* tangentsData = SkinTangents ? clonedBufferData + tangentOffset : nullptr;
+    unsigned char* vertexData = clonedBuffer->GetShadowData() + beginVertex * clonedVertexSize;
+    const unsigned char* indicesData = animationData.blendIndices_.data() + beginVertex * numBones_;
+    const float* weightsData = animationData.blendWeights_.data() + beginVertex * numBones_;
+    const unsigned count = endVertex - beginVertex;
 
-    const unsigned char* indicesData = animationData.blendIndices_.data();
-    const float* weightsData = animationData.blendWeights_.data();
+#ifdef URHO3D_SSE
+    const Vector4* transforms = skinMatrixColumns_.data();
+#else
+    const Matrix3x4* transforms = worldTransforms.data();
+#endif
 
-    const unsigned numVertices = clonedBuffer->GetVertexCount();
-    Matrix3x4 matrix;
-    for (unsigned vertexIndex = 0; vertexIndex < numVertices; ++vertexIndex)
+    if (!animationData.skinNormals_ && !animationData.skinTangents_)
     {
-        matrix = worldTransforms[indicesData[0]] * weightsData[0];
-        for (unsigned boneIndex = 1; boneIndex < numBones_; ++boneIndex)
-            matrix = matrix + worldTransforms[indicesData[boneIndex]] * weightsData[boneIndex];
-
-        Vector3& position = *reinterpret_cast<Vector3*>(positionsData);
-        position = matrix * position;
-
-        if (SkinNormals)
-        {
-            Vector3& normal = *reinterpret_cast<Vector3*>(normalsData);
-            normal = TransformNormal(matrix, normal);
-        }
-
-        if (SkinTangents)
-        {
-            Vector3& tangent = *reinterpret_cast<Vector3*>(tangentsData);
-            tangent = TransformNormal(matrix, tangent);
-        }
-
-        // Advance
-        indicesData += numBones_;
-        weightsData += numBones_;
-
-        positionsData += clonedVertexSize;
-        if (SkinNormals)
-            normalsData += clonedVertexSize;
-        if (SkinTangents)
-            tangentsData += clonedVertexSize;
+        SkinVertices<false, false>(vertexData, clonedVertexSize, normalOffset, tangentOffset,
+            indicesData, weightsData, numBones_, transforms, count);
+    }
+    else if (animationData.skinNormals_ && !animationData.skinTangents_)
+    {
+        SkinVertices<true, false>(vertexData, clonedVertexSize, normalOffset, tangentOffset,
+            indicesData, weightsData, numBones_, transforms, count);
+    }
+    else if (animationData.skinNormals_ && animationData.skinTangents_)
+    {
+        SkinVertices<true, true>(vertexData, clonedVertexSize, normalOffset, tangentOffset,
+            indicesData, weightsData, numBones_, transforms, count);
+    }
+    else
+    {
+        // this is really weird case
+        SkinVertices<false, true>(vertexData, clonedVertexSize, normalOffset, tangentOffset,
+            indicesData, weightsData, numBones_, transforms, count);
     }
-
 }
 
 void SoftwareModelAnimator::Commit()
@@ -445,6 +590,12 @@ void SoftwareModelAnimator::ApplyMorph(VertexBuffer* buffer, const VertexBufferM
     unsigned char* srcData = morph.morphData_.get();
     unsigned char* destData = buffer->GetShadowData();
 
+#ifdef URHO3D_SSE
+    const __m128 weightVec = _mm_set1_ps(weight);
+#else
+    const float weightVec = weight;
+#endif
+
     while (vertexCount--)
     {
         const unsigned vertexIndex = *reinterpret_cast<const unsigned*>(srcData);
@@ -453,28 +604,19 @@ void SoftwareModelAnimator::ApplyMorph(VertexBuffer* buffer, const VertexBufferM
         if (elementMask & MASK_POSITION)
         {
             auto dest = reinterpret_cast<float*>(destData + vertexIndex * vertexSize);
-            auto src = reinterpret_cast<const float*>(srcData);
-            dest[0] += src[0] * weight;
-            dest[1] += src[1] * weight;
-            dest[2] += src[2] * weight;
+            ApplyMorphDelta(dest, reinterpret_cast<const float*>(srcData), weightVec);
             srcData += 3 * sizeof(float);
         }
         if (elementMask & MASK_NORMAL)
         {
             auto dest = reinterpret_cast<float*>(destData + vertexIndex * vertexSize + normalOffset);
-            auto src = reinterpret_cast<const float*>(srcData);
-            dest[0] += src[0] * weight;
-            dest[1] += src[1] * weight;
-            dest[2] += src[2] * weight;
+            ApplyMorphDelta(dest, reinterpret_cast<const float*>(srcData), weightVec);
             srcData += 3 * sizeof(float);
         }
         if (elementMask & MASK_TANGENT)
         {
             auto dest = reinterpret_cast<float*>(destData + vertexIndex * vertexSize + tangentOffset);
-            auto src = reinterpret_cast<const float*>(srcData);
-            dest[0] += src[0] * weight;
-            dest[1] += src[1] * weight;
-            dest[2] += src[2] * weight;
+            ApplyMorphDelta(dest, reinterpret_cast<const float*>(srcData), weightVec);
             srcData += 3 * sizeof(float);
         }
     }
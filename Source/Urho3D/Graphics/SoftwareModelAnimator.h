@@ -91,10 +91,9 @@ private:
         VertexBuffer* destBuffer, VertexBuffer* srcBuffer) const;
     /// Apply a vertex buffer morph.
     void ApplyMorph(VertexBuffer* buffer, const VertexBufferMorph& morph, float weight);
-    /// Apply skinning for given vertex buffer.
-    template <bool SkinNormals, bool SkinTangents>
+    /// Apply skinning for given range of vertices in vertex buffer. Safe to call from worker thread.
     void ApplyVertexBufferSkinning(VertexBuffer* clonedBuffer, const VertexBufferAnimationData& animationData,
-        ea::span<const Matrix3x4> worldTransforms) const;
+        ea::span<const Matrix3x4> worldTransforms, unsigned beginVertex, unsigned endVertex) const;
 
     /// Original model.
     SharedPtr<Model> originalModel_;
@@ -109,6 +108,8 @@ private:
     unsigned numBones_{};
     /// Animation data for vertex buffers.
     ea::vector<VertexBufferAnimationData> vertexBuffersData_;
+    /// Skinning matrices stored by columns.
+    ea::vector<Vector4> skinMatrixColumns_;
 };
 
 }
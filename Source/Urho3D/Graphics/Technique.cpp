@@ -79,6 +79,7 @@ void Pass::SetDepthTestMode(CompareMode mode)
 void Pass::SetLightingMode(PassLightingMode mode)
 {
     lightingMode_ = mode;
+    ++shadersRevision_;
 }
 
 void Pass::SetDepthWrite(bool enable)
@@ -95,6 +96,7 @@ void Pass::SetAlphaToCoverage(bool enable)
 void Pass::SetIsDesktop(bool enable)
 {
     isDesktop_ = enable;
+    ++shadersRevision_;
 }
 
 void Pass::SetVertexShader(const ea::string& name)
@@ -139,6 +141,8 @@ void Pass::ReleaseShaders()
     pixelShaders_.clear();
     extraVertexShaders_.clear();
     extraPixelShaders_.clear();
+    baseShadersReadyFrameNumber_.store(M_MAX_UNSIGNED, std::memory_order_relaxed);
+    ++shadersRevision_;
 }
 
 void Pass::MarkShadersLoaded(unsigned frameNumber)
@@ -224,6 +228,7 @@ bool Technique::BeginLoad(Deserializer& source)
 {
     passes_.clear();
     cloneTechniques_.clear();
+    ++passesRevision_;
 
     SetMemoryUse(sizeof(Technique));
 
@@ -326,6 +331,7 @@ bool Technique::BeginLoad(Deserializer& source)
 void Technique::SetIsDesktop(bool enable)
 {
     isDesktop_ = enable;
+    ++passesRevision_;
 }
 
 void Technique::ReleaseShaders()
@@ -381,6 +387,7 @@ Pass* Technique::CreatePass(const ea::string& name)
     if (passIndex >= passes_.size())
         passes_.resize(passIndex + 1);
     passes_[passIndex] = newPass;
+    ++passesRevision_;
 
     // Calculate memory use now
     SetMemoryUse((unsigned)(sizeof(Technique) + GetNumPasses() * sizeof(Pass)));
@@ -396,6 +403,7 @@ void Technique::RemovePass(const ea::string& name)
     else if (i->second < passes_.size() && passes_[i->second].Get())
     {
         passes_[i->second].Reset();
+        ++passesRevision_;
         SetMemoryUse((unsigned)(sizeof(Technique) + GetNumPasses() * sizeof(Pass)));
     }
 }
@@ -28,6 +28,8 @@
 #include "../Graphics/GraphicsDefs.h"
 #include "../Resource/Resource.h"
 
+#include <atomic>
+
 namespace Urho3D
 {
 
@@ -114,6 +116,8 @@ public:
     void ReleaseShaders();
     /// Mark shaders loaded this frame.
     void MarkShadersLoaded(unsigned frameNumber);
+    /// Mark base shaders loaded for the specified frame, after which they may be read without locking until released.
+    void MarkBaseShadersReady(unsigned frameNumber) { baseShadersReadyFrameNumber_.store(frameNumber, std::memory_order_release); }
 
     /// Return pass name.
     const ea::string& GetName() const { return name_; }
@@ -136,6 +140,12 @@ public:
     /// Return last shaders loaded frame number.
     unsigned GetShadersLoadedFrameNumber() const { return shadersLoadedFrameNumber_; }
 
+    /// Return whether base shaders loaded for the specified frame are ready to be read without locking.
+    bool AreBaseShadersReady(unsigned frameNumber) const { return baseShadersReadyFrameNumber_.load(std::memory_order_acquire) == frameNumber; }
+
+    /// Return shaders revision. Incremented whenever shaders chosen for the pass may change.
+    unsigned GetShadersRevision() const { return shadersRevision_; }
+
     /// Return depth write mode.
     bool GetDepthWrite() const { return depthWrite_; }
 
@@ -191,6 +201,10 @@ private:
     PassLightingMode lightingMode_;
     /// Last shaders loaded frame number.
     unsigned shadersLoadedFrameNumber_;
+    /// Frame number for which base shaders are ready.
+    std::atomic<unsigned> baseShadersReadyFrameNumber_{M_MAX_UNSIGNED};
+    /// Shaders revision.
+    unsigned shadersRevision_{};
     /// Depth write mode.
     bool depthWrite_;
     /// Alpha-to-coverage mode.
@@ -284,6 +298,8 @@ public:
     ea::vector<ea::string> GetPassNames() const;
     /// Return all passes.
     ea::vector<Pass*> GetPasses() const;
+    /// Return passes revision. Incremented whenever passes are added or removed.
+    unsigned GetPassesRevision() const { return passesRevision_; }
 
     /// Return a clone with added shader compilation defines. Called internally by Material.
     SharedPtr<Technique> CloneWithDefines(const ea::string& vsDefines, const ea::string& psDefines);
@@ -315,6 +331,8 @@ private:
     bool desktopSupport_;
     /// Passes.
     ea::vector<SharedPtr<Pass> > passes_;
+    /// Passes revision.
+    unsigned passesRevision_{};
     /// Cached clones with added shader compilation defines.
     ea::unordered_map<ea::pair<StringHash, StringHash>, SharedPtr<Technique> > cloneTechniques_;
 
@@ -26,6 +26,7 @@
 
 #include "../Core/Context.h"
 #include "../Core/Profiler.h"
+#include "../Core/TaskGraph.h"
 #include "../Core/WorkQueue.h"
 #include "../Graphics/Camera.h"
 #include "../Graphics/DebugRenderer.h"
@@ -61,17 +62,84 @@
 namespace Urho3D
 {
 
-/// Update ambient for Drawable.
-static void UpdateBatchAmbient(Batch& destBatch, GlobalIllumination* gi, Drawable* drawable)
+/// Minimum number of drawables checked for visibility at once.
+static const unsigned CHECK_VISIBILITY_CHUNK_SIZE = 64;
+/// Minimum number of drawables whose geometry is updated at once.
+static const unsigned UPDATE_GEOMETRIES_CHUNK_SIZE = 16;
+/// Number of cached drawables kept regardless of the number of visible geometries.
+static const unsigned MIN_BATCH_CACHE_SIZE = 1024;
+
+/// Return whether any batch of the drawable uses light probes instead of a lightmap.
+static bool NeedsLightProbes(Drawable* drawable)
+{
+    for (const SourceBatch& batch : drawable->GetBatches())
+    {
+        if (!batch.lightmapScaleOffset_)
+            return true;
+    }
+    return false;
+}
+
+/// Sample light probes at once for geometries found by one visibility check work item. Geometries that were already
+/// sampled on this frame by another view are skipped.
+static void SampleLightProbes(GlobalIllumination* gi, PerThreadSceneResult& result, unsigned firstGeometry, unsigned frameNumber)
+{
+    result.lightProbeGeometries_.clear();
+    result.lightProbePositions_.clear();
+    result.lightProbeHints_.clear();
+    for (unsigned i = firstGeometry; i < result.geometries_.size(); ++i)
+    {
+        Drawable* drawable = result.geometries_[i];
+        if (drawable->GetLightProbeAmbientFrame() == frameNumber || !NeedsLightProbes(drawable))
+            continue;
+
+        result.lightProbeGeometries_.push_back(drawable);
+        result.lightProbePositions_.push_back(drawable->GetWorldBoundingBox().Center());
+        result.lightProbeHints_.push_back(drawable->GetMutableLightProbeTetrahedronHint());
+    }
+
+    if (result.lightProbeGeometries_.empty())
+        return;
+
+    result.lightProbeSamples_.resize(result.lightProbeGeometries_.size());
+#if URHO3D_SPHERICAL_HARMONICS
+    gi->SampleAmbientSH(result.lightProbePositions_, result.lightProbeHints_, result.lightProbeSamples_);
+#else
+    gi->SampleAverageAmbient(result.lightProbePositions_, result.lightProbeHints_, result.lightProbeSamples_);
+#endif
+
+    for (unsigned i = 0; i < result.lightProbeGeometries_.size(); ++i)
+    {
+        Drawable* drawable = result.lightProbeGeometries_[i];
+        drawable->GetMutableLightProbeTetrahedronHint() = result.lightProbeHints_[i];
+#if URHO3D_SPHERICAL_HARMONICS
+        drawable->SetLightProbeAmbient(result.lightProbeSamples_[i], frameNumber);
+#else
+        drawable->SetLightProbeAmbient(Vector4(result.lightProbeSamples_[i], 1.0f), frameNumber);
+#endif
+    }
+}
+
+/// Update ambient for Drawable. Light probe hint is not updated if the drawable may be processed by several threads at once.
+static void UpdateBatchAmbient(Batch& destBatch, GlobalIllumination* gi, Drawable* drawable, unsigned frameNumber,
+    bool updateHint = true)
 {
     if (gi && !destBatch.lightmapScaleOffset_)
     {
-        unsigned& hint = drawable->GetMutableLightProbeTetrahedronHint();
+        // Visible geometries are normally sampled already during the visibility check
+        if (drawable->GetLightProbeAmbientFrame() == frameNumber)
+        {
+            destBatch.shaderParameters_.ambient_ = drawable->GetLightProbeAmbient();
+            return;
+        }
+
+        unsigned localHint = drawable->GetMutableLightProbeTetrahedronHint();
+        unsigned& hint = updateHint ? drawable->GetMutableLightProbeTetrahedronHint() : localHint;
         const Vector3& samplePosition = drawable->GetWorldBoundingBox().Center();
 #if URHO3D_SPHERICAL_HARMONICS
         destBatch.shaderParameters_.ambient_ = gi->SampleAmbientSH(samplePosition, hint);
 #else
-        destBatch.shaderParameters_.ambient_ = gi->SampleAverageAmbient(samplePosition, hint);
+        destBatch.shaderParameters_.ambient_ = Vector4(gi->SampleAverageAmbient(samplePosition, hint), 1.0f);
 #endif
     }
 }
@@ -178,12 +246,9 @@ public:
     OcclusionBuffer* buffer_;
 };
 
-void CheckVisibilityWork(const WorkItem* item, unsigned threadIndex)
+void CheckVisibilityWork(View* view, Drawable** start, Drawable** end, unsigned threadIndex)
 {
     URHO3D_PROFILE("CheckVisibilityWork");
-    auto* view = reinterpret_cast<View*>(item->aux_);
-    auto** start = reinterpret_cast<Drawable**>(item->start_);
-    auto** end = reinterpret_cast<Drawable**>(item->end_);
     OcclusionBuffer* buffer = view->occlusionBuffer_;
     const Matrix3x4& viewMatrix = view->cullCamera_->GetView();
     Vector3 viewZ = Vector3(viewMatrix.m20_, viewMatrix.m21_, viewMatrix.m22_);
@@ -191,6 +256,7 @@ void CheckVisibilityWork(const WorkItem* item, unsigned threadIndex)
     unsigned cameraViewMask = view->cullCamera_->GetViewMask();
     bool cameraZoneOverride = view->cameraZoneOverride_;
     PerThreadSceneResult& result = view->sceneResults_[threadIndex];
+    const unsigned firstGeometry = result.geometries_.size();
 
     while (start != end)
     {
@@ -246,23 +312,14 @@ void CheckVisibilityWork(const WorkItem* item, unsigned threadIndex)
             }
         }
     }
-}
-
-void ProcessLightWork(const WorkItem* item, unsigned threadIndex)
-{
-    URHO3D_PROFILE("ProcessLightWork");
-    auto* view = reinterpret_cast<View*>(item->aux_);
-    auto* query = reinterpret_cast<LightQueryResult*>(item->start_);
 
-    view->ProcessLight(*query, threadIndex);
+    if (view->globalIllumination_)
+        SampleLightProbes(view->globalIllumination_, result, firstGeometry, view->frame_.frameNumber_);
 }
 
-void UpdateDrawableGeometriesWork(const WorkItem* item, unsigned threadIndex)
+void UpdateDrawableGeometries(Drawable** start, Drawable** end, const FrameInfo& frame)
 {
     URHO3D_PROFILE("UpdateDrawableGeometriesWork");
-    const FrameInfo& frame = *(reinterpret_cast<FrameInfo*>(item->aux_));
-    auto** start = reinterpret_cast<Drawable**>(item->start_);
-    auto** end = reinterpret_cast<Drawable**>(item->end_);
 
     while (start != end)
     {
@@ -273,36 +330,30 @@ void UpdateDrawableGeometriesWork(const WorkItem* item, unsigned threadIndex)
     }
 }
 
-void SortBatchQueueFrontToBackWork(const WorkItem* item, unsigned threadIndex)
+void SortBatchQueueFrontToBack(BatchQueue* queue)
 {
     URHO3D_PROFILE("SortBatchQueueFrontToBackWork");
-    auto* queue = reinterpret_cast<BatchQueue*>(item->start_);
-
     queue->SortFrontToBack();
 }
 
-void SortBatchQueueBackToFrontWork(const WorkItem* item, unsigned threadIndex)
+void SortBatchQueueBackToFront(BatchQueue* queue)
 {
     URHO3D_PROFILE("SortBatchQueueBackToFrontWork");
-    auto* queue = reinterpret_cast<BatchQueue*>(item->start_);
-
     queue->SortBackToFront();
 }
 
-void SortLightQueueWork(const WorkItem* item, unsigned threadIndex)
+void SortLightQueue(LightBatchQueue* queue)
 {
     URHO3D_PROFILE("SortLightQueueWork");
-    auto* start = reinterpret_cast<LightBatchQueue*>(item->start_);
-    start->litBaseBatches_.SortFrontToBack();
-    start->litBatches_.SortFrontToBack();
+    queue->litBaseBatches_.SortFrontToBack();
+    queue->litBatches_.SortFrontToBack();
 }
 
-void SortShadowQueueWork(const WorkItem* item, unsigned threadIndex)
+void SortShadowQueue(LightBatchQueue* queue)
 {
     URHO3D_PROFILE("SortShadowQueueWork");
-    auto* start = reinterpret_cast<LightBatchQueue*>(item->start_);
-    for (unsigned i = 0; i < start->shadowSplits_.size(); ++i)
-        start->shadowSplits_[i].shadowBatches_.SortFrontToBack();
+    for (unsigned i = 0; i < queue->shadowSplits_.size(); ++i)
+        queue->shadowSplits_[i].shadowBatches_.SortFrontToBack();
 }
 
 StringHash ParseTextureTypeXml(ResourceCache* cache, const ea::string& filename);
@@ -310,12 +361,21 @@ StringHash ParseTextureTypeXml(ResourceCache* cache, const ea::string& filename)
 View::View(Context* context) :
     Object(context),
     graphics_(GetSubsystem<Graphics>()),
-    renderer_(GetSubsystem<Renderer>())
+    renderer_(GetSubsystem<Renderer>()),
+    updateGeometriesTasks_(ea::make_unique<TaskGraph>(GetSubsystem<WorkQueue>()))
 {
     // Create octree query and scene results vector for each thread
     unsigned numThreads = GetSubsystem<WorkQueue>()->GetNumThreads() + 1; // Worker threads + main thread
     tempDrawables_.resize(numThreads);
     sceneResults_.resize(numThreads);
+    for (unsigned i = 0; i < numThreads; ++i)
+        frameAllocators_.push_back(ea::make_unique<LinearAllocator>());
+}
+
+View::~View()
+{
+    // Batch queues may still reference memory of the frame allocators
+    ResetFrameAllocators();
 }
 
 void View::RegisterObject(Context* context)
@@ -478,6 +538,22 @@ bool View::Define(RenderSurface* renderTarget, Viewport* viewport)
             lightPassIndex_ = command.passIndex_ = Technique::GetPassIndex(command.pass_);
     }
 
+    // Cached base batches refer to scene passes by index, drop them if scene passes change
+    unsigned scenePassesHash = scenePasses_.size();
+    for (const ScenePassInfo& info : scenePasses_)
+    {
+        const BatchQueue& queue = *info.batchQueue_;
+        CombineHash(scenePassesHash, info.passIndex_);
+        CombineHash(scenePassesHash, info.allowInstancing_ | (info.markToStencil_ << 1u) | (info.vertexLights_ << 2u));
+        CombineHash(scenePassesHash, queue.hasExtraDefines_ ? queue.vsExtraDefinesHash_.Value() : 0);
+        CombineHash(scenePassesHash, queue.hasExtraDefines_ ? queue.psExtraDefinesHash_.Value() : 0);
+    }
+    if (scenePassesHash != batchCacheScenePassesHash_)
+    {
+        batchCache_.clear();
+        batchCacheScenePassesHash_ = scenePassesHash;
+    }
+
     octree_ = nullptr;
     globalIllumination_ = nullptr;
     // Get default zone first in case we do not have zones defined
@@ -576,8 +652,12 @@ void View::Update(const FrameInfo& frame)
     occluders_.clear();
     activeOccluders_ = 0;
     vertexLightQueues_.clear();
+    ResetFrameAllocators();
     for (auto i = batchQueues_.begin(); i != batchQueues_.end(); ++i)
+    {
         i->second.Clear(maxSortedInstances);
+        i->second.SetAllocator(frameAllocators_[0].get());
+    }
 
     if (hasScenePasses_ && (!cullCamera_ || !octree_))
     {
@@ -591,6 +671,7 @@ void View::Update(const FrameInfo& frame)
 
     GetDrawables();
     GetBatches();
+    ++batchesVersion_;
     renderer_->StorePreparedView(this, cullCamera_);
 
     SendViewEvent(E_ENDVIEWUPDATE);
@@ -712,6 +793,22 @@ View* View::GetSourceView() const
     return sourceView_;
 }
 
+size_t View::GetFrameAllocatorUsedSize() const
+{
+    size_t size = 0;
+    for (const auto& allocator : frameAllocators_)
+        size += allocator->GetUsedSize();
+    return size;
+}
+
+size_t View::GetFrameAllocatorPeakSize() const
+{
+    size_t size = 0;
+    for (const auto& allocator : frameAllocators_)
+        size += allocator->GetPeakUsedSize();
+    return size;
+}
+
 void View::SetGlobalShaderParameters()
 {
     graphics_->SetShaderParameter(VSP_DELTATIME, frame_.timeStep_);
@@ -879,6 +976,12 @@ void View::GetDrawables()
     if (farClipZone_ == renderer_->GetDefaultZone())
         farClipZone_ = cameraZone_;
 
+    // Index zones for the drawable zone queries in the visibility check. Not needed if the camera zone overrides them
+    if (!cameraZoneOverride_)
+        zoneIndex_.Define(zones_, BoundingBox(cullCamera_->GetFrustum()));
+    else
+        zoneIndex_.Clear();
+
     // If occlusion in use, get & render the occluders
     occlusionBuffer_ = nullptr;
     if (maxOccluderTriangles_ > 0)
@@ -920,30 +1023,11 @@ void View::GetDrawables()
             result.maxZ_ = 0.0f;
         }
 
-        int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-        int drawablesPerItem = tempDrawables.size() / numWorkItems;
-
-        auto start = tempDrawables.begin();
-        // Create a work item for each thread
-        for (int i = 0; i < numWorkItems; ++i)
+        queue->ParallelFor(tempDrawables.size(), CHECK_VISIBILITY_CHUNK_SIZE,
+            [&](unsigned beginIndex, unsigned endIndex, unsigned threadIndex)
         {
-            SharedPtr<WorkItem> item = queue->GetFreeItem();
-            item->priority_ = M_MAX_UNSIGNED;
-            item->workFunction_ = CheckVisibilityWork;
-            item->aux_ = this;
-
-            auto end = tempDrawables.end();
-            if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                end = start + drawablesPerItem;
-
-            item->start_ = &(*start);
-            item->end_ = &(*end);
-            queue->AddWorkItem(item);
-
-            start = end;
-        }
-
-        queue->Complete(M_MAX_UNSIGNED);
+            CheckVisibilityWork(this, tempDrawables.data() + beginIndex, tempDrawables.data() + endIndex, threadIndex);
+        });
     }
 
     // Combine lights, geometries & scene Z range from the threads
@@ -989,6 +1073,8 @@ void View::GetDrawables()
 
 void View::GetBatches()
 {
+    lightClustersValid_ = false;
+
     if (!octree_ || !cullCamera_)
         return;
 
@@ -1009,21 +1095,15 @@ void View::ProcessLights()
     lightQueryResults_.resize(lights_.size());
 
     for (unsigned i = 0; i < lightQueryResults_.size(); ++i)
-    {
-        SharedPtr<WorkItem> item = queue->GetFreeItem();
-        item->priority_ = M_MAX_UNSIGNED;
-        item->workFunction_ = ProcessLightWork;
-        item->aux_ = this;
-
-        LightQueryResult& query = lightQueryResults_[i];
-        query.light_ = lights_[i];
-
-        item->start_ = &query;
-        queue->AddWorkItem(item);
-    }
+        lightQueryResults_[i].light_ = lights_[i];
 
-    // Ensure all lights have been processed before proceeding
-    queue->Complete(M_MAX_UNSIGNED);
+    // Light processing cost varies a lot, so let each light be a separate chunk
+    queue->ParallelFor(lightQueryResults_.size(), 1, [&](unsigned beginIndex, unsigned endIndex, unsigned threadIndex)
+    {
+        URHO3D_PROFILE("ProcessLightWork");
+        for (unsigned i = beginIndex; i < endIndex; ++i)
+            ProcessLight(lightQueryResults_[i], threadIndex);
+    });
 }
 
 void View::GetLightBatches()
@@ -1045,12 +1125,15 @@ void View::GetLightBatches()
         }
 
         lightQueues_.resize(numLightQueues);
+        lightBatchQueries_.clear();
         maxLightsDrawables_.clear();
         auto maxSortedInstances = (unsigned)renderer_->GetMaxSortedInstances();
 
+        // Set up light queues and record lights in drawables in light order, then build batches for each light in parallel
         for (auto i = lightQueryResults_.begin(); i != lightQueryResults_.end(); ++i)
         {
             LightQueryResult& query = *i;
+            query.litAlphaBatches_.clear();
 
             // If light has no affected geometries, no need to process further
             if (query.litGeometries_.empty())
@@ -1069,6 +1152,8 @@ void View::GetLightBatches()
                 lightQueue.light_ = light;
                 lightQueue.negative_ = light->IsNegative();
                 lightQueue.shadowMap_ = nullptr;
+                lightQueue.shadowSplitHashes_.clear();
+                lightQueue.shadowMapUpToDate_ = false;
                 lightQueue.litBaseBatches_.Clear(maxSortedInstances);
                 lightQueue.litBatches_.Clear(maxSortedInstances);
                 if (forwardLightsCommand_)
@@ -1092,10 +1177,12 @@ void View::GetLightBatches()
                         shadowSplits = 0;
                 }
 
-                // Setup shadow batch queues
+                // Setup shadow batch queues. For cached shadow maps, hash everything that affects the shadow map contents
+                const bool shadowMapCached = light->IsShadowMapCached();
                 lightQueue.shadowSplits_.resize(shadowSplits);
                 for (unsigned j = 0; j < shadowSplits; ++j)
                 {
+                    ShadowSplitHash splitHash;
                     ShadowBatchQueue& shadowQueue = lightQueue.shadowSplits_[j];
                     Camera* shadowCamera = query.shadowCameras_[j];
                     shadowQueue.shadowCamera_ = shadowCamera;
@@ -1106,12 +1193,23 @@ void View::GetLightBatches()
                     // Setup the shadow split viewport and finalize shadow camera parameters
                     shadowQueue.shadowViewport_ = GetShadowMapViewport(light, j, lightQueue.shadowMap_);
                     FinalizeShadowCamera(shadowCamera, light, shadowQueue.shadowViewport_, query.shadowCasterBox_[j]);
+                    if (shadowMapCached)
+                    {
+                        const BiasParameters& bias = light->GetShadowBias();
+                        splitHash.AddValue((unsigned long long)(size_t)lightQueue.shadowMap_);
+                        splitHash.AddValue(FloatToRawIntBits(bias.constantBias_));
+                        splitHash.AddValue(FloatToRawIntBits(bias.slopeScaledBias_));
+                        splitHash.AddValue(FloatToRawIntBits(renderer_->GetShadowSoftness()));
+                        splitHash.AddCamera(shadowCamera, shadowQueue.shadowViewport_);
+                    }
 
                     // Loop through shadow casters
                     for (auto k = query.shadowCasters_.begin() + query.shadowCasterBegin_[j];
                          k < query.shadowCasters_.begin() + query.shadowCasterEnd_[j]; ++k)
                     {
                         Drawable* drawable = *k;
+                        if (shadowMapCached)
+                            splitHash.AddCaster(drawable, frame_.frameNumber_);
                         // If drawable is not in actual view frustum, mark it in view here and check its geometry update type
                         if (!drawable->IsInView(frame_, true))
                         {
@@ -1122,32 +1220,17 @@ void View::GetLightBatches()
                             else if (type == UPDATE_WORKER_THREAD)
                                 threadedGeometries_.push_back(drawable);
                         }
-
-                        const ea::vector<SourceBatch>& batches = drawable->GetBatches();
-
-                        for (unsigned l = 0; l < batches.size(); ++l)
-                        {
-                            const SourceBatch& srcBatch = batches[l];
-
-                            Technique* tech = GetTechnique(drawable, srcBatch.material_);
-                            if (!srcBatch.geometry_ || !srcBatch.numWorldTransforms_ || !tech)
-                                continue;
-
-                            Pass* pass = tech->GetSupportedPass(Technique::shadowPassIndex);
-                            // Skip if material has no shadow pass
-                            if (!pass)
-                                continue;
-
-                            Batch destBatch(srcBatch);
-                            destBatch.pass_ = pass;
-                            destBatch.zone_ = nullptr;
-
-                            AddBatchToQueue(shadowQueue.shadowBatches_, destBatch, tech);
-                        }
                     }
+
+                    if (shadowMapCached)
+                        lightQueue.shadowSplitHashes_.push_back(splitHash.GetHash());
                 }
 
-                // Process lit geometries
+                // If nothing has changed since the cached shadow map was last rendered, skip shadow batches and rendering
+                if (!lightQueue.shadowSplitHashes_.empty())
+                    lightQueue.shadowMapUpToDate_ = renderer_->IsShadowMapUpToDate(light, lightQueue.shadowSplitHashes_);
+
+                // Record lit geometries
                 for (auto j = query.litGeometries_.begin(); j !=
                     query.litGeometries_.end(); ++j)
                 {
@@ -1155,9 +1238,7 @@ void View::GetLightBatches()
                     drawable->AddLight(light);
 
                     // If drawable limits maximum lights, only record the light, and check maximum count / build batches later
-                    if (!drawable->GetMaxLights())
-                        GetLitBatches(drawable, lightQueue, alphaQueue);
-                    else
+                    if (drawable->GetMaxLights())
                         maxLightsDrawables_.insert(drawable);
                 }
 
@@ -1180,6 +1261,8 @@ void View::GetLightBatches()
                         lightVolumeCommand_->pixelShaderDefines_);
                     lightQueue.volumeBatches_.push_back(volumeBatch);
                 }
+
+                lightBatchQueries_.push_back(&query);
             }
             // Per-vertex light
             else
@@ -1193,6 +1276,38 @@ void View::GetLightBatches()
                 }
             }
         }
+
+        // Each light only writes to its own queues. Lit transparent batches are kept aside and added in light order
+        auto* queue = GetSubsystem<WorkQueue>();
+        queue->ParallelFor(lightBatchQueries_.size(), 1, [&](unsigned beginIndex, unsigned endIndex, unsigned threadIndex)
+        {
+            URHO3D_PROFILE("GetLightBatchesWork");
+            for (unsigned i = beginIndex; i < endIndex; ++i)
+                GetLightQueryBatches(*lightBatchQueries_[i], alphaQueue != nullptr, threadIndex);
+        });
+
+        // Worker threads can not load shaders and leave batches of passes without loaded shaders incomplete. This only
+        // happens when shaders have changed, so build the light batches again on the main thread, which loads them
+        if (renderer_->ResetBatchShadersDeferred())
+        {
+            URHO3D_PROFILE("GetLightBatchesLoadShaders");
+            for (LightQueryResult* query : lightBatchQueries_)
+            {
+                LightBatchQueue& lightQueue = *query->light_->GetLightQueue();
+                lightQueue.litBaseBatches_.Clear(maxSortedInstances);
+                lightQueue.litBatches_.Clear(maxSortedInstances);
+                for (ShadowBatchQueue& shadowQueue : lightQueue.shadowSplits_)
+                    shadowQueue.shadowBatches_.Clear(maxSortedInstances);
+                query->litAlphaBatches_.clear();
+                GetLightQueryBatches(*query, alphaQueue != nullptr, 0);
+            }
+        }
+
+        if (alphaQueue)
+        {
+            for (LightQueryResult* query : lightBatchQueries_)
+                AddLitAlphaBatches(*alphaQueue, query->litAlphaBatches_);
+        }
     }
 
     // Process drawables with limited per-pixel light count
@@ -1212,16 +1327,101 @@ void View::GetLightBatches()
                 // Find the correct light queue again
                 LightBatchQueue* queue = light->GetLightQueue();
                 if (queue)
-                    GetLitBatches(drawable, *queue, alphaQueue);
+                    GetLitBatches(drawable, *queue, alphaQueue ? &maxLightsAlphaBatches_ : nullptr);
+            }
+
+            if (alphaQueue)
+                AddLitAlphaBatches(*alphaQueue, maxLightsAlphaBatches_);
+        }
+    }
+}
+
+void View::GetLightQueryBatches(LightQueryResult& query, bool useAlphaQueue, unsigned threadIndex)
+{
+    Light* light = query.light_;
+    LightBatchQueue& lightQueue = *light->GetLightQueue();
+    const unsigned numShadowSplits = lightQueue.shadowMapUpToDate_ ? 0 : lightQueue.shadowSplits_.size();
+
+    // Instanced batch groups of this light are allocated from the frame allocator of the current thread
+    LinearAllocator* allocator = frameAllocators_[threadIndex].get();
+    lightQueue.litBaseBatches_.SetAllocator(allocator);
+    lightQueue.litBatches_.SetAllocator(allocator);
+    for (ShadowBatchQueue& shadowQueue : lightQueue.shadowSplits_)
+        shadowQueue.shadowBatches_.SetAllocator(allocator);
+
+    for (unsigned i = 0; i < numShadowSplits; ++i)
+    {
+        ShadowBatchQueue& shadowQueue = lightQueue.shadowSplits_[i];
+        for (auto j = query.shadowCasters_.begin() + query.shadowCasterBegin_[i];
+             j < query.shadowCasters_.begin() + query.shadowCasterEnd_[i]; ++j)
+        {
+            Drawable* drawable = *j;
+            const ea::vector<SourceBatch>& batches = drawable->GetBatches();
+
+            for (unsigned k = 0; k < batches.size(); ++k)
+            {
+                const SourceBatch& srcBatch = batches[k];
+
+                Technique* tech = GetTechnique(drawable, srcBatch.material_);
+                if (!srcBatch.geometry_ || !srcBatch.numWorldTransforms_ || !tech)
+                    continue;
+
+                Pass* pass = tech->GetSupportedPass(Technique::shadowPassIndex);
+                // Skip if material has no shadow pass
+                if (!pass)
+                    continue;
+
+                Batch destBatch(srcBatch);
+                destBatch.pass_ = pass;
+                destBatch.zone_ = nullptr;
+
+                AddBatchToQueue(shadowQueue.shadowBatches_, destBatch, tech);
             }
         }
     }
+
+    for (auto i = query.litGeometries_.begin(); i != query.litGeometries_.end(); ++i)
+    {
+        Drawable* drawable = *i;
+        if (!drawable->GetMaxLights())
+            GetLitBatches(drawable, lightQueue, useAlphaQueue ? &query.litAlphaBatches_ : nullptr);
+    }
+}
+
+void View::AddLitAlphaBatches(BatchQueue& alphaQueue, ea::vector<PendingLitAlphaBatch>& batches)
+{
+    // Transparent batches can not be instanced, and shadows on transparencies can only be rendered if shadow maps are
+    // not reused
+    const bool allowShadows = !renderer_->GetReuseShadowMaps();
+    for (PendingLitAlphaBatch& pendingBatch : batches)
+        AddBatchToQueue(alphaQueue, pendingBatch.batch_, pendingBatch.technique_, false, allowShadows);
+    batches.clear();
+}
+
+void View::ResetFrameAllocators()
+{
+    for (auto i = batchQueues_.begin(); i != batchQueues_.end(); ++i)
+        i->second.SetAllocator(nullptr);
+
+    for (LightBatchQueue& lightQueue : lightQueues_)
+    {
+        lightQueue.litBaseBatches_.SetAllocator(nullptr);
+        lightQueue.litBatches_.SetAllocator(nullptr);
+        for (ShadowBatchQueue& shadowQueue : lightQueue.shadowSplits_)
+            shadowQueue.shadowBatches_.SetAllocator(nullptr);
+    }
+
+    for (const auto& allocator : frameAllocators_)
+        allocator->Reset();
 }
 
 void View::GetBaseBatches()
 {
     URHO3D_PROFILE("GetBaseBatches");
 
+    numBatchCacheHits_ = 0;
+    numBatchCacheMisses_ = 0;
+
     for (auto i = geometries_.begin(); i != geometries_.end(); ++i)
     {
         Drawable* drawable = *i;
@@ -1232,18 +1432,60 @@ void View::GetBaseBatches()
             threadedGeometries_.push_back(drawable);
 
         const ea::vector<SourceBatch>& batches = drawable->GetBatches();
+
+        // Check here if the material refers to a rendertarget texture with camera(s) attached
+        // Only check this for backbuffer views (null rendertarget)
+        if (!renderTarget_)
+        {
+            for (const SourceBatch& srcBatch : batches)
+            {
+                if (srcBatch.material_ && srcBatch.material_->GetAuxViewFrameNumber() != frame_.frameNumber_)
+                    CheckMaterialForAuxView(srcBatch.material_);
+            }
+        }
+
+        // Vertex lights change from frame to frame, so such drawables are never cached
+        DrawableBatchCache* cache = nullptr;
+        if (drawable->GetVertexLights().empty())
+        {
+            cache = &batchCache_[drawable];
+            cache->frameNumber_ = frame_.frameNumber_;
+            if (cache->drawable_.Get() == drawable && IsBatchCacheValid(drawable, *cache))
+            {
+                AddCachedBaseBatches(drawable, *cache);
+                ++numBatchCacheHits_;
+                continue;
+            }
+
+            Zone* zone = GetZone(drawable);
+            const auto lightMask = (unsigned char)GetLightMask(drawable);
+            cache->drawable_ = drawable;
+            cache->zone_ = zone;
+            cache->heightFog_ = zone->GetHeightFog();
+            cache->lightMask_ = lightMask;
+            cache->zoneLightMask_ = (unsigned char)zone->GetLightMask();
+            cache->sourceBatches_.clear();
+            cache->batches_.clear();
+        }
+        ++numBatchCacheMisses_;
+
         bool vertexLightsProcessed = false;
 
         for (unsigned j = 0; j < batches.size(); ++j)
         {
             const SourceBatch& srcBatch = batches[j];
 
-            // Check here if the material refers to a rendertarget texture with camera(s) attached
-            // Only check this for backbuffer views (null rendertarget)
-            if (srcBatch.material_ && srcBatch.material_->GetAuxViewFrameNumber() != frame_.frameNumber_ && !renderTarget_)
-                CheckMaterialForAuxView(srcBatch.material_);
-
             Technique* tech = GetTechnique(drawable, srcBatch.material_);
+            if (cache)
+            {
+                CachedSourceBatch& cachedBatch = cache->sourceBatches_.push_back();
+                cachedBatch.geometry_ = srcBatch.geometry_;
+                cachedBatch.material_ = srcBatch.material_;
+                cachedBatch.technique_ = tech;
+                cachedBatch.passesRevision_ = tech ? tech->GetPassesRevision() : 0;
+                cachedBatch.geometryType_ = srcBatch.geometryType_;
+                cachedBatch.hasTransforms_ = srcBatch.numWorldTransforms_ != 0;
+            }
             if (!srcBatch.geometry_ || !srcBatch.numWorldTransforms_ || !tech)
                 continue;
 
@@ -1251,18 +1493,20 @@ void View::GetBaseBatches()
             for (unsigned k = 0; k < scenePasses_.size(); ++k)
             {
                 ScenePassInfo& info = scenePasses_[k];
-                // Skip forward base pass if the corresponding litbase pass already exists
-                if (info.passIndex_ == basePassIndex_ && j < 32 && drawable->HasBasePass(j))
-                    continue;
-
                 Pass* pass = tech->GetSupportedPass(info.passIndex_);
                 if (!pass)
                     continue;
 
+                // Skip forward base pass if the corresponding litbase pass already exists
+                // Cached batch is still prepared because the litbase pass may be unavailable in the next frames
+                const bool skipBasePass = info.passIndex_ == basePassIndex_ && j < 32 && drawable->HasBasePass(j);
+                if (skipBasePass && !cache)
+                    continue;
+
                 Batch destBatch(srcBatch);
                 destBatch.pass_ = pass;
                 destBatch.zone_ = GetZone(drawable);
-                UpdateBatchAmbient(destBatch, globalIllumination_, drawable);
+                UpdateBatchAmbient(destBatch, globalIllumination_, drawable, frame_.frameNumber_);
                 destBatch.isBase_ = true;
                 destBatch.lightMask_ = (unsigned char)GetLightMask(drawable);
 
@@ -1302,10 +1546,126 @@ void View::GetBaseBatches()
                 if (allowInstancing && info.markToStencil_ && destBatch.lightMask_ != (destBatch.zone_->GetLightMask() & 0xffu))
                     allowInstancing = false;
 
-                AddBatchToQueue(*info.batchQueue_, destBatch, tech, allowInstancing);
+                PrepareBatch(*info.batchQueue_, destBatch, tech, allowInstancing, true);
+                if (cache)
+                    cache->batches_.push_back(CachedBaseBatch{j, k, pass->GetShadersRevision(), destBatch});
+                if (!skipBasePass)
+                    AddPreparedBatchToQueue(*info.batchQueue_, destBatch, tech, true);
             }
         }
     }
+
+    // Drop cached batches of drawables that are no longer visible
+    if (batchCache_.size() > 2 * geometries_.size() + MIN_BATCH_CACHE_SIZE)
+    {
+        for (auto i = batchCache_.begin(); i != batchCache_.end();)
+        {
+            if (i->second.frameNumber_ != frame_.frameNumber_)
+                i = batchCache_.erase(i);
+            else
+                ++i;
+        }
+    }
+}
+
+bool View::IsBatchCacheValid(Drawable* drawable, const DrawableBatchCache& cache)
+{
+    Zone* zone = GetZone(drawable);
+    if (cache.zone_ != zone || cache.heightFog_ != zone->GetHeightFog() || cache.lightMask_ != (unsigned char)GetLightMask(drawable)
+        || cache.zoneLightMask_ != (unsigned char)zone->GetLightMask())
+        return false;
+
+    const ea::vector<SourceBatch>& batches = drawable->GetBatches();
+    if (cache.sourceBatches_.size() != batches.size())
+        return false;
+
+    for (unsigned i = 0; i < batches.size(); ++i)
+    {
+        const SourceBatch& srcBatch = batches[i];
+        const CachedSourceBatch& cachedBatch = cache.sourceBatches_[i];
+        if (cachedBatch.geometry_ != srcBatch.geometry_ || cachedBatch.material_ != srcBatch.material_
+            || cachedBatch.geometryType_ != srcBatch.geometryType_ || cachedBatch.hasTransforms_ != (srcBatch.numWorldTransforms_ != 0)
+            || cachedBatch.technique_.Get() != GetTechnique(drawable, srcBatch.material_))
+            return false;
+        if (cachedBatch.technique_ && cachedBatch.technique_->GetPassesRevision() != cachedBatch.passesRevision_)
+            return false;
+    }
+
+    // Shaders may have been reloaded or changed
+    const unsigned shadersChangedFrameNumber = renderer_->GetShadersChangedFrameNumber();
+    for (const CachedBaseBatch& cachedBatch : cache.batches_)
+    {
+        const Pass* pass = cachedBatch.batch_.pass_;
+        if (pass->GetShadersLoadedFrameNumber() != shadersChangedFrameNumber || pass->GetShadersRevision() != cachedBatch.shadersRevision_)
+            return false;
+    }
+
+    return true;
+}
+
+void View::AddCachedBaseBatches(Drawable* drawable, const DrawableBatchCache& cache)
+{
+    const ea::vector<SourceBatch>& batches = drawable->GetBatches();
+    for (const CachedBaseBatch& cachedBatch : cache.batches_)
+    {
+        const unsigned j = cachedBatch.sourceIndex_;
+        ScenePassInfo& info = scenePasses_[cachedBatch.scenePassIndex_];
+        if (info.passIndex_ == basePassIndex_ && j < 32 && drawable->HasBasePass(j))
+            continue;
+
+        // Only per-frame data is taken from the source batch
+        Batch destBatch(batches[j]);
+        destBatch.sortKey_ = cachedBatch.batch_.sortKey_;
+        destBatch.isBase_ = true;
+        destBatch.lightMask_ = cache.lightMask_;
+        destBatch.material_ = cachedBatch.batch_.material_;
+        destBatch.zone_ = cache.zone_;
+        destBatch.pass_ = cachedBatch.batch_.pass_;
+        destBatch.vertexShader_ = cachedBatch.batch_.vertexShader_;
+        destBatch.pixelShader_ = cachedBatch.batch_.pixelShader_;
+        destBatch.geometryType_ = cachedBatch.batch_.geometryType_;
+        UpdateBatchAmbient(destBatch, globalIllumination_, drawable, frame_.frameNumber_);
+
+        AddPreparedBatchToQueue(*info.batchQueue_, destBatch, cache.sourceBatches_[j].technique_, true);
+    }
+}
+
+void View::UpdateLightClusters()
+{
+    if (lightClustersValid_)
+        return;
+
+    URHO3D_PROFILE("UpdateLightClusters");
+    lightClustersValid_ = true;
+
+    clusterLights_.clear();
+    clusterLightSpheres_.clear();
+    clusterLightData_.clear();
+
+    // Directional lights affect all clusters and are not included
+    const Matrix3x4& view = camera_->GetView();
+    for (Light* light : lights_)
+    {
+        const LightType lightType = light->GetLightType();
+        if (light->GetPerVertex() || lightType == LIGHT_DIRECTIONAL)
+            continue;
+
+        Node* lightNode = light->GetNode();
+        const Vector3 position = lightNode->GetWorldPosition();
+        const Vector3 direction = lightNode->GetWorldDirection();
+        const float range = light->GetRange();
+        const Color color = light->GetEffectiveColor();
+        const float spotCutoff = lightType == LIGHT_SPOT ? Cos(light->GetFov() * 0.5f) : -2.0f;
+
+        clusterLights_.push_back(light);
+        clusterLightSpheres_.emplace_back(view * position, range);
+        clusterLightData_.emplace_back(position, range > 0.0f ? 1.0f / range : 0.0f);
+        clusterLightData_.emplace_back(color.r_, color.g_, color.b_, light->GetSpecularIntensity());
+        clusterLightData_.emplace_back(direction, spotCutoff);
+    }
+
+    lightClusters_.Define(camera_->GetViewSpaceFrustum(), camera_->IsOrthographic());
+    lightClusters_.AssignLights(clusterLightSpheres_, GetSubsystem<WorkQueue>());
 }
 
 void View::UpdateGeometries()
@@ -1320,6 +1680,21 @@ void View::UpdateGeometries()
     URHO3D_PROFILE("SortAndUpdateGeometry");
 
     auto* queue = GetSubsystem<WorkQueue>();
+    TaskGraph& tasks = *updateGeometriesTasks_;
+    tasks.Clear();
+
+    // Lock the instancing buffer up front, so that the instances of each queue are written as soon as it is sorted
+    void* instancingData = renderer_->GetDynamicInstancing() && graphics_->GetInstancingSupport() ? LockInstancingBuffer() : nullptr;
+    instancingQueueSortTasks_.clear();
+    instancingQueueSortTasks_.resize(instancingData ? instancingQueues_.size() : 0, M_MAX_UNSIGNED);
+    const auto setInstancingQueueSortTask = [this](const BatchQueue& queue, TaskHandle sortTask)
+    {
+        for (unsigned i = 0; i < instancingQueueSortTasks_.size(); ++i)
+        {
+            if (instancingQueues_[i] == &queue)
+                instancingQueueSortTasks_[i] = sortTask;
+        }
+    };
 
     // Sort batches
     {
@@ -1331,34 +1706,49 @@ void View::UpdateGeometries()
 
             if (command.type_ == CMD_SCENEPASS)
             {
-                SharedPtr<WorkItem> item = queue->GetFreeItem();
-                item->priority_ = M_MAX_UNSIGNED;
-                item->workFunction_ =
-                    command.sortMode_ == SORT_FRONTTOBACK ? SortBatchQueueFrontToBackWork : SortBatchQueueBackToFrontWork;
-                item->start_ = &batchQueues_[command.passIndex_];
-                queue->AddWorkItem(item);
+                BatchQueue* batchQueue = &batchQueues_[command.passIndex_];
+                TaskHandle sortTask;
+                if (command.sortMode_ == SORT_FRONTTOBACK)
+                    sortTask = tasks.AddTask([batchQueue](unsigned) { SortBatchQueueFrontToBack(batchQueue); });
+                else
+                    sortTask = tasks.AddTask([batchQueue](unsigned) { SortBatchQueueBackToFront(batchQueue); });
+                setInstancingQueueSortTask(*batchQueue, sortTask);
             }
         }
 
         for (auto i = lightQueues_.begin(); i != lightQueues_.end(); ++i)
         {
-            SharedPtr<WorkItem> lightItem = queue->GetFreeItem();
-            lightItem->priority_ = M_MAX_UNSIGNED;
-            lightItem->workFunction_ = SortLightQueueWork;
-            lightItem->start_ = &(*i);
-            queue->AddWorkItem(lightItem);
+            LightBatchQueue* lightQueue = &(*i);
+            const TaskHandle sortTask = tasks.AddTask([lightQueue](unsigned) { SortLightQueue(lightQueue); });
+            setInstancingQueueSortTask(i->litBaseBatches_, sortTask);
+            setInstancingQueueSortTask(i->litBatches_, sortTask);
 
             if (i->shadowSplits_.size())
             {
-                SharedPtr<WorkItem> shadowItem = queue->GetFreeItem();
-                shadowItem->priority_ = M_MAX_UNSIGNED;
-                shadowItem->workFunction_ = SortShadowQueueWork;
-                shadowItem->start_ = &(*i);
-                queue->AddWorkItem(shadowItem);
+                const TaskHandle shadowSortTask = tasks.AddTask([lightQueue](unsigned) { SortShadowQueue(lightQueue); });
+                for (ShadowBatchQueue& shadowSplit : i->shadowSplits_)
+                    setInstancingQueueSortTask(shadowSplit.shadowBatches_, shadowSortTask);
             }
         }
     }
 
+    // Fill instancing buffer ranges of the sorted queues. Queues write disjoint ranges
+    if (instancingData)
+    {
+        const unsigned stride = renderer_->GetInstancingBuffer()->GetVertexSize();
+        for (unsigned i = 0; i < instancingQueues_.size(); ++i)
+        {
+            const TaskHandle fillTask = tasks.AddTask([this, i, instancingData, stride](unsigned)
+            {
+                URHO3D_PROFILE("SetInstancingData");
+                unsigned freeIndex = instancingQueueOffsets_[i];
+                instancingQueues_[i]->SetInstancingData(instancingData, stride, freeIndex);
+            });
+            if (instancingQueueSortTasks_[i] != M_MAX_UNSIGNED)
+                tasks.AddDependency(fillTask, instancingQueueSortTasks_[i]);
+        }
+    }
+
     // Update geometries. Split into threaded and non-threaded updates.
     {
         if (threadedGeometries_.size())
@@ -1375,40 +1765,34 @@ void View::UpdateGeometries()
                 }
             }
 
-            int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-            int drawablesPerItem = threadedGeometries_.size() / numWorkItems;
-
-            auto start = threadedGeometries_.begin();
-            for (int i = 0; i < numWorkItems; ++i)
+            tasks.AddTask([this, queue](unsigned)
             {
-                auto end = threadedGeometries_.end();
-                if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                    end = start + drawablesPerItem;
-
-                SharedPtr<WorkItem> item = queue->GetFreeItem();
-                item->priority_ = M_MAX_UNSIGNED;
-                item->workFunction_ = UpdateDrawableGeometriesWork;
-                item->aux_ = const_cast<FrameInfo*>(&frame_);
-                item->start_ = &(*start);
-                item->end_ = &(*end);
-                queue->AddWorkItem(item);
-
-                start = end;
-            }
+                queue->ParallelFor(threadedGeometries_.size(), UPDATE_GEOMETRIES_CHUNK_SIZE,
+                    [this](unsigned beginIndex, unsigned endIndex, unsigned)
+                {
+                    Drawable** geometries = threadedGeometries_.data();
+                    UpdateDrawableGeometries(geometries + beginIndex, geometries + endIndex, frame_);
+                });
+            });
         }
 
+        tasks.Run();
+
         // While the work queue is processed, update non-threaded geometries
         for (auto i = nonThreadedGeometries_.begin(); i !=
             nonThreadedGeometries_.end(); ++i)
             (*i)->UpdateGeometry(frame_);
     }
 
-    // Finally ensure all threaded work has completed
-    queue->Complete(M_MAX_UNSIGNED);
+    // Finally ensure all threaded work has completed. Unrelated work in the queue is not waited for
+    tasks.Wait();
     geometriesUpdated_ = true;
+
+    if (instancingData)
+        UnlockInstancingBuffer();
 }
 
-void View::GetLitBatches(Drawable* drawable, LightBatchQueue& lightQueue, BatchQueue* alphaQueue)
+void View::GetLitBatches(Drawable* drawable, LightBatchQueue& lightQueue, ea::vector<PendingLitAlphaBatch>* alphaBatches)
 {
     Light* light = lightQueue.light_;
     Zone* zone = GetZone(drawable);
@@ -1463,7 +1847,7 @@ void View::GetLitBatches(Drawable* drawable, LightBatchQueue& lightQueue, BatchQ
 
         destBatch.lightQueue_ = &lightQueue;
         destBatch.zone_ = zone;
-        UpdateBatchAmbient(destBatch, globalIllumination_, drawable);
+        UpdateBatchAmbient(destBatch, globalIllumination_, drawable, frame_.frameNumber_, false);
 
         if (!isLitAlpha)
         {
@@ -1472,12 +1856,8 @@ void View::GetLitBatches(Drawable* drawable, LightBatchQueue& lightQueue, BatchQ
             else
                 AddBatchToQueue(lightQueue.litBatches_, destBatch, tech);
         }
-        else if (alphaQueue)
-        {
-            // Transparent batches can not be instanced, and shadows on transparencies can only be rendered if shadow maps are
-            // not reused
-            AddBatchToQueue(*alphaQueue, destBatch, tech, false, !renderer_->GetReuseShadowMaps());
-        }
+        else if (alphaBatches)
+            alphaBatches->push_back(PendingLitAlphaBatch{destBatch, tech});
     }
 }
 
@@ -1787,7 +2167,7 @@ void View::SetRenderTargets(RenderPathCommand& command)
             {
                 useColorWrite = false;
                 useCustomDepth = true;
-#if !defined(URHO3D_OPENGL) && !defined(URHO3D_D3D11)
+#ifdef URHO3D_D3D9
                 // On D3D9 actual depth-only rendering is illegal, we need a color rendertarget
                 if (!depthOnlyDummyTexture_)
                 {
@@ -2386,8 +2766,8 @@ void View::ProcessLight(LightQueryResult& query, unsigned threadIndex)
         const Frustum& shadowCameraFrustum = shadowCamera->GetFrustum();
         query.shadowCasterBegin_[i] = query.shadowCasterEnd_[i] = query.shadowCasters_.size();
 
-        // For point light check that the face is visible: if not, can skip the split
-        if (type == LIGHT_POINT && frustum.IsInsideFast(BoundingBox(shadowCameraFrustum)) == OUTSIDE)
+        // For point light check that the face is visible: if not, can skip the split. Cached shadow maps need all faces
+        if (type == LIGHT_POINT && !light->IsShadowMapCached() && frustum.IsInsideFast(BoundingBox(shadowCameraFrustum)) == OUTSIDE)
             continue;
 
         // For directional light check that the split is inside the visible scene: if not, can skip the split
@@ -2423,6 +2803,8 @@ void View::ProcessShadowCasters(LightQueryResult& query, const ea::vector<Drawab
     const Matrix3x4& lightView = shadowCamera->GetView();
     const Matrix4& lightProj = shadowCamera->GetProjection();
     LightType type = light->GetLightType();
+    // Cached shadow maps must not depend on the view, so include casters outside the view frustum
+    const bool shadowMapCached = light->IsShadowMapCached();
 
     query.shadowCasterBox_[splitIndex].Clear();
 
@@ -2439,7 +2821,7 @@ void View::ProcessShadowCasters(LightQueryResult& query, const ea::vector<Drawab
     BoundingBox lightViewFrustumBox(lightViewFrustum);
 
     // Check for degenerate split frustum: in that case there is no need to get shadow casters
-    if (lightViewFrustum.vertices_[0] == lightViewFrustum.vertices_[4])
+    if (!shadowMapCached && lightViewFrustum.vertices_[0] == lightViewFrustum.vertices_[4])
         return;
 
     BoundingBox lightViewBox;
@@ -2474,7 +2856,8 @@ void View::ProcessShadowCasters(LightQueryResult& query, const ea::vector<Drawab
         // Project shadow caster bounding box to light view space for visibility check
         lightViewBox = drawable->GetWorldBoundingBox().Transformed(lightView);
 
-        if (IsShadowCasterVisible(drawable, lightViewBox, shadowCamera, lightView, lightViewFrustum, lightViewFrustumBox))
+        if (shadowMapCached ||
+            IsShadowCasterVisible(drawable, lightViewBox, shadowCamera, lightView, lightViewFrustum, lightViewFrustumBox))
         {
             // Merge to shadow caster bounding box (only needed for focused spot lights) and add to the list
             if (type == LIGHT_SPOT && light->GetShadowFocus().focus_)
@@ -2817,7 +3200,6 @@ void View::QuantizeDirLightShadowCamera(Camera* shadowCamera, Light* light, cons
 void View::FindZone(Drawable* drawable)
 {
     Vector3 center = drawable->GetWorldBoundingBox().Center();
-    int bestPriority = M_MIN_INT;
     Zone* newZone = nullptr;
 
     // If bounding box center is in view, the zone assignment is conclusive also for next frames. Otherwise it is temporary
@@ -2831,18 +3213,7 @@ void View::FindZone(Drawable* drawable)
         (drawable->GetZoneMask() & lastZone->GetZoneMask()) && lastZone->IsInside(center))
         newZone = lastZone;
     else
-    {
-        for (auto i = zones_.begin(); i != zones_.end(); ++i)
-        {
-            Zone* zone = *i;
-            int priority = zone->GetPriority();
-            if (priority > bestPriority && (drawable->GetZoneMask() & zone->GetZoneMask()) && zone->IsInside(center))
-            {
-                newZone = zone;
-                bestPriority = priority;
-            }
-        }
-    }
+        newZone = zoneIndex_.FindZone(center, drawable->GetZoneMask());
 
     drawable->SetZone(newZone, temporary);
 }
@@ -2933,6 +3304,12 @@ void View::SetQueueShaderDefines(BatchQueue& queue, const RenderPathCommand& com
 }
 
 void View::AddBatchToQueue(BatchQueue& queue, Batch& batch, Technique* tech, bool allowInstancing, bool allowShadows)
+{
+    PrepareBatch(queue, batch, tech, allowInstancing, allowShadows);
+    AddPreparedBatchToQueue(queue, batch, tech, allowShadows);
+}
+
+void View::PrepareBatch(BatchQueue& queue, Batch& batch, Technique* tech, bool allowInstancing, bool allowShadows)
 {
     if (!batch.material_)
         batch.material_ = renderer_->GetDefaultMaterial();
@@ -2941,6 +3318,16 @@ void View::AddBatchToQueue(BatchQueue& queue, Batch& batch, Technique* tech, boo
     if (allowInstancing && batch.geometryType_ == GEOM_STATIC && batch.geometry_->GetIndexBuffer())
         batch.geometryType_ = GEOM_INSTANCED;
 
+    // Instanced batches get their shaders when added to a group
+    if (batch.geometryType_ != GEOM_INSTANCED)
+    {
+        renderer_->SetBatchShaders(batch, tech, allowShadows, queue);
+        batch.CalculateSortKey();
+    }
+}
+
+void View::AddPreparedBatchToQueue(BatchQueue& queue, Batch& batch, Technique* tech, bool allowShadows)
+{
     if (batch.geometryType_ == GEOM_INSTANCED)
     {
         BatchGroupKey key(batch);
@@ -2950,7 +3337,7 @@ void View::AddBatchToQueue(BatchQueue& queue, Batch& batch, Technique* tech, boo
         {
             // Create a new group based on the batch
             // In case the group remains below the instancing limit, do not enable instancing shaders yet
-            BatchGroup newGroup(batch);
+            BatchGroup newGroup(batch, queue.batchGroups_.get_allocator());
             newGroup.geometryType_ = GEOM_STATIC;
             renderer_->SetBatchShaders(newGroup, tech, allowShadows, queue);
             newGroup.CalculateSortKey();
@@ -2969,9 +3356,6 @@ void View::AddBatchToQueue(BatchQueue& queue, Batch& batch, Technique* tech, boo
     }
     else
     {
-        renderer_->SetBatchShaders(batch, tech, allowShadows, queue);
-        batch.CalculateSortKey();
-
         // If batch is static with multiple world transforms and cannot instance, we must push copies of the batch individually
         if (batch.geometryType_ == GEOM_STATIC && batch.numWorldTransforms_ > 1)
         {
@@ -2992,50 +3376,77 @@ void View::AddBatchToQueue(BatchQueue& queue, Batch& batch, Technique* tech, boo
 void View::PrepareInstancingBuffer()
 {
     // Prepare instancing buffer from the source view
-    /// \todo If rendering the same view several times back-to-back, would not need to refill the buffer
     if (sourceView_)
     {
         sourceView_->PrepareInstancingBuffer();
         return;
     }
 
+    // Normally filled during the geometry update. Refill if another view has used the buffer since
+    void* dest = LockInstancingBuffer();
+    if (!dest)
+        return;
+
     URHO3D_PROFILE("PrepareInstancingBuffer");
 
+    // Queues write disjoint ranges of the buffer
+    const unsigned stride = renderer_->GetInstancingBuffer()->GetVertexSize();
+    GetSubsystem<WorkQueue>()->ParallelFor(instancingQueues_.size(), 1,
+        [&](unsigned beginIndex, unsigned endIndex, unsigned /*threadIndex*/)
+    {
+        URHO3D_PROFILE("SetInstancingData");
+        for (unsigned i = beginIndex; i < endIndex; ++i)
+        {
+            unsigned freeIndex = instancingQueueOffsets_[i];
+            instancingQueues_[i]->SetInstancingData(dest, stride, freeIndex);
+        }
+    });
+
+    UnlockInstancingBuffer();
+}
+
+void* View::LockInstancingBuffer()
+{
+    // If rendering the same view several times back-to-back, do not refill the buffer
+    if (renderer_->IsInstancingBufferSource(this, batchesVersion_))
+        return nullptr;
+
+    // Assign instancing buffer range to each queue
+    instancingQueues_.clear();
+    instancingQueueOffsets_.clear();
     unsigned totalInstances = 0;
+    const auto addQueue = [&](BatchQueue& queue)
+    {
+        const unsigned numInstances = queue.GetNumInstances();
+        if (numInstances)
+        {
+            instancingQueues_.push_back(&queue);
+            instancingQueueOffsets_.push_back(totalInstances);
+            totalInstances += numInstances;
+        }
+    };
 
     for (auto i = batchQueues_.begin(); i != batchQueues_.end(); ++i)
-        totalInstances += i->second.GetNumInstances();
+        addQueue(i->second);
 
     for (auto i = lightQueues_.begin(); i != lightQueues_.end(); ++i)
     {
         for (unsigned j = 0; j < i->shadowSplits_.size(); ++j)
-            totalInstances += i->shadowSplits_[j].shadowBatches_.GetNumInstances();
-        totalInstances += i->litBaseBatches_.GetNumInstances();
-        totalInstances += i->litBatches_.GetNumInstances();
+            addQueue(i->shadowSplits_[j].shadowBatches_);
+        addQueue(i->litBaseBatches_);
+        addQueue(i->litBatches_);
     }
 
     if (!totalInstances || !renderer_->ResizeInstancingBuffer(totalInstances))
-        return;
-
-    VertexBuffer* instancingBuffer = renderer_->GetInstancingBuffer();
-    unsigned freeIndex = 0;
-    void* dest = instancingBuffer->Lock(0, totalInstances, true);
-    if (!dest)
-        return;
-
-    const unsigned stride = instancingBuffer->GetVertexSize();
-    for (auto i = batchQueues_.begin(); i != batchQueues_.end(); ++i)
-        i->second.SetInstancingData(dest, stride, freeIndex);
+        return nullptr;
 
-    for (auto i = lightQueues_.begin(); i != lightQueues_.end(); ++i)
-    {
-        for (unsigned j = 0; j < i->shadowSplits_.size(); ++j)
-            i->shadowSplits_[j].shadowBatches_.SetInstancingData(dest, stride, freeIndex);
-        i->litBaseBatches_.SetInstancingData(dest, stride, freeIndex);
-        i->litBatches_.SetInstancingData(dest, stride, freeIndex);
-    }
+    return renderer_->GetInstancingBuffer()->Lock(0, totalInstances, true);
+}
 
-    instancingBuffer->Unlock();
+void View::UnlockInstancingBuffer()
+{
+    renderer_->GetInstancingBuffer()->Unlock();
+    renderer_->SetInstancingBufferSource(this, batchesVersion_);
 }
 
 void View::SetupLightVolumeBatch(Batch& batch)
@@ -3089,8 +3500,8 @@ void View::SetupLightVolumeBatch(Batch& batch)
 
 bool View::NeedRenderShadowMap(const LightBatchQueue& queue)
 {
-    // Must have a shadow map, and either forward or deferred lit batches
-    return queue.shadowMap_ && (!queue.litBatches_.IsEmpty() || !queue.litBaseBatches_.IsEmpty() ||
+    // Must have a shadow map which is not cached from earlier frames, and either forward or deferred lit batches
+    return queue.shadowMap_ && !queue.shadowMapUpToDate_ && (!queue.litBatches_.IsEmpty() || !queue.litBaseBatches_.IsEmpty() ||
         !queue.volumeBatches_.empty());
 }
 
@@ -3174,6 +3585,9 @@ void View::RenderShadowMap(const LightBatchQueue& queue)
     // reset some parameters
     graphics_->SetColorWrite(true);
     graphics_->SetDepthBias(0.0f, 0.0f);
+
+    if (!queue.shadowSplitHashes_.empty())
+        renderer_->SetShadowMapRendered(queue.light_, queue.shadowSplitHashes_);
 }
 
 RenderSurface* View::GetDepthStencil(RenderSurface* renderTarget)
@@ -27,7 +27,9 @@
 #include "../Core/Object.h"
 #include "../Graphics/Batch.h"
 #include "../Graphics/Light.h"
+#include "../Graphics/LightClusters.h"
 #include "../Graphics/Zone.h"
+#include "../Graphics/ZoneIndex.h"
 #include "../Math/Polyhedron.h"
 
 namespace Urho3D
@@ -43,6 +45,7 @@ class OcclusionBuffer;
 class Octree;
 class Renderer;
 class RenderPath;
+class TaskGraph;
 class RenderSurface;
 class Technique;
 class Texture;
@@ -50,7 +53,15 @@ class Texture2D;
 class Viewport;
 class Zone;
 struct RenderPathCommand;
-struct WorkItem;
+
+/// Lit transparent batch waiting to be added to the alpha batch queue.
+struct PendingLitAlphaBatch
+{
+    /// Batch.
+    Batch batch_;
+    /// Technique.
+    Technique* technique_{};
+};
 
 /// Intermediate light processing result.
 struct LightQueryResult
@@ -73,6 +84,8 @@ struct LightQueryResult
     float shadowNearSplits_[MAX_LIGHT_SPLITS];
     /// Shadow camera far splits (directional lights only).
     float shadowFarSplits_[MAX_LIGHT_SPLITS];
+    /// Lit transparent batches. Added to the alpha batch queue in light order.
+    ea::vector<PendingLitAlphaBatch> litAlphaBatches_;
     /// Shadow map split count.
     unsigned numSplits_;
 };
@@ -92,6 +105,57 @@ struct ScenePassInfo
     BatchQueue* batchQueue_;
 };
 
+/// Source batch state that cached base batches were prepared for.
+struct CachedSourceBatch
+{
+    /// Geometry.
+    Geometry* geometry_{};
+    /// Material.
+    Material* material_{};
+    /// Technique chosen for the material.
+    SharedPtr<Technique> technique_;
+    /// Passes revision of the technique.
+    unsigned passesRevision_{};
+    /// %Geometry type.
+    GeometryType geometryType_{};
+    /// Whether the source batch has any world transforms.
+    bool hasTransforms_{};
+};
+
+/// Base batch prepared for one source batch and scene pass.
+struct CachedBaseBatch
+{
+    /// Source batch index.
+    unsigned sourceIndex_{};
+    /// Scene pass info index.
+    unsigned scenePassIndex_{};
+    /// Shaders revision of the pass when shaders were chosen.
+    unsigned shadersRevision_{};
+    /// Batch with pass, material, geometry type, shaders and sort key assigned.
+    Batch batch_;
+};
+
+/// Base batches of a drawable reused by the view while the drawable does not change.
+struct DrawableBatchCache
+{
+    /// Drawable.
+    WeakPtr<Drawable> drawable_;
+    /// Last frame number when the cache was used.
+    unsigned frameNumber_{};
+    /// Zone.
+    Zone* zone_{};
+    /// Zone height fog flag.
+    bool heightFog_{};
+    /// Light mask.
+    unsigned char lightMask_{};
+    /// Zone light mask, decides whether batches marked to stencil can be instanced.
+    unsigned char zoneLightMask_{};
+    /// Source batch states.
+    ea::vector<CachedSourceBatch> sourceBatches_;
+    /// Prepared base batches.
+    ea::vector<CachedBaseBatch> batches_;
+};
+
 /// Per-thread geometry, light and scene range collection structure.
 struct PerThreadSceneResult
 {
@@ -103,6 +167,19 @@ struct PerThreadSceneResult
     float minZ_;
     /// Scene maximum Z value.
     float maxZ_;
+    /// Geometries whose light probes are sampled. Scratch buffer.
+    ea::vector<Drawable*> lightProbeGeometries_;
+    /// Light probe sample positions. Scratch buffer.
+    ea::vector<Vector3> lightProbePositions_;
+    /// Light probe tetrahedron hints. Scratch buffer.
+    ea::vector<unsigned> lightProbeHints_;
+#if URHO3D_SPHERICAL_HARMONICS
+    /// Sampled light probe ambient. Scratch buffer.
+    ea::vector<SphericalHarmonicsDot9> lightProbeSamples_;
+#else
+    /// Sampled light probe ambient. Scratch buffer.
+    ea::vector<Vector3> lightProbeSamples_;
+#endif
 };
 
 static const unsigned MAX_VIEWPORT_TEXTURES = 2;
@@ -110,8 +187,7 @@ static const unsigned MAX_VIEWPORT_TEXTURES = 2;
 /// Internal structure for 3D rendering work. Created for each backbuffer and texture viewport, but not for shadow cameras.
 class URHO3D_API View : public Object
 {
-    friend void CheckVisibilityWork(const WorkItem* item, unsigned threadIndex);
-    friend void ProcessLightWork(const WorkItem* item, unsigned threadIndex);
+    friend void CheckVisibilityWork(View* view, Drawable** start, Drawable** end, unsigned threadIndex);
 
     URHO3D_OBJECT(View, Object);
 
@@ -119,7 +195,7 @@ public:
     /// Construct.
     explicit View(Context* context);
     /// Destruct.
-    ~View() override = default;
+    ~View() override;
 
     /// Register object with the engine.
     static void RegisterObject(Context* context);
@@ -186,6 +262,30 @@ public:
     /// Return number of occluders that were actually rendered. Occluders may be rejected if running out of triangles or if behind other occluders.
     unsigned GetNumActiveOccluders() const { return activeOccluders_; }
 
+    /// Assign per-pixel point and spot lights to clusters for custom clustered forward rendering, if not done yet since the last update.
+    /// Built-in render paths use per-light batches and do not need the clusters, so they are only computed on demand.
+    void UpdateLightClusters();
+    /// Return light clusters. Valid after UpdateLightClusters().
+    const LightClusters& GetLightClusters() const { return lightClusters_; }
+
+    /// Return lights referenced by light clusters.
+    const ea::vector<Light*>& GetClusterLights() const { return clusterLights_; }
+
+    /// Return packed parameters of lights referenced by light clusters.
+    /// Each light takes three vectors: world position and inverse range, color and specular intensity, direction and spot cutoff.
+    const ea::vector<Vector4>& GetClusterLightData() const { return clusterLightData_; }
+
+    /// Return number of drawables whose base batches were reused from the previous frames.
+    unsigned GetNumBatchCacheHits() const { return numBatchCacheHits_; }
+
+    /// Return number of drawables whose base batches were prepared from scratch.
+    unsigned GetNumBatchCacheMisses() const { return numBatchCacheMisses_; }
+
+    /// Return bytes of transient batch data allocated by all threads during the last update.
+    size_t GetFrameAllocatorUsedSize() const;
+    /// Return highest bytes of transient batch data allocated by all threads during one update.
+    size_t GetFrameAllocatorPeakSize() const;
+
     /// Return the source view that was already prepared. Used when viewports specify the same culling camera.
     View* GetSourceView() const;
 
@@ -215,10 +315,20 @@ private:
     void GetLightBatches();
     /// Get unlit batches.
     void GetBaseBatches();
+    /// Detach batch queues from the per-thread frame allocators and release transient memory of the previous update.
+    void ResetFrameAllocators();
+    /// Return whether cached base batches of a drawable are still valid.
+    bool IsBatchCacheValid(Drawable* drawable, const DrawableBatchCache& cache);
+    /// Add cached base batches of a drawable to the batch queues.
+    void AddCachedBaseBatches(Drawable* drawable, const DrawableBatchCache& cache);
     /// Update geometries and sort batches.
     void UpdateGeometries();
-    /// Get pixel lit batches for a certain light and drawable.
-    void GetLitBatches(Drawable* drawable, LightBatchQueue& lightQueue, BatchQueue* alphaQueue);
+    /// Get shadow and pixel lit batches for a per-pixel light. Called from worker threads.
+    void GetLightQueryBatches(LightQueryResult& query, bool useAlphaQueue, unsigned threadIndex);
+    /// Get pixel lit batches for a certain light and drawable. Lit transparent batches are stored to be added to the alpha queue later.
+    void GetLitBatches(Drawable* drawable, LightBatchQueue& lightQueue, ea::vector<PendingLitAlphaBatch>* alphaBatches);
+    /// Add lit transparent batches to the alpha queue and clear them.
+    void AddLitAlphaBatches(BatchQueue& alphaQueue, ea::vector<PendingLitAlphaBatch>& batches);
     /// Execute render commands.
     void ExecuteRenderPathCommands();
     /// Set rendertargets for current render command.
@@ -272,8 +382,17 @@ private:
     void SetQueueShaderDefines(BatchQueue& queue, const RenderPathCommand& command);
     /// Choose shaders for a batch and add it to queue.
     void AddBatchToQueue(BatchQueue& queue, Batch& batch, Technique* tech, bool allowInstancing = true, bool allowShadows = true);
-    /// Prepare instancing buffer by filling it with all instance transforms.
+    /// Choose shaders for a batch unless it is converted to instanced.
+    void PrepareBatch(BatchQueue& queue, Batch& batch, Technique* tech, bool allowInstancing, bool allowShadows);
+    /// Add batch prepared with PrepareBatch to queue.
+    void AddPreparedBatchToQueue(BatchQueue& queue, Batch& batch, Technique* tech, bool allowShadows);
+    /// Prepare instancing buffer by filling it with all instance transforms, unless already filled by this view.
     void PrepareInstancingBuffer();
+    /// Assign instancing buffer ranges to the batch queues and lock the buffer. Return null if there are no instances
+    /// or the buffer already holds the instances of this view.
+    void* LockInstancingBuffer();
+    /// Unlock the instancing buffer after filling and remember this view as its source.
+    void UnlockInstancingBuffer();
     /// Set up a light volume rendering batch.
     void SetupLightVolumeBatch(Batch& batch);
     /// Check whether a light queue needs shadow rendering.
@@ -395,12 +514,18 @@ private:
     bool drawDebug_{};
     /// Renderpath.
     RenderPath* renderPath_{};
+    /// Batch sorting and geometry update tasks.
+    ea::unique_ptr<TaskGraph> updateGeometriesTasks_;
     /// Per-thread octree query results.
     ea::vector<ea::vector<Drawable*> > tempDrawables_;
+    /// Per-thread linear allocators for instanced batch groups. Reset at the beginning of every update.
+    ea::vector<ea::unique_ptr<LinearAllocator>> frameAllocators_;
     /// Per-thread geometries, lights and Z range collection results.
     ea::vector<PerThreadSceneResult> sceneResults_;
     /// Visible zones.
     ea::vector<Zone*> zones_;
+    /// Spatial index of zones for drawable zone queries.
+    ZoneIndex zoneIndex_;
     /// Visible geometry objects.
     ea::vector<Drawable*> geometries_;
     /// Geometry objects that will be updated in the main thread.
@@ -420,6 +545,20 @@ private:
     ea::unordered_map<StringHash, Texture*> renderTargets_;
     /// Intermediate light processing results.
     ea::vector<LightQueryResult> lightQueryResults_;
+    /// Per-pixel lights whose batches are built in parallel.
+    ea::vector<LightQueryResult*> lightBatchQueries_;
+    /// Light clusters.
+    LightClusters lightClusters_;
+    /// Lights referenced by light clusters.
+    ea::vector<Light*> clusterLights_;
+    /// View space bounding spheres of lights referenced by light clusters.
+    ea::vector<Sphere> clusterLightSpheres_;
+    /// Packed parameters of lights referenced by light clusters.
+    ea::vector<Vector4> clusterLightData_;
+    /// Whether light clusters are up to date with the last update.
+    bool lightClustersValid_{};
+    /// Lit transparent batches of drawables with limited per-pixel light count.
+    ea::vector<PendingLitAlphaBatch> maxLightsAlphaBatches_;
     /// Info for scene render passes defined by the renderpath.
     ea::vector<ScenePassInfo> scenePasses_;
     /// Per-pixel light queues.
@@ -428,6 +567,22 @@ private:
     ea::unordered_map<unsigned long long, LightBatchQueue> vertexLightQueues_;
     /// Batch queues by pass index.
     ea::unordered_map<unsigned, BatchQueue> batchQueues_;
+    /// Cached base batches by drawable.
+    ea::unordered_map<Drawable*, DrawableBatchCache> batchCache_;
+    /// Hash of the scene passes the cached base batches were prepared for.
+    unsigned batchCacheScenePassesHash_{};
+    /// Number of drawables whose base batches were reused.
+    unsigned numBatchCacheHits_{};
+    /// Number of drawables whose base batches were prepared from scratch.
+    unsigned numBatchCacheMisses_{};
+    /// Version of the batch queues. Incremented on every update.
+    unsigned batchesVersion_{};
+    /// Batch queues with instances to be written to the instancing buffer.
+    ea::vector<BatchQueue*> instancingQueues_;
+    /// First instancing buffer index of each batch queue with instances.
+    ea::vector<unsigned> instancingQueueOffsets_;
+    /// Handle of the sort task of each batch queue with instances during the geometry update, or M_MAX_UNSIGNED if not sorted.
+    ea::vector<unsigned> instancingQueueSortTasks_;
     /// Index of the GBuffer pass.
     unsigned gBufferPassIndex_{};
     /// Index of the opaque forward base pass.
@@ -0,0 +1,189 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Graphics/Zone.h"
+#include "../Graphics/ZoneIndex.h"
+
+#include <EASTL/sort.h>
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+/// Minimum number of zones to build the grid. Fewer zones are searched linearly.
+static const unsigned MIN_ZONES_FOR_GRID = 8;
+/// Target number of grid cells per zone.
+static const unsigned GRID_CELLS_PER_ZONE = 2;
+/// Maximum total number of grid cells.
+static const unsigned MAX_GRID_CELLS = 16384;
+/// Maximum number of grid cells along one axis.
+static const int MAX_GRID_SIZE = 64;
+
+void ZoneIndex::Define(const ea::vector<Zone*>& zones, const BoundingBox& bounds)
+{
+    Clear();
+
+    zones_ = zones;
+    ea::stable_sort(zones_.begin(), zones_.end(),
+        [](const Zone* lhs, const Zone* rhs) { return lhs->GetPriority() > rhs->GetPriority(); });
+
+    zoneData_.resize(zones_.size());
+    for (unsigned i = 0; i < zones_.size(); ++i)
+    {
+        Zone* zone = zones_[i];
+        zoneData_[i].inverseWorld_ = zone->GetInverseWorldTransform();
+        zoneData_[i].boundingBox_ = zone->GetBoundingBox();
+        zoneData_[i].zoneMask_ = zone->GetZoneMask();
+        zonesBounds_.Merge(zone->GetWorldBoundingBox());
+    }
+
+    if (zones_.size() < MIN_ZONES_FOR_GRID || !zonesBounds_.Defined() || !bounds.Defined())
+        return;
+
+    gridBounds_ = zonesBounds_;
+    gridBounds_.Clip(bounds);
+    if (!gridBounds_.Defined())
+        return;
+
+    // Choose cubic-ish cells so that the grid has roughly the target number of cells
+    const Vector3 size = gridBounds_.Size();
+    const float maxSize = Max(size.x_, Max(size.y_, size.z_));
+    const unsigned targetCells = Min(zones_.size() * GRID_CELLS_PER_ZONE, MAX_GRID_CELLS);
+    const float volume = Max(size.x_, M_EPSILON) * Max(size.y_, M_EPSILON) * Max(size.z_, M_EPSILON);
+    const float cellSize = Max(Max(Pow(volume / (float)targetCells, 1.0f / 3.0f), maxSize / (float)MAX_GRID_SIZE), M_EPSILON);
+
+    gridSize_.x_ = Clamp(CeilToInt(size.x_ / cellSize), 1, MAX_GRID_SIZE);
+    gridSize_.y_ = Clamp(CeilToInt(size.y_ / cellSize), 1, MAX_GRID_SIZE);
+    gridSize_.z_ = Clamp(CeilToInt(size.z_ / cellSize), 1, MAX_GRID_SIZE);
+    cellScale_.x_ = size.x_ > 0.0f ? gridSize_.x_ / size.x_ : 0.0f;
+    cellScale_.y_ = size.y_ > 0.0f ? gridSize_.y_ / size.y_ : 0.0f;
+    cellScale_.z_ = size.z_ > 0.0f ? gridSize_.z_ / size.z_ : 0.0f;
+
+    const auto getCell = [this](const Vector3& position)
+    {
+        const Vector3 cell = (position - gridBounds_.min_) * cellScale_;
+        return IntVector3(Clamp(FloorToInt(cell.x_), 0, gridSize_.x_ - 1), Clamp(FloorToInt(cell.y_), 0, gridSize_.y_ - 1),
+            Clamp(FloorToInt(cell.z_), 0, gridSize_.z_ - 1));
+    };
+
+    // Count zones per cell, then fill cells in zone order so that each cell stays sorted by priority
+    const unsigned numCells = gridSize_.x_ * gridSize_.y_ * gridSize_.z_;
+    ea::vector<IntVector3> zoneCells(zones_.size() * 2);
+    cellOffsets_.resize(numCells + 1, 0);
+    for (unsigned i = 0; i < zones_.size(); ++i)
+    {
+        BoundingBox zoneBox = zones_[i]->GetWorldBoundingBox();
+        zoneBox.Clip(gridBounds_);
+        if (!zoneBox.Defined())
+        {
+            zoneCells[i * 2] = IntVector3::ZERO;
+            zoneCells[i * 2 + 1] = -IntVector3::ONE;
+            continue;
+        }
+
+        const IntVector3 minCell = getCell(zoneBox.min_);
+        const IntVector3 maxCell = getCell(zoneBox.max_);
+        zoneCells[i * 2] = minCell;
+        zoneCells[i * 2 + 1] = maxCell;
+        for (int z = minCell.z_; z <= maxCell.z_; ++z)
+        {
+            for (int y = minCell.y_; y <= maxCell.y_; ++y)
+            {
+                for (int x = minCell.x_; x <= maxCell.x_; ++x)
+                    ++cellOffsets_[(z * gridSize_.y_ + y) * gridSize_.x_ + x + 1];
+            }
+        }
+    }
+
+    for (unsigned i = 0; i < numCells; ++i)
+        cellOffsets_[i + 1] += cellOffsets_[i];
+
+    ea::vector<unsigned> cellEnds(cellOffsets_.begin(), cellOffsets_.end() - 1);
+    cellZones_.resize(cellOffsets_[numCells]);
+    for (unsigned i = 0; i < zones_.size(); ++i)
+    {
+        const IntVector3& minCell = zoneCells[i * 2];
+        const IntVector3& maxCell = zoneCells[i * 2 + 1];
+        for (int z = minCell.z_; z <= maxCell.z_; ++z)
+        {
+            for (int y = minCell.y_; y <= maxCell.y_; ++y)
+            {
+                for (int x = minCell.x_; x <= maxCell.x_; ++x)
+                    cellZones_[cellEnds[(z * gridSize_.y_ + y) * gridSize_.x_ + x]++] = i;
+            }
+        }
+    }
+}
+
+void ZoneIndex::Clear()
+{
+    zones_.clear();
+    zoneData_.clear();
+    zonesBounds_.Clear();
+    gridBounds_.Clear();
+    gridSize_ = IntVector3::ZERO;
+    cellScale_ = Vector3::ZERO;
+    cellOffsets_.clear();
+    cellZones_.clear();
+}
+
+Zone* ZoneIndex::FindZone(const Vector3& point, unsigned zoneMask) const
+{
+    if (zonesBounds_.IsInside(point) == OUTSIDE)
+        return nullptr;
+
+    if (gridSize_.x_ > 0 && gridBounds_.IsInside(point) != OUTSIDE)
+    {
+        const Vector3 cell = (point - gridBounds_.min_) * cellScale_;
+        const int x = Clamp(FloorToInt(cell.x_), 0, gridSize_.x_ - 1);
+        const int y = Clamp(FloorToInt(cell.y_), 0, gridSize_.y_ - 1);
+        const int z = Clamp(FloorToInt(cell.z_), 0, gridSize_.z_ - 1);
+        const unsigned cellIndex = (z * gridSize_.y_ + y) * gridSize_.x_ + x;
+
+        for (unsigned i = cellOffsets_[cellIndex]; i < cellOffsets_[cellIndex + 1]; ++i)
+        {
+            if (IsInZone(cellZones_[i], point, zoneMask))
+                return zones_[cellZones_[i]];
+        }
+        return nullptr;
+    }
+
+    for (unsigned i = 0; i < zones_.size(); ++i)
+    {
+        if (IsInZone(i, point, zoneMask))
+            return zones_[i];
+    }
+    return nullptr;
+}
+
+bool ZoneIndex::IsInZone(unsigned index, const Vector3& point, unsigned zoneMask) const
+{
+    // Same oriented bounding box test as Zone::IsInside()
+    const ZoneData& data = zoneData_[index];
+    return (zoneMask & data.zoneMask_) && data.boundingBox_.IsInside(data.inverseWorld_ * point) != OUTSIDE;
+}
+
+}
@@ -0,0 +1,88 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+/// \file
+
+#pragma once
+
+#include "../Math/BoundingBox.h"
+#include "../Math/Matrix3x4.h"
+
+#include <EASTL/vector.h>
+
+namespace Urho3D
+{
+
+class Zone;
+
+/// Uniform grid over zone bounding boxes for fast point-in-zone queries. Zones in each cell are sorted by descending
+/// priority, so a query returns the same zone as a linear search for the highest priority zone containing the point.
+class URHO3D_API ZoneIndex
+{
+public:
+    /// Build index from zones. Grid covers the union of zone bounding boxes clipped to the given bounds; points outside it fall back to linear search.
+    void Define(const ea::vector<Zone*>& zones, const BoundingBox& bounds);
+    /// Remove all zones.
+    void Clear();
+    /// Return highest priority zone that contains the point and matches the zone mask, or null if none.
+    Zone* FindZone(const Vector3& point, unsigned zoneMask) const;
+
+    /// Return zones sorted by descending priority.
+    const ea::vector<Zone*>& GetZones() const { return zones_; }
+    /// Return number of cells along X, Y and Z axes. Zero if the grid is not used.
+    const IntVector3& GetGridSize() const { return gridSize_; }
+
+private:
+    /// Zone data copied for cache-friendly queries.
+    struct ZoneData
+    {
+        /// Inverse world transform.
+        Matrix3x4 inverseWorld_;
+        /// Local space bounding box.
+        BoundingBox boundingBox_;
+        /// Zone mask.
+        unsigned zoneMask_{};
+    };
+
+    /// Return whether zone contains the point and matches the zone mask.
+    bool IsInZone(unsigned index, const Vector3& point, unsigned zoneMask) const;
+
+    /// Zones sorted by descending priority.
+    ea::vector<Zone*> zones_;
+    /// Query data of zones in the same order.
+    ea::vector<ZoneData> zoneData_;
+    /// Union of zone bounding boxes.
+    BoundingBox zonesBounds_;
+    /// Grid bounds.
+    BoundingBox gridBounds_;
+    /// Number of cells along X, Y and Z axes.
+    IntVector3 gridSize_;
+    /// Scale from world position relative to grid minimum to cell coordinates.
+    Vector3 cellScale_;
+    /// Offset of the first zone index of each cell, plus the end offset.
+    ea::vector<unsigned> cellOffsets_;
+    /// Zone indices referenced by cells, in ascending order (descending priority) within a cell.
+    ea::vector<unsigned> cellZones_;
+};
+
+}
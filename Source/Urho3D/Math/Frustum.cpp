@@ -186,6 +186,78 @@ void Frustum::Transform(const Matrix3x4& transform)
     UpdatePlanes();
 }
 
+void Frustum::GetVisibilityMask(const BoundingBox* boxes, unsigned count, unsigned* visibilityMask) const
+{
+    for (unsigned i = 0; i < (count + 31) / 32; ++i)
+        visibilityMask[i] = 0;
+
+    unsigned index = 0;
+#ifdef URHO3D_SSE
+    // Test 4 boxes at once against each plane
+    __m128 normalX[NUM_FRUSTUM_PLANES];
+    __m128 normalY[NUM_FRUSTUM_PLANES];
+    __m128 normalZ[NUM_FRUSTUM_PLANES];
+    __m128 absNormalX[NUM_FRUSTUM_PLANES];
+    __m128 absNormalY[NUM_FRUSTUM_PLANES];
+    __m128 absNormalZ[NUM_FRUSTUM_PLANES];
+    __m128 planeD[NUM_FRUSTUM_PLANES];
+    for (unsigned j = 0; j < NUM_FRUSTUM_PLANES; ++j)
+    {
+        normalX[j] = _mm_set1_ps(planes_[j].normal_.x_);
+        normalY[j] = _mm_set1_ps(planes_[j].normal_.y_);
+        normalZ[j] = _mm_set1_ps(planes_[j].normal_.z_);
+        absNormalX[j] = _mm_set1_ps(planes_[j].absNormal_.x_);
+        absNormalY[j] = _mm_set1_ps(planes_[j].absNormal_.y_);
+        absNormalZ[j] = _mm_set1_ps(planes_[j].absNormal_.z_);
+        planeD[j] = _mm_set1_ps(planes_[j].d_);
+    }
+
+    const __m128 half = _mm_set1_ps(0.5f);
+    for (; index + 4 <= count; index += 4)
+    {
+        const BoundingBox* box = boxes + index;
+
+        // Min and max are padded to 4 floats, transpose them to get X, Y and Z of 4 boxes
+        __m128 min0 = _mm_loadu_ps(&box[0].min_.x_);
+        __m128 min1 = _mm_loadu_ps(&box[1].min_.x_);
+        __m128 min2 = _mm_loadu_ps(&box[2].min_.x_);
+        __m128 min3 = _mm_loadu_ps(&box[3].min_.x_);
+        __m128 max0 = _mm_loadu_ps(&box[0].max_.x_);
+        __m128 max1 = _mm_loadu_ps(&box[1].max_.x_);
+        __m128 max2 = _mm_loadu_ps(&box[2].max_.x_);
+        __m128 max3 = _mm_loadu_ps(&box[3].max_.x_);
+        _MM_TRANSPOSE4_PS(min0, min1, min2, min3);
+        _MM_TRANSPOSE4_PS(max0, max1, max2, max3);
+
+        const __m128 centerX = _mm_mul_ps(_mm_add_ps(min0, max0), half);
+        const __m128 centerY = _mm_mul_ps(_mm_add_ps(min1, max1), half);
+        const __m128 centerZ = _mm_mul_ps(_mm_add_ps(min2, max2), half);
+        const __m128 edgeX = _mm_sub_ps(centerX, min0);
+        const __m128 edgeY = _mm_sub_ps(centerY, min1);
+        const __m128 edgeZ = _mm_sub_ps(centerZ, min2);
+
+        __m128 outside = _mm_setzero_ps();
+        for (unsigned j = 0; j < NUM_FRUSTUM_PLANES; ++j)
+        {
+            const __m128 dist = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(normalX[j], centerX),
+                _mm_mul_ps(normalY[j], centerY)), _mm_mul_ps(normalZ[j], centerZ)), planeD[j]);
+            const __m128 absDist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absNormalX[j], edgeX), _mm_mul_ps(absNormalY[j], edgeY)),
+                _mm_mul_ps(absNormalZ[j], edgeZ));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(dist, _mm_sub_ps(_mm_setzero_ps(), absDist)));
+        }
+
+        const unsigned insideBits = ~static_cast<unsigned>(_mm_movemask_ps(outside)) & 0xfu;
+        visibilityMask[index / 32] |= insideBits << (index % 32);
+    }
+#endif
+
+    for (; index < count; ++index)
+    {
+        if (IsInsideFast(boxes[index]) != OUTSIDE)
+            visibilityMask[index / 32] |= 1u << (index % 32);
+    }
+}
+
 Frustum Frustum::Transformed(const Matrix3& transform) const
 {
     Frustum transformed;
@@ -158,6 +158,9 @@ public:
         return INSIDE;
     }
 
+    /// Test bounding boxes for being (partially) inside. Set bit in visibility mask (32 boxes per element) for each box inside.
+    void GetVisibilityMask(const BoundingBox* boxes, unsigned count, unsigned* visibilityMask) const;
+
     /// Return distance of a point to the frustum, or 0 if inside.
     float Distance(const Vector3& point) const
     {
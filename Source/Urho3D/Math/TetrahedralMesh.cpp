@@ -291,6 +291,85 @@ Vector4 TetrahedralMesh::GetInterpolationFactors(const Vector3& position, unsign
     return GetBarycentricCoords(tetIndexHint, position);
 }
 
+void TetrahedralMesh::GetInterpolationFactors(ea::span<const Vector3> positions, ea::span<unsigned> tetIndexHints,
+    ea::span<Vector4> weights) const
+{
+    const unsigned count = positions.size();
+    unsigned i = 0;
+
+#ifdef URHO3D_SSE
+    // Test four positions at once against their hint tetrahedrons, which are usually still valid. Arithmetic matches
+    // Matrix3x4 multiplication in GetInnerBarycentricCoords exactly, so the results are identical to the scalar path
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 zero = _mm_setzero_ps();
+    for (; i + 4 <= count; i += 4)
+    {
+        const unsigned* hints = &tetIndexHints[i];
+        if (hints[0] >= numInnerTetrahedrons_ || hints[1] >= numInnerTetrahedrons_
+            || hints[2] >= numInnerTetrahedrons_ || hints[3] >= numInnerTetrahedrons_)
+        {
+            for (unsigned j = i; j < i + 4; ++j)
+                weights[j] = GetInterpolationFactors(positions[j], tetIndexHints[j]);
+            continue;
+        }
+
+        const Tetrahedron* tets[4] = { &tetrahedrons_[hints[0]], &tetrahedrons_[hints[1]],
+            &tetrahedrons_[hints[2]], &tetrahedrons_[hints[3]] };
+
+        // Transpose matrix rows so that each register holds one matrix element of all four tetrahedrons
+        __m128 rows[3][4];
+        for (unsigned row = 0; row < 3; ++row)
+        {
+            for (unsigned lane = 0; lane < 4; ++lane)
+                rows[row][lane] = _mm_loadu_ps(tets[lane]->matrix_.Data() + row * 4);
+            _MM_TRANSPOSE4_PS(rows[row][0], rows[row][1], rows[row][2], rows[row][3]);
+        }
+
+        __m128 offset[3];
+        for (unsigned axis = 0; axis < 3; ++axis)
+        {
+            float values[4];
+            for (unsigned lane = 0; lane < 4; ++lane)
+            {
+                const Vector3& position = positions[i + lane];
+                const Vector3& basePosition = vertices_[tets[lane]->indices_[0]];
+                values[lane] = position.Data()[axis] - basePosition.Data()[axis];
+            }
+            offset[axis] = _mm_loadu_ps(values);
+        }
+
+        // Same operation order as SSE Matrix3x4 * Vector3: (m0 * x + m2 * z) + (m1 * y + m3)
+        __m128 coords[3];
+        for (unsigned row = 0; row < 3; ++row)
+        {
+            const __m128 xz = _mm_add_ps(_mm_mul_ps(rows[row][0], offset[0]), _mm_mul_ps(rows[row][2], offset[2]));
+            const __m128 yw = _mm_add_ps(_mm_mul_ps(rows[row][1], offset[1]), rows[row][3]);
+            coords[row] = _mm_add_ps(xz, yw);
+        }
+        const __m128 first = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(one, coords[0]), coords[1]), coords[2]);
+
+        const __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(first, zero), _mm_cmpge_ps(coords[0], zero)),
+            _mm_and_ps(_mm_cmpge_ps(coords[1], zero), _mm_cmpge_ps(coords[2], zero)));
+        const int insideMask = _mm_movemask_ps(inside);
+
+        // Transpose back to per-position weights
+        __m128 result[4] = { first, coords[0], coords[1], coords[2] };
+        _MM_TRANSPOSE4_PS(result[0], result[1], result[2], result[3]);
+
+        for (unsigned lane = 0; lane < 4; ++lane)
+        {
+            if (insideMask & (1 << lane))
+                _mm_storeu_ps(&weights[i + lane].x_, result[lane]);
+            else
+                weights[i + lane] = GetInterpolationFactors(positions[i + lane], tetIndexHints[i + lane]);
+        }
+    }
+#endif
+
+    for (; i < count; ++i)
+        weights[i] = GetInterpolationFactors(positions[i], tetIndexHints[i]);
+}
+
 int TetrahedralMesh::SolveCubicEquation(double result[], double a, double b, double c, double eps)
 {
     // Performance-critical code, don't use degree-based functions here
@@ -321,25 +321,50 @@ public:
     /// Find tetrahedron containing given position and calculate barycentric coordinates within this tetrahedron.
     Vector4 GetInterpolationFactors(const Vector3& position, unsigned& tetIndexHint) const;
 
+    /// Find tetrahedrons containing given positions and calculate barycentric coordinates. Results are identical to calling the single position overload for each position.
+    void GetInterpolationFactors(ea::span<const Vector3> positions, ea::span<unsigned> tetIndexHints, ea::span<Vector4> weights) const;
+
     /// Sample value at given position from the arbitrary container of per-vertex data.
     template <class Container>
     auto Sample(const Container& container, const Vector3& position, unsigned& tetIndexHint) const
     {
-        typename Container::value_type result{};
-
         const Vector4& weights = GetInterpolationFactors(position, tetIndexHint);
-        if (tetIndexHint < tetrahedrons_.size())
+        return Interpolate(container, tetIndexHint, weights);
+    }
+
+    /// Sample values at given positions from the arbitrary container of per-vertex data.
+    template <class Container>
+    void Sample(const Container& container, ea::span<const Vector3> positions, ea::span<unsigned> tetIndexHints,
+        ea::span<typename Container::value_type> results) const
+    {
+        static const unsigned chunkSize = 64;
+        Vector4 weights[chunkSize];
+        for (unsigned begin = 0; begin < positions.size(); begin += chunkSize)
+        {
+            const unsigned count = ea::min(chunkSize, static_cast<unsigned>(positions.size()) - begin);
+            GetInterpolationFactors(positions.subspan(begin, count), tetIndexHints.subspan(begin, count), { weights, count });
+            for (unsigned i = 0; i < count; ++i)
+                results[begin + i] = Interpolate(container, tetIndexHints[begin + i], weights[i]);
+        }
+    }
+
+private:
+    /// Interpolate per-vertex data of tetrahedron with barycentric coordinates.
+    template <class Container>
+    auto Interpolate(const Container& container, unsigned tetIndex, const Vector4& weights) const
+    {
+        typename Container::value_type result{};
+        if (tetIndex < tetrahedrons_.size())
         {
-            const Tetrahedron& tetrahedron = tetrahedrons_[tetIndexHint];
+            const Tetrahedron& tetrahedron = tetrahedrons_[tetIndex];
             for (unsigned i = 0; i < 3; ++i)
                 result += container[tetrahedron.indices_[i]] * weights[i];
-            if (tetIndexHint < numInnerTetrahedrons_)
+            if (tetIndex < numInnerTetrahedrons_)
                 result += container[tetrahedron.indices_[3]] * weights[3];
         }
         return result;
     }
 
-private:
     /// Solve cubic equation x^3 + a*x^2 + b*x + c = 0.
     static int SolveCubicEquation(double result[], double a, double b, double c, double eps);
     /// Calculate most positive root of cubic equation x^3 + a*x^2 + b*x + c = 0.
@@ -24,6 +24,7 @@
 
 #include "../Core/Context.h"
 #include "../Core/Profiler.h"
+#include "../Core/WorkQueue.h"
 #include "../Graphics/DebugRenderer.h"
 #include "../Graphics/Drawable.h"
 #include "../Graphics/Geometry.h"
@@ -82,6 +83,7 @@ static const float DEFAULT_DETAIL_SAMPLE_DISTANCE = 6.0f;
 static const float DEFAULT_DETAIL_SAMPLE_MAX_ERROR = 1.0f;
 
 static const int MAX_POLYS = 2048;
+static const unsigned TILE_BATCH_SIZE_PER_THREAD = 4;
 
 
 /// Temporary data for finding a path.
@@ -97,6 +99,28 @@ struct FindPathData
     unsigned char pathFlags_[MAX_POLYS]{};
 };
 
+/// Intermediate state of navigation mesh tile build.
+struct NavigationTileBuild
+{
+    /// Destruct. Free tile data if it was not added to the navigation mesh.
+    ~NavigationTileBuild() { dtFree(navData_); }
+
+    /// Tile coordinates.
+    IntVector2 tile_;
+    /// Tile bounding box.
+    BoundingBox boundingBox_;
+    /// Recast configuration.
+    rcConfig config_{};
+    /// Geometry and intermediate Recast data.
+    SimpleNavBuildData build_;
+    /// Detour tile data.
+    unsigned char* navData_{};
+    /// Size of Detour tile data.
+    int navDataSize_{};
+    /// Whether the tile data is successfully built.
+    bool success_{};
+};
+
 NavigationMesh::NavigationMesh(Context* context) :
     Component(context),
     navMesh_(nullptr),
@@ -1299,19 +1323,13 @@ bool NavigationMesh::ReadTile(Deserializer& source, bool silent)
     return true;
 }
 
-bool NavigationMesh::BuildTile(ea::vector<NavigationGeometryInfo>& geometryList, int x, int z)
+void NavigationMesh::PrepareTileBuild(NavigationTileBuild& tileBuild, ea::vector<NavigationGeometryInfo>& geometryList,
+    const IntVector2& tile)
 {
-    URHO3D_PROFILE("BuildNavigationMeshTile");
+    tileBuild.tile_ = tile;
+    tileBuild.boundingBox_ = GetTileBoundingBox(tile);
 
-    // Remove previous tile (if any)
-    navMesh_->removeTile(navMesh_->getTileRefAt(x, z, 0), nullptr, nullptr);
-
-    const BoundingBox tileBoundingBox = GetTileBoundingBox(IntVector2(x, z));
-
-    SimpleNavBuildData build;
-
-    rcConfig cfg;       // NOLINT(hicpp-member-init)
-    memset(&cfg, 0, sizeof cfg);
+    rcConfig& cfg = tileBuild.config_;
     cfg.cs = cellSize_;
     cfg.ch = cellHeight_;
     cfg.walkableSlopeAngle = agentMaxSlope_;
@@ -1330,15 +1348,23 @@ bool NavigationMesh::BuildTile(ea::vector<NavigationGeometryInfo>& geometryList,
     cfg.detailSampleDist = detailSampleDistance_ < 0.9f ? 0.0f : cellSize_ * detailSampleDistance_;
     cfg.detailSampleMaxError = cellHeight_ * detailSampleMaxError_;
 
-    rcVcopy(cfg.bmin, &tileBoundingBox.min_.x_);
-    rcVcopy(cfg.bmax, &tileBoundingBox.max_.x_);
+    rcVcopy(cfg.bmin, &tileBuild.boundingBox_.min_.x_);
+    rcVcopy(cfg.bmax, &tileBuild.boundingBox_.max_.x_);
     cfg.bmin[0] -= cfg.borderSize * cfg.cs;
     cfg.bmin[2] -= cfg.borderSize * cfg.cs;
     cfg.bmax[0] += cfg.borderSize * cfg.cs;
     cfg.bmax[2] += cfg.borderSize * cfg.cs;
 
     BoundingBox expandedBox(*reinterpret_cast<Vector3*>(cfg.bmin), *reinterpret_cast<Vector3*>(cfg.bmax));
-    GetTileGeometry(&build, geometryList, expandedBox);
+    GetTileGeometry(&tileBuild.build_, geometryList, expandedBox);
+}
+
+bool NavigationMesh::BuildTileData(NavigationTileBuild& tileBuild) const
+{
+    URHO3D_PROFILE("BuildNavigationMeshTile");
+
+    SimpleNavBuildData& build = tileBuild.build_;
+    const rcConfig& cfg = tileBuild.config_;
 
     if (build.vertices_.empty() || build.indices_.empty())
         return true; // Nothing to do
@@ -1462,9 +1488,6 @@ bool NavigationMesh::BuildTile(ea::vector<NavigationGeometryInfo>& geometryList,
             build.polyMesh_->flags[i] = 0x1;
     }
 
-    unsigned char* navData = nullptr;
-    int navDataSize = 0;
-
     dtNavMeshCreateParams params;       // NOLINT(hicpp-member-init)
     memset(&params, 0, sizeof params);
     params.verts = build.polyMesh_->verts;
@@ -1482,8 +1505,8 @@ bool NavigationMesh::BuildTile(ea::vector<NavigationGeometryInfo>& geometryList,
     params.walkableHeight = agentHeight_;
     params.walkableRadius = agentRadius_;
     params.walkableClimb = agentMaxClimb_;
-    params.tileX = x;
-    params.tileY = z;
+    params.tileX = tileBuild.tile_.x_;
+    params.tileY = tileBuild.tile_.y_;
     rcVcopy(params.bmin, build.polyMesh_->bmin);
     rcVcopy(params.bmax, build.polyMesh_->bmax);
     params.cs = cfg.cs;
@@ -1501,18 +1524,34 @@ bool NavigationMesh::BuildTile(ea::vector<NavigationGeometryInfo>& geometryList,
         params.offMeshConDir = &build.offMeshDir_[0];
     }
 
-    if (!dtCreateNavMeshData(&params, &navData, &navDataSize))
+    if (!dtCreateNavMeshData(&params, &tileBuild.navData_, &tileBuild.navDataSize_))
     {
         URHO3D_LOGERROR("Could not build navigation mesh tile data");
         return false;
     }
 
-    if (dtStatusFailed(navMesh_->addTile(navData, navDataSize, DT_TILE_FREE_DATA, 0, nullptr)))
+    return true;
+}
+
+bool NavigationMesh::AddTileData(NavigationTileBuild& tileBuild)
+{
+    const IntVector2& tile = tileBuild.tile_;
+
+    // Remove previous tile (if any)
+    navMesh_->removeTile(navMesh_->getTileRefAt(tile.x_, tile.y_, 0), nullptr, nullptr);
+
+    if (!tileBuild.success_)
+        return false;
+    if (!tileBuild.navData_)
+        return true; // Nothing to do
+
+    if (dtStatusFailed(navMesh_->addTile(tileBuild.navData_, tileBuild.navDataSize_, DT_TILE_FREE_DATA, 0, nullptr)))
     {
         URHO3D_LOGERROR("Failed to add navigation mesh tile");
-        dtFree(navData);
         return false;
     }
+    // Navigation mesh owns the data now
+    tileBuild.navData_ = nullptr;
 
     // Send a notification of the rebuild of this tile to anyone interested
     {
@@ -1520,25 +1559,62 @@ bool NavigationMesh::BuildTile(ea::vector<NavigationGeometryInfo>& geometryList,
         VariantMap& eventData = GetContext()->GetEventDataMap();
         eventData[P_NODE] = GetNode();
         eventData[P_MESH] = this;
-        eventData[P_BOUNDSMIN] = Variant(tileBoundingBox.min_);
-        eventData[P_BOUNDSMAX] = Variant(tileBoundingBox.max_);
+        eventData[P_BOUNDSMIN] = Variant(tileBuild.boundingBox_.min_);
+        eventData[P_BOUNDSMAX] = Variant(tileBuild.boundingBox_.max_);
         SendEvent(E_NAVIGATION_AREA_REBUILT, eventData);
     }
     return true;
 }
 
+bool NavigationMesh::BuildTile(ea::vector<NavigationGeometryInfo>& geometryList, int x, int z)
+{
+    NavigationTileBuild tileBuild;
+    PrepareTileBuild(tileBuild, geometryList, IntVector2(x, z));
+    tileBuild.success_ = BuildTileData(tileBuild);
+    return AddTileData(tileBuild);
+}
+
 unsigned NavigationMesh::BuildTiles(ea::vector<NavigationGeometryInfo>& geometryList, const IntVector2& from, const IntVector2& to)
 {
+    URHO3D_PROFILE("BuildNavigationMeshTiles");
+
+    auto* workQueue = GetSubsystem<WorkQueue>();
+
+    // Geometry is collected and tiles are added on the main thread, Recast processing of the batch runs in parallel.
+    // Tiles are processed in batches to limit the amount of intermediate data kept alive
+    const unsigned batchSize = (workQueue->GetNumThreads() + 1) * TILE_BATCH_SIZE_PER_THREAD;
+    ea::vector<ea::unique_ptr<NavigationTileBuild>> batch;
     unsigned numTiles = 0;
 
+    auto processBatch = [&]()
+    {
+        workQueue->ParallelFor(batch.size(), 1, [&](unsigned begin, unsigned end, unsigned /*threadIndex*/)
+        {
+            for (unsigned i = begin; i < end; ++i)
+                batch[i]->success_ = BuildTileData(*batch[i]);
+        });
+
+        for (const auto& tileBuild : batch)
+        {
+            if (AddTileData(*tileBuild))
+                ++numTiles;
+        }
+        batch.clear();
+    };
+
     for (int z = from.y_; z <= to.y_; ++z)
     {
         for (int x = from.x_; x <= to.x_; ++x)
         {
-            if (BuildTile(geometryList, x, z))
-                ++numTiles;
+            batch.push_back(ea::make_unique<NavigationTileBuild>());
+            PrepareTileBuild(*batch.back(), geometryList, IntVector2(x, z));
+            if (batch.size() >= batchSize)
+                processBatch();
         }
     }
+    if (!batch.empty())
+        processBatch();
+
     return numTiles;
 }
 
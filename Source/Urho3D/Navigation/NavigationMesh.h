@@ -54,6 +54,7 @@ class NavArea;
 
 struct FindPathData;
 struct NavBuildData;
+struct NavigationTileBuild;
 
 /// Description of a navigation mesh geometry component, with transform and bounds information.
 struct NavigationGeometryInfo
@@ -289,8 +290,16 @@ protected:
     void GetTileGeometry(NavBuildData* build, ea::vector<NavigationGeometryInfo>& geometryList, BoundingBox& box);
     /// Add a triangle mesh to the geometry data.
     void AddTriMeshGeometry(NavBuildData* build, Geometry* geometry, const Matrix3x4& transform);
+    /// Configure tile build and collect tile geometry.
+    void PrepareTileBuild(NavigationTileBuild& tileBuild, ea::vector<NavigationGeometryInfo>& geometryList, const IntVector2& tile);
+    /// Build Detour tile data from collected geometry. Safe to call from worker threads. Return true if successful.
+    bool BuildTileData(NavigationTileBuild& tileBuild) const;
+    /// Replace tile in the navigation mesh with built tile data and send notification. Return true if successful.
+    bool AddTileData(NavigationTileBuild& tileBuild);
     /// Build one tile of the navigation mesh. Return true if successful.
-    virtual bool BuildTile(ea::vector<NavigationGeometryInfo>& geometryList, int x, int z);
+    /// Not virtual: BuildTiles builds tiles in parallel batches through PrepareTileBuild, BuildTileData and AddTileData
+    /// and does not call it.
+    bool BuildTile(ea::vector<NavigationGeometryInfo>& geometryList, int x, int z);
     /// Build tiles in the rectangular area. Return number of built tiles.
     unsigned BuildTiles(ea::vector<NavigationGeometryInfo>& geometryList, const IntVector2& from, const IntVector2& to);
     /// Ensure that the navigation mesh query is initialized. Return true if successful.
@@ -41,7 +41,11 @@ LogicComponent::LogicComponent(Context* context) :
 {
 }
 
-LogicComponent::~LogicComponent() = default;
+LogicComponent::~LogicComponent()
+{
+    if (threadedUpdateScene_)
+        threadedUpdateScene_->RemoveThreadedLogicComponent(this);
+}
 
 void LogicComponent::OnSetEnabled()
 {
@@ -73,6 +77,15 @@ void LogicComponent::SetUpdateEventMask(UpdateEventFlags mask)
     }
 }
 
+void LogicComponent::SetThreadSafeUpdate(bool enable)
+{
+    if (threadSafeUpdate_ != enable)
+    {
+        threadSafeUpdate_ = enable;
+        UpdateEventSubscription();
+    }
+}
+
 void LogicComponent::OnNodeSet(Node* node)
 {
     if (node)
@@ -100,6 +113,9 @@ void LogicComponent::OnSceneSet(Scene* scene)
         UnsubscribeFromEvent(E_PHYSICSPOSTSTEP);
 #endif
         currentEventMask_ = USE_NO_EVENT;
+
+        if (threadedUpdateScene_)
+            threadedUpdateScene_->RemoveThreadedLogicComponent(this);
     }
 }
 
@@ -111,7 +127,15 @@ void LogicComponent::UpdateEventSubscription()
 
     bool enabled = IsEnabledEffective();
 
-    bool needUpdate = enabled && ((updateEventMask_ & USE_UPDATE) || !delayedStartCalled_);
+    // Thread-safe components are updated by the scene once delayed start is done
+    const bool threadedUpdate = threadSafeUpdate_ && delayedStartCalled_;
+    bool needThreadedUpdate = enabled && threadedUpdate && (updateEventMask_ & USE_UPDATE);
+    if (needThreadedUpdate && !threadedUpdateScene_)
+        scene->AddThreadedLogicComponent(this);
+    else if (!needThreadedUpdate && threadedUpdateScene_)
+        threadedUpdateScene_->RemoveThreadedLogicComponent(this);
+
+    bool needUpdate = enabled && !threadedUpdate && ((updateEventMask_ & USE_UPDATE) || !delayedStartCalled_);
     if (needUpdate && !(currentEventMask_ & USE_UPDATE))
     {
         SubscribeToEvent(scene, E_SCENEUPDATE, URHO3D_HANDLER(LogicComponent, HandleSceneUpdate));
@@ -183,6 +207,13 @@ void LogicComponent::HandleSceneUpdate(StringHash eventType, VariantMap& eventDa
             currentEventMask_ &= ~USE_UPDATE;
             return;
         }
+
+        // Thread-safe component is updated by the scene after this event, starting from this frame
+        if (threadSafeUpdate_)
+        {
+            UpdateEventSubscription();
+            return;
+        }
     }
 
     // Then execute user-defined update function
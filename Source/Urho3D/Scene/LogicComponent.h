@@ -50,6 +50,8 @@ class URHO3D_API LogicComponent : public Component
 {
     URHO3D_OBJECT(LogicComponent, Component);
 
+    friend class Scene;
+
     /// Construct.
     explicit LogicComponent(Context* context);
     /// Destruct.
@@ -79,8 +81,15 @@ class URHO3D_API LogicComponent : public Component
     /// Set what update events should be subscribed to. Use this for optimization: by default all are in use. Note that this is not an attribute and is not saved or network-serialized, therefore it should always be called eg. in the subclass constructor.
     void SetUpdateEventMask(UpdateEventFlags mask);
 
+    /// Set whether Update() is thread-safe. Thread-safe components are updated in parallel by the scene right after E_SCENEUPDATE.
+    /// Update() of such component may only modify its own node and its children, and must not create or remove nodes or components or send events.
+    /// Components dirtied by node changes are notified on the main thread after the parallel update. DelayedStart() is always called from the main thread.
+    void SetThreadSafeUpdate(bool enable);
+
     /// Return what update events are subscribed to.
     UpdateEventFlags GetUpdateEventMask() const { return updateEventMask_; }
+    /// Return whether Update() is thread-safe.
+    bool IsThreadSafeUpdate() const { return threadSafeUpdate_; }
 
     /// Return whether the DelayedStart() function has been called.
     bool IsDelayedStartCalled() const { return delayedStartCalled_; }
@@ -110,6 +119,12 @@ private:
     UpdateEventFlags currentEventMask_;
     /// Flag for delayed start.
     bool delayedStartCalled_;
+    /// Whether Update() is thread-safe.
+    bool threadSafeUpdate_{};
+    /// Scene that performs parallel update of this component.
+    Scene* threadedUpdateScene_{};
+    /// Index in the parallel update list of the scene.
+    unsigned threadedUpdateIndex_{};
 };
 
 }
@@ -979,6 +979,10 @@ void Node::AddChild(Node* node, unsigned index)
             }
 
             oldParent->children_.erase_first(nodeShared);
+
+            // Node stays in the scene under a different parent
+            if (scene_)
+                scene_->MarkTransformHierarchyDirty();
         }
     }
 
@@ -77,6 +77,7 @@ class URHO3D_API Node : public Animatable
     URHO3D_OBJECT(Node, Animatable);
 
     friend class Connection;
+    friend class TransformHierarchy;
 
 public:
     /// Construct.
@@ -37,6 +37,7 @@
 #include "../Resource/JSONFile.h"
 #include "../Scene/CameraViewport.h"
 #include "../Scene/Component.h"
+#include "../Scene/LogicComponent.h"
 #include "../Scene/ObjectAnimation.h"
 #include "../Scene/ReplicationState.h"
 #include "../Scene/Scene.h"
@@ -44,9 +45,12 @@
 #include "../Scene/SceneManager.h"
 #include "../Scene/SmoothedTransform.h"
 #include "../Scene/SplinePath.h"
+#include "../Scene/TransformHierarchy.h"
 #include "../Scene/UnknownComponent.h"
 #include "../Scene/ValueAnimation.h"
 
+#include <EASTL/sort.h>
+
 #include "../DebugNew.h"
 
 namespace Urho3D
@@ -58,6 +62,7 @@ const char* SUBSYSTEM_CATEGORY = "Subsystem";
 
 static const float DEFAULT_SMOOTHING_CONSTANT = 50.0f;
 static const float DEFAULT_SNAP_THRESHOLD = 5.0f;
+static const unsigned THREADED_LOGIC_CHUNK_SIZE = 16;
 
 Scene::Scene(Context* context) :
     Node(context),
@@ -853,6 +858,7 @@ void Scene::Update(float timeStep)
 
     // Update variable timestep logic
     SendEvent(E_SCENEUPDATE, eventData);
+    UpdateThreadedLogicComponents(timeStep);
 
     // Update scene attribute animation.
     SendEvent(E_ATTRIBUTEANIMATIONUPDATE, eventData);
@@ -874,6 +880,10 @@ void Scene::Update(float timeStep)
         SendEvent(E_UPDATESMOOTHING, smoothingData_);
     }
 
+    // Update world transforms in batch, so post-update logic and rendering do not evaluate them node by node
+    if (transformHierarchy_)
+        UpdateWorldTransforms();
+
     // Post-update variable timestep logic
     SendEvent(E_SCENEPOSTUPDATE, eventData);
 
@@ -883,6 +893,72 @@ void Scene::Update(float timeStep)
     elapsedTime_ += timeStep;
 }
 
+void Scene::AddThreadedLogicComponent(LogicComponent* component)
+{
+    assert(!threadedUpdate_ && !component->threadedUpdateScene_);
+    component->threadedUpdateScene_ = this;
+    component->threadedUpdateIndex_ = threadedLogicComponents_.size();
+    threadedLogicComponents_.push_back(component);
+}
+
+void Scene::RemoveThreadedLogicComponent(LogicComponent* component)
+{
+    assert(!threadedUpdate_ && component->threadedUpdateScene_ == this);
+    threadedLogicComponents_[component->threadedUpdateIndex_] = nullptr;
+    component->threadedUpdateScene_ = nullptr;
+}
+
+void Scene::UpdateThreadedLogicComponents(float timeStep)
+{
+    if (threadedLogicComponents_.empty())
+        return;
+
+    URHO3D_PROFILE("UpdateThreadedLogic");
+
+    // Remove holes, keeping update order stable
+    unsigned numComponents = 0;
+    for (LogicComponent* component : threadedLogicComponents_)
+    {
+        if (component)
+        {
+            component->threadedUpdateIndex_ = numComponents;
+            threadedLogicComponents_[numComponents++] = component;
+        }
+    }
+    threadedLogicComponents_.resize(numComponents);
+
+    // Components marked dirty are notified from the main thread in EndThreadedUpdate
+    auto* queue = GetSubsystem<WorkQueue>();
+    BeginThreadedUpdate();
+    queue->ParallelFor(threadedLogicComponents_.size(), THREADED_LOGIC_CHUNK_SIZE,
+        [&](unsigned beginIndex, unsigned endIndex, unsigned /*threadIndex*/)
+    {
+        for (unsigned i = beginIndex; i < endIndex; ++i)
+            threadedLogicComponents_[i]->Update(timeStep);
+    });
+    EndThreadedUpdate();
+}
+
+void Scene::SetBatchedTransformUpdate(bool enable)
+{
+    if (enable && !transformHierarchy_)
+        transformHierarchy_ = ea::make_unique<TransformHierarchy>(this);
+    else if (!enable)
+        transformHierarchy_ = nullptr;
+}
+
+void Scene::UpdateWorldTransforms()
+{
+    if (transformHierarchy_)
+        transformHierarchy_->Update(GetSubsystem<WorkQueue>());
+}
+
+void Scene::MarkTransformHierarchyDirty()
+{
+    if (transformHierarchy_)
+        transformHierarchy_->MarkStructureDirty();
+}
+
 void Scene::BeginThreadedUpdate()
 {
     // Check the work queue subsystem whether it actually has created worker threads. If not, do not enter threaded mode.
@@ -901,6 +977,12 @@ void Scene::EndThreadedUpdate()
     {
         URHO3D_PROFILE("EndThreadedUpdate");
 
+        // Threads add components in arbitrary order, notify them in order of IDs to keep side effects deterministic
+        ea::sort(delayedDirtyComponents_.begin(), delayedDirtyComponents_.end(),
+            [](const Component* lhs, const Component* rhs) { return lhs->GetID() < rhs->GetID(); });
+        delayedDirtyComponents_.erase(ea::unique(delayedDirtyComponents_.begin(), delayedDirtyComponents_.end()),
+            delayedDirtyComponents_.end());
+
         for (auto i = delayedDirtyComponents_.begin(); i !=
             delayedDirtyComponents_.end(); ++i)
             (*i)->OnMarkedDirty((*i)->GetNode());
@@ -983,6 +1065,8 @@ void Scene::NodeAdded(Node* node)
     if (!node || node->GetScene() == this)
         return;
 
+    MarkTransformHierarchyDirty();
+
     // Remove from old scene first
     Scene* oldScene = node->GetScene();
     if (oldScene)
@@ -1056,6 +1140,8 @@ void Scene::NodeRemoved(Node* node)
     if (!node || node->GetScene() != this)
         return;
 
+    MarkTransformHierarchyDirty();
+
     unsigned id = node->GetID();
     if (Scene::IsReplicatedID(id))
     {
@@ -37,8 +37,10 @@ namespace Urho3D
 {
 
 class File;
+class LogicComponent;
 class PackageFile;
 class Texture2D;
+class TransformHierarchy;
 
 static const unsigned FIRST_REPLICATED_ID = 0x1;
 static const unsigned LAST_REPLICATED_ID = 0xffffff;
@@ -183,6 +185,8 @@ public:
     void SetSnapThreshold(float threshold);
     /// Set maximum milliseconds per frame to spend on async scene loading.
     void SetAsyncLoadingMs(int ms);
+    /// Enable or disable batched world transform update. When enabled, dirty world transforms are updated for whole subtrees at once in parallel at the end of scene update.
+    void SetBatchedTransformUpdate(bool enable);
     /// Add a required package file for networking. To be called on the server.
     void AddRequiredPackageFile(PackageFile* package);
     /// Clear required package files.
@@ -239,6 +243,11 @@ public:
     /// Return maximum milliseconds per frame to spend on async loading.
     int GetAsyncLoadingMs() const { return asyncLoadingMs_; }
 
+    /// Return whether batched world transform update is enabled.
+    bool GetBatchedTransformUpdate() const { return transformHierarchy_ != nullptr; }
+    /// Return transform hierarchy used for batched world transform update, or null if disabled.
+    TransformHierarchy* GetTransformHierarchy() const { return transformHierarchy_.get(); }
+
     /// Return required package files.
     const ea::vector<SharedPtr<PackageFile> >& GetRequiredPackageFiles() const { return requiredPackageFiles_; }
 
@@ -256,6 +265,14 @@ public:
 
     /// Return threaded update flag.
     bool IsThreadedUpdate() const { return threadedUpdate_; }
+    /// Add logic component to parallel update. Called by LogicComponent.
+    void AddThreadedLogicComponent(LogicComponent* component);
+    /// Remove logic component from parallel update. Called by LogicComponent.
+    void RemoveThreadedLogicComponent(LogicComponent* component);
+    /// Update dirty world transforms of all nodes in batch. Called by Update if batched world transform update is enabled.
+    void UpdateWorldTransforms();
+    /// Mark transform hierarchy for rebuild after the node hierarchy has changed.
+    void MarkTransformHierarchyDirty();
 
     /// Get free node ID, either non-local or local.
     unsigned GetFreeNodeID(CreateMode mode);
@@ -293,6 +310,8 @@ public:
     void MarkReplicationDirty(Node* node);
 
 private:
+    /// Update thread-safe logic components in parallel.
+    void UpdateThreadedLogicComponents(float timeStep);
     /// Handle the logic update event to update the scene, if active.
     void HandleUpdate(StringHash eventType, VariantMap& eventData);
     /// Handle a background loaded resource completing.
@@ -345,6 +364,10 @@ private:
     ea::hash_set<unsigned> networkUpdateNodes_;
     /// Components to check for attribute changes on the next network update.
     ea::hash_set<unsigned> networkUpdateComponents_;
+    /// Thread-safe logic components updated in parallel. Removed components leave null holes until the next update.
+    ea::vector<LogicComponent*> threadedLogicComponents_;
+    /// Transform hierarchy for batched world transform update.
+    ea::unique_ptr<TransformHierarchy> transformHierarchy_;
     /// Delayed dirty notification queue for components.
     ea::vector<Component*> delayedDirtyComponents_;
     /// Mutex for the delayed dirty notification queue.
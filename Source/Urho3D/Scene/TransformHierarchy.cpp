@@ -0,0 +1,144 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+
+#include "../Precompiled.h"
+
+#include "../Core/Profiler.h"
+#include "../Core/WorkQueue.h"
+#include "../Scene/Scene.h"
+#include "../Scene/TransformHierarchy.h"
+
+#include "../DebugNew.h"
+
+namespace Urho3D
+{
+
+TransformHierarchy::TransformHierarchy(Scene* scene)
+    : scene_(scene)
+{
+}
+
+void TransformHierarchy::Update(WorkQueue* workQueue)
+{
+    URHO3D_PROFILE("UpdateWorldTransforms");
+
+    if (structureDirty_)
+        Rebuild();
+
+    CollectDirtyRanges();
+    if (dirtyRanges_.empty())
+        return;
+
+    workQueue->ParallelFor(dirtyRanges_.size(), 1, [this](unsigned beginIndex, unsigned endIndex, unsigned /*threadIndex*/)
+    {
+        for (unsigned i = beginIndex; i < endIndex; ++i)
+            UpdateSubtree(dirtyRanges_[i].first, dirtyRanges_[i].second);
+    });
+}
+
+void TransformHierarchy::Rebuild()
+{
+    nodes_.clear();
+    parentIndices_.clear();
+    subtreeEnds_.clear();
+
+    for (Node* child : scene_->GetChildren())
+        AddSubtree(child, M_MAX_UNSIGNED);
+
+    worldTransforms_.resize(nodes_.size());
+    worldRotations_.resize(nodes_.size());
+    structureDirty_ = false;
+}
+
+void TransformHierarchy::AddSubtree(Node* node, unsigned parentIndex)
+{
+    const unsigned index = nodes_.size();
+    nodes_.push_back(node);
+    parentIndices_.push_back(parentIndex);
+    subtreeEnds_.push_back(index + 1);
+
+    for (Node* child : node->GetChildren())
+        AddSubtree(child, index);
+
+    subtreeEnds_[index] = nodes_.size();
+}
+
+void TransformHierarchy::CollectDirtyRanges()
+{
+    dirtyRanges_.clear();
+    numUpdatedNodes_ = 0;
+
+    // Children of dirty node are always dirty, so the whole subtree is skipped
+    const unsigned numNodes = nodes_.size();
+    unsigned index = 0;
+    while (index < numNodes)
+    {
+        if (nodes_[index]->dirty_)
+        {
+            dirtyRanges_.emplace_back(index, subtreeEnds_[index]);
+            numUpdatedNodes_ += subtreeEnds_[index] - index;
+            index = subtreeEnds_[index];
+        }
+        else
+            ++index;
+    }
+}
+
+void TransformHierarchy::UpdateSubtree(unsigned beginIndex, unsigned endIndex)
+{
+    // Parent of the subtree root is not dirty, take its transform from the node
+    {
+        Node* node = nodes_[beginIndex];
+        const unsigned parentIndex = parentIndices_[beginIndex];
+        if (parentIndex == M_MAX_UNSIGNED)
+        {
+            worldTransforms_[beginIndex] = node->GetTransform();
+            worldRotations_[beginIndex] = node->rotation_;
+        }
+        else
+        {
+            const Node* parent = nodes_[parentIndex];
+            worldTransforms_[beginIndex] = parent->worldTransform_ * node->GetTransform();
+            worldRotations_[beginIndex] = parent->worldRotation_ * node->rotation_;
+        }
+    }
+
+    // Parents of other nodes are within the subtree and already updated
+    for (unsigned index = beginIndex + 1; index < endIndex; ++index)
+    {
+        const Node* node = nodes_[index];
+        const unsigned parentIndex = parentIndices_[index];
+        worldTransforms_[index] = worldTransforms_[parentIndex] * node->GetTransform();
+        worldRotations_[index] = worldRotations_[parentIndex] * node->rotation_;
+    }
+
+    for (unsigned index = beginIndex; index < endIndex; ++index)
+    {
+        Node* node = nodes_[index];
+        node->worldTransform_ = worldTransforms_[index];
+        node->worldRotation_ = worldRotations_[index];
+        node->dirty_ = false;
+    }
+}
+
+}
@@ -0,0 +1,90 @@
+//
+// Copyright (c) 2017-2020 the rbfx project.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+
+/// \file
+
+#pragma once
+
+#include "../Core/NonCopyable.h"
+#include "../Math/Matrix3x4.h"
+#include "../Math/Quaternion.h"
+
+#include <EASTL/utility.h>
+#include <EASTL/vector.h>
+
+namespace Urho3D
+{
+
+class Node;
+class Scene;
+class WorkQueue;
+
+/// Structure-of-arrays store of the scene node hierarchy used to update world transforms in batch.
+/// Nodes are kept in hierarchy order (parents before children), so every dirty subtree is a contiguous range
+/// that is updated in one linear pass. Independent dirty subtrees are updated in parallel.
+class URHO3D_API TransformHierarchy : private NonCopyable
+{
+public:
+    /// Construct.
+    explicit TransformHierarchy(Scene* scene);
+
+    /// Mark hierarchy structure as changed. Store is rebuilt on next update.
+    void MarkStructureDirty() { structureDirty_ = true; }
+    /// Update world transforms of all dirty nodes. Must be called from the main thread.
+    void Update(WorkQueue* workQueue);
+
+    /// Return number of nodes in the store.
+    unsigned GetNumNodes() const { return nodes_.size(); }
+    /// Return number of nodes updated by the last update.
+    unsigned GetNumUpdatedNodes() const { return numUpdatedNodes_; }
+
+private:
+    /// Rebuild node arrays from the scene.
+    void Rebuild();
+    /// Append node and its children in hierarchy order.
+    void AddSubtree(Node* node, unsigned parentIndex);
+    /// Find ranges of dirty subtrees.
+    void CollectDirtyRanges();
+    /// Update world transforms of the dirty subtree.
+    void UpdateSubtree(unsigned beginIndex, unsigned endIndex);
+
+    /// Scene.
+    Scene* scene_{};
+    /// Nodes in hierarchy order.
+    ea::vector<Node*> nodes_;
+    /// Parent indices. M_MAX_UNSIGNED for children of the scene.
+    ea::vector<unsigned> parentIndices_;
+    /// Indices past the last node of the subtree for each node.
+    ea::vector<unsigned> subtreeEnds_;
+    /// World transforms.
+    ea::vector<Matrix3x4> worldTransforms_;
+    /// World rotations.
+    ea::vector<Quaternion> worldRotations_;
+    /// Dirty subtree ranges of the current update.
+    ea::vector<ea::pair<unsigned, unsigned>> dirtyRanges_;
+    /// Number of nodes updated by the last update.
+    unsigned numUpdatedNodes_{};
+    /// Whether the hierarchy structure has changed.
+    bool structureDirty_{true};
+};
+
+}
@@ -174,6 +174,12 @@ void DebugHud::RenderUI(DebugHudModeFlags mode)
         ui::SetCursorPosX(left_offset);
         ui::Text("Occluders %u", renderer->GetNumOccluders(true));
         ui::SetCursorPosX(left_offset);
+        const unsigned batchCacheHits = renderer->GetNumBatchCacheHits(true);
+        ui::Text("Batch cache %u/%u", batchCacheHits, batchCacheHits + renderer->GetNumBatchCacheMisses(true));
+        ui::SetCursorPosX(left_offset);
+        ui::Text("Frame memory %u/%u KB", (unsigned)(renderer->GetFrameAllocatorUsedSize(true) / 1024),
+            (unsigned)(renderer->GetFrameAllocatorPeakSize(true) / 1024));
+        ui::SetCursorPosX(left_offset);
 
         for (auto i = appStats_.begin(); i != appStats_.end(); ++i)
         {
@@ -49,6 +49,7 @@ namespace Urho3D
 {
 
 static const unsigned MASK_VERTEX2D = MASK_POSITION | MASK_COLOR | MASK_TEXCOORD1;
+static const unsigned CHECK_VISIBILITY_CHUNK_SIZE = 64;
 
 ViewBatchInfo2D::ViewBatchInfo2D() :
     vertexBufferUpdateFrameNumber_(0),
@@ -305,12 +306,9 @@ SharedPtr<Material> Renderer2D::CreateMaterial(Texture2D* texture, BlendMode ble
     return newMaterial;
 }
 
-void CheckDrawableVisibilityWork(const WorkItem* item, unsigned threadIndex)
+void CheckDrawableVisibilityWork(Renderer2D* renderer, Drawable2D** start, Drawable2D** end)
 {
     URHO3D_PROFILE("CheckDrawableVisibilityWork");
-    auto* renderer = reinterpret_cast<Renderer2D*>(item->aux_);
-    auto** start = reinterpret_cast<Drawable2D**>(item->start_);
-    auto** end = reinterpret_cast<Drawable2D**>(item->end_);
 
     while (start != end)
     {
@@ -341,29 +339,11 @@ void Renderer2D::HandleBeginViewUpdate(StringHash eventType, VariantMap& eventDa
         URHO3D_PROFILE("CheckDrawableVisibility");
 
         auto* queue = GetSubsystem<WorkQueue>();
-        int numWorkItems = queue->GetNumThreads() + 1; // Worker threads + main thread
-        int drawablesPerItem = drawables_.size() / numWorkItems;
-
-        auto start = drawables_.begin();
-        for (int i = 0; i < numWorkItems; ++i)
+        queue->ParallelFor(drawables_.size(), CHECK_VISIBILITY_CHUNK_SIZE,
+            [this](unsigned beginIndex, unsigned endIndex, unsigned)
         {
-            SharedPtr<WorkItem> item = queue->GetFreeItem();
-            item->priority_ = M_MAX_UNSIGNED;
-            item->workFunction_ = CheckDrawableVisibilityWork;
-            item->aux_ = this;
-
-            auto end = drawables_.end();
-            if (i < numWorkItems - 1 && end - start > drawablesPerItem)
-                end = start + drawablesPerItem;
-
-            item->start_ = &(*start);
-            item->end_ = &(*end);
-            queue->AddWorkItem(item);
-
-            start = end;
-        }
-
-        queue->Complete(M_MAX_UNSIGNED);
+            CheckDrawableVisibilityWork(this, drawables_.data() + beginIndex, drawables_.data() + endIndex);
+        });
     }
 
     ViewBatchInfo2D& viewBatchInfo = viewBatchInfos_[camera];